@@ -1,14 +1,144 @@
-#include <GL/glut.h>
+#include <GL/freeglut.h> // FreeGLUT¼glutGetProcAddress ʱؼʱѯ
+#include <stdio.h> // snprintf, sscanfʽʱϢGL汾
+#include <string.h> // strstrGLչ
+#include <chrono> // steady_clock̶ʱ䲽CPUʱ
 
 // ȫֱ
 bool isRotating = false; // ƳǷתͨ 'r'ʼת 's'ֹͣתл
-float rotationAngle = 0.0f; // ¼Χ Y ĵǰתǶ
+float rotationAngle = 0.0f; // ¼Χ Y ĵǰתǶȣһģⲽĽ
+float previousAngle = 0.0f; // һģⲽתǶȣȾʱֵ֮
 int projectionMode = 1; // ͶӰģʽ1 ʾ͸ͶӰ0 ʾͶӰ
+int windowWidth = 600, windowHeight = 600; // ǰڴСڻƼʱϢ
+
+// ̶ʱ䲽ģʱƽȾ֡޹أÿ 10 ת 0.3 ȣÿ 30 ȣ
+const double SIMULATION_STEP = 0.01; // ģⲽ룩
+const float ROTATION_PER_STEP = 0.3f; // ÿģⲽתĽǶ
+const double MAX_FRAME_TIME = 0.25; // ֡ಹʱ䣨룩ڱ϶ͣٺһ׷̫ಽ
+double simulationLag = 0.0; // Ѿȥδģʱ䣨룩
+std::chrono::steady_clock::time_point lastFrameTime; // һ֡ƽģʱ
+
+// ʱϢCPU ֡ʱ䡢GPU ʱ䣨ʱѯƵ
+bool showTimings = true; // 't' лʱϢʾ
+double cpuFrameMs = 0.0, frameIntervalMs = 0.0, gpuFrameMs = 0.0; // ָƽĺ
+int objectsDrawn = 0; // ֡лƵÿһΣglut ڲʵʻᷢ GL ãﲻĻƵ
+
+// GL 3.3 / ARB_timer_queryGPU ʱѯʱأ֧ʱֻʾ CPU ʱ
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+typedef void (APIENTRY* PfnGenQueries)(GLsizei, GLuint*);
+typedef void (APIENTRY* PfnBeginQuery)(GLenum, GLuint);
+typedef void (APIENTRY* PfnEndQuery)(GLenum);
+typedef void (APIENTRY* PfnGetQueryObjectiv)(GLuint, GLenum, GLint*);
+typedef void (APIENTRY* PfnGetQueryObjectui64v)(GLuint, GLenum, unsigned long long*);
+PfnGenQueries genQueries = NULL;
+PfnBeginQuery beginQuery = NULL;
+PfnEndQuery endQuery = NULL;
+PfnGetQueryObjectiv getQueryObjectiv = NULL;
+PfnGetQueryObjectui64v getQueryObjectui64v = NULL;
+const int TIMER_QUERIES = 4; // ѯڼ֡ſɶȡʱȴGPU
+GLuint timerQueries[TIMER_QUERIES];
+bool timerQueryPending[TIMER_QUERIES] = { false };
+int timerQueryIndex = 0;
+bool timerQueryActive = false; // ֡ǷĿʼ˲ѯʱʱܵ glEndQuery
 
 // ʼ OpenGL 
 void initializeGL() {
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f); // ɫΪɫRGBA0.1, 0.1, 0.1ȫ͸
     glEnable(GL_DEPTH_TEST); // ȲԣȷȷȾ 3D ȹϵ
+
+    // ֧ GL 3.3  ARB_timer_query ʱGPUʱѯ
+    const char* version = (const char*)glGetString(GL_VERSION);
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    int major = 1, minor = 0;
+    if (version) sscanf(version, "%d.%d", &major, &minor);
+    if (major > 3 || (major == 3 && minor >= 3) || (extensions && strstr(extensions, "GL_ARB_timer_query"))) {
+        genQueries = (PfnGenQueries)glutGetProcAddress("glGenQueries");
+        beginQuery = (PfnBeginQuery)glutGetProcAddress("glBeginQuery");
+        endQuery = (PfnEndQuery)glutGetProcAddress("glEndQuery");
+        getQueryObjectiv = (PfnGetQueryObjectiv)glutGetProcAddress("glGetQueryObjectiv");
+        getQueryObjectui64v = (PfnGetQueryObjectui64v)glutGetProcAddress("glGetQueryObjectui64v");
+    }
+    if (genQueries && beginQuery && endQuery && getQueryObjectiv && getQueryObjectui64v) genQueries(TIMER_QUERIES, timerQueries);
+    else genQueries = NULL;
+
+    lastFrameTime = std::chrono::steady_clock::now();
+}
+
+// ƽģ⣺Ѿһ֡ʱۼ̶ת֮Ĳֵ [0, 1)
+float advanceSimulation() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastFrameTime).count();
+    lastFrameTime = now;
+    simulationLag += elapsed < MAX_FRAME_TIME ? elapsed : MAX_FRAME_TIME;
+    while (simulationLag >= SIMULATION_STEP) {
+        previousAngle = rotationAngle;
+        if (isRotating) rotationAngle += ROTATION_PER_STEP;
+        if (rotationAngle >= 360.0f) { // ֽǶһȦڣⳤʱк󸡵㾫½
+            rotationAngle -= 360.0f;
+            previousAngle -= 360.0f;
+        }
+        simulationLag -= SIMULATION_STEP;
+    }
+    return isRotating ? (float)(simulationLag / SIMULATION_STEP) : 0.0f;
+}
+
+// ȡɵGPUʱѯȴʼ֡Ĳѯ
+void beginGpuTimer() {
+    if (!genQueries) return;
+    for (int i = 0; i < TIMER_QUERIES; ++i) {
+        if (!timerQueryPending[i]) continue;
+        GLint available = 0;
+        getQueryObjectiv(timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        unsigned long long nanoseconds = 0;
+        getQueryObjectui64v(timerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+        gpuFrameMs = gpuFrameMs * 0.9 + nanoseconds * 1e-6 * 0.1;
+        timerQueryPending[i] = false;
+    }
+    if (timerQueryPending[timerQueryIndex]) return; // ֡ʱ
+    beginQuery(GL_TIME_ELAPSED, timerQueries[timerQueryIndex]);
+    timerQueryPending[timerQueryIndex] = true;
+    timerQueryActive = true;
+}
+
+// ֡GPUʱѯ֡δʼѯʱʲôҲǰ
+void endGpuTimer() {
+    if (!timerQueryActive) return;
+    endQuery(GL_TIME_ELAPSED);
+    timerQueryActive = false;
+    timerQueryIndex = (timerQueryIndex + 1) % TIMER_QUERIES;
+}
+
+// ڴ (x, y) һ
+void drawText(int x, int y, const char* text) {
+    glRasterPos2i(x, y);
+    for (const char* c = text; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+}
+
+// ϽǻƼʱϢ볡GPUʱ䣩
+void drawTimings() {
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluOrtho2D(0, windowWidth, 0, windowHeight);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glDisable(GL_DEPTH_TEST);
+    glColor3f(1.0f, 1.0f, 1.0f);
+
+    char buffer[96];
+    snprintf(buffer, sizeof(buffer), "%s, %d objects", projectionMode == 1 ? "Perspective" : "Orthographic", objectsDrawn);
+    drawText(10, windowHeight - 20, buffer);
+    snprintf(buffer, sizeof(buffer), "CPU: %.2f ms  Frame: %.2f ms", cpuFrameMs, frameIntervalMs);
+    drawText(10, windowHeight - 36, buffer);
+    if (genQueries) snprintf(buffer, sizeof(buffer), "GPU: %.2f ms", gpuFrameMs);
+    else snprintf(buffer, sizeof(buffer), "GPU: timer queries unsupported");
+    drawText(10, windowHeight - 52, buffer);
+    glEnable(GL_DEPTH_TEST);
 }
 
 // ᣨXYZΪ 3D Ĳο
@@ -19,6 +149,7 @@ void drawCoordinateAxes() {
     glVertex3f(0.0f, 0.0f, 0.0f); glVertex3f(0.0f, 6.0f, 0.0f); //  Y ᣨԭ㵽 (0, 6, 0)
     glVertex3f(0.0f, 0.0f, 0.0f); glVertex3f(0.0f, 0.0f, 6.0f); //  Z ᣨԭ㵽 (0, 0, 6)
     glEnd(); // ߶λ
+    objectsDrawn++;
 }
 
 // Ƴе 3D 塢塢
@@ -28,6 +159,7 @@ void drawObjects() {
     glColor3f(0.0f, 0.0f, 1.0f); // ɫΪɫ
     glTranslatef(-2.0f, 0.0f, -4.0f); // ƽƵ (-2, 0, -4)
     glutSolidCube(1.0f); // Ʊ߳Ϊ 1 ʵ
+    objectsDrawn++;
     glPopMatrix(); // ָģ;
 
     // Ƶڶ
@@ -35,6 +167,7 @@ void drawObjects() {
     glColor3f(1.0f, 0.0f, 0.0f); // ɫΪɫ
     glTranslatef(-2.0f, 0.0f, -6.0f); // ƽƵ (-2, 0, -6)
     glutSolidCube(1.0f); // Ʊ߳Ϊ 1 ʵ
+    objectsDrawn++;
     glPopMatrix();
 
     // Ƶһ
@@ -42,6 +175,7 @@ void drawObjects() {
     glColor3f(0.0f, 0.0f, 1.0f); // ɫΪɫ
     glTranslatef(0.0f, 0.0f, -4.0f); // ƽƵ (0, 0, -4)
     glutSolidSphere(0.7f, 20, 20); // ư뾶Ϊ 0.7 ʵ壬ϸ 20x20
+    objectsDrawn++;
     glPopMatrix();
 
     // Ƶڶ
@@ -49,6 +183,7 @@ void drawObjects() {
     glColor3f(1.0f, 0.0f, 0.0f); // ɫΪɫ
     glTranslatef(0.0f, 0.0f, -6.0f); // ƽƵ (0, 0, -6)
     glutSolidSphere(0.7f, 20, 20); // ư뾶Ϊ 0.7 ʵ壬ϸ 20x20
+    objectsDrawn++;
     glPopMatrix();
 
     // Ƶһ
@@ -56,6 +191,7 @@ void drawObjects() {
     glColor3f(0.0f, 0.0f, 1.0f); // ɫΪɫ
     glTranslatef(2.0f, 0.0f, -4.0f); // ƽƵ (2, 0, -4)
     glutSolidTeapot(0.6f); // ƳߴΪ 0.6 ʵĲ
+    objectsDrawn++;
     glPopMatrix();
 
     // Ƶڶ
@@ -63,11 +199,20 @@ void drawObjects() {
     glColor3f(1.0f, 0.0f, 0.0f); // ɫΪɫ
     glTranslatef(2.0f, 0.0f, -6.0f); // ƽƵ (2, 0, -6)
     glutSolidTeapot(0.6f); // ƳߴΪ 0.6 ʵĲ
+    objectsDrawn++;
     glPopMatrix();
 }
 
-// Ⱦ
+// ȾȰ̶ƽ֮ĲֵǶȻƣ
+// תʱÿ֡һ֡ɽĴֱͬƽֹࣩʱֻ״̬ıػ
 void displayScene() {
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+    double interval = std::chrono::duration<double, std::milli>(frameStart - lastFrameTime).count();
+    float alpha = advanceSimulation();
+    if (isRotating) frameIntervalMs = frameIntervalMs * 0.9 + interval * 0.1; // ֹʱ֡ļû
+
+    beginGpuTimer();
+    objectsDrawn = 0;
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // ɫȻ
     glMatrixMode(GL_PROJECTION); // õǰģʽΪͶӰ
     glLoadIdentity(); // ͶӰΪλ
@@ -84,47 +229,52 @@ void displayScene() {
     glLoadIdentity(); // ģͼΪλ
     gluLookAt(0.0f, 4.0f, 12.0f, 0.0f, 0.0f, -6.0f, 0.0f, 1.0f, 0.0f); // λ (0, 4, 12)۲ (0, 0, -6)Ϸ (0, 1, 0)
 
-    // תתǶ
-    if (isRotating) {
-        rotationAngle += 0.3f; // ÿ֡ 0.3 ȵת
-    }
-    glRotatef(rotationAngle, 0.0f, 1.0f, 0.0f); // Χ Y ת rotationAngle 
+    // Χ Y תһ뵱ǰĽǶֵ֮
+    glRotatef(previousAngle + (rotationAngle - previousAngle) * alpha, 0.0f, 1.0f, 0.0f);
 
     drawCoordinateAxes(); // 
     drawObjects(); //  3D 
+    endGpuTimer();
 
-    glutSwapBuffers(); // ǰ󻺳ʾȾ
-}
+    double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    cpuFrameMs = cpuFrameMs * 0.9 + cpuMs * 0.1;
+    if (showTimings) drawTimings();
 
-// ʱص³
-void updateScene(int value) {
-    glutPostRedisplay(); // ǴҪػ棬 displayScene
-    glutTimerFunc(10, updateScene, 0); // ÿ 10 һ updateSceneγɶѭ
+    glutSwapBuffers(); // ǰ󻺳ʾȾ
+    if (isRotating) glutPostRedisplay(); // Уһ֡
 }
 
 // Ҽ˵صлͶӰģʽ
 void projectionMenu(int option) {
+    if (projectionMode == option) return; // ģʽδ䣬ػ
     projectionMode = option; // ͶӰģʽ1: ͸ӣ0: 
     glutPostRedisplay(); // ػӦµͶӰģʽ
 }
 
-// ¼
-void handleMouse(int button, int state, int x, int y) {
-    if (button == GLUT_RIGHT_BUTTON && state == GLUT_DOWN) { // Ҽ¼
-        glutCreateMenu(projectionMenu); // Ҽ˵
-        glutAddMenuEntry("Perspective Projection", 1); // Ӳ˵͸ͶӰ
-        glutAddMenuEntry("Orthographic Projection", 0); // Ӳ˵ͶӰ
-        glutAttachMenu(GLUT_RIGHT_BUTTON); // ˵󶨵Ҽ
-    }
+// Ҽ˵ֻʱһΣ
+void createProjectionMenu() {
+    glutCreateMenu(projectionMenu); // Ҽ˵
+    glutAddMenuEntry("Perspective Projection", 1); // Ӳ˵͸ͶӰ
+    glutAddMenuEntry("Orthographic Projection", 0); // Ӳ˵ͶӰ
+    glutAttachMenu(GLUT_RIGHT_BUTTON); // ˵󶨵Ҽ
 }
 
 // ¼
 void handleKeyboard(unsigned char key, int x, int y) {
-    if (key == 'r' || key == 'R') { //  'r'  'R' ʼת
+    if ((key == 'r' || key == 'R') && !isRotating) { //  'r'  'R' ʼת
         isRotating = true;
+        lastFrameTime = std::chrono::steady_clock::now(); // ֹڼʱ䲻ģ
+        simulationLag = 0.0;
     }
-    else if (key == 's' || key == 'S') { //  's'  'S' ֹͣת
+    else if ((key == 's' || key == 'S') && isRotating) { //  's'  'S' ֹͣת
         isRotating = false;
+        previousAngle = rotationAngle; // ͣһĽǶ
+    }
+    else if (key == 't' || key == 'T') { //  't'  'T' лʱϢʾ
+        showTimings = !showTimings;
+    }
+    else {
+        return; // ״̬δ䣬ػ
     }
     glutPostRedisplay(); // ػԸ³
 }
@@ -132,6 +282,8 @@ void handleKeyboard(unsigned char key, int x, int y) {
 // ڴСص
 void reshapeWindow(int width, int height) {
     glViewport(0, 0, width, height); // ӿڴС봰ڴСһ
+    windowWidth = width;
+    windowHeight = height;
 }
 
 // 
@@ -144,9 +296,8 @@ int main(int argc, char** argv) {
     initializeGL(); // óʼ
     glutDisplayFunc(displayScene); // עȾص
     glutReshapeFunc(reshapeWindow); // עᴰڵص
-    glutMouseFunc(handleMouse); // ע¼ص
     glutKeyboardFunc(handleKeyboard); // ע¼ص
-    glutTimerFunc(0, updateScene, 0); // ʱ updateScene
+    createProjectionMenu(); // Ҽ˵лͶӰģʽ
 
     glutMainLoop(); //  GLUT ѭ¼Ⱦ
     return 0; // ʵʲִеΪ glutMainLoop أ
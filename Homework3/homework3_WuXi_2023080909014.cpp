@@ -11,23 +11,27 @@
  * 2. ɵڵָЧģ͸Ч
  * 3. ʵʱ״̬ʾԴ״̬ǿֵ
  * 4. ƣƹԴأ̵ǿ
+ * 5. 񻺴棺ʼʱ༶ϸһδVBOÿ֡ĻСŨѡ񾫶
  *
  * ʽ
  * - лɫԴ
  * - ҼлɫԴ
  * - Ϸǿ
  * - ·Сǿ
+ * - LлϸڲΣرʱ尴߾Ȼƣ
  *
  * Ҫ㣺
  * - ʹGL_LIGHT0GL_LIGHT1ʵֶԴ
  * - GL_EXPģʽЧʵȸ֪
  * - ͶӰ͸ͶӰлȾ
  * - ջʵ־ֲ任
+ * - 㻺GL 1.5 glDrawElements Ԥϸֵ
  *
  * ļṹ
- * - ʼsetupLighting(), setupFog(), initialize()
- * - ȾrenderScene(), drawText(), drawCylinder(), drawTorus()
- * - صadjustViewport(), handleKeyboard(), handleMouse()
+ * - ʼsetupLighting(), setupFog(), initMeshes(), initialize()
+ * - ɣbuildTeapot(), buildSphere(), buildCube(), buildCylinder(), buildTorus()
+ * - ȾrenderScene(), drawText(), selectLevel(), drawSceneObjects()
+ * - صadjustViewport(), handleKeyboard(), handleKeys(), handleMouse()
  * - main()
  *
  * Ҫ
@@ -40,10 +44,16 @@
 
 // Visual StudioйscanfȺİȫ
 #define _CRT_SECURE_NO_DEPRECATE
+#define _USE_MATH_DEFINES  // M_PIѧ
 
 // OpenGLGLUTͷļ
-#include <GL/glut.h>
+#include <GL/freeglut.h>  // glutGetProcAddressʱػ
 #include <stdio.h>
+#include <stddef.h>       // ptrdiff_tС
+#include <math.h>         // sinf, cosf, exp, acosLODѡ
+#include <vector>         // 񶥵
+#include <utility>        // std::swapת
+#include "../common/simd_math.h"  // ѧģ飺Vec3߹һΧ Mat4ͼLODȣ
 
 // ȫֱ
 bool redLightOn = true;      // ɫԴ״̬
@@ -97,19 +107,410 @@ void drawText(float x, float y, const char* text) {
     }
 }
 
-// Բ庯
-void drawCylinder(float baseRadius, float topRadius, float height, int slices, int stacks) {
-    // 
-    GLUquadricObj* quadric = gluNewQuadric();
-    gluQuadricDrawStyle(quadric, GLU_FILL);    // ûģʽΪ
-    gluQuadricNormals(quadric, GLU_SMOOTH);    // ÷Ϊƽģʽ
-    gluCylinder(quadric, baseRadius, topRadius, height, slices, stacks); // Բ
-    gluDeleteQuadric(quadric);  // ɾͷڴ
+// ---- 񻺴ϸڲΣLOD ----
+// ÿּڳʼʱ LOD_LEVELS ȸϸһΣ㣨+λãVBO
+// ÿֻ֡ĻϵĴСŨΪÿѡһƣظϸֻ򴴽
+// ѡ뱳ı߽磩ƫʵ治 LOD_SILHOUETTE_ERROR أ
+// Ҫα߳ LOD_SHADING_EDGE أԽŨԽСı߳ɼȷŴ
+// ɫɫͬȫסһɫӰԲ޳ֻرչհȻ
+#define LOD_LEVELS 4                             // ÿϸּ0ϸ
+#define LOD_SILHOUETTE_ERROR 1.0f                // ƫأ
+#define LOD_SHADING_EDGE 8.0f                    // ʱα߳ޣأ
+#define FOG_HIDDEN_VISIBILITY (0.5f / 255.0f)    // ɼȵڴֵʱɫ8λɫͬ
+#define FIELD_OF_VIEW 50.0                       // ֱӳǣȣͶӰһ
+#define NEAR_PLANE 0.5                           // ü
+
+// 񶥵㣺 GL_N3F_V3F ʽһ
+struct MeshVertex {
+    GLfloat normal[3];
+    GLfloat position[3];
+};
+
+// һϸڹ/еλ
+struct MeshLevel {
+    int segments;          // һܵķֶڹƸü
+    GLsizei firstVertex;   // ʼ㣨ڴ˶㣩
+    GLsizei firstIndex;    // ʼ
+    GLsizei indexCount;    //  x 3
+};
+
+// һּȫϸּ
+struct Mesh {
+    int levelCount;
+    MeshLevel levels[LOD_LEVELS];
+    GLfloat radius;        // ģԭΪĵİΧ뾶
+};
+
+enum { MESH_TEAPOT, MESH_SPHERE, MESH_CUBE, MESH_CYLINDER, MESH_TORUS, MESH_COUNT };
+
+// еһ壺λ볯Լ֡ѡеϸּ
+struct SceneObject {
+    int mesh;
+    GLfloat position[3];
+    GLfloat angle;         // XתĽǶȣȣ
+    int level;             // ֡Ƶϸּ
+    bool hidden;           // ֡ȫڵֻɫӰ
+};
+
+Mesh meshes[MESH_COUNT];
+std::vector<MeshVertex> meshVertices;  // мĶ㣨ϴVBOΪͻĺ󱸣
+std::vector<GLushort> meshIndices;     // м
+GLuint meshVBO = 0, meshIBO = 0;       // 壬GL 1.5 Ϊ0
+bool lodEnabled = true;                // Lлرʱ嶼0Ʋ
+int frameTriangles = 0;                // һ֡Ƶ
+
+// ԭ glutSolidTeapot/glutSolidSphere/glutSolidCube/gluCylinder/glutSolidTorus ͬİڷ
+SceneObject sceneObjects[] = {
+    { MESH_TEAPOT,   {  4.0f, 0.0f,  4.0f },   0.0f, 0, false },  // Ͻǣ
+    { MESH_SPHERE,   { -4.0f, 0.0f,  4.0f },   0.0f, 0, false },  // 壨Ͻǣ
+    { MESH_CUBE,     {  0.0f, 0.0f,  9.0f },   0.0f, 0, false },  // 壨мλã
+    { MESH_CYLINDER, { -4.0f, 0.0f, -4.0f }, -90.0f, 0, false },  // Բ壨½ǣXת-90ʹֱ
+    { MESH_TORUS,    {  4.0f, 0.0f, -4.0f },  45.0f, 0, false },  // Բ壨½ǣXת45
+};
+const int SCENE_OBJECT_COUNT = sizeof(sceneObjects) / sizeof(sceneObjects[0]);
+
+// GL 1.5 ʱأ֧ʱ˻ؿͻ˶
+// Windows Դ gl.h ֻ GL 1.1ûЩ
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW 0x88E4
+#endif
+typedef void (APIENTRY* PfnGenBuffers)(GLsizei, GLuint*);
+typedef void (APIENTRY* PfnBindBuffer)(GLenum, GLuint);
+typedef void (APIENTRY* PfnBufferData)(GLenum, ptrdiff_t, const void*, GLenum);
+PfnGenBuffers genBuffers = NULL;
+PfnBindBuffer bindBuffer = NULL;
+PfnBufferData bufferData = NULL;
+
+// BezierƵ㣨Zϣ freeglut ʹõֻͬ x>=0y<=0 ķ֮һɾõ
+const GLfloat teapotControlPoints[][3] = {
+    { 1.4f, 0.0f, 2.4f }, { 1.4f, -0.784f, 2.4f }, { 0.784f, -1.4f, 2.4f }, { 0.0f, -1.4f, 2.4f },
+    { 1.3375f, 0.0f, 2.53125f }, { 1.3375f, -0.749f, 2.53125f }, { 0.749f, -1.3375f, 2.53125f }, { 0.0f, -1.3375f, 2.53125f },
+    { 1.4375f, 0.0f, 2.53125f }, { 1.4375f, -0.805f, 2.53125f }, { 0.805f, -1.4375f, 2.53125f }, { 0.0f, -1.4375f, 2.53125f },
+    { 1.5f, 0.0f, 2.4f }, { 1.5f, -0.84f, 2.4f }, { 0.84f, -1.5f, 2.4f }, { 0.0f, -1.5f, 2.4f },
+    { 1.75f, 0.0f, 1.875f }, { 1.75f, -0.98f, 1.875f }, { 0.98f, -1.75f, 1.875f }, { 0.0f, -1.75f, 1.875f },
+    { 2.0f, 0.0f, 1.35f }, { 2.0f, -1.12f, 1.35f }, { 1.12f, -2.0f, 1.35f }, { 0.0f, -2.0f, 1.35f },
+    { 2.0f, 0.0f, 0.9f }, { 2.0f, -1.12f, 0.9f }, { 1.12f, -2.0f, 0.9f }, { 0.0f, -2.0f, 0.9f },
+    { 2.0f, 0.0f, 0.45f }, { 2.0f, -1.12f, 0.45f }, { 1.12f, -2.0f, 0.45f }, { 0.0f, -2.0f, 0.45f },
+    { 1.5f, 0.0f, 0.225f }, { 1.5f, -0.84f, 0.225f }, { 0.84f, -1.5f, 0.225f }, { 0.0f, -1.5f, 0.225f },
+    { 1.5f, 0.0f, 0.15f }, { 1.5f, -0.84f, 0.15f }, { 0.84f, -1.5f, 0.15f }, { 0.0f, -1.5f, 0.15f },
+    { 0.0f, 0.0f, 3.15f }, { 0.0f, -0.002f, 3.15f }, { 0.002f, 0.0f, 3.15f }, { 0.8f, 0.0f, 3.15f },
+    { 0.8f, -0.45f, 3.15f }, { 0.45f, -0.8f, 3.15f }, { 0.0f, -0.8f, 3.15f }, { 0.0f, 0.0f, 2.85f },
+    { 0.2f, 0.0f, 2.7f }, { 0.2f, -0.112f, 2.7f }, { 0.112f, -0.2f, 2.7f }, { 0.0f, -0.2f, 2.7f },
+    { 0.4f, 0.0f, 2.55f }, { 0.4f, -0.224f, 2.55f }, { 0.224f, -0.4f, 2.55f }, { 0.0f, -0.4f, 2.55f },
+    { 1.3f, 0.0f, 2.55f }, { 1.3f, -0.728f, 2.55f }, { 0.728f, -1.3f, 2.55f }, { 0.0f, -1.3f, 2.55f },
+    { 1.3f, 0.0f, 2.4f }, { 1.3f, -0.728f, 2.4f }, { 0.728f, -1.3f, 2.4f }, { 0.0f, -1.3f, 2.4f },
+    { 0.0f, 0.0f, 0.0f }, { 0.0f, -1.425f, 0.0f }, { 0.798f, -1.425f, 0.0f }, { 1.425f, -0.798f, 0.0f },
+    { 1.425f, 0.0f, 0.0f }, { 0.0f, -1.5f, 0.075f }, { 0.84f, -1.5f, 0.075f }, { 1.5f, -0.84f, 0.075f },
+    { 1.5f, 0.0f, 0.075f }, { -1.6f, 0.0f, 2.025f }, { -1.6f, -0.3f, 2.025f }, { -1.5f, -0.3f, 2.25f },
+    { -1.5f, 0.0f, 2.25f }, { -2.3f, 0.0f, 2.025f }, { -2.3f, -0.3f, 2.025f }, { -2.5f, -0.3f, 2.25f },
+    { -2.5f, 0.0f, 2.25f }, { -2.7f, 0.0f, 2.025f }, { -2.7f, -0.3f, 2.025f }, { -3.0f, -0.3f, 2.25f },
+    { -3.0f, 0.0f, 2.25f }, { -2.7f, 0.0f, 1.8f }, { -2.7f, -0.3f, 1.8f }, { -3.0f, -0.3f, 1.8f },
+    { -3.0f, 0.0f, 1.8f }, { -2.7f, 0.0f, 1.575f }, { -2.7f, -0.3f, 1.575f }, { -3.0f, -0.3f, 1.35f },
+    { -3.0f, 0.0f, 1.35f }, { -2.5f, 0.0f, 1.125f }, { -2.5f, -0.3f, 1.125f }, { -2.65f, -0.3f, 0.9375f },
+    { -2.65f, 0.0f, 0.9375f }, { -2.0f, 0.0f, 0.9f }, { -2.0f, -0.3f, 0.9f }, { -1.9f, -0.3f, 0.6f },
+    { -1.9f, 0.0f, 0.6f }, { 1.7f, 0.0f, 1.425f }, { 1.7f, -0.66f, 1.425f }, { 1.7f, -0.66f, 0.6f },
+    { 1.7f, 0.0f, 0.6f }, { 2.6f, 0.0f, 1.425f }, { 2.6f, -0.66f, 1.425f }, { 3.1f, -0.66f, 0.825f },
+    { 3.1f, 0.0f, 0.825f }, { 2.3f, 0.0f, 2.1f }, { 2.3f, -0.25f, 2.1f }, { 2.4f, -0.25f, 2.025f },
+    { 2.4f, 0.0f, 2.025f }, { 2.7f, 0.0f, 2.4f }, { 2.7f, -0.25f, 2.4f }, { 3.3f, -0.25f, 2.4f },
+    { 3.3f, 0.0f, 2.4f }, { 2.8f, 0.0f, 2.475f }, { 2.8f, -0.25f, 2.475f }, { 3.525f, -0.25f, 2.49375f },
+    { 3.525f, 0.0f, 2.49375f }, { 2.9f, 0.0f, 2.475f }, { 2.9f, -0.15f, 2.475f }, { 3.45f, -0.15f, 2.5125f },
+    { 3.45f, 0.0f, 2.5125f }, { 2.8f, 0.0f, 2.4f }, { 2.8f, -0.15f, 2.4f }, { 3.2f, -0.15f, 2.4f },
+    { 3.2f, 0.0f, 2.4f },
+};
+
+// 10˫Ƭÿ16Ƶ㣬4x40-5ΪءǡףZ᾵Ϊ4ݣ6-9Ϊ죬YΪ2
+const int teapotPatches[10][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27 },
+    { 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39 },
+    { 40, 41, 42, 40, 43, 44, 45, 46, 47, 47, 47, 47, 48, 49, 50, 51 },
+    { 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63 },
+    { 64, 64, 64, 64, 65, 66, 67, 68, 69, 70, 71, 72, 39, 38, 37, 36 },
+    { 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88 },
+    { 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100 },
+    { 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116 },
+    { 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127, 128 },};
+
+// ʼ¼һϸ֣ظü¼֮׷ӵĶһ
+MeshLevel* beginMeshLevel(int mesh, int segments) {
+    MeshLevel* level = &meshes[mesh].levels[meshes[mesh].levelCount++];
+    level->segments = segments;
+    level->firstVertex = (GLsizei)meshVertices.size();
+    level->firstIndex = (GLsizei)meshIndices.size();
+    return level;
 }
 
-// Բ庯
-void drawTorus(float innerRadius, float outerRadius, int sides, int rings) {
-    glutSolidTorus(innerRadius, outerRadius, sides, rings); // ʹGLUTúʵԲ
+// һϸ֣¼öİΧ뾶
+void endMeshLevel(int mesh, MeshLevel* level) {
+    level->indexCount = (GLsizei)meshIndices.size() - level->firstIndex;
+    for (size_t i = level->firstVertex; i < meshVertices.size(); ++i) {
+        const GLfloat* p = meshVertices[i].position;
+        GLfloat r = Vec3(p[0], p[1], p[2]).length();
+        if (r > meshes[mesh].radius) meshes[mesh].radius = r;
+    }
+}
+
+// ׷һ㣨߻ᱻһ
+void addVertex(GLfloat nx, GLfloat ny, GLfloat nz, GLfloat x, GLfloat y, GLfloat z) {
+    Vec3 n = Vec3(nx, ny, nz).normalize();  // ֲ
+    MeshVertex v = { { n.x, n.y, n.z }, { x, y, z } };
+    meshVertices.push_back(v);
+}
+
+// Ϊ (rows+1) x (columns+1) Ĺ򶥵׷base Ϊ׶ڱı
+void addGridIndices(const MeshLevel* level, int rows, int columns, bool flip) {
+    int base = (int)meshVertices.size() - (rows + 1) * (columns + 1) - level->firstVertex;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < columns; ++j) {
+            GLushort a = (GLushort)(base + i * (columns + 1) + j), b = (GLushort)(a + columns + 1);
+            GLushort quad[6] = { a, b, (GLushort)(a + 1), (GLushort)(a + 1), b, (GLushort)(b + 1) };
+            if (flip) { std::swap(quad[1], quad[2]); std::swap(quad[4], quad[5]); }
+            meshIndices.insert(meshIndices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// Bernstein䵼
+void bernstein(float t, float b[4], float db[4]) {
+    float s = 1.0f - t;
+    b[0] = s * s * s; b[1] = 3.0f * t * s * s; b[2] = 3.0f * t * t * s; b[3] = t * t * t;
+    db[0] = -3.0f * s * s; db[1] = 3.0f * s * s - 6.0f * t * s; db[2] = 6.0f * t * s - 3.0f * t * t; db[3] = 3.0f * t * t;
+}
+
+//  (u, v) Ƭλƫ
+void evaluatePatch(const GLfloat control[16][3], float u, float v, float p[3], float du[3], float dv[3]) {
+    float bu[4], dbu[4], bv[4], dbv[4];
+    bernstein(u, bu, dbu);
+    bernstein(v, bv, dbv);
+    for (int k = 0; k < 3; ++k) {
+        p[k] = du[k] = dv[k] = 0.0f;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j) {
+                float c = control[i * 4 + j][k];
+                p[k] += bu[i] * bv[j] * c;
+                du[k] += dbu[i] * bv[j] * c;
+                dv[k] += bu[i] * dbv[j] * c;
+            }
+    }
+}
+
+// ÿƬϸΪ subdivisions x subdivisions ıΣ
+//  glutSolidTeapot(size) ͬ 0.5*size1.575ߵһ룩ʹԭ㣬Xת-90ʹڳϣYᣩ
+void buildTeapot(int subdivisions, float size) {
+    MeshLevel* level = beginMeshLevel(MESH_TEAPOT, subdivisions * 4);
+    float scale = 0.5f * size;
+    for (int patch = 0; patch < 10; ++patch) {
+        int copies = patch < 6 ? 4 : 2;
+        for (int copy = 0; copy < copies; ++copy) {
+            float sx = patch < 6 && (copy & 1) ? -1.0f : 1.0f;
+            float sy = (patch < 6 ? (copy & 2) : copy) ? -1.0f : 1.0f;
+            bool mirrored = sx * sy < 0.0f;  // ξᷭתƬĳ
+            GLfloat control[16][3];
+            for (int i = 0; i < 16; ++i) {
+                const GLfloat* c = teapotControlPoints[teapotPatches[patch][i]];
+                control[i][0] = c[0] * sx;
+                control[i][1] = c[1] * sy;
+                control[i][2] = c[2];
+            }
+            for (int i = 0; i <= subdivisions; ++i) {
+                for (int j = 0; j <= subdivisions; ++j) {
+                    float u = (float)i / subdivisions, v = (float)j / subdivisions, p[3], du[3], dv[3];
+                    evaluatePatch(control, u, v, p, du, dv);
+                    float n[3] = { du[1] * dv[2] - du[2] * dv[1], du[2] * dv[0] - du[0] * dv[2], du[0] * dv[1] - du[1] * dv[0] };
+                    if (n[0] * n[0] + n[1] * n[1] + n[2] * n[2] < 1e-12f) {
+                        // ˻㣨ǶˡģƬڲŲһ
+                        float q[3], eu[3], ev[3];
+                        evaluatePatch(control, u < 0.5f ? u + 0.001f : u - 0.001f, v, q, eu, ev);
+                        n[0] = eu[1] * ev[2] - eu[2] * ev[1]; n[1] = eu[2] * ev[0] - eu[0] * ev[2]; n[2] = eu[0] * ev[1] - eu[1] * ev[0];
+                    }
+                    if (mirrored) { n[0] = -n[0]; n[1] = -n[1]; n[2] = -n[2]; }
+                    // Xת-90ȣ(x, y, z) -> (x, z, -y)
+                    addVertex(-n[0], -n[2], n[1], p[0] * scale, (p[2] - 1.575f) * scale, -p[1] * scale);
+                }
+            }
+            addGridIndices(level, subdivisions, subdivisions, !mirrored);
+        }
+    }
+    endMeshLevel(MESH_TEAPOT, level);
+}
+
+// 壺 glutSolidSphere ͬZϣslices ΪȷֶΡstacks Ϊγȷֶ
+void buildSphere(float radius, int slices, int stacks) {
+    MeshLevel* level = beginMeshLevel(MESH_SPHERE, slices);
+    for (int i = 0; i <= stacks; ++i) {
+        float theta = (float)M_PI * i / stacks;
+        for (int j = 0; j <= slices; ++j) {
+            float phi = 2.0f * (float)M_PI * j / slices;
+            float x = cosf(phi) * sinf(theta), y = sinf(phi) * sinf(theta), z = cosf(theta);
+            addVertex(x, y, z, x * radius, y * radius, z * radius);
+        }
+    }
+    addGridIndices(level, stacks, slices, false);
+    endMeshLevel(MESH_SPHERE, level);
+}
+
+// 壺 glutSolidCube ͬԭ㡢ÿ淨ߺ㶨ֻһ
+void buildCube(float size) {
+    MeshLevel* level = beginMeshLevel(MESH_CUBE, 4);
+    float h = size * 0.5f;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            float n[3] = { 0.0f, 0.0f, 0.0f };
+            n[axis] = (float)sign;
+            int u = (axis + 1) % 3, v = (axis + 2) % 3;  // ڵ
+            for (int i = 0; i <= 1; ++i) {
+                for (int j = 0; j <= 1; ++j) {
+                    float p[3];
+                    p[axis] = h * sign;
+                    p[u] = i ? h : -h;
+                    p[v] = j ? h : -h;
+                    addVertex(n[0], n[1], n[2], p[0], p[1], p[2]);
+                }
+            }
+            addGridIndices(level, 1, 1, sign < 0);
+        }
+    }
+    endMeshLevel(MESH_CUBE, level);
+}
+
+// Բ棺 gluCylinder ͬZ0 height˵ĵ
+void buildCylinder(float baseRadius, float topRadius, float height, int slices, int stacks) {
+    MeshLevel* level = beginMeshLevel(MESH_CYLINDER, slices);
+    float nz = (baseRadius - topRadius) / height;
+    for (int i = 0; i <= stacks; ++i) {
+        float t = (float)i / stacks, r = baseRadius + (topRadius - baseRadius) * t;
+        for (int j = 0; j <= slices; ++j) {
+            float a = 2.0f * (float)M_PI * j / slices;
+            addVertex(sinf(a), cosf(a), nz, sinf(a) * r, cosf(a) * r, height * t);
+        }
+    }
+    addGridIndices(level, stacks, slices, true);
+    endMeshLevel(MESH_CYLINDER, level);
+}
+
+// Բ glutSolidTorus ͬλXYƽ棬innerRadius Ϊܰ뾶outerRadius Ϊ߰뾶
+void buildTorus(float innerRadius, float outerRadius, int sides, int rings) {
+    MeshLevel* level = beginMeshLevel(MESH_TORUS, rings);
+    for (int i = 0; i <= rings; ++i) {
+        float phi = 2.0f * (float)M_PI * i / rings;
+        for (int j = 0; j <= sides; ++j) {
+            float theta = 2.0f * (float)M_PI * j / sides;
+            float nx = cosf(phi) * cosf(theta), ny = sinf(phi) * cosf(theta), nz = sinf(theta);
+            float r = outerRadius + innerRadius * cosf(theta);
+            addVertex(nx, ny, nz, cosf(phi) * r, sinf(phi) * r, innerRadius * nz);
+        }
+    }
+    addGridIndices(level, rings, sides, false);
+    endMeshLevel(MESH_TORUS, level);
+}
+
+// ϸ0ԭÿ֡Ƶľ֧ͬ GL 1.5 ʱϴ/
+void initMeshes() {
+    static const int teapotLevels[LOD_LEVELS] = { 7, 5, 3, 2 };
+    static const int sphereLevels[LOD_LEVELS] = { 30, 18, 12, 6 };
+    static const int cylinderSlices[LOD_LEVELS] = { 30, 18, 12, 6 }, cylinderStacks[LOD_LEVELS] = { 15, 6, 2, 1 };
+    static const int torusSides[LOD_LEVELS] = { 25, 15, 10, 6 }, torusRings[LOD_LEVELS] = { 35, 21, 14, 8 };
+    for (int i = 0; i < LOD_LEVELS; ++i) {
+        buildTeapot(teapotLevels[i], 1.5f);
+        buildSphere(1.8f, sphereLevels[i], sphereLevels[i]);
+        buildCylinder(1.2f, 1.2f, 2.5f, cylinderSlices[i], cylinderStacks[i]);
+        buildTorus(0.6f, 1.6f, torusSides[i], torusRings[i]);
+    }
+    buildCube(2.2f);
+
+    int major = 1, minor = 0;
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (version) sscanf(version, "%d.%d", &major, &minor);
+    if (major > 1 || minor >= 5) {
+        genBuffers = (PfnGenBuffers)glutGetProcAddress("glGenBuffers");
+        bindBuffer = (PfnBindBuffer)glutGetProcAddress("glBindBuffer");
+        bufferData = (PfnBufferData)glutGetProcAddress("glBufferData");
+    }
+    if (genBuffers && bindBuffer && bufferData) {
+        genBuffers(1, &meshVBO);
+        genBuffers(1, &meshIBO);
+        bindBuffer(GL_ARRAY_BUFFER, meshVBO);
+        bufferData(GL_ARRAY_BUFFER, (ptrdiff_t)(meshVertices.size() * sizeof(MeshVertex)), meshVertices.data(), GL_STATIC_DRAW);
+        bindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshIBO);
+        bufferData(GL_ELEMENT_ARRAY_BUFFER, (ptrdiff_t)(meshIndices.size() * sizeof(GLushort)), meshIndices.data(), GL_STATIC_DRAW);
+        bindBuffer(GL_ARRAY_BUFFER, 0);
+        bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        std::vector<MeshVertex>().swap(meshVertices);  // Դ
+        std::vector<GLushort>().swap(meshIndices);
+    }
+}
+
+// Ϊѡ֡ϸּview Ϊͼ
+// ΧͶӰĻϵİ뾶 R أn εƫԼΪ R*(1-cos(pi/n))߳ԼΪ 2*pi*R/n
+// Χȼɼ exp(-density*depth)֮С
+// ȫеֻɫӰֱһ
+void selectLevel(SceneObject& object, const Mat4& view) {
+    const Mesh& mesh = meshes[object.mesh];
+    const GLfloat* p = object.position;
+    double depth = -view.transformPoint(Vec3(p[0], p[1], p[2])).z;
+    double nearest = depth - mesh.radius;
+    object.level = 0;
+    object.hidden = false;
+    if (!lodEnabled || nearest <= NEAR_PLANE) return;  // ʱ߾
+
+    double visibility = exp(-fogIntensity * nearest);
+    object.hidden = visibility < FOG_HIDDEN_VISIBILITY;
+    if (object.hidden) {
+        object.level = mesh.levelCount - 1;
+        return;
+    }
+    double pixelRadius = mesh.radius * (screenHeight * 0.5) / (tan(FIELD_OF_VIEW * M_PI / 360.0) * depth);
+    double needed = 2.0 * M_PI * pixelRadius * visibility / LOD_SHADING_EDGE;
+    if (pixelRadius > LOD_SILHOUETTE_ERROR) {
+        double silhouette = M_PI / acos(1.0 - LOD_SILHOUETTE_ERROR / pixelRadius);
+        if (silhouette > needed) needed = silhouette;
+    }
+    for (int i = mesh.levelCount - 1; i > 0; --i) {  // Ҫһ
+        if (mesh.levels[i].segments >= needed) {
+            object.level = i;
+            return;
+        }
+    }
+}
+
+// Ƴе壺ÿһ glDrawElements
+void drawSceneObjects(const Mat4& view) {
+    GLfloat fogColor[4];
+    glGetFloatv(GL_FOG_COLOR, fogColor);
+
+    const char* vertexBase = meshVBO ? NULL : (const char*)meshVertices.data();
+    const char* indexBase = meshIBO ? NULL : (const char*)meshIndices.data();
+    if (meshVBO) {
+        bindBuffer(GL_ARRAY_BUFFER, meshVBO);
+        bindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshIBO);
+    }
+    frameTriangles = 0;
+    for (int i = 0; i < SCENE_OBJECT_COUNT; ++i) {
+        SceneObject& object = sceneObjects[i];
+        selectLevel(object, view);
+        const MeshLevel& level = meshes[object.mesh].levels[object.level];
+        if (object.hidden) {
+            // ȫУսɼֱɫƼӰ
+            glDisable(GL_LIGHTING);
+            glColor3fv(fogColor);
+        }
+        glPushMatrix();
+        glTranslatef(object.position[0], object.position[1], object.position[2]);
+        if (object.angle != 0.0f) glRotatef(object.angle, 1.0f, 0.0f, 0.0f);
+        glInterleavedArrays(GL_N3F_V3F, 0, vertexBase + level.firstVertex * sizeof(MeshVertex));  // VBOʱָΪƫ
+        glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_SHORT, indexBase + level.firstIndex * sizeof(GLushort));
+        glPopMatrix();
+        if (object.hidden) glEnable(GL_LIGHTING);
+        frameTriangles += level.indexCount / 3;
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);  // glInterleavedArrays õ
+    glDisableClientState(GL_NORMAL_ARRAY);
+    if (meshVBO) {
+        bindBuffer(GL_ARRAY_BUFFER, 0);
+        bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
 }
 
 // Ⱦ
@@ -119,12 +520,11 @@ void renderScene() {
 
     // лģͼģʽ
     glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();  // ģͼ
 
-    // λúӽ
-    gluLookAt(12.0, 10.0, 12.0,  // λ (x,y,z)
-        0.0, 0.0, 0.0,     // ۲λ
-        0.0, 1.0, 0.0);    // Ϸ
+    // λ (12, 10, 12)ԭ㣬ϷΪY᣻
+    // ͼCPUϼ㣨 gluLookAt ͬ룬LODѡֱʹãٴGL
+    Mat4 view = Mat4::lookAt(Vec3(12.0f, 10.0f, 12.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+    glLoadMatrixf(view.m);
 
     // ݿ״̬ƺɫԴ
     glEnable(GL_LIGHT0);
@@ -134,37 +534,8 @@ void renderScene() {
     glEnable(GL_LIGHT1);
     if (!blueLightOn) glDisable(GL_LIGHT1);
 
-    // ƲϽǣ
-    glPushMatrix();                     // 浱ǰ״̬
-    glTranslatef(4.0f, 0.0f, 4.0f);    // ƽƵָλ
-    glutSolidTeapot(1.5f);             // ƴСΪ1.5Ĳ
-    glPopMatrix();                      // ָ֮ǰľ״̬
-
-    // 壨Ͻǣ
-    glPushMatrix();
-    glTranslatef(-4.0f, 0.0f, 4.0f);
-    glutSolidSphere(1.8f, 30, 30);     // 壬30ȷֶΣ30γȷֶ
-    glPopMatrix();
-
-    // 壨мλã
-    glPushMatrix();
-    glTranslatef(0.0f, 0.0f, 9.0f);    // ƶZԶλ
-    glutSolidCube(2.2f);               // Ʊ߳Ϊ2.2
-    glPopMatrix();
-
-    // Բ壨½ǣ
-    glPushMatrix();
-    glTranslatef(-4.0f, 0.0f, -4.0f);
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f); // Xת-90ȣʹԲֱ
-    drawCylinder(1.2f, 1.2f, 2.5f, 30, 15); // Բ壨뾶뾶߶ȣֶ
-    glPopMatrix();
-
-    // Բ壨½ǣ
-    glPushMatrix();
-    glTranslatef(4.0f, 0.0f, -4.0f);
-    glRotatef(45.0f, 1.0f, 0.0f, 0.0f); // Xת45
-    drawTorus(0.6f, 1.6f, 25, 35);     // Բڰ뾶뾶
-    glPopMatrix();
+    // Ʋ塢塢ԲԲ壨Ԥϸֵÿ尴LODѡ񾫶ȣ
+    drawSceneObjects(view);
 
     // ״̬Ϣ
     glDisable(GL_LIGHTING);  // ʱùգȷɼ
@@ -194,6 +565,12 @@ void renderScene() {
     snprintf(buffer, sizeof(buffer), "Fog Intensity: %.2f", fogIntensity);
     drawText(screenWidth - 120, 20, buffer);  // ǿֵ
 
+    snprintf(buffer, sizeof(buffer), "Triangles: %d", frameTriangles);
+    drawText(screenWidth - 120, 80, buffer);  // Ʊ֡
+
+    snprintf(buffer, sizeof(buffer), "LOD: %s", lodEnabled ? "On" : "Off");
+    drawText(screenWidth - 120, 100, buffer);  // ϸڲο״̬
+
     // ָ֮ǰľ״̬
     glPopMatrix();              // ָģͼ
     glMatrixMode(GL_PROJECTION);
@@ -220,7 +597,7 @@ void adjustViewport(int width, int height) {
     glLoadIdentity();  // ͶӰ
 
     // ͸ͶӰ
-    gluPerspective(50.0, (float)width / height, 0.5, 80.0);
+    gluPerspective(FIELD_OF_VIEW, (float)width / screenHeight, NEAR_PLANE, 80.0);
 
     // лģͼģʽ
     glMatrixMode(GL_MODELVIEW);
@@ -241,6 +618,14 @@ void handleKeyboard(int key, int x, int y) {
     glutPostRedisplay();  // Ҫ»Ƴ
 }
 
+// ̰ͨ
+void handleKeys(unsigned char key, int x, int y) {
+    if (key == 'l' || key == 'L') {  // Lлϸڲ
+        lodEnabled = !lodEnabled;
+        glutPostRedisplay();
+    }
+}
+
 // 갴
 void handleMouse(int button, int state, int x, int y) {
     // ֻ갴¼
@@ -262,6 +647,7 @@ void initialize() {
     glShadeModel(GL_SMOOTH);               // ƽɫģʽ
     setupLighting();                       // ʼ
     setupFog();                            // ʼЧ
+    initMeshes();                          // ϸֲ
 }
 
 // 
@@ -285,6 +671,7 @@ int main(int argc, char** argv) {
     glutDisplayFunc(renderScene);      // ʾص
     glutReshapeFunc(adjustViewport);   // ڵص
     glutSpecialFunc(handleKeyboard);   // ̰ص
+    glutKeyboardFunc(handleKeys);      // ̰ͨص
     glutMouseFunc(handleMouse);        // 갴ص
 
     // GLUT¼ѭ
@@ -0,0 +1,264 @@
+/*
+ * simd_math.hõĴͷļѧģ飨ֻ #include赥룩
+ *
+ * - vfloatSIMD_WIDTH ·㣬-mavx2 ʱΪ8·AVX2x86-64ĬΪ4·SSEƽ̨ SIMD_WIDTH Ϊ1ֻñ·
+ * - Vec3 / Vec4 / Mat4ά4x4󣻳Ǻ㶼 constexprڱڳ
+ *   Mat4 Ĳ glLoadMatrixf / glGetFloatv(GL_MODELVIEW_MATRIX) ͬm[ * 4 + ]ֱӽ̶ߡ
+ * - 㣨SoAֱ x/y/z Уÿδ SIMD_WIDTH ĩβĲ
+ *   dotSpannormalizeSpantransformPointSpan Ӧ㣨Vec3::dotVec3::normalizeMat4::transformPoint˳ͬλһ£
+ *   normalizeSpanFast ýƵƽԼ 1e-7 ڲҪ·λһµĳϡ
+ *
+ * ΢׼common/simd_math_bench.cpp Уg++ -O2 [-mavx2] simd_math_bench.cppԱȱģ
+ * ׷ lab4  --bench micro
+ */
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cmath>  // std::sqrtһ볤
+#if defined(__SSE2__)
+#include <immintrin.h>  // SSE/AVX2 intrinsics -mavx2 8·
+#endif
+
+// ---- SIMD  ----
+
+#if defined(__AVX2__)
+#define SIMD_WIDTH 8
+typedef __m256 vfloat;
+inline vfloat vset1(float x) { return _mm256_set1_ps(x); }
+inline vfloat vload(const float* p) { return _mm256_loadu_ps(p); }
+inline void vstore(float* p, vfloat a) { _mm256_storeu_ps(p, a); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+inline vfloat vminf(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+inline vfloat vmaxf(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+inline vfloat vsqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+inline vfloat vcmpgt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline vfloat vcmpge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+inline vfloat vcmplt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline vfloat vcmple(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+inline vfloat vor(vfloat a, vfloat b) { return _mm256_or_ps(a, b); }
+inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }  // mask ? a : b
+inline int vmovemask(vfloat m) { return _mm256_movemask_ps(m); }
+inline vfloat vcmpeq(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline vfloat vlaneindex() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+inline vfloat vfloor(vfloat a) { return _mm256_floor_ps(a); }
+#elif defined(__SSE2__)
+#define SIMD_WIDTH 4
+typedef __m128 vfloat;
+inline vfloat vset1(float x) { return _mm_set1_ps(x); }
+inline vfloat vload(const float* p) { return _mm_loadu_ps(p); }
+inline void vstore(float* p, vfloat a) { _mm_storeu_ps(p, a); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+inline vfloat vminf(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+inline vfloat vmaxf(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+inline vfloat vsqrt(vfloat a) { return _mm_sqrt_ps(a); }
+inline vfloat vcmpgt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+inline vfloat vcmpge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+inline vfloat vcmplt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+inline vfloat vcmple(vfloat a, vfloat b) { return _mm_cmple_ps(a, b); }
+inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+inline vfloat vor(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline int vmovemask(vfloat m) { return _mm_movemask_ps(m); }
+inline vfloat vcmpeq(vfloat a, vfloat b) { return _mm_cmpeq_ps(a, b); }
+inline vfloat vlaneindex() { return _mm_setr_ps(0, 1, 2, 3); }
+inline vfloat vfloor(vfloat a) {  // SSE2ûfloorָضϺԸ1|a| < 2^31
+    vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+#else
+#define SIMD_WIDTH 1
+#endif
+
+//  1/sqrt(a)ӲƣԼ12λȣһţٵ y' = y * (1.5 - 0.5 * a * y * y)
+#if SIMD_WIDTH > 1
+inline vfloat vrsqrtFast(vfloat a) {
+#if defined(__AVX2__)
+    vfloat y = _mm256_rsqrt_ps(a);
+#else
+    vfloat y = _mm_rsqrt_ps(a);
+#endif
+    return vmul(y, vsub(vset1(1.5f), vmul(vmul(vset1(0.5f), a), vmul(y, y))));
+}
+#endif
+
+// 汾 vrsqrtFast ͬĹƼһţٵûSSEʱֱӼ
+inline float rsqrtFast(float a) {
+#if defined(__SSE2__)
+    float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(a)));
+    return y * (1.5f - (0.5f * a) * (y * y));
+#else
+    return 1.0f / std::sqrt(a);
+#endif
+}
+
+// ----  ----
+
+// Vec33D͵㣬λáߡɫ
+struct Vec3 {
+    float x, y, z;  // 
+    constexpr Vec3(float x = 0, float y = 0, float z = 0) : x(x), y(y), z(z) {}  // 캯Ĭ
+    // ӷ
+    constexpr Vec3 operator+(const Vec3& v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
+    // 
+    constexpr Vec3 operator-(const Vec3& v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
+    // ȡ
+    constexpr Vec3 operator-() const { return Vec3(-x, -y, -z); }
+    // ˷ * 
+    constexpr Vec3 operator*(float s) const { return Vec3(x * s, y * s, z * s); }
+    // ˷Hadamardɫϣ
+    constexpr Vec3 operator*(const Vec3& v) const { return Vec3(x * v.x, y * v.y, z * v.z); }
+    // Ԫ * Գƣ
+    friend constexpr Vec3 operator*(float s, const Vec3& v) { return v * s; }
+    // ڼǶȡͶӰ
+    constexpr float dot(const Vec3& v) const { return x * v.x + y * v.y + z * v.z; }
+    // ڼ㷨ߡֱ
+    constexpr Vec3 cross(const Vec3& v) const {
+        return Vec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
+    }
+    // һصλ
+    Vec3 normalize() const {
+        float len = std::sqrt(x * x + y * y + z * z);  // 㳤
+        return len > 0 ? *this * (1.0f / len) : *this;  // 
+    }
+    // ȼ
+    float length() const { return std::sqrt(x * x + y * y + z * z); }
+};
+
+// Vec4꣨w=1 Ϊ㣬w=0 Ϊ򣩣Ҳ RGBA ɫԴλ
+struct Vec4 {
+    float x, y, z, w;
+    constexpr Vec4(float x = 0, float y = 0, float z = 0, float w = 0) : x(x), y(y), z(z), w(w) {}
+    constexpr Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+    constexpr Vec4 operator+(const Vec4& v) const { return Vec4(x + v.x, y + v.y, z + v.z, w + v.w); }
+    constexpr Vec4 operator-(const Vec4& v) const { return Vec4(x - v.x, y - v.y, z - v.z, w - v.w); }
+    constexpr Vec4 operator*(float s) const { return Vec4(x * s, y * s, z * s, w * s); }
+    constexpr float dot(const Vec4& v) const { return x * v.x + y * v.y + z * v.z + w * v.w; }
+    constexpr Vec3 xyz() const { return Vec3(x, y, z); }
+};
+
+// Mat44x4m[ * 4 + ]
+struct Mat4 {
+    float m[16];
+    // λ
+    static constexpr Mat4 identity() { return Mat4{ { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } }; }
+    // ƽƾ
+    static constexpr Mat4 translation(const Vec3& t) { return Mat4{ { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, t.x, t.y, t.z, 1 } }; }
+    //  OpenGL ȡص16죨ͬΪ
+    static Mat4 fromArray(const float* a) {
+        Mat4 r{};
+        for (int i = 0; i < 16; ++i) r.m[i] = a[i];
+        return r;
+    }
+    // ͼ gluLookAt ͬ eye centerup ΪµϷ
+    static Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up) {
+        Vec3 f = (center - eye).normalize();
+        Vec3 s = f.cross(up).normalize();
+        Vec3 u = s.cross(f);
+        return Mat4{ { s.x, u.x, -f.x, 0, s.y, u.y, -f.y, 0, s.z, u.z, -f.z, 0, -s.dot(eye), -u.dot(eye), f.dot(eye), 1 } };
+    }
+    // ˷(*this) * bӦ b Ӧ *this
+    constexpr Mat4 operator*(const Mat4& b) const {
+        Mat4 r{};
+        for (int c = 0; c < 4; ++c)
+            for (int row = 0; row < 4; ++row)
+                r.m[c * 4 + row] = m[row] * b.m[c * 4] + m[4 + row] * b.m[c * 4 + 1] + m[8 + row] * b.m[c * 4 + 2] + m[12 + row] * b.m[c * 4 + 3];
+        return r;
+    }
+    // 任
+    constexpr Vec4 operator*(const Vec4& v) const {
+        return Vec4(m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w, m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+            m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w, m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w);
+    }
+    // 任㣨w=1͸ӳ
+    constexpr Vec3 transformPoint(const Vec3& p) const {
+        return Vec3(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12], m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+            m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]);
+    }
+    // 任w=0ƽӰ죩
+    constexpr Vec3 transformVector(const Vec3& v) const {
+        return Vec3(m[0] * v.x + m[4] * v.y + m[8] * v.z, m[1] * v.x + m[5] * v.y + m[9] * v.z, m[2] * v.x + m[6] * v.y + m[10] * v.z);
+    }
+};
+
+// ---- 㣨SoA ----
+
+// out[i] = a[i]  b[i]
+inline void dotSpan(const float* ax, const float* ay, const float* az, const float* bx, const float* by, const float* bz, float* out, int n) {
+    int i = 0;
+#if SIMD_WIDTH > 1
+    for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+        vfloat d = vadd(vadd(vmul(vload(ax + i), vload(bx + i)), vmul(vload(ay + i), vload(by + i))), vmul(vload(az + i), vload(bz + i)));
+        vstore(out + i, d);
+    }
+#endif
+    for (; i < n; ++i) out[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+}
+
+// ԭعһ n ֲ䣬 Vec3::normalize ͬ
+inline void normalizeSpan(float* x, float* y, float* z, int n) {
+    int i = 0;
+#if SIMD_WIDTH > 1
+    const vfloat zero = vset1(0.0f), one = vset1(1.0f);
+    for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+        vfloat vx = vload(x + i), vy = vload(y + i), vz = vload(z + i);
+        vfloat len = vsqrt(vadd(vadd(vmul(vx, vx), vmul(vy, vy)), vmul(vz, vz)));
+        vfloat inv = vselect(vcmpgt(len, zero), vdiv(one, len), one);
+        vstore(x + i, vmul(vx, inv));
+        vstore(y + i, vmul(vy, inv));
+        vstore(z + i, vmul(vz, inv));
+    }
+#endif
+    for (; i < n; ++i) {
+        Vec3 v = Vec3(x[i], y[i], z[i]).normalize();
+        x[i] = v.x; y[i] = v.y; z[i] = v.z;
+    }
+}
+
+// ԭؽƹһ n Ƶƽĩβñ rsqrtFastֲ䣩
+inline void normalizeSpanFast(float* x, float* y, float* z, int n) {
+    int i = 0;
+#if SIMD_WIDTH > 1
+    const vfloat zero = vset1(0.0f), one = vset1(1.0f);
+    for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+        vfloat vx = vload(x + i), vy = vload(y + i), vz = vload(z + i);
+        vfloat len2 = vadd(vadd(vmul(vx, vx), vmul(vy, vy)), vmul(vz, vz));
+        vfloat inv = vselect(vcmpgt(len2, zero), vrsqrtFast(len2), one);
+        vstore(x + i, vmul(vx, inv));
+        vstore(y + i, vmul(vy, inv));
+        vstore(z + i, vmul(vz, inv));
+    }
+#endif
+    for (; i < n; ++i) {
+        float len2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+        float inv = len2 > 0 ? rsqrtFast(len2) : 1.0f;
+        x[i] *= inv; y[i] *= inv; z[i] *= inv;
+    }
+}
+
+// þ t 任 n 㣨w=1д ox/oy/ozͬ
+inline void transformPointSpan(const Mat4& t, const float* x, const float* y, const float* z, float* ox, float* oy, float* oz, int n) {
+    int i = 0;
+#if SIMD_WIDTH > 1
+    const vfloat m0 = vset1(t.m[0]), m1 = vset1(t.m[1]), m2 = vset1(t.m[2]), m4 = vset1(t.m[4]), m5 = vset1(t.m[5]), m6 = vset1(t.m[6]);
+    const vfloat m8 = vset1(t.m[8]), m9 = vset1(t.m[9]), m10 = vset1(t.m[10]), m12 = vset1(t.m[12]), m13 = vset1(t.m[13]), m14 = vset1(t.m[14]);
+    for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+        vfloat vx = vload(x + i), vy = vload(y + i), vz = vload(z + i);
+        vstore(ox + i, vadd(vadd(vadd(vmul(m0, vx), vmul(m4, vy)), vmul(m8, vz)), m12));
+        vstore(oy + i, vadd(vadd(vadd(vmul(m1, vx), vmul(m5, vy)), vmul(m9, vz)), m13));
+        vstore(oz + i, vadd(vadd(vadd(vmul(m2, vx), vmul(m6, vy)), vmul(m10, vz)), m14));
+    }
+#endif
+    for (; i < n; ++i) {
+        Vec3 p = t.transformPoint(Vec3(x[i], y[i], z[i]));
+        ox[i] = p.x; oy[i] = p.y; oz[i] = p.z;
+    }
+}
+
+#endif
\ No newline at end of file
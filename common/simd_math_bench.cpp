@@ -0,0 +1,111 @@
+/*
+ * simd_math.h ΢׼Աȱ Vec3 / Mat4 SoA
+ *
+ * У OpenGL
+ * g++ -O2 -mavx2 -o simd_math_bench simd_math_bench.cpp   ȥ -mavx2 ʹ4·SSEģ
+ * ./simd_math_bench [quick]
+ *
+ * ʽ lab4  --bench ͬÿһJSON
+ *   {"kind":"micro","name":"normalize_span","ops":..,"ns_per_op":..,"checksum":".."}
+ * λһµӦ׼ checksum ͬnormalize_span_fast 뾫ȷһ
+ * ÿȡ REPEATS еʱ䡣
+ */
+#include "simd_math.h"
+#include <chrono>     // ߾ʱ
+#include <random>     // ̶ӵ
+#include <vector>
+#include <iostream>
+#include <algorithm>  // std::max, std::min
+#include <cstdint>    // uint64_tУ
+#include <cstdio>     // std::snprintf
+#include <cstring>    // std::strcmp
+
+const unsigned int BENCH_SEED = 1u;
+const int REPEATS = 3;
+
+// 64λFNV-1aϣ
+uint64_t fnv1a(const void* data, size_t size, uint64_t h = 1469598103934665603ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void report(const char* name, long long ops, double seconds, uint64_t checksum) {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(checksum));
+    std::cout << "{\"kind\":\"micro\",\"name\":\"" << name << "\",\"ops\":" << ops << ",\"ns_per_op\":" << seconds * 1e9 / ops
+        << ",\"checksum\":\"" << hex << "\"}" << std::endl;
+}
+
+//  body REPEATS Σʱ룩ÿǰȵ reset ָ
+template <typename Reset, typename Body>
+double bestOf(Reset reset, Body body) {
+    typedef std::chrono::high_resolution_clock Clock;
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; ++r) {
+        reset();
+        Clock::time_point t0 = Clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    bool quick = argc > 1 && std::strcmp(argv[1], "quick") == 0;
+    const int N = quick ? 1 << 16 : 1 << 20;
+    std::mt19937 g(BENCH_SEED);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // 룺N δһ N λAoS ׼ʹãSoA ʹã
+    std::vector<Vec3> a(N), b(N), result(N);
+    std::vector<float> ax(N), ay(N), az(N), bx(N), by(N), bz(N), x(N), y(N), z(N), scratch(N);
+    for (int i = 0; i < N; ++i) {
+        a[i] = Vec3(unit(g) * 4.0f, unit(g) * 4.0f, unit(g) * 4.0f);
+        b[i] = Vec3(unit(g), unit(g), unit(g)).normalize();
+        ax[i] = a[i].x; ay[i] = a[i].y; az[i] = a[i].z;
+        bx[i] = b[i].x; by[i] = b[i].y; bz[i] = b[i].z;
+    }
+    auto none = [] {};
+    auto copyA = [&] { x = ax; y = ay; z = az; };
+    auto soaChecksum = [&] {
+        for (int i = 0; i < N; ++i) result[i] = Vec3(x[i], y[i], z[i]);
+        return fnv1a(result.data(), result.size() * sizeof(Vec3));
+    };
+
+    double sec = bestOf(none, [&] { for (int i = 0; i < N; ++i) result[i] = a[i].normalize(); });
+    report("vec3_normalize", N, sec, fnv1a(result.data(), result.size() * sizeof(Vec3)));
+    sec = bestOf(copyA, [&] { normalizeSpan(x.data(), y.data(), z.data(), N); });
+    report("normalize_span", N, sec, soaChecksum());
+    sec = bestOf(copyA, [&] { normalizeSpanFast(x.data(), y.data(), z.data(), N); });
+    float maxError = 0.0f;  // ƽ뾫ȷһ׼Уͬ
+    for (int i = 0; i < N; ++i) {
+        Vec3 exact = a[i].normalize();
+        maxError = std::max(maxError, std::max(std::fabs(x[i] - exact.x), std::max(std::fabs(y[i] - exact.y), std::fabs(z[i] - exact.z))));
+    }
+    std::cout << "{\"kind\":\"micro\",\"name\":\"normalize_span_fast\",\"ops\":" << N << ",\"ns_per_op\":" << sec * 1e9 / N
+        << ",\"max_error\":" << maxError << "}" << std::endl;
+
+    sec = bestOf(none, [&] { for (int i = 0; i < N; ++i) scratch[i] = a[i].dot(b[i]); });
+    report("vec3_dot", N, sec, fnv1a(scratch.data(), scratch.size() * sizeof(float)));
+    sec = bestOf(none, [&] { dotSpan(ax.data(), ay.data(), az.data(), bx.data(), by.data(), bz.data(), scratch.data(), N); });
+    report("dot_span", N, sec, fnv1a(scratch.data(), scratch.size() * sizeof(float)));
+
+    // ͼ任 GL ʾаѹԴ/λñ任ӵͬ
+    const Mat4 view = Mat4::lookAt(Vec3(3.0f, 4.0f, 12.0f), Vec3(0.0f, 0.0f, -6.0f), Vec3(0.0f, 1.0f, 0.0f));
+    sec = bestOf(none, [&] { for (int i = 0; i < N; ++i) result[i] = view.transformPoint(a[i]); });
+    report("mat4_transform_point", N, sec, fnv1a(result.data(), result.size() * sizeof(Vec3)));
+    sec = bestOf(none, [&] { transformPointSpan(view, ax.data(), ay.data(), az.data(), x.data(), y.data(), z.data(), N); });
+    report("transform_point_span", N, sec, soaChecksum());
+
+    // ˷ÿΰһƽƾͼˣģͼ
+    std::vector<Mat4> products(N / 16);
+    sec = bestOf(none, [&] {
+        for (size_t i = 0; i < products.size(); ++i) products[i] = view * Mat4::translation(a[i]);
+    });
+    report("mat4_multiply", static_cast<long long>(products.size()), sec, fnv1a(products.data(), products.size() * sizeof(Mat4)));
+    return 0;
+}
\ No newline at end of file
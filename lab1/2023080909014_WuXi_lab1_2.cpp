@@ -3,8 +3,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <string.h>
-#include <GL/glut.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#if defined(__SSE2__)
+#include <immintrin.h>  // SSE/AVX2 intrinsics：批量颜色转换（用 -mavx2 编译启用8路）
+#endif
+#include <GL/freeglut.h>  // glutGetProcAddress 用于加载VBO与着色器函数
 
 // HSV和RGB颜色参数结构
 typedef struct {
@@ -46,6 +53,80 @@ static float last_time = 0.0;
 
 GLvoid* current_font = GLUT_BITMAP_TIMES_ROMAN_10;
 
+// RGB立方体格点：每条边 lattice_res 个点（默认41，即原来0.05的间距），共 lattice_res^3 个点
+// 格点数据只在分辨率改变时生成一次并放在显存中，旋转只改变模型视图矩阵。
+// OpenGL 3.3 下VBO只存一行 lattice_res 个X坐标，用 lattice_res^2 个实例绘制，
+// 顶点着色器由 gl_InstanceID 算出Y/Z和颜色（256^3 也只需1KB）；否则回退为完整的静态VBO（颜色+坐标）
+#define LATTICE_MIN 2
+#define LATTICE_MAX 256           // 着色器路径的上限
+#define LATTICE_FALLBACK_MAX 128  // 完整VBO每点24字节，128^3 约48MB
+static int lattice_res = 41;
+static int lattice_dirty = 1;     // 分辨率改变后在下一次绘制时重新上传
+static int lattice_inited = 0;    // GL资源在RGB子窗口的上下文中首次绘制时创建
+static int lattice_shader = 0;    // 1=实例化着色器路径, 0=完整VBO
+static GLuint lattice_vbo = 0;
+static GLuint lattice_program = 0;
+static GLint lattice_res_loc = -1;
+static GLsizei lattice_vertices = 0;  // 回退路径中VBO的顶点数
+static float* lattice_data = NULL;    // 没有VBO时直接作为顶点数组使用
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#endif
+typedef void (APIENTRY *gen_buffers_fn)(GLsizei, GLuint*);
+typedef void (APIENTRY *bind_buffer_fn)(GLenum, GLuint);
+typedef void (APIENTRY *buffer_data_fn)(GLenum, ptrdiff_t, const void*, GLenum);
+typedef GLuint (APIENTRY *create_shader_fn)(GLenum);
+typedef void (APIENTRY *shader_source_fn)(GLuint, GLsizei, const char* const*, const GLint*);
+typedef void (APIENTRY *compile_shader_fn)(GLuint);
+typedef void (APIENTRY *get_shaderiv_fn)(GLuint, GLenum, GLint*);
+typedef GLuint (APIENTRY *create_program_fn)(void);
+typedef void (APIENTRY *attach_shader_fn)(GLuint, GLuint);
+typedef void (APIENTRY *bind_attrib_location_fn)(GLuint, GLuint, const char*);
+typedef void (APIENTRY *link_program_fn)(GLuint);
+typedef void (APIENTRY *get_programiv_fn)(GLuint, GLenum, GLint*);
+typedef void (APIENTRY *use_program_fn)(GLuint);
+typedef GLint (APIENTRY *get_uniform_location_fn)(GLuint, const char*);
+typedef void (APIENTRY *uniform1i_fn)(GLint, GLint);
+typedef void (APIENTRY *enable_vertex_attrib_array_fn)(GLuint);
+typedef void (APIENTRY *disable_vertex_attrib_array_fn)(GLuint);
+typedef void (APIENTRY *vertex_attrib_pointer_fn)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+typedef void (APIENTRY *draw_arrays_instanced_fn)(GLenum, GLint, GLsizei, GLsizei);
+static gen_buffers_fn gl_gen_buffers;
+static bind_buffer_fn gl_bind_buffer;
+static buffer_data_fn gl_buffer_data;
+static use_program_fn gl_use_program;
+static uniform1i_fn gl_uniform1i;
+static enable_vertex_attrib_array_fn gl_enable_vertex_attrib_array;
+static disable_vertex_attrib_array_fn gl_disable_vertex_attrib_array;
+static vertex_attrib_pointer_fn gl_vertex_attrib_pointer;
+static draw_arrays_instanced_fn gl_draw_arrays_instanced;
+
+// 每个实例是一行X方向的格点：实例号给出Y、Z下标，颜色即坐标从[-1,1]映射到[0,1]
+static const char* lattice_vertex_source =
+    "#version 330 compatibility\n"
+    "in float lattice_x;\n"
+    "uniform int resolution;\n"
+    "void main() {\n"
+    "    float scale = 2.0 / float(resolution - 1);\n"
+    "    vec3 p = vec3(lattice_x, -1.0 + scale * float(gl_InstanceID % resolution), -1.0 + scale * float(gl_InstanceID / resolution));\n"
+    "    gl_FrontColor = vec4((p + 1.0) * 0.5, 1.0);\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(p, 1.0);\n"
+    "}\n";
+static const char* lattice_fragment_source =
+    "#version 330 compatibility\n"
+    "void main() { gl_FragColor = gl_Color; }\n";
+
 void refresh_all(void);
 void render_triangle(float x_pos, float y_pos, float scale, float red, float green, float blue);
 void convert_hsv_rgb(float hue, float sat, float val, float* red, float* green, float* blue);
@@ -53,6 +134,8 @@ void convert_rgb_hsv(float red, float green, float blue, float* hue, float* sat,
 void render_rgb_cube(void);
 void draw_rgb_point(float r, float g, float b);
 void animate_cube(void);
+void set_lattice_res(int res);
+int color_self_test(void);
 
 void select_font(const char* font_name, int font_size) {
     current_font = GLUT_BITMAP_HELVETICA_10;
@@ -190,6 +273,10 @@ void ctrl_window_render(void) {
     glColor3f(auto_rotate ? 0.0 : 1.0, auto_rotate ? 1.0 : 0.0, 0.0);
     output_text(400, 80, "Auto Rotate: %s", auto_rotate ? "ON" : "OFF");
 
+    // 显示格点分辨率（+/- 调整）
+    glColor3f(1.0, 1.0, 1.0);
+    output_text(400, 180, "Lattice: %d^3", lattice_res);
+
     glutSwapBuffers();
 }
 
@@ -311,28 +398,129 @@ void animate_cube(void) {
     }
 }
 
+// 着色器路径所需的GL 3.3函数与程序；任何一步失败返回0（使用完整VBO）
+static int init_lattice_shader(void) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    int major = 0, minor = 0;
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2 || major * 10 + minor < 33) return 0;
+
+    create_shader_fn create_shader = (create_shader_fn)glutGetProcAddress("glCreateShader");
+    shader_source_fn shader_source = (shader_source_fn)glutGetProcAddress("glShaderSource");
+    compile_shader_fn compile_shader = (compile_shader_fn)glutGetProcAddress("glCompileShader");
+    get_shaderiv_fn get_shaderiv = (get_shaderiv_fn)glutGetProcAddress("glGetShaderiv");
+    create_program_fn create_program = (create_program_fn)glutGetProcAddress("glCreateProgram");
+    attach_shader_fn attach_shader = (attach_shader_fn)glutGetProcAddress("glAttachShader");
+    bind_attrib_location_fn bind_attrib_location = (bind_attrib_location_fn)glutGetProcAddress("glBindAttribLocation");
+    link_program_fn link_program = (link_program_fn)glutGetProcAddress("glLinkProgram");
+    get_programiv_fn get_programiv = (get_programiv_fn)glutGetProcAddress("glGetProgramiv");
+    get_uniform_location_fn get_uniform_location = (get_uniform_location_fn)glutGetProcAddress("glGetUniformLocation");
+    gl_use_program = (use_program_fn)glutGetProcAddress("glUseProgram");
+    gl_uniform1i = (uniform1i_fn)glutGetProcAddress("glUniform1i");
+    gl_enable_vertex_attrib_array = (enable_vertex_attrib_array_fn)glutGetProcAddress("glEnableVertexAttribArray");
+    gl_disable_vertex_attrib_array = (disable_vertex_attrib_array_fn)glutGetProcAddress("glDisableVertexAttribArray");
+    gl_vertex_attrib_pointer = (vertex_attrib_pointer_fn)glutGetProcAddress("glVertexAttribPointer");
+    gl_draw_arrays_instanced = (draw_arrays_instanced_fn)glutGetProcAddress("glDrawArraysInstanced");
+    if (!create_shader || !shader_source || !compile_shader || !get_shaderiv || !create_program || !attach_shader ||
+        !bind_attrib_location || !link_program || !get_programiv || !get_uniform_location || !gl_use_program || !gl_uniform1i ||
+        !gl_enable_vertex_attrib_array || !gl_disable_vertex_attrib_array || !gl_vertex_attrib_pointer || !gl_draw_arrays_instanced)
+        return 0;
+
+    GLuint vs = create_shader(GL_VERTEX_SHADER), fs = create_shader(GL_FRAGMENT_SHADER);
+    GLint ok_vs = 0, ok_fs = 0, ok_link = 0;
+    shader_source(vs, 1, &lattice_vertex_source, NULL);
+    shader_source(fs, 1, &lattice_fragment_source, NULL);
+    compile_shader(vs);
+    compile_shader(fs);
+    get_shaderiv(vs, GL_COMPILE_STATUS, &ok_vs);
+    get_shaderiv(fs, GL_COMPILE_STATUS, &ok_fs);
+    if (!ok_vs || !ok_fs) return 0;
+    lattice_program = create_program();
+    attach_shader(lattice_program, vs);
+    attach_shader(lattice_program, fs);
+    bind_attrib_location(lattice_program, 0, "lattice_x");
+    link_program(lattice_program);
+    get_programiv(lattice_program, GL_LINK_STATUS, &ok_link);
+    if (!ok_link) return 0;
+    lattice_res_loc = get_uniform_location(lattice_program, "resolution");
+    return 1;
+}
+
+// 第一次绘制时在RGB子窗口的上下文中创建VBO（各子窗口的上下文互不共享）
+static void init_lattice(void) {
+    lattice_inited = 1;
+    gl_gen_buffers = (gen_buffers_fn)glutGetProcAddress("glGenBuffers");
+    gl_bind_buffer = (bind_buffer_fn)glutGetProcAddress("glBindBuffer");
+    gl_buffer_data = (buffer_data_fn)glutGetProcAddress("glBufferData");
+    if (gl_gen_buffers && gl_bind_buffer && gl_buffer_data) gl_gen_buffers(1, &lattice_vbo);
+    lattice_shader = lattice_vbo && init_lattice_shader();
+    if (!lattice_shader && lattice_res > LATTICE_FALLBACK_MAX) lattice_res = LATTICE_FALLBACK_MAX;
+    printf("RGB立方体: %s\n", lattice_shader ? "实例化着色器生成格点" : (lattice_vbo ? "静态VBO" : "顶点数组"));
+}
+
+// 按当前分辨率生成格点数据：着色器路径只需一行X坐标，回退路径为全部点的颜色+坐标（GL_C3F_V3F）
+static void upload_lattice(void) {
+    int n = lattice_res, count = lattice_shader ? n : n * n * n;
+    float scale = 2.0f / (n - 1);
+    float* data;
+    int i, x, y, z;
+    free(lattice_data);
+    lattice_data = data = (float*)malloc(sizeof(float) * (lattice_shader ? count : count * 6));
+    if (lattice_shader) {
+        for (i = 0; i < n; i++) data[i] = -1.0f + scale * i;
+    }
+    else {
+        for (z = 0; z < n; z++)
+            for (y = 0; y < n; y++)
+                for (x = 0; x < n; x++) {
+                    float px = -1.0f + scale * x, py = -1.0f + scale * y, pz = -1.0f + scale * z;
+                    data[0] = (px + 1.0f) * 0.5f; data[1] = (py + 1.0f) * 0.5f; data[2] = (pz + 1.0f) * 0.5f;  // 将立方体坐标[-1,1]映射到RGB值[0,1]
+                    data[3] = px; data[4] = py; data[5] = pz;
+                    data += 6;
+                }
+    }
+    lattice_vertices = count;
+    if (lattice_vbo) {
+        gl_bind_buffer(GL_ARRAY_BUFFER, lattice_vbo);
+        gl_buffer_data(GL_ARRAY_BUFFER, sizeof(float) * (lattice_shader ? count : count * 6), lattice_data, GL_STATIC_DRAW);
+        gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+        free(lattice_data);  // 数据已在显存中
+        lattice_data = NULL;
+    }
+    lattice_dirty = 0;
+}
+
+// 改变格点分辨率（键盘 +/- 或 --resolution）
+void set_lattice_res(int res) {
+    int max_res = (lattice_inited && !lattice_shader) ? LATTICE_FALLBACK_MAX : LATTICE_MAX;
+    if (res < LATTICE_MIN) res = LATTICE_MIN;
+    if (res > max_res) res = max_res;
+    if (res == lattice_res) return;
+    lattice_res = res;
+    lattice_dirty = 1;
+}
+
 void render_rgb_cube(void) {
-    // 使用点云方式渲染RGB颜色立方体 (参考lab1_2的实现)
-    float increment = 0.05;
+    // 使用点云方式渲染RGB颜色立方体：格点数据常驻显存，每帧一次绘制调用
+    if (!lattice_inited) init_lattice();
+    if (lattice_dirty) upload_lattice();
     glPointSize(2.0);
-    glBegin(GL_POINTS);
-    for (float x_coord = -1.0; x_coord <= 1.0; x_coord += increment)
-    {
-        for (float y_coord = -1.0; y_coord <= 1.0; y_coord += increment)
-        {
-            for (float z_coord = -1.0; z_coord <= 1.0; z_coord += increment)
-            {
-                // 将立方体坐标[-1,1]映射到RGB值[0,1]
-                float r = (x_coord + 1.0) / 2.0;
-                float g = (y_coord + 1.0) / 2.0;
-                float b = (z_coord + 1.0) / 2.0;
-                
-                glColor3f(r, g, b);
-                glVertex3f(x_coord, y_coord, z_coord);
-            }
-        }
+    if (lattice_vbo) gl_bind_buffer(GL_ARRAY_BUFFER, lattice_vbo);
+    if (lattice_shader) {
+        gl_use_program(lattice_program);
+        gl_uniform1i(lattice_res_loc, lattice_res);
+        gl_enable_vertex_attrib_array(0);
+        gl_vertex_attrib_pointer(0, 1, GL_FLOAT, GL_FALSE, 0, NULL);
+        gl_draw_arrays_instanced(GL_POINTS, 0, lattice_res, lattice_res * lattice_res);
+        gl_disable_vertex_attrib_array(0);
+        gl_use_program(0);
     }
-    glEnd();
+    else {
+        glInterleavedArrays(GL_C3F_V3F, 0, lattice_vbo ? NULL : lattice_data);  // 绑定VBO时指针为缓冲内偏移
+        glDrawArrays(GL_POINTS, 0, lattice_vertices);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+    if (lattice_vbo) gl_bind_buffer(GL_ARRAY_BUFFER, 0);
     
     // 绘制立方体边框
     glColor3f(0.8, 0.8, 0.8);
@@ -430,6 +618,16 @@ void keyboard(unsigned char key, int x, int y) {
             rotation[0] = rotation[1] = rotation[2] = 0.0;  // 重置旋转
             refresh_all();
             break;
+        case '+':
+        case '=':
+            set_lattice_res((lattice_res - 1) * 2 + 1);  // 格点间距减半
+            refresh_all();
+            break;
+        case '-':
+        case '_':
+            set_lattice_res((lattice_res - 1) / 2 + 1);  // 格点间距加倍
+            refresh_all();
+            break;
         case 27:  // ESC键退出
             exit(0);
             break;
@@ -572,12 +770,370 @@ void refresh_all(void) {
     glutPostRedisplay();
 }
 
+// ----------------------------------------------------
+// 批量颜色空间转换：对连续的像素缓冲做 HSV<->RGB 转换（整幅图像离线处理用）
+// 支持交错（RGBRGB...）与平面（RRR...GGG...BBB...）布局、浮点 [0,1] 与8位 [0,255] 分量，
+// 每 COLOR_BLOCK 个像素读入SoA临时块，用无分支的SIMD核心计算后写回；大图按线程分块并行。
+// -mavx2 编译时为8路AVX2，x86-64默认为4路SSE，其他平台退化为同样公式的标量循环。
+// 8位HSV的色相同样映射到 [0,255]。运行 --selftest 与逐像素的 convert_hsv_rgb/convert_rgb_hsv 对比并计时
+
+#if defined(__AVX2__)
+#define COLOR_SIMD_WIDTH 8
+typedef __m256 vfloat;
+static inline vfloat vset1(float x) { return _mm256_set1_ps(x); }
+static inline vfloat vload(const float* p) { return _mm256_load_ps(p); }
+static inline void vstore(float* p, vfloat a) { _mm256_store_ps(p, a); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+static inline vfloat vminf(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat vmaxf(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vcmpgt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vfloat vcmpge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline vfloat vcmpeq(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }  // mask ? a : b
+static inline vfloat vfloor(vfloat a) { return _mm256_floor_ps(a); }
+#elif defined(__SSE2__)
+#define COLOR_SIMD_WIDTH 4
+typedef __m128 vfloat;
+static inline vfloat vset1(float x) { return _mm_set1_ps(x); }
+static inline vfloat vload(const float* p) { return _mm_load_ps(p); }
+static inline void vstore(float* p, vfloat a) { _mm_store_ps(p, a); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+static inline vfloat vminf(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat vmaxf(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat vcmpgt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+static inline vfloat vcmpge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+static inline vfloat vcmpeq(vfloat a, vfloat b) { return _mm_cmpeq_ps(a, b); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline vfloat vfloor(vfloat a) {  // SSE2没有floor指令：截断后对负数非整数减1（|a| < 2^31）
+    vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+#else
+#define COLOR_SIMD_WIDTH 1
+typedef float vfloat;  // 标量：比较结果为 0/1，vselect 按非零选择
+static inline vfloat vset1(float x) { return x; }
+static inline vfloat vload(const float* p) { return *p; }
+static inline void vstore(float* p, vfloat a) { *p = a; }
+static inline vfloat vadd(vfloat a, vfloat b) { return a + b; }
+static inline vfloat vsub(vfloat a, vfloat b) { return a - b; }
+static inline vfloat vmul(vfloat a, vfloat b) { return a * b; }
+static inline vfloat vdiv(vfloat a, vfloat b) { return a / b; }
+static inline vfloat vminf(vfloat a, vfloat b) { return fminf(a, b); }
+static inline vfloat vmaxf(vfloat a, vfloat b) { return fmaxf(a, b); }
+static inline vfloat vcmpgt(vfloat a, vfloat b) { return a > b ? 1.0f : 0.0f; }
+static inline vfloat vcmpge(vfloat a, vfloat b) { return a >= b ? 1.0f : 0.0f; }
+static inline vfloat vcmpeq(vfloat a, vfloat b) { return a == b ? 1.0f : 0.0f; }
+static inline vfloat vand(vfloat mask, vfloat a) { return mask != 0.0f ? a : 0.0f; }
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return mask != 0.0f ? a : b; }
+static inline vfloat vfloor(vfloat a) { return floorf(a); }
+#endif
+
+#define COLOR_BLOCK 256              // 每块像素数（COLOR_SIMD_WIDTH 的倍数）
+#define COLOR_PARALLEL_MIN 65536     // 少于此像素数时不开线程
+
+// 颜色缓冲：三个通道的首地址与相邻像素同一通道的间隔（元素数）
+// 交错格式三个通道指向同一缓冲中相邻的分量、间隔为3；平面格式各通道独立、间隔为1
+typedef struct {
+    void* channel[3];
+    int stride;
+    int is_u8;  // 1=8位分量 [0,255]，0=浮点分量 [0,1]
+} color_buffer;
+
+color_buffer color_interleaved_f32(float* pixels) {
+    color_buffer b = { { pixels, pixels + 1, pixels + 2 }, 3, 0 };
+    return b;
+}
+color_buffer color_planar_f32(float* c0, float* c1, float* c2) {
+    color_buffer b = { { c0, c1, c2 }, 1, 0 };
+    return b;
+}
+color_buffer color_interleaved_u8(unsigned char* pixels) {
+    color_buffer b = { { pixels, pixels + 1, pixels + 2 }, 3, 1 };
+    return b;
+}
+color_buffer color_planar_u8(unsigned char* c0, unsigned char* c1, unsigned char* c2) {
+    color_buffer b = { { c0, c1, c2 }, 1, 1 };
+    return b;
+}
+
+// 像素 [first, first+n) 读入SoA块（8位分量除以255）
+static void load_color_block(const color_buffer* src, size_t first, int n, float block[3][COLOR_BLOCK]) {
+    for (int c = 0; c < 3; c++) {
+        if (src->is_u8) {
+            const unsigned char* p = (const unsigned char*)src->channel[c] + first * src->stride;
+            for (int i = 0; i < n; i++) block[c][i] = p[i * src->stride] * (1.0f / 255.0f);
+        }
+        else {
+            const float* p = (const float*)src->channel[c] + first * src->stride;
+            for (int i = 0; i < n; i++) block[c][i] = p[i * src->stride];
+        }
+        for (int i = n; i < COLOR_BLOCK; i++) block[c][i] = 0.0f;  // 末块多出的通道按黑色计算，不写回
+    }
+}
+
+// SoA块写回像素 [first, first+n)（8位分量截断到 [0,1] 后四舍五入）
+static void store_color_block(const color_buffer* dst, size_t first, int n, float block[3][COLOR_BLOCK]) {
+    for (int c = 0; c < 3; c++) {
+        if (dst->is_u8) {
+            unsigned char* p = (unsigned char*)dst->channel[c] + first * dst->stride;
+            for (int i = 0; i < n; i++) p[i * dst->stride] = (unsigned char)(fminf(fmaxf(block[c][i], 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+        else {
+            float* p = (float*)dst->channel[c] + first * dst->stride;
+            for (int i = 0; i < n; i++) p[i * dst->stride] = block[c][i];
+        }
+    }
+}
+
+// 原地 HSV -> RGB：通道 k = (n + 6h) mod 6（n = 5,3,1 对应 R,G,B），分量 = v - v*s*clamp(min(k, 4-k), 0, 1)，
+// 与 convert_hsv_rgb 的六个扇区逐一等价（h=1 时 k 回绕到 h=0，s=0 时三个分量都等于 v）
+static void hsv_rgb_kernel(float block[3][COLOR_BLOCK]) {
+    const vfloat six = vset1(6.0f), inv_six = vset1(1.0f / 6.0f), four = vset1(4.0f), one = vset1(1.0f), zero = vset1(0.0f);
+    const vfloat offsets[3] = { vset1(5.0f), vset1(3.0f), vset1(1.0f) };
+    for (int i = 0; i < COLOR_BLOCK; i += COLOR_SIMD_WIDTH) {
+        vfloat h6 = vmul(vload(&block[0][i]), six), v = vload(&block[2][i]);
+        vfloat vs = vmul(v, vload(&block[1][i]));
+        for (int c = 0; c < 3; c++) {
+            vfloat k = vadd(offsets[c], h6);
+            k = vsub(k, vmul(six, vfloor(vmul(k, inv_six))));
+            vfloat t = vmaxf(vminf(vminf(k, vsub(four, k)), one), zero);
+            vstore(&block[c][i], vsub(v, vmul(vs, t)));
+        }
+    }
+}
+
+// 原地 RGB -> HSV：最大分量决定色相公式（与 convert_rgb_hsv 的判断顺序相同），用选择代替分支，
+// 只做一次色相除法；delta=0 时色相与饱和度为0
+static void rgb_hsv_kernel(float block[3][COLOR_BLOCK]) {
+    const vfloat six = vset1(6.0f), two = vset1(2.0f), four = vset1(4.0f), one = vset1(1.0f), zero = vset1(0.0f);
+    for (int i = 0; i < COLOR_BLOCK; i += COLOR_SIMD_WIDTH) {
+        vfloat r = vload(&block[0][i]), g = vload(&block[1][i]), b = vload(&block[2][i]);
+        vfloat max_val = vmaxf(vmaxf(r, g), b), min_val = vminf(vminf(r, g), b);
+        vfloat delta = vsub(max_val, min_val);
+        vfloat valid = vcmpgt(delta, zero);
+        vfloat is_r = vcmpeq(max_val, r), is_g = vcmpeq(max_val, g);
+        vfloat num = vselect(is_r, vsub(g, b), vselect(is_g, vsub(b, r), vsub(r, g)));
+        vfloat offset = vselect(is_r, six, vselect(is_g, two, four));
+        vfloat safe_delta = vselect(valid, delta, one);
+        vfloat h = vadd(vdiv(num, safe_delta), offset);
+        h = vsub(h, vand(vcmpge(h, six), six));  // 只有R为最大时可能 >= 6：等价于 fmodf(x + 6, 6)
+        vstore(&block[0][i], vand(valid, vdiv(h, six)));
+        vstore(&block[1][i], vand(valid, vdiv(delta, vselect(valid, max_val, one))));
+        vstore(&block[2][i], max_val);
+    }
+}
+
+// 原地调整HSV：色相平移后回绕到 [0,1)，饱和度与明度按比例缩放（饱和度截断到 [0,1]，明度只截断下限）
+static void adjust_hsv_kernel(float block[3][COLOR_BLOCK], const float* params) {
+    const vfloat shift = vset1(params[0]), sat_scale = vset1(params[1]), val_scale = vset1(params[2]);
+    const vfloat one = vset1(1.0f), zero = vset1(0.0f);
+    for (int i = 0; i < COLOR_BLOCK; i += COLOR_SIMD_WIDTH) {
+        vfloat h = vadd(vload(&block[0][i]), shift);
+        vstore(&block[0][i], vsub(h, vfloor(h)));
+        vstore(&block[1][i], vmaxf(vminf(vmul(vload(&block[1][i]), sat_scale), one), zero));
+        vstore(&block[2][i], vmaxf(vmul(vload(&block[2][i]), val_scale), zero));
+    }
+}
+
+enum { COLOR_OP_HSV_RGB, COLOR_OP_RGB_HSV, COLOR_OP_ADJUST_HSV };
+
+// 单线程处理像素 [first, last)
+static void convert_color_range(int op, color_buffer src, color_buffer dst, size_t first, size_t last, const float* params) {
+#if COLOR_SIMD_WIDTH > 1
+    alignas(32) float block[3][COLOR_BLOCK];
+#else
+    float block[3][COLOR_BLOCK];
+#endif
+    for (size_t start = first; start < last; start += COLOR_BLOCK) {
+        int n = (int)(last - start < COLOR_BLOCK ? last - start : COLOR_BLOCK);
+        load_color_block(&src, start, n, block);
+        if (op == COLOR_OP_HSV_RGB) hsv_rgb_kernel(block);
+        else if (op == COLOR_OP_RGB_HSV) rgb_hsv_kernel(block);
+        else {  // RGB -> HSV -> 调整 -> RGB，中间结果不离开块
+            rgb_hsv_kernel(block);
+            adjust_hsv_kernel(block, params);
+            hsv_rgb_kernel(block);
+        }
+        store_color_block(&dst, start, n, block);
+    }
+}
+
+// 大图按线程分块（块边界对齐到 COLOR_BLOCK），小图直接在调用线程中处理
+static void convert_color_parallel(int op, color_buffer src, color_buffer dst, size_t count, const float* params) {
+    unsigned int threads = std::thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    if (count < COLOR_PARALLEL_MIN || threads == 1) {
+        convert_color_range(op, src, dst, 0, count, params);
+        return;
+    }
+    size_t blocks = (count + COLOR_BLOCK - 1) / COLOR_BLOCK;
+    size_t per_thread = (blocks + threads - 1) / threads * COLOR_BLOCK;
+    std::vector<std::thread> workers;
+    for (size_t first = per_thread; first < count; first += per_thread) {
+        size_t last = first + per_thread < count ? first + per_thread : count;
+        workers.emplace_back(convert_color_range, op, src, dst, first, last, params);
+    }
+    convert_color_range(op, src, dst, 0, per_thread < count ? per_thread : count, params);  // 第一段由调用线程处理
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+// count 个像素从 HSV 转为 RGB（src 与 dst 可以是同一缓冲）
+void convert_hsv_rgb_buffer(color_buffer src, color_buffer dst, size_t count) {
+    convert_color_parallel(COLOR_OP_HSV_RGB, src, dst, count, NULL);
+}
+
+// count 个像素从 RGB 转为 HSV（src 与 dst 可以是同一缓冲）
+void convert_rgb_hsv_buffer(color_buffer src, color_buffer dst, size_t count) {
+    convert_color_parallel(COLOR_OP_RGB_HSV, src, dst, count, NULL);
+}
+
+// 原地调整 RGB 缓冲的 HSV：色相平移 hue_shift（一整圈为1），饱和度、明度分别乘以 sat_scale、val_scale
+void adjust_hsv_buffer(color_buffer rgb, size_t count, float hue_shift, float sat_scale, float val_scale) {
+    float params[3] = { hue_shift, sat_scale, val_scale };
+    convert_color_parallel(COLOR_OP_ADJUST_HSV, rgb, rgb, count, params);
+}
+
+// --selftest：批量接口与逐像素标量函数对比（四种布局/精度、往返误差），并在4K图像上计时；全部通过返回0
+static float hue_distance(float a, float b) {  // 色相是环形的：0 与 1 为同一色相
+    float d = fabsf(a - b);
+    return d > 0.5f ? 1.0f - d : d;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int color_self_test(void) {
+    const size_t n = 1 << 20;
+    std::vector<float> rgb(n * 3), hsv(n * 3), out(n * 3), planes(n * 3);
+    std::vector<unsigned char> rgb8(n * 3), out8(n * 3), planes8(n * 3);
+    unsigned int seed = 12345u;
+    for (size_t i = 0; i < n * 3; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        rgb[i] = (seed >> 8) * (1.0f / 16777216.0f);
+        rgb8[i] = (unsigned char)(seed >> 24);
+    }
+    for (size_t i = 0; i < 4096 * 3; i += 3) {  // 边界情况：灰色、纯色、分量相等、0和1
+        size_t k = i / 3;
+        rgb[i] = (k & 1) ? 1.0f : 0.0f;
+        rgb[i + 1] = (k & 2) ? 1.0f : ((k & 8) ? rgb[i] : 0.5f);
+        rgb[i + 2] = (k & 4) ? 1.0f : ((k & 16) ? rgb[i + 1] : 0.0f);
+    }
+    int failures = 0;
+
+    // 浮点交错：RGB -> HSV 与标量对比
+    convert_rgb_hsv_buffer(color_interleaved_f32(rgb.data()), color_interleaved_f32(hsv.data()), n);
+    float max_h = 0, max_sv = 0;
+    for (size_t i = 0; i < n; i++) {
+        float h, s, v;
+        convert_rgb_hsv(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], &h, &s, &v);
+        max_h = fmaxf(max_h, hue_distance(h, hsv[i * 3]));
+        max_sv = fmaxf(max_sv, fmaxf(fabsf(s - hsv[i * 3 + 1]), fabsf(v - hsv[i * 3 + 2])));
+    }
+    printf("RGB->HSV  浮点交错: 与标量最大误差 色相 %.2e, 饱和度/明度 %.2e\n", max_h, max_sv);
+    failures += max_h > 1e-6f || max_sv > 1e-6f;
+
+    // 浮点交错：HSV -> RGB 与标量对比，以及往返误差
+    convert_hsv_rgb_buffer(color_interleaved_f32(hsv.data()), color_interleaved_f32(out.data()), n);
+    float max_rgb = 0, max_trip = 0;
+    for (size_t i = 0; i < n; i++) {
+        float c[3];
+        convert_hsv_rgb(hsv[i * 3], hsv[i * 3 + 1], hsv[i * 3 + 2], &c[0], &c[1], &c[2]);
+        for (int k = 0; k < 3; k++) {
+            max_rgb = fmaxf(max_rgb, fabsf(c[k] - out[i * 3 + k]));
+            max_trip = fmaxf(max_trip, fabsf(rgb[i * 3 + k] - out[i * 3 + k]));
+        }
+    }
+    printf("HSV->RGB  浮点交错: 与标量最大误差 %.2e, RGB往返最大误差 %.2e\n", max_rgb, max_trip);
+    failures += max_rgb > 1e-6f || max_trip > 1e-5f;
+
+    // 浮点平面：与交错结果逐位相同
+    float* p0 = planes.data(), * p1 = p0 + n, * p2 = p1 + n;
+    for (size_t i = 0; i < n; i++) { p0[i] = rgb[i * 3]; p1[i] = rgb[i * 3 + 1]; p2[i] = rgb[i * 3 + 2]; }
+    convert_rgb_hsv_buffer(color_planar_f32(p0, p1, p2), color_planar_f32(p0, p1, p2), n);
+    size_t planar_diff = 0;
+    for (size_t i = 0; i < n; i++) planar_diff += p0[i] != hsv[i * 3] || p1[i] != hsv[i * 3 + 1] || p2[i] != hsv[i * 3 + 2];
+    convert_hsv_rgb_buffer(color_planar_f32(p0, p1, p2), color_planar_f32(p0, p1, p2), n);
+    for (size_t i = 0; i < n; i++) planar_diff += p0[i] != out[i * 3] || p1[i] != out[i * 3 + 1] || p2[i] != out[i * 3 + 2];
+    printf("浮点平面: 与交错结果不同的像素 %zu\n", planar_diff);
+    failures += planar_diff != 0;
+
+    // 8位交错：RGB -> 浮点HSV -> RGB 往返应完全还原；与标量函数加同样量化的结果对比
+    convert_rgb_hsv_buffer(color_interleaved_u8(rgb8.data()), color_interleaved_f32(hsv.data()), n);
+    convert_hsv_rgb_buffer(color_interleaved_f32(hsv.data()), color_interleaved_u8(out8.data()), n);
+    int max_u8_trip = 0, max_u8_scalar = 0;
+    for (size_t i = 0; i < n; i++) {
+        float h, s, v, c[3];
+        convert_rgb_hsv(rgb8[i * 3] / 255.0f, rgb8[i * 3 + 1] / 255.0f, rgb8[i * 3 + 2] / 255.0f, &h, &s, &v);
+        convert_hsv_rgb(h, s, v, &c[0], &c[1], &c[2]);
+        for (int k = 0; k < 3; k++) {
+            int scalar = (int)(fminf(fmaxf(c[k], 0.0f), 1.0f) * 255.0f + 0.5f);
+            max_u8_trip = abs(rgb8[i * 3 + k] - out8[i * 3 + k]) > max_u8_trip ? abs(rgb8[i * 3 + k] - out8[i * 3 + k]) : max_u8_trip;
+            max_u8_scalar = abs(scalar - out8[i * 3 + k]) > max_u8_scalar ? abs(scalar - out8[i * 3 + k]) : max_u8_scalar;
+        }
+    }
+    printf("8位交错: RGB往返最大误差 %d, 与标量最大误差 %d\n", max_u8_trip, max_u8_scalar);
+    failures += max_u8_trip != 0 || max_u8_scalar > 1;
+
+    // 8位平面HSV（色相量化为256级）：往返误差的上界
+    unsigned char* q0 = planes8.data(), * q1 = q0 + n, * q2 = q1 + n;
+    convert_rgb_hsv_buffer(color_interleaved_u8(rgb8.data()), color_planar_u8(q0, q1, q2), n);
+    convert_hsv_rgb_buffer(color_planar_u8(q0, q1, q2), color_interleaved_u8(out8.data()), n);
+    int max_hsv8_trip = 0;
+    for (size_t i = 0; i < n * 3; i++) max_hsv8_trip = abs(rgb8[i] - out8[i]) > max_hsv8_trip ? abs(rgb8[i] - out8[i]) : max_hsv8_trip;
+    printf("8位平面HSV: RGB往返最大误差 %d\n", max_hsv8_trip);
+    failures += max_hsv8_trip > 4;
+
+    // 4K 8位交错图像（与 lab4 framebuffer 相同的布局）的HSV调整计时
+    const size_t pixels = 3840 * 2160;
+    std::vector<unsigned char> frame(pixels * 3);
+    for (size_t i = 0; i < frame.size(); i++) frame[i] = (unsigned char)(i * 2654435761u >> 24);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pixels; i++) {  // 标量参考：逐像素调用
+        float h, s, v, c[3];
+        unsigned char* p = &frame[i * 3];
+        convert_rgb_hsv(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, &h, &s, &v);
+        h += 0.1f;
+        h -= floorf(h);
+        convert_hsv_rgb(h, fminf(s * 1.2f, 1.0f), v, &c[0], &c[1], &c[2]);
+        for (int k = 0; k < 3; k++) p[k] = (unsigned char)(fminf(fmaxf(c[k], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    double scalar_ms = elapsed_ms(start);
+    start = std::chrono::steady_clock::now();
+    const int repeats = 10;
+    for (int r = 0; r < repeats; r++) adjust_hsv_buffer(color_interleaved_u8(frame.data()), pixels, 0.1f, 1.2f, 1.0f);
+    double batch_ms = elapsed_ms(start) / repeats;
+    printf("4K HSV调整: 逐像素标量 %.1f ms, 批量接口 %.1f ms（%d 路SIMD, %u 线程）\n",
+        scalar_ms, batch_ms, COLOR_SIMD_WIDTH, std::thread::hardware_concurrency());
+
+    printf(failures ? "自检失败: %d 项\n" : "自检通过\n", failures);
+    return failures ? 1 : 0;
+}
+
 int main(int argc, char** argv) {
+    // --selftest：只运行批量颜色转换的自检与计时，不创建窗口
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--selftest") == 0) return color_self_test();
+    }
+
     glutInitDisplayMode(GLUT_RGB | GLUT_DEPTH | GLUT_DOUBLE);
     glutInitWindowSize(512 + 25 * 3, 512 + 25 * 3);
     glutInitWindowPosition(250, 50);
     glutInit(&argc, argv);
 
+    // 命令行参数：--resolution N 设置立方体每条边的格点数（2~256）
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--resolution") == 0) set_lattice_res(atoi(argv[++i]));
+    }
+
     main_win = glutCreateWindow("HSV-RGB Color Model Converter - Auto Rotating 3D RGB Cube");
     glutReshapeFunc(main_window_resize);
     glutDisplayFunc(main_window_render);
@@ -1,6 +1,13 @@
 #include <GL/freeglut.h>
 #include <GL/glut.h>
 #include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+#include "../common/simd_math.h"  // ѧģ飺 Vec3 / Mat4عշͰ任
 #define PI 3.14159265358979323846
 
 // ȫֹղ
@@ -22,15 +29,32 @@ struct Camera {
     int lastMouseY = 0;          // һY꣨ڼƶ
 } camera;
 
-// λã3С4е
-const float spherePositions[3][4][3] = {
-    // һУ
-    {{-2.0f, 1.5f, -7.0f}, {-0.5f, 1.5f, -7.0f}, {1.0f, 1.5f, -7.0f}, {2.5f, 1.5f, -7.0f}},
-    // ڶУм䣩
-    {{-2.0f, 0.0f, -7.0f}, {-0.5f, 0.0f, -7.0f}, {1.0f, 0.0f, -7.0f}, {2.5f, 0.0f, -7.0f}},
-    // Уײ
-    {{-2.0f, -1.5f, -7.0f}, {-0.5f, -1.5f, -7.0f}, {1.0f, -1.5f, -7.0f}, {2.5f, -1.5f, -7.0f}}
-};
+// ͸ͶӰhandleReshape ãعշͰʹͬ׶
+struct Projection {
+    double fovY = 45.0;          // ֱӽǣȣ
+    double aspect = 1.0;         // ߱
+    double zNear = 1.0;          // ü
+    double zFar = 100.0;         // Զü
+    int width = 1;               // ӿڿȣأ
+    int height = 1;              // ӿڸ߶ȣأ
+} projection;
+
+// ãĬ3С4У --grid   չģѹã
+//  row е col еĲΪ materials[(row % 3) * 4 + col % 4]Ĭԭ12ֲ
+struct SphereGrid {
+    int rows = 3;              // 
+    int cols = 4;              // 
+    float spacing = 1.5f;      // ĵļ
+    float radius = 0.5f;       // 뾶
+    float depth = -7.0f;       // ƽZ
+} grid;
+
+//  row е col У0-basedģı (0.25, 0)Ĭԭλͬ
+void sphereCenter(int row, int col, float center[3]) {
+    center[0] = (col - (grid.cols - 1) * 0.5f) * grid.spacing + 0.25f;
+    center[1] = ((grid.rows - 1) * 0.5f - row) * grid.spacing;
+    center[2] = grid.depth;
+}
 
 // ԤĲ
 GLfloat noMaterial[4] = { 0.0f, 0.0f, 0.0f, 1.0f };         // ޲
@@ -40,6 +64,332 @@ GLfloat blueDiffuse[4] = { 0.1f, 0.5f, 0.8f, 1.0f };        // 
 GLfloat whiteSpecular[4] = { 1.0f, 1.0f, 1.0f, 1.0f };      // ɫ淴
 GLfloat redEmission[4] = { 0.3f, 0.2f, 0.2f, 1.0f };        // ɫԷ
 
+// ʱо⣨/ɫ/ɫоԷ⣨/;/߾/Է⣩
+// ɫе std140 Material ṹһ£ĸvec4 + ռһvec4űֱϴΪuniform
+struct Material {
+    GLfloat ambient[4];
+    GLfloat diffuse[4];
+    GLfloat specular[4];
+    GLfloat emission[4];
+    GLfloat shininess[4];  // ֻõһ
+};
+const int MATERIAL_COUNT = 12;
+Material materials[MATERIAL_COUNT];
+
+// Ԥװʱ
+void initMaterials() {
+    const GLfloat* rowAmbient[3] = { noMaterial, grayAmbient, yellowAmbient };      // һ޻⣬ڶлɫлɫ
+    const GLfloat* colSpecular[4] = { noMaterial, whiteSpecular, whiteSpecular, noMaterial };
+    const GLfloat colShininess[4] = { 0.0f, 5.0f, 100.0f, 0.0f };                   // ޹/͹/߹/޹
+    const GLfloat* colEmission[4] = { noMaterial, noMaterial, noMaterial, redEmission };  // кɫԷ
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            Material& m = materials[row * 4 + col];
+            memcpy(m.ambient, rowAmbient[row], sizeof(m.ambient));
+            memcpy(m.diffuse, blueDiffuse, sizeof(m.diffuse));  // ȫΪɫ
+            memcpy(m.specular, colSpecular[col], sizeof(m.specular));
+            memcpy(m.emission, colEmission[col], sizeof(m.emission));
+            m.shininess[0] = colShininess[col];
+            m.shininess[1] = m.shininess[2] = m.shininess[3] = 0.0f;
+        }
+    }
+}
+
+// ֻϸһΣ gluSphere(radius, 30, 30) ͬľγ֣干
+// λϵĵͬʱǸõķֻһ
+const int SPHERE_SLICES = 30;  // ȷֶ
+const int SPHERE_STACKS = 30;  // γȷֶ
+std::vector<GLfloat> sphereVertices;  // ÿ xyz
+std::vector<GLushort> sphereIndices;  // 
+
+void buildSphereMesh() {
+    sphereVertices.clear();
+    sphereIndices.clear();
+    for (int j = 0; j <= SPHERE_STACKS; j++) {  //  +Z  -Z 
+        double rho = PI * j / SPHERE_STACKS;
+        for (int i = 0; i <= SPHERE_SLICES; i++) {  // һһغϣǶͬӷ죩
+            double theta = 2.0 * PI * (i == SPHERE_SLICES ? 0 : i) / SPHERE_SLICES;
+            sphereVertices.push_back(static_cast<GLfloat>(sin(theta) * sin(rho)));
+            sphereVertices.push_back(static_cast<GLfloat>(cos(theta) * sin(rho)));
+            sphereVertices.push_back(static_cast<GLfloat>(cos(rho)));
+        }
+    }
+    for (int j = 0; j < SPHERE_STACKS; j++) {
+        for (int i = 0; i < SPHERE_SLICES; i++) {
+            GLushort a = static_cast<GLushort>(j * (SPHERE_SLICES + 1) + i), b = static_cast<GLushort>(a + SPHERE_SLICES + 1);  // a һγߣb һγ
+            // ⿴ʱ
+            sphereIndices.push_back(a); sphereIndices.push_back(b); sphereIndices.push_back(static_cast<GLushort>(a + 1));
+            sphereIndices.push_back(static_cast<GLushort>(a + 1)); sphereIndices.push_back(b); sphereIndices.push_back(static_cast<GLushort>(b + 1));
+        }
+    }
+}
+
+// ʵƣOpenGL 3.3ÿʵ/ʱŷVBOУʱuniformУ
+// ֻһ glDrawElementsInstancedڶɫа̶߹ʽ㣨𶥵㣬GL_SMOOTHֵ
+// Դ״̬ͨ glLightfv á֧ʱ˵ƣͬһ񣬲ֻڱ仯ʱã
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_UNIFORM_BUFFER
+#define GL_UNIFORM_BUFFER 0x8A11
+#endif
+typedef void (APIENTRY* PfnGenBuffers)(GLsizei, GLuint*);
+typedef void (APIENTRY* PfnBindBuffer)(GLenum, GLuint);
+typedef void (APIENTRY* PfnBufferData)(GLenum, ptrdiff_t, const void*, GLenum);
+typedef void (APIENTRY* PfnBindBufferBase)(GLenum, GLuint, GLuint);
+typedef GLuint(APIENTRY* PfnCreateShader)(GLenum);
+typedef void (APIENTRY* PfnShaderSource)(GLuint, GLsizei, const char* const*, const GLint*);
+typedef void (APIENTRY* PfnCompileShader)(GLuint);
+typedef void (APIENTRY* PfnGetShaderiv)(GLuint, GLenum, GLint*);
+typedef void (APIENTRY* PfnGetShaderInfoLog)(GLuint, GLsizei, GLsizei*, char*);
+typedef void (APIENTRY* PfnDeleteShader)(GLuint);
+typedef GLuint(APIENTRY* PfnCreateProgram)();
+typedef void (APIENTRY* PfnAttachShader)(GLuint, GLuint);
+typedef void (APIENTRY* PfnLinkProgram)(GLuint);
+typedef void (APIENTRY* PfnGetProgramiv)(GLuint, GLenum, GLint*);
+typedef void (APIENTRY* PfnGetProgramInfoLog)(GLuint, GLsizei, GLsizei*, char*);
+typedef void (APIENTRY* PfnBindAttribLocation)(GLuint, GLuint, const char*);
+typedef void (APIENTRY* PfnUseProgram)(GLuint);
+typedef GLint(APIENTRY* PfnGetUniformLocation)(GLuint, const char*);
+typedef void (APIENTRY* PfnUniform1f)(GLint, GLfloat);
+typedef GLuint(APIENTRY* PfnGetUniformBlockIndex)(GLuint, const char*);
+typedef void (APIENTRY* PfnUniformBlockBinding)(GLuint, GLuint, GLuint);
+typedef void (APIENTRY* PfnEnableVertexAttribArray)(GLuint);
+typedef void (APIENTRY* PfnDisableVertexAttribArray)(GLuint);
+typedef void (APIENTRY* PfnVertexAttribPointer)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+typedef void (APIENTRY* PfnVertexAttribDivisor)(GLuint, GLuint);
+typedef void (APIENTRY* PfnDrawElementsInstanced)(GLenum, GLsizei, GLenum, const void*, GLsizei);
+
+// ɫ Material C++ṹ岼һ£ʱŷʵԵw
+const char* SPHERE_VERTEX_SHADER =
+    "#version 330 compatibility\n"
+    "in vec3 position;\n"      // λϵĵ㣬ͬʱǷ
+    "in vec4 instance;\n"      // xyz ģw ʱ
+    "uniform float radius;\n"
+    "struct Material { vec4 ambient; vec4 diffuse; vec4 specular; vec4 emission; vec4 shininess; };\n"
+    "layout(std140) uniform Materials { Material materials[12]; };\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    Material m = materials[int(instance.w)];\n"
+    "    vec4 eyePos = gl_ModelViewMatrix * vec4(instance.xyz + position * radius, 1.0);\n"
+    "    vec3 n = normalize(gl_NormalMatrix * position);\n"
+    "    vec4 lightPos = gl_LightSource[0].position;\n"  // glLightfv ʱѱ任ӵ
+    "    vec3 l = normalize(lightPos.w == 0.0 ? lightPos.xyz : lightPos.xyz - eyePos.xyz);\n"
+    "    float nl = max(dot(n, l), 0.0);\n"
+    "    vec4 c = m.emission + m.ambient * gl_LightModel.ambient + m.ambient * gl_LightSource[0].ambient\n"
+    "           + nl * m.diffuse * gl_LightSource[0].diffuse;\n"
+    "    if (nl > 0.0) {\n"  // Ǿֲ۲ߣȡ l + (0,0,1)
+    "        float nh = max(dot(n, normalize(l + vec3(0.0, 0.0, 1.0))), 0.0);\n"
+    "        c += (m.shininess.x == 0.0 ? 1.0 : pow(nh, m.shininess.x)) * m.specular * gl_LightSource[0].specular;\n"
+    "    }\n"
+    "    color = vec4(clamp(c.rgb, 0.0, 1.0), m.diffuse.a);\n"
+    "    gl_Position = gl_ProjectionMatrix * eyePos;\n"
+    "}\n";
+const char* SPHERE_FRAGMENT_SHADER =
+    "#version 330 compatibility\n"
+    "in vec4 color;\n"
+    "void main() { gl_FragColor = color; }\n";
+
+struct InstancedSpheres {
+    bool ready = false;        // ʼɹʹʵ
+    GLuint program = 0;
+    GLuint vertexBuffer = 0;   // λ򶥵
+    GLuint indexBuffer = 0;    // 
+    GLuint instanceBuffer = 0; // ÿʵ (x, y, z, ʱ)
+    GLuint materialBuffer = 0; // ʱuniform壬󶨵0
+    GLint radiusLocation = -1;
+    GLsizei instanceCount = 0;
+    PfnBindBuffer bindBuffer = nullptr;
+    PfnBufferData bufferData = nullptr;
+    PfnBindBufferBase bindBufferBase = nullptr;
+    PfnUseProgram useProgram = nullptr;
+    PfnUniform1f uniform1f = nullptr;
+    PfnEnableVertexAttribArray enableVertexAttribArray = nullptr;
+    PfnDisableVertexAttribArray disableVertexAttribArray = nullptr;
+    PfnVertexAttribPointer vertexAttribPointer = nullptr;
+    PfnVertexAttribDivisor vertexAttribDivisor = nullptr;
+    PfnDrawElementsInstanced drawElementsInstanced = nullptr;
+    PfnGenBuffers genBuffers = nullptr;        // ڴɫ򣨴عģʽҲʹã
+    PfnCreateShader createShader = nullptr;
+    PfnShaderSource shaderSource = nullptr;
+    PfnCompileShader compileShader = nullptr;
+    PfnGetShaderiv getShaderiv = nullptr;
+    PfnGetShaderInfoLog getShaderInfoLog = nullptr;
+    PfnDeleteShader deleteShader = nullptr;
+    PfnCreateProgram createProgram = nullptr;
+    PfnAttachShader attachShader = nullptr;
+    PfnLinkProgram linkProgram = nullptr;
+    PfnGetProgramiv getProgramiv = nullptr;
+    PfnGetProgramInfoLog getProgramInfoLog = nullptr;
+    PfnBindAttribLocation bindAttribLocation = nullptr;
+    PfnGetUniformLocation getUniformLocation = nullptr;
+    PfnGetUniformBlockIndex getUniformBlockIndex = nullptr;
+    PfnUniformBlockBinding uniformBlockBinding = nullptr;
+} instanced;
+
+// һɫʧʱӡ־0
+GLuint compileSphereShader(GLenum type, const char* source) {
+    GLuint shader = instanced.createShader(type);
+    instanced.shaderSource(shader, 1, &source, nullptr);
+    instanced.compileShader(shader);
+    GLint ok = 0;
+    instanced.getShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[4096];
+        instanced.getShaderInfoLog(shader, sizeof(log), nullptr, log);
+        fprintf(stderr, "ɫʧ:\n%s\n", log);
+        instanced.deleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// ɫλù̶Ϊ position=0instance=1ʱ󶨵uniform󶨵0ʧʱ0
+GLuint linkSphereProgram(const char* vertexSource, const char* fragmentSource) {
+    GLuint vs = compileSphereShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fs = compileSphereShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vs || !fs) {
+        if (vs) instanced.deleteShader(vs);
+        if (fs) instanced.deleteShader(fs);
+        return 0;
+    }
+    GLuint program = instanced.createProgram();
+    instanced.attachShader(program, vs);
+    instanced.attachShader(program, fs);
+    instanced.bindAttribLocation(program, 0, "position");  // ʱֱʹ01
+    instanced.bindAttribLocation(program, 1, "instance");
+    instanced.linkProgram(program);
+    instanced.deleteShader(vs);  // ӵĴ
+    instanced.deleteShader(fs);
+    GLint ok = 0;
+    instanced.getProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[4096];
+        instanced.getProgramInfoLog(program, sizeof(log), nullptr, log);
+        fprintf(stderr, "ɫʧ:\n%s\n", log);
+        return 0;
+    }
+    instanced.uniformBlockBinding(program, instanced.getUniformBlockIndex(program, "Materials"), 0);
+    return program;
+}
+
+// GLĴãϴʱɫʧʱ˵ԭ򲢷falseʹƣ
+bool initInstancedSpheres() {
+    int major = 0, minor = 0;
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2 || major * 10 + minor < 33) {
+        fprintf(stderr, "ʵҪ OpenGL 3.3ǰ %sʹ\n", version ? version : "δ֪");
+        return false;
+    }
+    instanced.genBuffers = reinterpret_cast<PfnGenBuffers>(glutGetProcAddress("glGenBuffers"));
+    instanced.createShader = reinterpret_cast<PfnCreateShader>(glutGetProcAddress("glCreateShader"));
+    instanced.shaderSource = reinterpret_cast<PfnShaderSource>(glutGetProcAddress("glShaderSource"));
+    instanced.compileShader = reinterpret_cast<PfnCompileShader>(glutGetProcAddress("glCompileShader"));
+    instanced.getShaderiv = reinterpret_cast<PfnGetShaderiv>(glutGetProcAddress("glGetShaderiv"));
+    instanced.getShaderInfoLog = reinterpret_cast<PfnGetShaderInfoLog>(glutGetProcAddress("glGetShaderInfoLog"));
+    instanced.deleteShader = reinterpret_cast<PfnDeleteShader>(glutGetProcAddress("glDeleteShader"));
+    instanced.createProgram = reinterpret_cast<PfnCreateProgram>(glutGetProcAddress("glCreateProgram"));
+    instanced.attachShader = reinterpret_cast<PfnAttachShader>(glutGetProcAddress("glAttachShader"));
+    instanced.linkProgram = reinterpret_cast<PfnLinkProgram>(glutGetProcAddress("glLinkProgram"));
+    instanced.getProgramiv = reinterpret_cast<PfnGetProgramiv>(glutGetProcAddress("glGetProgramiv"));
+    instanced.getProgramInfoLog = reinterpret_cast<PfnGetProgramInfoLog>(glutGetProcAddress("glGetProgramInfoLog"));
+    instanced.bindAttribLocation = reinterpret_cast<PfnBindAttribLocation>(glutGetProcAddress("glBindAttribLocation"));
+    instanced.getUniformLocation = reinterpret_cast<PfnGetUniformLocation>(glutGetProcAddress("glGetUniformLocation"));
+    instanced.getUniformBlockIndex = reinterpret_cast<PfnGetUniformBlockIndex>(glutGetProcAddress("glGetUniformBlockIndex"));
+    instanced.uniformBlockBinding = reinterpret_cast<PfnUniformBlockBinding>(glutGetProcAddress("glUniformBlockBinding"));
+    instanced.bindBuffer = reinterpret_cast<PfnBindBuffer>(glutGetProcAddress("glBindBuffer"));
+    instanced.bufferData = reinterpret_cast<PfnBufferData>(glutGetProcAddress("glBufferData"));
+    instanced.bindBufferBase = reinterpret_cast<PfnBindBufferBase>(glutGetProcAddress("glBindBufferBase"));
+    instanced.useProgram = reinterpret_cast<PfnUseProgram>(glutGetProcAddress("glUseProgram"));
+    instanced.uniform1f = reinterpret_cast<PfnUniform1f>(glutGetProcAddress("glUniform1f"));
+    instanced.enableVertexAttribArray = reinterpret_cast<PfnEnableVertexAttribArray>(glutGetProcAddress("glEnableVertexAttribArray"));
+    instanced.disableVertexAttribArray = reinterpret_cast<PfnDisableVertexAttribArray>(glutGetProcAddress("glDisableVertexAttribArray"));
+    instanced.vertexAttribPointer = reinterpret_cast<PfnVertexAttribPointer>(glutGetProcAddress("glVertexAttribPointer"));
+    instanced.vertexAttribDivisor = reinterpret_cast<PfnVertexAttribDivisor>(glutGetProcAddress("glVertexAttribDivisor"));
+    instanced.drawElementsInstanced = reinterpret_cast<PfnDrawElementsInstanced>(glutGetProcAddress("glDrawElementsInstanced"));
+    if (!instanced.genBuffers || !instanced.createShader || !instanced.shaderSource || !instanced.compileShader || !instanced.getShaderiv ||
+        !instanced.getShaderInfoLog || !instanced.deleteShader || !instanced.createProgram || !instanced.attachShader || !instanced.linkProgram ||
+        !instanced.getProgramiv || !instanced.getProgramInfoLog || !instanced.bindAttribLocation || !instanced.getUniformLocation ||
+        !instanced.getUniformBlockIndex || !instanced.uniformBlockBinding || !instanced.bindBuffer || !instanced.bufferData ||
+        !instanced.bindBufferBase || !instanced.useProgram || !instanced.uniform1f || !instanced.enableVertexAttribArray ||
+        !instanced.disableVertexAttribArray || !instanced.vertexAttribPointer || !instanced.vertexAttribDivisor || !instanced.drawElementsInstanced) {
+        fprintf(stderr, "޷ʵGLʹ\n");
+        return false;
+    }
+
+    instanced.program = linkSphereProgram(SPHERE_VERTEX_SHADER, SPHERE_FRAGMENT_SHADER);
+    if (!instanced.program) return false;
+    instanced.radiusLocation = instanced.getUniformLocation(instanced.program, "radius");
+
+    GLuint buffers[4];
+    instanced.genBuffers(4, buffers);
+    instanced.vertexBuffer = buffers[0];
+    instanced.indexBuffer = buffers[1];
+    instanced.instanceBuffer = buffers[2];
+    instanced.materialBuffer = buffers[3];
+    instanced.bindBuffer(GL_ARRAY_BUFFER, instanced.vertexBuffer);
+    instanced.bufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(GLfloat), sphereVertices.data(), GL_STATIC_DRAW);
+    instanced.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, instanced.indexBuffer);
+    instanced.bufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(GLushort), sphereIndices.data(), GL_STATIC_DRAW);
+    instanced.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    instanced.bindBuffer(GL_UNIFORM_BUFFER, instanced.materialBuffer);
+    instanced.bufferData(GL_UNIFORM_BUFFER, sizeof(materials), materials, GL_STATIC_DRAW);
+    instanced.bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // ÿʵʱţСֻʱȷϴһ
+    std::vector<GLfloat> instanceData;
+    instanceData.reserve(static_cast<size_t>(grid.rows) * grid.cols * 4);
+    for (int row = 0; row < grid.rows; row++) {
+        for (int col = 0; col < grid.cols; col++) {
+            float center[3];
+            sphereCenter(row, col, center);
+            instanceData.push_back(center[0]);
+            instanceData.push_back(center[1]);
+            instanceData.push_back(center[2]);
+            instanceData.push_back(static_cast<GLfloat>((row % 3) * 4 + col % 4));
+        }
+    }
+    instanced.bindBuffer(GL_ARRAY_BUFFER, instanced.instanceBuffer);
+    instanced.bufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(GLfloat), instanceData.data(), GL_STATIC_DRAW);
+    instanced.bindBuffer(GL_ARRAY_BUFFER, 0);
+    instanced.instanceCount = static_cast<GLsizei>(grid.rows * grid.cols);
+    instanced.ready = true;
+    return true;
+}
+
+// һεûprogram ΪʵɫͨعգradiusLocation Ϊ radius 
+void drawSphereInstances(GLuint program, GLint radiusLocation) {
+    instanced.useProgram(program);
+    instanced.uniform1f(radiusLocation, grid.radius);
+    instanced.bindBufferBase(GL_UNIFORM_BUFFER, 0, instanced.materialBuffer);
+    instanced.bindBuffer(GL_ARRAY_BUFFER, instanced.vertexBuffer);
+    instanced.enableVertexAttribArray(0);
+    instanced.vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    instanced.bindBuffer(GL_ARRAY_BUFFER, instanced.instanceBuffer);
+    instanced.enableVertexAttribArray(1);
+    instanced.vertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+    instanced.vertexAttribDivisor(1, 1);  // ÿʵǰһ
+    instanced.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, instanced.indexBuffer);
+    instanced.drawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(sphereIndices.size()), GL_UNSIGNED_SHORT, nullptr, instanced.instanceCount);
+    instanced.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    instanced.vertexAttribDivisor(1, 0);
+    instanced.disableVertexAttribArray(1);
+    instanced.disableVertexAttribArray(0);
+    instanced.bindBuffer(GL_ARRAY_BUFFER, 0);
+    instanced.useProgram(0);
+}
+
 // ʼOpenGL
 void initializeGraphics() {
     glClearColor(0.0f, 0.1f, 0.1f, 1.0f);  // ñɫɫ
@@ -55,115 +405,360 @@ void initializeGraphics() {
     glLightfv(GL_LIGHT0, GL_SPECULAR, light.specular);  // þ淴
 }
 
-// Ƶ
-void renderSphereAt(float x, float y, float z, float radius, int row, int col) {
-    glPushMatrix();     // 浱ǰ״̬
-    glTranslatef(x, y, z);  // ƶָλ
+// عģʽL  --lights NԴٸ̬Դÿ֡CPUϰѵԴ׶
+// Ļ 169   24 ָƬͰƬɫֻԼڴصĹԴб
+// ֡ʱȡÿӰĹԴǹԴԴɼ̿ƣƬΰ̶߹ʽ㣬Ͱ
+const int CLUSTER_X = 16;            // Ļˮƽֿ
+const int CLUSTER_Y = 9;             // Ļֱֿ
+const int CLUSTER_Z = 24;            // Ƭ/Զü֮䰴֣
+const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+const int MAX_POINT_LIGHTS = 4096;   // [ ] 
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_TEXTURE_BUFFER
+#define GL_TEXTURE_BUFFER 0x8C2A
+#define GL_MAX_TEXTURE_BUFFER_SIZE 0x8C2B
+#endif
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+#ifndef GL_R32UI
+#define GL_R32UI 0x8236
+#define GL_RG32UI 0x823C
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+typedef void (APIENTRY* PfnActiveTexture)(GLenum);
+typedef void (APIENTRY* PfnTexBuffer)(GLenum, GLenum, GLuint);
+typedef void (APIENTRY* PfnUniform1i)(GLint, GLint);
+typedef void (APIENTRY* PfnUniform4f)(GLint, GLfloat, GLfloat, GLfloat, GLfloat);
+
+// ԴǰƸԵԲ˶
+struct PointLight {
+    float center[3];   // 켣ģ꣩
+    float orbit;       // 켣뾶
+    float phase;       // ࣨȣ
+    float speed;       // ٶȣ/룬Ϊ
+    float color[3];    // Դɫͬʱ;淴䣩
+    float range;       // Ӱ뾶ǿȰ (1 - d^2/range^2)^2 ˥0ͰݴȷǵĴ
+};
 
-    // λò - ʹԤ
-    // row: 1=һ, 2=ڶ, 3=
-    // col: 1=һ, 2=ڶ, 3=, 4=
-    switch (row) {
-    case 1: // һ - ޻
-        if (col == 1) { // 
-            glMaterialfv(GL_FRONT, GL_AMBIENT, noMaterial);    // ޻
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);   // ɫ
-            glMaterialfv(GL_FRONT, GL_SPECULAR, noMaterial);   // ޾淴
-            glMaterialf(GL_FRONT, GL_SHININESS, 0.0f);         // ޹
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);   // Է
-        }
-        else if (col == 2) { //  + ;
-            glMaterialfv(GL_FRONT, GL_AMBIENT, noMaterial);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, whiteSpecular); // ɫ淴
-            glMaterialf(GL_FRONT, GL_SHININESS, 5.0f);          // ͹
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
-        }
-        else if (col == 3) { //  + ߾
-            glMaterialfv(GL_FRONT, GL_AMBIENT, noMaterial);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, whiteSpecular);
-            glMaterialf(GL_FRONT, GL_SHININESS, 100.0f);        // ߹
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
-        }
-        else { //  + Է
-            glMaterialfv(GL_FRONT, GL_AMBIENT, noMaterial);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, noMaterial);
-            glMaterialfv(GL_FRONT, GL_EMISSION, redEmission);   // ɫԷ
-            glMaterialf(GL_FRONT, GL_SHININESS, 0.0f);
-        }
-        break;
-
-    case 2: // ڶ - л
-        if (col == 1) { //  + ޾
-            glMaterialfv(GL_FRONT, GL_AMBIENT, grayAmbient);   // ɫ
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, noMaterial);
-            glMaterialf(GL_FRONT, GL_SHININESS, 0.0f);
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
-        }
-        else if (col == 2) { //  +  + ;
-            glMaterialfv(GL_FRONT, GL_AMBIENT, grayAmbient);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, whiteSpecular);
-            glMaterialf(GL_FRONT, GL_SHININESS, 5.0f);
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
-        }
-        else if (col == 3) { //  +  + ߾
-            glMaterialfv(GL_FRONT, GL_AMBIENT, grayAmbient);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, whiteSpecular);
-            glMaterialf(GL_FRONT, GL_SHININESS, 100.0f);
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
-        }
-        else { //  +  + Է
-            glMaterialfv(GL_FRONT, GL_AMBIENT, grayAmbient);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, noMaterial);
-            glMaterialfv(GL_FRONT, GL_EMISSION, redEmission);
-            glMaterialf(GL_FRONT, GL_SHININESS, 0.0f);
-        }
-        break;
-
-    case 3: //  - вɫ
-        if (col == 1) { //  + ɫ޾
-            glMaterialfv(GL_FRONT, GL_AMBIENT, yellowAmbient); // ɫ
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, noMaterial);
-            glMaterialf(GL_FRONT, GL_SHININESS, 0.0f);
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
+const char* CLUSTERED_VERTEX_SHADER =
+    "#version 330 compatibility\n"
+    "in vec3 position;\n"
+    "in vec4 instance;\n"
+    "uniform float radius;\n"
+    "out vec3 eyePosition;\n"
+    "out vec3 eyeNormal;\n"
+    "flat out int materialIndex;\n"
+    "void main() {\n"
+    "    vec4 eyePos = gl_ModelViewMatrix * vec4(instance.xyz + position * radius, 1.0);\n"
+    "    eyePosition = eyePos.xyz;\n"
+    "    eyeNormal = gl_NormalMatrix * position;\n"
+    "    materialIndex = int(instance.w);\n"
+    "    gl_Position = gl_ProjectionMatrix * eyePos;\n"
+    "}\n";
+// صĻ %d ʽ initClusteredLighting 룬CPU˳һ
+const char* CLUSTERED_FRAGMENT_SHADER =
+    "#version 330 compatibility\n"
+    "const ivec3 CLUSTERS = ivec3(%d, %d, %d);\n"
+    "struct Material { vec4 ambient; vec4 diffuse; vec4 specular; vec4 emission; vec4 shininess; };\n"
+    "layout(std140) uniform Materials { Material materials[12]; };\n"
+    "uniform samplerBuffer lightData;\n"      // ÿԴtexelӵ + Ӱ뾶ɫ
+    "uniform usamplerBuffer clusterData;\n"   // ÿ (Դб, )
+    "uniform usamplerBuffer lightIndices;\n"  // صĹԴбβ
+    "uniform vec4 clusterParams;\n"           // ӿڿ, ӿڸ, ü, log(Զ/)
+    "in vec3 eyePosition;\n"
+    "in vec3 eyeNormal;\n"
+    "flat in int materialIndex;\n"
+    "float specularTerm(vec3 n, vec3 l, float shininess) {\n"  // Ǿֲ۲ߣȡ l + (0,0,1)
+    "    float nh = max(dot(n, normalize(l + vec3(0.0, 0.0, 1.0))), 0.0);\n"
+    "    return shininess == 0.0 ? 1.0 : pow(nh, shininess);\n"
+    "}\n"
+    "void main() {\n"
+    "    Material m = materials[materialIndex];\n"
+    "    vec3 n = normalize(eyeNormal);\n"
+    "    vec4 lightPos = gl_LightSource[0].position;\n"
+    "    vec3 l = normalize(lightPos.w == 0.0 ? lightPos.xyz : lightPos.xyz - eyePosition);\n"
+    "    float nl = max(dot(n, l), 0.0);\n"
+    "    vec3 c = (m.emission + m.ambient * gl_LightModel.ambient + m.ambient * gl_LightSource[0].ambient\n"
+    "           + nl * m.diffuse * gl_LightSource[0].diffuse).rgb;\n"
+    "    if (nl > 0.0) c += specularTerm(n, l, m.shininess.x) * (m.specular * gl_LightSource[0].specular).rgb;\n"
+    "    ivec3 cell = ivec3(vec3(gl_FragCoord.xy / clusterParams.xy, log(-eyePosition.z / clusterParams.z) / clusterParams.w) * vec3(CLUSTERS));\n"
+    "    cell = clamp(cell, ivec3(0), CLUSTERS - 1);\n"
+    "    uvec2 range = texelFetch(clusterData, (cell.z * CLUSTERS.y + cell.y) * CLUSTERS.x + cell.x).xy;\n"
+    "    for (uint i = 0u; i < range.y; ++i) {\n"
+    "        int id = int(texelFetch(lightIndices, int(range.x + i)).x);\n"
+    "        vec4 pr = texelFetch(lightData, 2 * id);\n"
+    "        vec3 d = pr.xyz - eyePosition;\n"
+    "        float d2 = dot(d, d), r2 = pr.w * pr.w;\n"
+    "        if (d2 >= r2) continue;\n"
+    "        vec3 pl = d * inversesqrt(d2);\n"
+    "        float pnl = dot(n, pl);\n"
+    "        if (pnl <= 0.0) continue;\n"
+    "        float falloff = 1.0 - d2 / r2;\n"
+    "        c += falloff * falloff * texelFetch(lightData, 2 * id + 1).rgb * (pnl * m.diffuse.rgb + specularTerm(n, pl, m.shininess.x) * m.specular.rgb);\n"
+    "    }\n"
+    "    gl_FragColor = vec4(clamp(c, 0.0, 1.0), m.diffuse.a);\n"
+    "}\n";
+
+struct ClusteredLighting {
+    bool ready = false;               // ʼɹҪʵ壩
+    bool enabled = false;             // ǰǷʹôع
+    int lightCount = 256;             // Դ
+    std::vector<PointLight> lights;
+    std::vector<GLfloat> lightData;   // ÿ֡ÿԴvec4ӵ+뾶ɫ
+    std::vector<float> lightPositions;  // ÿ֡ԴλõSoAx[n], y[n], z[n]дԭر任ӵ
+    std::vector<GLuint> clusterData;  // ÿ֡ÿ (, )
+    std::vector<GLuint> lightIndices; // ÿ֡صĹԴ
+    std::vector<int> lightCells;      // ÿ֡ÿԴǵĴطΧ x0 x1 y0 y1 z0 z1x0 > x1 ʾɼ
+    std::vector<GLuint> cursor;       // Ͱڶид
+    GLint maxIndices = 65536;         // texelGL 3.1 ֤65536
+    GLuint program = 0;
+    GLint radiusLocation = -1;
+    GLint paramsLocation = -1;
+    GLuint buffers[3] = { 0, 0, 0 };  // Դء
+    GLuint textures[3] = { 0, 0, 0 }; // Ӧ
+    double binMs = 0;                 // ͳƣͰϴʱۼ
+    double perCluster = 0;            // ͳƣǿմصƽԴۼ
+    int frames = 0;                   // ͳƣͳڵ֡
+    int statStart = 0;                // ͳڿʼʱ䣨룩
+    PfnActiveTexture activeTexture = nullptr;
+    PfnTexBuffer texBuffer = nullptr;
+    PfnUniform1i uniform1i = nullptr;
+    PfnUniform4f uniform4f = nullptr;
+} clustered;
+
+// ̶ɵԴֲǰ
+void generatePointLights() {
+    unsigned int seed = 20240601u;
+    float random[9];
+    float halfWidth = grid.cols * grid.spacing * 0.5f, halfHeight = grid.rows * grid.spacing * 0.5f;
+    clustered.lights.resize(clustered.lightCount);
+    for (PointLight& p : clustered.lights) {
+        for (float& r : random) {  // ͬ࣬[0, 1)
+            seed = seed * 1664525u + 1013904223u;
+            r = (seed >> 8) * (1.0f / 16777216.0f);
         }
-        else if (col == 2) { //  + ɫ + ;
-            glMaterialfv(GL_FRONT, GL_AMBIENT, yellowAmbient);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, whiteSpecular);
-            glMaterialf(GL_FRONT, GL_SHININESS, 5.0f);
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
-        }
-        else if (col == 3) { //  + ɫ + ߾
-            glMaterialfv(GL_FRONT, GL_AMBIENT, yellowAmbient);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, whiteSpecular);
-            glMaterialf(GL_FRONT, GL_SHININESS, 100.0f);
-            glMaterialfv(GL_FRONT, GL_EMISSION, noMaterial);
-        }
-        else { //  + ɫ + Է
-            glMaterialfv(GL_FRONT, GL_AMBIENT, yellowAmbient);
-            glMaterialfv(GL_FRONT, GL_DIFFUSE, blueDiffuse);
-            glMaterialfv(GL_FRONT, GL_SPECULAR, noMaterial);
-            glMaterialfv(GL_FRONT, GL_EMISSION, redEmission);
-            glMaterialf(GL_FRONT, GL_SHININESS, 0.0f);
-        }
-        break;
+        p.center[0] = 0.25f + (random[0] * 2.0f - 1.0f) * halfWidth;  //  (0.25, 0)
+        p.center[1] = (random[1] * 2.0f - 1.0f) * halfHeight;
+        p.center[2] = grid.depth + grid.radius + 0.2f + random[2] * grid.spacing;  // ǰ
+        p.orbit = (0.2f + 0.5f * random[3]) * grid.spacing;
+        p.phase = random[4] * 2.0f * static_cast<float>(PI);
+        p.speed = (random[5] < 0.5f ? -1.0f : 1.0f) * (0.5f + 1.5f * random[6]);
+        p.color[0] = 0.1f + 0.5f * random[7];  // ƫůƫɫԴϰӺ׹
+        p.color[1] = 0.1f + 0.5f * random[8];
+        p.color[2] = 0.1f + 0.5f * (1.0f - random[7]);
+        p.range = (0.8f + 0.8f * random[3]) * grid.spacing;
+    }
+}
+
+// ÿ֡µԴλò任ӵ꣬ǵĴطͰϴ
+void binPointLights(const Mat4& view, float seconds) {
+    auto start = std::chrono::steady_clock::now();
+    int n = static_cast<int>(clustered.lights.size());
+    double tanY = tan(projection.fovY * 0.5 * PI / 180.0), tanX = tanY * projection.aspect;
+    double logDepth = log(projection.zFar / projection.zNear);
+    clustered.lightData.resize(static_cast<size_t>(n) * 8);
+    clustered.lightCells.resize(static_cast<size_t>(n) * 6);
+    clustered.clusterData.assign(CLUSTER_COUNT * 2, 0);
+    clustered.lightPositions.resize(static_cast<size_t>(n) * 3);
+    float* px = clustered.lightPositions.data();
+    float* py = px + n;
+    float* pz = py + n;
+    for (int i = 0; i < n; i++) {  // ֡꣺ת
+        const PointLight& p = clustered.lights[i];
+        float angle = p.phase + p.speed * seconds;
+        px[i] = p.center[0] + p.orbit * cosf(angle);
+        py[i] = p.center[1] + p.orbit * sinf(angle);
+        pz[i] = p.center[2];
     }
+    transformPointSpan(view, px, py, pz, px, py, pz, n);  // ȫԴһα任ӵ꣨SIMD_WIDTH һ飩
+    for (int i = 0; i < n; i++) {
+        const PointLight& p = clustered.lights[i];
+        float ex = px[i], ey = py[i], ez = pz[i];
+        GLfloat* data = &clustered.lightData[static_cast<size_t>(i) * 8];
+        data[0] = ex; data[1] = ey; data[2] = ez; data[3] = p.range;
+        data[4] = p.color[0]; data[5] = p.color[1]; data[6] = p.color[2]; data[7] = 0.0f;
+
+        // ԴΧ׶иǵĴأȷΧü/Զƽ
+        // Ļ x/depth ļֵһȷΧ
+        int* cells = &clustered.lightCells[static_cast<size_t>(i) * 6];
+        cells[0] = 1; cells[1] = 0;  // Ĭϲɼ
+        double d0 = -ez - p.range, d1 = -ez + p.range;
+        if (d1 <= projection.zNear || d0 >= projection.zFar) continue;
+        d0 = fmax(d0, projection.zNear);
+        d1 = fmin(d1, projection.zFar);
+        double x0 = ex - p.range, x1 = ex + p.range, y0 = ey - p.range, y1 = ey + p.range;
+        double sx0 = fmin(x0 / d0, x0 / d1) / tanX, sx1 = fmax(x1 / d0, x1 / d1) / tanX;  // NDC
+        double sy0 = fmin(y0 / d0, y0 / d1) / tanY, sy1 = fmax(y1 / d0, y1 / d1) / tanY;
+        if (sx1 < -1.0 || sx0 > 1.0 || sy1 < -1.0 || sy0 > 1.0) continue;
+        cells[0] = static_cast<int>(floor((fmax(sx0, -1.0) * 0.5 + 0.5) * CLUSTER_X));
+        cells[1] = static_cast<int>(floor((fmin(sx1, 1.0) * 0.5 + 0.5) * CLUSTER_X));
+        cells[2] = static_cast<int>(floor((fmax(sy0, -1.0) * 0.5 + 0.5) * CLUSTER_Y));
+        cells[3] = static_cast<int>(floor((fmin(sy1, 1.0) * 0.5 + 0.5) * CLUSTER_Y));
+        cells[4] = static_cast<int>(floor(log(d0 / projection.zNear) / logDepth * CLUSTER_Z));
+        cells[5] = static_cast<int>(floor(log(d1 / projection.zNear) / logDepth * CLUSTER_Z));
+        if (cells[1] > CLUSTER_X - 1) cells[1] = CLUSTER_X - 1;  // ǡ//Զ߽ʱ
+        if (cells[3] > CLUSTER_Y - 1) cells[3] = CLUSTER_Y - 1;
+        if (cells[5] > CLUSTER_Z - 1) cells[5] = CLUSTER_Z - 1;
+        for (int cz = cells[4]; cz <= cells[5]; cz++)
+            for (int cy = cells[2]; cy <= cells[3]; cy++)
+                for (int cx = cells[0]; cx <= cells[1]; cx++)
+                    clustered.clusterData[((cz * CLUSTER_Y + cy) * CLUSTER_X + cx) * 2 + 1]++;
+    }
+
+    // ǰ׺ȷб㣻ʱضϿĴ
+    GLuint total = 0, nonEmpty = 0;
+    for (int c = 0; c < CLUSTER_COUNT; c++) {
+        GLuint count = clustered.clusterData[c * 2 + 1];
+        if (count > static_cast<GLuint>(clustered.maxIndices) - total) count = static_cast<GLuint>(clustered.maxIndices) - total;
+        clustered.clusterData[c * 2] = total;
+        clustered.clusterData[c * 2 + 1] = count;
+        total += count;
+        if (count) nonEmpty++;
+    }
+    clustered.lightIndices.resize(total > 0 ? total : 1);
+    clustered.cursor.assign(CLUSTER_COUNT, 0);
+    for (int i = 0; i < n; i++) {
+        const int* cells = &clustered.lightCells[static_cast<size_t>(i) * 6];
+        for (int cz = cells[4]; cells[0] <= cells[1] && cz <= cells[5]; cz++)
+            for (int cy = cells[2]; cy <= cells[3]; cy++)
+                for (int cx = cells[0]; cx <= cells[1]; cx++) {
+                    int c = (cz * CLUSTER_Y + cy) * CLUSTER_X + cx;
+                    if (clustered.cursor[c] < clustered.clusterData[c * 2 + 1])
+                        clustered.lightIndices[clustered.clusterData[c * 2] + clustered.cursor[c]++] = static_cast<GLuint>(i);
+                }
+    }
+
+    instanced.bindBuffer(GL_TEXTURE_BUFFER, clustered.buffers[0]);
+    instanced.bufferData(GL_TEXTURE_BUFFER, (n > 0 ? clustered.lightData.size() : 8) * sizeof(GLfloat), n > 0 ? clustered.lightData.data() : nullptr, GL_STREAM_DRAW);
+    instanced.bindBuffer(GL_TEXTURE_BUFFER, clustered.buffers[1]);
+    instanced.bufferData(GL_TEXTURE_BUFFER, clustered.clusterData.size() * sizeof(GLuint), clustered.clusterData.data(), GL_STREAM_DRAW);
+    instanced.bindBuffer(GL_TEXTURE_BUFFER, clustered.buffers[2]);
+    instanced.bufferData(GL_TEXTURE_BUFFER, clustered.lightIndices.size() * sizeof(GLuint), clustered.lightIndices.data(), GL_STREAM_DRAW);
+    instanced.bindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // ÿӡһͳ
+    clustered.binMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    clustered.perCluster += nonEmpty ? static_cast<double>(total) / nonEmpty : 0.0;
+    clustered.frames++;
+    int now = glutGet(GLUT_ELAPSED_TIME);
+    if (now - clustered.statStart >= 1000) {
+        printf("ع: %d Դ, ǿմƽ %.1f Դ, Ͱ %.2f ms/֡, %.1f ֡/\n", n,
+            clustered.perCluster / clustered.frames, clustered.binMs / clustered.frames, clustered.frames * 1000.0 / (now - clustered.statStart));
+        clustered.binMs = 0;
+        clustered.perCluster = 0;
+        clustered.frames = 0;
+        clustered.statStart = now;
+    }
+}
+
+//  initInstancedSpheres ɹãعɫ壻ʧʱعģʽ
+bool initClusteredLighting() {
+    clustered.activeTexture = reinterpret_cast<PfnActiveTexture>(glutGetProcAddress("glActiveTexture"));
+    clustered.texBuffer = reinterpret_cast<PfnTexBuffer>(glutGetProcAddress("glTexBuffer"));
+    clustered.uniform1i = reinterpret_cast<PfnUniform1i>(glutGetProcAddress("glUniform1i"));
+    clustered.uniform4f = reinterpret_cast<PfnUniform4f>(glutGetProcAddress("glUniform4f"));
+    if (!clustered.activeTexture || !clustered.texBuffer || !clustered.uniform1i || !clustered.uniform4f) {
+        fprintf(stderr, "޷شعGLعģʽ\n");
+        return false;
+    }
+    char fragmentSource[4096];
+    snprintf(fragmentSource, sizeof(fragmentSource), CLUSTERED_FRAGMENT_SHADER, CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+    clustered.program = linkSphereProgram(CLUSTERED_VERTEX_SHADER, fragmentSource);
+    if (!clustered.program) return false;
+    clustered.radiusLocation = instanced.getUniformLocation(clustered.program, "radius");
+    clustered.paramsLocation = instanced.getUniformLocation(clustered.program, "clusterParams");
+    instanced.useProgram(clustered.program);  // ʹԪ0~2
+    clustered.uniform1i(instanced.getUniformLocation(clustered.program, "lightData"), 0);
+    clustered.uniform1i(instanced.getUniformLocation(clustered.program, "clusterData"), 1);
+    clustered.uniform1i(instanced.getUniformLocation(clustered.program, "lightIndices"), 2);
+    instanced.useProgram(0);
+
+    const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+    instanced.genBuffers(3, clustered.buffers);
+    glGenTextures(3, clustered.textures);
+    for (int i = 0; i < 3; i++) {
+        instanced.bindBuffer(GL_TEXTURE_BUFFER, clustered.buffers[i]);
+        instanced.bufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, clustered.textures[i]);
+        clustered.texBuffer(GL_TEXTURE_BUFFER, formats[i], clustered.buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    instanced.bindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &clustered.maxIndices);
+    generatePointLights();
+    clustered.ready = true;
+    return true;
+}
+
+// 󶨹Դ/ݺһʵ
+void drawClusteredSpheres() {
+    instanced.useProgram(clustered.program);
+    clustered.uniform4f(clustered.paramsLocation, static_cast<GLfloat>(projection.width), static_cast<GLfloat>(projection.height),
+        static_cast<GLfloat>(projection.zNear), static_cast<GLfloat>(log(projection.zFar / projection.zNear)));
+    for (int i = 0; i < 3; i++) {
+        clustered.activeTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_BUFFER, clustered.textures[i]);
+    }
+    drawSphereInstances(clustered.program, clustered.radiusLocation);
+    for (int i = 2; i >= 0; i--) {
+        clustered.activeTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+}
 
-    // 
-    GLUquadric* quadric = gluNewQuadric();          // 
-    gluQuadricNormals(quadric, GLU_SMOOTH);         // ƽ
-    gluSphere(quadric, radius, 30, 30);             // 壨뾶ȷֶγȷֶ
-    gluDeleteQuadric(quadric);                      // ɾ
-    glPopMatrix();                                  // ָ״̬
+// лصعģʽµԴ˶ػ
+void handleIdle() {
+    glutPostRedisplay();
+}
+
+// شعģʽʱԴ˶Ҫлصػ
+void setClusteredLighting(bool enable) {
+    if (enable && !clustered.ready) {
+        printf("عģʽҪ OpenGL 3.3 ʵ\n");
+        return;
+    }
+    clustered.enabled = enable;
+    clustered.statStart = glutGet(GLUT_ELAPSED_TIME);
+    clustered.frames = 0;
+    clustered.binMs = 0;
+    clustered.perCluster = 0;
+    glutIdleFunc(enable ? handleIdle : nullptr);
+    if (enable) printf("عģʽ: %d Դ\n", clustered.lightCount);
+    else printf("عģʽر\n");
+}
+
+// Դ
+void setPointLightCount(int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_POINT_LIGHTS) count = MAX_POINT_LIGHTS;
+    clustered.lightCount = count;
+    if (!clustered.ready) return;
+    generatePointLights();
+    if (clustered.enabled) printf("عģʽ: %d Դ\n", clustered.lightCount);
+}
+
+// õ index ֲʣʱʹã
+void applyMaterial(int index) {
+    const Material& m = materials[index];
+    glMaterialfv(GL_FRONT, GL_AMBIENT, m.ambient);
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, m.diffuse);
+    glMaterialfv(GL_FRONT, GL_SPECULAR, m.specular);
+    glMaterialf(GL_FRONT, GL_SHININESS, m.shininess[0]);
+    glMaterialfv(GL_FRONT, GL_EMISSION, m.emission);
+}
+
+// Ƶ壨·ʹԤϸֵ񣬶ɵ
+void renderSphereAt(float x, float y, float z, float radius) {
+    glPushMatrix();         // 浱ǰ״̬
+    glTranslatef(x, y, z);  // ƶָλ
+    glScalef(radius, radius, radius);  // λŵ뾶GL_NORMALIZE ¹һ
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(sphereIndices.size()), GL_UNSIGNED_SHORT, sphereIndices.data());
+    glPopMatrix();          // ָ״̬
 }
 
 // Ⱦ
@@ -174,33 +769,46 @@ void renderScene() {
     // camX = distance * sin(angleY) * cos(angleX)
     // camY = distance * sin(angleX)
     // camZ = distance * cos(angleY) * cos(angleX)
-    float camX = camera.distance * static_cast<float>(sin(camera.angleY) * cos(camera.angleX));
-    float camY = camera.distance * static_cast<float>(sin(camera.angleX));
-    float camZ = camera.distance * static_cast<float>(cos(camera.angleY) * cos(camera.angleX));
+    Vec3 eye = Vec3(sinf(camera.angleY) * cosf(camera.angleX), sinf(camera.angleX), cosf(camera.angleY) * cosf(camera.angleX)) * camera.distance;
 
-    glLoadIdentity();  // ģͼ
-    // ۾λã۲㣬
-    gluLookAt(camX, camY, camZ,        // λ
-        0.0f, 0.0f, 0.0f,        // ۲㣨ģ
-        0.0f, 1.0f, 0.0f);       // Y
+    // ۾λã۲㣨ģY򣩡
+    // ͼCPUϼ㣨 gluLookAt ͬ룬عշͰֱʹãٴGL
+    Mat4 view = Mat4::lookAt(eye, Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+    glLoadMatrixf(view.m);
 
     // ¹Դ
     glLightfv(GL_LIGHT0, GL_POSITION, light.position);  // ùԴλ
     glLightfv(GL_LIGHT0, GL_DIFFUSE, light.diffuse);    // ɫ
     glLightfv(GL_LIGHT0, GL_SPECULAR, light.specular);  // þ淴ɫ
 
-    // Ⱦ壨3С4У
-    for (int row = 0; row < 3; row++) {
-        for (int col = 0; col < 4; col++) {
-            renderSphereAt(
-                spherePositions[row][col][0],  // X
-                spherePositions[row][col][1],  // Y
-                spherePositions[row][col][2],  // Z
-                0.5f,                          // 뾶
-                row + 1,                       // кţ1-based
-                col + 1                        // кţ1-based
-            );
+    // Ⱦ壨grid.rowsСgrid.colsУ
+    if (clustered.enabled) {
+        binPointLights(view, glutGet(GLUT_ELAPSED_TIME) * 0.001f);  // view -> ӵ
+        drawClusteredSpheres();  // һʵƣƬαڴصĹԴ
+    }
+    else if (instanced.ready) {
+        drawSphereInstances(instanced.program, instanced.radiusLocation);  // һʵ
+    }
+    else {
+        glEnableClientState(GL_VERTEX_ARRAY);  // λͬʱΪ
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glVertexPointer(3, GL_FLOAT, 0, sphereVertices.data());
+        glNormalPointer(GL_FLOAT, 0, sphereVertices.data());
+        int currentMaterial = -1;
+        for (int row = 0; row < grid.rows; row++) {
+            for (int col = 0; col < grid.cols; col++) {
+                int material = (row % 3) * 4 + col % 4;
+                if (material != currentMaterial) {  // ͬ岻ظ
+                    applyMaterial(material);
+                    currentMaterial = material;
+                }
+                float center[3];
+                sphereCenter(row, col, center);
+                renderSphereAt(center[0], center[1], center[2], grid.radius);
+            }
         }
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
     }
 
     glutSwapBuffers();  // ǰ󻺳˫壩
@@ -220,6 +828,11 @@ void handleKeyboard(unsigned char key, int x, int y) {
     case 'y': light.diffuse[1] = fmaxf(0.0f, light.diffuse[1] - light.colorStep); break;  // ɫ
     case 'u': light.diffuse[2] = fminf(1.0f, light.diffuse[2] + light.colorStep); break;  // ɫ
     case 'i': light.diffuse[2] = fmaxf(0.0f, light.diffuse[2] - light.colorStep); break;  // ɫ
+
+        // عģʽ
+    case 'l': setClusteredLighting(!clustered.enabled); break;  // ضԴģʽ
+    case '[': setPointLightCount(clustered.lightCount / 2); break;  // Դ
+    case ']': setPointLightCount(clustered.lightCount * 2); break;  // Դӱ
     }
     glutPostRedisplay();  // Ҫ»
 }
@@ -275,7 +888,10 @@ void handleReshape(int width, int height) {
     glLoadIdentity();                 // ͶӰ
 
     // ͸ͶӰӽ45ȣ߱ȣü1.0Զü100.0
-    gluPerspective(45.0, static_cast<double>(width) / static_cast<double>(height), 1.0, 100.0);
+    projection.aspect = static_cast<double>(width) / static_cast<double>(height);
+    projection.width = width;
+    projection.height = height;
+    gluPerspective(projection.fovY, projection.aspect, projection.zNear, projection.zFar);
 
     glMatrixMode(GL_MODELVIEW);       // лģͼ
 }
@@ -283,6 +899,20 @@ void handleReshape(int width, int height) {
 int main(int argc, char** argv) {
     // ʼGLUT
     glutInit(&argc, argv);
+    // вGLUTѱ glutInit Ƴ--grid  У--lights Դ
+    bool startClustered = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--grid") == 0 && i + 2 < argc) {
+            grid.rows = atoi(argv[++i]);
+            grid.cols = atoi(argv[++i]);
+            if (grid.rows < 1) grid.rows = 1;
+            if (grid.cols < 1) grid.cols = 1;
+        }
+        else if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {  // --lights Nʱعģʽ
+            startClustered = true;
+            clustered.lightCount = atoi(argv[++i]);
+        }
+    }
     // ʾģʽ˫塢RGBɫȻ
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(800, 600);                    // ôڴС
@@ -290,6 +920,15 @@ int main(int argc, char** argv) {
 
     // ûص
     initializeGraphics();              // ʼOpenGL
+    initMaterials();                   // װʱ
+    buildSphereMesh();                 // ϸһ
+    if (initInstancedSpheres()) printf(" %d%dÿ֡һʵ\n", grid.rows, grid.cols);
+    else printf(" %d%d\n", grid.rows, grid.cols);
+    if (instanced.ready) initClusteredLighting();  // عģʽʵ֮
+    if (startClustered) {
+        setPointLightCount(clustered.lightCount);
+        setClusteredLighting(true);
+    }
     glutDisplayFunc(renderScene);      // ʾص
     glutReshapeFunc(handleReshape);    // ôܻص
     glutKeyboardFunc(handleKeyboard);  // ü̻ص
@@ -4,29 +4,54 @@
  * 
  * һʹOpenGLGLUTļ3DȾʾȾһȣظ10λɣذ塢ǽں컨壬ʹBMPء
  * ֧MipmapģʽĶ̬лͨҼ˵ѡͬNEAREST, LINEAR, MIPMAP壩
- * ̼ͷתǰ/ˣקӽת͸
+ * ̼ͷתǰ/ˣקӽת͸[ ] ȶ/ӱE л޾ȡ
  *
  * Ҫԣ
- * - BMPأַ֧2256x256ʹgluScaleImagegluBuild2DMipmapsMipmap
+ * - ߣɫռλ̨߳ӳBMPѷ2Сԭߴ2ݲMipmap
+ *   ֧S3TCʱѹΪBC1ԴļݹϣΪ <ļ>.mipֱ֮ӳ仺沢ϴݡ
  * - ˣ˵лMIN_FILTERMAGʼΪLINEARʾMipmapԶĿЧ
- * - ȴz=-600/߶ȡ10ظGL_REPEAT
+ * - Ĭϴz=-6007Σ--segments N--segment-length L ɵ/߶ȡ10ظGL_REPEAT
+ * - ΣʱһΣ뾲̬㻺壨GL 1.5 VBO֧ʱΪ飩ÿÿ֡һλƵá
+ * - ׶޳ÿֻ֡ǰԶüڵĶ䣬 onReshape ͸Ӳ޳ֻƿɼ䷶Χ
+ * - ޾ȣ--endless  E 㻺ֻ渲Ӿһ䣬ڶƽƺظʹã
+ *   ۲˫ȼ㣬ߵԶԴռÿ֡Ҳ䡣
+ * - פذ/ǽ/컨ҪϸMip𣬸ϸļӳMip水ϴҪʱͷ
+ *   GL_TEXTURE_BASE_LEVEL
  * - ͸ͶӰ35.5 FOV֧ƽơתơ
  * - ԴҪresource/Ŀ¼µground.bmp, wall.bmp, ceiling.bmpļ
  *
  * У
- * g++ -o mipmap_demo main.c -lGL -lGLU -lglut -lmfreeglut
- * ./mipmap_demo
+ * g++ -std=c++11 -o mipmap_demo main.cpp -lGL -lGLU -lglut -lm -lpthreadfreeglut
+ * ./mipmap_demo [--segments N] [--segment-length L] [--endless]
  *
- * ע⣺400x400ʧʱIDΪ0ʹGL_BGR_EXTBMPʽ
+ * ע⣺400x400ʧʱɫռλֻ֧24λBMPGL_BGR_EXTϴ
  */
 
 #define _CRT_SECURE_NO_WARNINGS  // Visual StudiofopenȰȫ
 
-#include <stdio.h>       // ׼I/Ofopen, fread
-#include <stdlib.h>      // ڴ䣬malloc, free
-#include <Windows.h>     // Windows APIڼݣǱ裩
+#include <stdio.h>       // ׼I/Ofopen, fwriteдMip棩
+#include <stdlib.h>      // atexit˳ʱȴ߳
+#include <string.h>      // memcpy, strstr, strcmpBMPͷGLչв
+#include <stddef.h>      // ptrdiff_t㻺С
+#include <math.h>        // tan, sqrt, floor׶޳פ
+#include <stdint.h>      // uint32_t, uint64_tļͷļϣ
+#include <vector>        // Mip
+#include <thread>        // ̨߳
+#include <atomic>        // ״̬߳дGL̶߳
+#include <chrono>        // ʱ
+#if defined(_WIN32)
+#include <Windows.h>     // Windows APICreateFileMapping/MapViewOfFile ӳͼ뻺ļ
+#else
+#include <sys/mman.h>    // mmapӳͼ뻺ļ
+#include <fcntl.h>       // open
+#include <unistd.h>      // close
+#endif
 #include <GL/freeglut.h> // FreeGLUT⣺ڹ¼OpenGL
 
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0  // BC1DXT1ÿ4x48ֽ
+#endif
+
  // IDȫ֣ڰ
 GLuint groundTex;  // ذ
 GLuint wallTex;    // ǽ
@@ -37,11 +62,11 @@ GLuint textures[3];
 
 static int isMenuOpen = 0;  // ˵򿪱־ֹ꽻ͻ
 
-#define BMP_OFFSET 54  // BMPļͷСƫƣ
+#define BMP_OFFSET 54  // BMPļͷ+ϢͷСС
 
 // ȫֱ任
 static GLfloat rotateAngle = 0.0f;   // YתǶȣ̿ƣ
-static GLfloat depthPos = 0.0f;      // Zƽƣǰ/ˣ
+static GLdouble depthPos = 0.0;      // Zƽƣǰ/ˣ˫ȣ޾ߵúԶҲʧ
 static GLint prevMouseX, prevMouseY; // ϴλãק㣩
 static GLfloat mouseRotate = 0.0f;   // Yת
 static GLfloat mouseDepth = 0.0f;    // ZƽƣδʹãӦõ޸£
@@ -53,77 +78,469 @@ int isPowerOfTwo(int num) {
     return (num & (num - 1)) == 0;  // λ㣺2^nֻһλΪ1
 }
 
-/* BMPļȡšMipmapID */
-GLuint loadBmpTexture(const char* filename) {
-    GLint imgWidth, imgHeight, dataSize;  // ͼߴݴС
-    GLubyte* pixelData = NULL;            // ݻ
-    GLuint texID = 0;                     // ID
-
-    // BMPļģʽ
-    FILE* file = fopen(filename, "rb");
-    if (!file) return 0;  // ļʧ
-
-    // ȡȣļƫ0x0012
-    fseek(file, 0x0012, SEEK_SET);
-    fread(&imgWidth, 4, 1, file);
-    // ȡ߶ȣƫ0x0016
-    fread(&imgHeight, 4, 1, file);
-    // ݣƫ54
-    fseek(file, BMP_OFFSET, SEEK_SET);
-
-    // ֽڣRGB=3ֽ/أ4ֽڶ룩
-    GLint rowBytes = imgWidth * 3;
-    while (rowBytes % 4 != 0) ++rowBytes;  // 䵽4ı
-    dataSize = rowBytes * imgHeight;       // ݴС
-
-    // ػ
-    pixelData = (GLubyte*)malloc(dataSize);
-    if (!pixelData) {
-        fclose(file);
-        return 0;  // ڴʧ
-    }
-
-    // ȡݣBGRʽ
-    if (fread(pixelData, dataSize, 1, file) <= 0) {
-        free(pixelData);
-        fclose(file);
-        return 0;  // ȡʧ
-    }
-
-    // ߴ磺2ҲС
-    GLint maxTexSize;
-    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
-    if (!isPowerOfTwo(imgWidth) || !isPowerOfTwo(imgHeight) ||
-        imgWidth > maxTexSize || imgHeight > maxTexSize) {
-        const GLint newSize = 256;  // 256x256
-        GLint newRowBytes = newSize * 3;
-        while (newRowBytes % 4 != 0) ++newRowBytes;  // 4ֽڶ
-        GLint newDataSize = newRowBytes * newSize;
-
-        // »
-        GLubyte* newPixelData = (GLubyte*)malloc(newDataSize);
-        if (!newPixelData) {
-            free(pixelData);
-            fclose(file);
-            return 0;
+// ====================  ====================
+// GL߳ȴ1x1ɫռλأ̨߳ӳBMPļݹϣ
+// л棨<ļ>.mipʱֱӳԤɵMip롢ŵ2ݡMip
+// ֧S3TCʱѹΪBC1дػ棻GL߳ڶʱϴѾĸݡ
+
+#define MIP_CACHE_MAGIC 0x4350494Du  // "MIPC"
+#define MIP_CACHE_VERSION 1u         // ʽ㷨仯ʱ1ɻԶʧЧ
+
+enum TextureFormat {
+    TEX_FORMAT_BGR8 = 0,  // δѹÿ3ֽBGRн
+    TEX_FORMAT_BC1 = 1    // BC1ѹ4x4鰴Уÿ8ֽ
+};
+
+typedef void (APIENTRY* PfnCompressedTexImage2D)(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei, const void*);
+static PfnCompressedTexImage2D compressedTexImage2D = NULL;  // GL 1.3 ʱ
+static int useCompression = 0;      // ֧ GL_EXT_texture_compression_s3tc ʱΪ1
+static GLint maxTextureSize = 256;  // GL_MAX_TEXTURE_SIZE̲߳ܵGLǰGL̲߳ѯ
+static int textureStreaming = 0;    // ֧ GL 1.2GL_TEXTURE_BASE_LEVELʱΪ1/ͷϸ
+static GLenum currentMinFilter = GL_LINEAR_MIPMAP_LINEAR;  // ˵ѡĹ˷ʽMipmapֱӲ0볣פ
+
+// ֻļӳ䣺ԴͼMip涼ҳȡڴ
+struct MappedFile {
+    const GLubyte* data = NULL;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = NULL;
+#endif
+
+    int open(const char* path) {
+        close();
+#if defined(_WIN32)
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return 0;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return 0; }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) { close(); return 0; }
+        data = (const GLubyte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) { close(); return 0; }
+        size = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return 0;
+        off_t end = lseek(fd, 0, SEEK_END);
+        if (end <= 0) { ::close(fd); return 0; }
+        void* p = mmap(NULL, (size_t)end, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // ӳ佨󼴿ɹر
+        if (p == MAP_FAILED) return 0;
+        data = (const GLubyte*)p;
+        size = (size_t)end;
+#endif
+        return 1;
+    }
+
+    void close() {
+#if defined(_WIN32)
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap((void*)data, size);
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+};
+
+// MipӴС data 
+struct MipChain {
+    int format = TEX_FORMAT_BGR8;
+    int width = 0, height = 0, levels = 0;  // 0ߴ뼶ֱ1x1
+    std::vector<GLubyte> storage;  // ʱе
+    MappedFile cache;              // ӻʱ data ֱָӳ
+    const GLubyte* data = NULL;
+
+    void release() {
+        std::vector<GLubyte>().swap(storage);
+        cache.close();
+        data = NULL;
+    }
+};
+
+//  level ĳߴ磨ÿ룬СΪ1
+static void mipLevelSize(int width, int height, int level, int& w, int& h) {
+    w = width >> level; if (w < 1) w = 1;
+    h = height >> level; if (h < 1) h = 1;
+}
+
+// һݵֽ
+static size_t mipLevelBytes(int format, int w, int h) {
+    if (format == TEX_FORMAT_BC1) return (size_t)((w + 3) / 4) * ((h + 3) / 4) * 8;
+    return (size_t)w * h * 3;
+}
+
+// Mipֽ
+static size_t mipChainBytes(int format, int width, int height, int levels) {
+    size_t total = 0;
+    for (int level = 0; level < levels; ++level) {
+        int w, h;
+        mipLevelSize(width, height, level, w, h);
+        total += mipLevelBytes(format, w, h);
+    }
+    return total;
+}
+
+// FNV-1a 64λϣȡԴļݣļ滻޸ĺ󻺴ԶʧЧ
+static uint64_t hashBytes(const GLubyte* p, size_t n, uint64_t h = 1469598103934665603ull) {
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// ļͷΪ
+struct MipCacheHeader {
+    uint32_t magic, version;
+    uint64_t key;  // Դļϣʽߴ磩
+    uint32_t format, width, height, levels;
+};
+
+// 24λBMPΪеBGRأ¶ϣtһ£ʽֻ֧ļضʱ0
+static int decodeBmp(const MappedFile& file, int& width, int& height, std::vector<GLubyte>& pixels) {
+    if (file.size < BMP_OFFSET || file.data[0] != 'B' || file.data[1] != 'M') return 0;
+    uint32_t offset;
+    int32_t w, h;
+    uint16_t bits;
+    memcpy(&offset, file.data + 0x000A, 4);  // ƫ
+    memcpy(&w, file.data + 0x0012, 4);       // 
+    memcpy(&h, file.data + 0x0016, 4);       // ߶ȣʾ϶£
+    memcpy(&bits, file.data + 0x001C, 2);    // ÿλ
+    if (bits != 24 || w <= 0 || h == 0) return 0;
+    int topDown = h < 0;
+    if (topDown) h = -h;
+    size_t rowBytes = ((size_t)w * 3 + 3) & ~(size_t)3;  // ÿ䵽4ֽ
+    if (offset > file.size || rowBytes * h > file.size - offset) return 0;
+    pixels.resize((size_t)w * h * 3);
+    for (int y = 0; y < h; ++y) {
+        const GLubyte* row = file.data + offset + rowBytes * (topDown ? h - 1 - y : y);
+        memcpy(&pixels[(size_t)y * w * 3], row, (size_t)w * 3);  // ȥ
+    }
+    width = w;
+    height = h;
+    return 1;
+}
+
+//  n 2ݣҲ limit
+static int floorPowerOfTwo(int n, int limit) {
+    int p = 1;
+    while (p * 2 <= n && p * 2 <= limit) p *= 2;
+    return p;
+}
+
+// ʽСĿȡ串ǷΧڵԴƽֵÿĿȡһԴأ
+static void resampleBox(const std::vector<GLubyte>& src, int sw, int sh, std::vector<GLubyte>& dst, int dw, int dh) {
+    dst.resize((size_t)dw * dh * 3);
+    for (int y = 0; y < dh; ++y) {
+        int y0 = (int)((long long)y * sh / dh), y1 = (int)((long long)(y + 1) * sh / dh);
+        if (y1 <= y0) y1 = y0 + 1;
+        for (int x = 0; x < dw; ++x) {
+            int x0 = (int)((long long)x * sw / dw), x1 = (int)((long long)(x + 1) * sw / dw);
+            if (x1 <= x0) x1 = x0 + 1;
+            unsigned sum[3] = { 0, 0, 0 };
+            for (int sy = y0; sy < y1; ++sy)
+                for (int sx = x0; sx < x1; ++sx)
+                    for (int c = 0; c < 3; ++c) sum[c] += src[((size_t)sy * sw + sx) * 3 + c];
+            unsigned count = (unsigned)((y1 - y0) * (x1 - x0));
+            for (int c = 0; c < 3; ++c) dst[((size_t)y * dw + x) * 3 + c] = (GLubyte)((sum[c] + count / 2) / count);
+        }
+    }
+}
+
+// һһ2x2ʽ˲ gluBuild2DMipmaps ͬĳһάΪ1ʱֻһάƽ
+static void downsampleHalf(const GLubyte* src, int sw, int sh, GLubyte* dst, int dw, int dh) {
+    for (int y = 0; y < dh; ++y) {
+        int ya = y * 2, yb = sh > 1 ? y * 2 + 1 : ya;
+        for (int x = 0; x < dw; ++x) {
+            int xa = x * 2, xb = sw > 1 ? x * 2 + 1 : xa;
+            for (int c = 0; c < 3; ++c) {
+                unsigned sum = src[((size_t)ya * sw + xa) * 3 + c] + src[((size_t)ya * sw + xb) * 3 + c]
+                    + src[((size_t)yb * sw + xa) * 3 + c] + src[((size_t)yb * sw + xb) * 3 + c];
+                dst[((size_t)y * dw + x) * 3 + c] = (GLubyte)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// BGRתRGB565
+static uint16_t packRGB565(const GLubyte* bgr) {
+    return (uint16_t)(((bgr[2] >> 3) << 11) | ((bgr[1] >> 2) << 5) | (bgr[0] >> 3));
+}
+
+// RGB565չΪ8λBGRλƵλ
+static void unpackRGB565(uint16_t c, int bgr[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    bgr[0] = (b << 3) | (b >> 2);
+    bgr[1] = (g << 2) | (g >> 4);
+    bgr[2] = (r << 3) | (r >> 2);
+}
+
+// BC1ѹһ4x4飨texels Ϊ16BGRأУ˵ȡɫΧеһԽߣ̵ѡ
+// 1/16ÿѡ4ɫɫһ֤ color0 > color1 ʹ4ɫģʽ
+static void encodeBC1Block(const GLubyte texels[16][3], GLubyte out[8]) {
+    GLubyte lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            if (texels[i][c] < lo[c]) lo[c] = texels[i][c];
+            if (texels[i][c] > hi[c]) hi[c] = texels[i][c];
         }
+    }
+    for (int c = 0; c < 3; ++c) {
+        int inset = (hi[c] - lo[c]) >> 4;  // ΧУ˵С
+        lo[c] = (GLubyte)(lo[c] + inset);
+        hi[c] = (GLubyte)(hi[c] - inset);
+    }
+    int mean[3] = { 0, 0, 0 }, cov[3] = { 0, 0, 0 };  // ̷ЭΪʱȡһԽ
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c) mean[c] += texels[i][c];
+    for (int i = 0; i < 16; ++i) {
+        int dg = texels[i][1] * 16 - mean[1];
+        cov[0] += (texels[i][0] * 16 - mean[0]) * dg;
+        cov[2] += (texels[i][2] * 16 - mean[2]) * dg;
+    }
+    for (int c = 0; c < 3; c += 2) {
+        if (cov[c] < 0) { GLubyte t = lo[c]; lo[c] = hi[c]; hi[c] = t; }
+    }
+    uint16_t c0 = packRGB565(hi), c1 = packRGB565(lo);
+    if (c0 < c1) { uint16_t t = c0; c0 = c1; c1 = t; }  // color0 <= color1 ᱻΪ3ɫģʽ
+    int palette[4][3];
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    uint32_t indices = 0;
+    if (c0 != c1) {  // ˵ͬʱȡ color0±ȫΪ0
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestDist = 1 << 30;
+            for (int k = 0; k < 4; ++k) {
+                int dist = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int d = texels[i][c] - palette[k][c];
+                    dist += d * d;
+                }
+                if (dist < bestDist) { bestDist = dist; best = k; }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+    out[0] = (GLubyte)(c0 & 0xFF); out[1] = (GLubyte)(c0 >> 8);  // С˴
+    out[2] = (GLubyte)(c1 & 0xFF); out[3] = (GLubyte)(c1 >> 8);
+    for (int i = 0; i < 4; ++i) out[4 + i] = (GLubyte)(indices >> (8 * i));
+}
 
-        // ʹGLUͼ˫Բֵ
-        gluScaleImage(GL_RGB, imgWidth, imgHeight, GL_UNSIGNED_BYTE, pixelData,
-            newSize, newSize, GL_UNSIGNED_BYTE, newPixelData);
+// ѹһ4ıԵ鸴һ/
+static void encodeBC1Level(const GLubyte* src, int w, int h, GLubyte* dst) {
+    GLubyte texels[16][3];
+    for (int by = 0; by < h; by += 4) {
+        for (int bx = 0; bx < w; bx += 4) {
+            for (int i = 0; i < 16; ++i) {
+                int x = bx + (i & 3), y = by + (i >> 2);
+                if (x >= w) x = w - 1;
+                if (y >= h) y = h - 1;
+                memcpy(texels[i], src + ((size_t)y * w + x) * 3, 3);
+            }
+            encodeBC1Block(texels, dst);
+            dst += 8;
+        }
+    }
+}
 
-        free(pixelData);         // ͷž
-        pixelData = newPixelData;  // ʹ
-        imgWidth = imgHeight = newSize;  // ³ߴ
+// ɵ0Mipcompress Ϊ1ʱѹΪBC1
+static void buildMipChain(std::vector<GLubyte>& base, int width, int height, int compress, MipChain& chain) {
+    chain.format = compress ? TEX_FORMAT_BC1 : TEX_FORMAT_BGR8;
+    chain.width = width;
+    chain.height = height;
+    chain.levels = 1;
+    while ((width >> chain.levels) > 0 || (height >> chain.levels) > 0) ++chain.levels;  // ֱ1x1
+    chain.storage.resize(mipChainBytes(chain.format, width, height, chain.levels));
+    std::vector<GLubyte> level, next;
+    level.swap(base);
+    GLubyte* out = chain.storage.data();
+    for (int i = 0; i < chain.levels; ++i) {
+        int w, h;
+        mipLevelSize(width, height, i, w, h);
+        if (compress) encodeBC1Level(level.data(), w, h, out);
+        else memcpy(out, level.data(), level.size());
+        out += mipLevelBytes(chain.format, w, h);
+        if (i + 1 == chain.levels) break;
+        int nw, nh;
+        mipLevelSize(width, height, i + 1, nw, nh);
+        next.resize((size_t)nw * nh * 3);
+        downsampleHalf(level.data(), w, h, next.data(), nw, nh);
+        level.swap(next);
     }
+    chain.data = chain.storage.data();
+}
 
-    // ID
-    glGenTextures(1, &texID);
-    if (texID == 0) {
-        free(pixelData);
-        fclose(file);
-        return 0;  // ʧ
+// ȡ棺ʽݳȶǺʱ1chain.data ֱָӳ
+static int readMipCache(const char* path, uint64_t key, MipChain& chain) {
+    if (!chain.cache.open(path)) return 0;
+    MipCacheHeader header;
+    if (chain.cache.size < sizeof(header)) { chain.cache.close(); return 0; }
+    memcpy(&header, chain.cache.data, sizeof(header));
+    if (header.magic != MIP_CACHE_MAGIC || header.version != MIP_CACHE_VERSION || header.key != key
+        || header.format > TEX_FORMAT_BC1 || header.levels == 0 || header.levels > 32
+        || chain.cache.size - sizeof(header) != mipChainBytes(header.format, header.width, header.height, header.levels)) {
+        chain.cache.close();  // ڻ𻵣ɲ
+        return 0;
+    }
+    chain.format = (int)header.format;
+    chain.width = (int)header.width;
+    chain.height = (int)header.height;
+    chain.levels = (int)header.levels;
+    chain.data = chain.cache.data + sizeof(header);
+    return 1;
+}
+
+// д棺дʱļ滻;ʧܲ²Ļ
+static int writeMipCache(const char* path, uint64_t key, const MipChain& chain) {
+    char tempPath[520];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) return 0;
+    MipCacheHeader header = { MIP_CACHE_MAGIC, MIP_CACHE_VERSION, key, (uint32_t)chain.format,
+                              (uint32_t)chain.width, (uint32_t)chain.height, (uint32_t)chain.levels };
+    size_t bytes = mipChainBytes(chain.format, chain.width, chain.height, chain.levels);
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(chain.data, bytes, 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    if (ok) {
+        remove(path);  // Windows  rename ļ
+        ok = rename(tempPath, path) == 0;
+    }
+    if (!ok) remove(tempPath);
+    return ok;
+}
+
+// ״̬
+enum TextureState {
+    TEX_PENDING = 0,  // ȴ̴̨߳
+    TEX_READY,        // MipѾȴGL߳ϴ
+    TEX_FAILED,       // ļȱʧʽ֧֣ռλ
+    TEX_UPLOADED      // ϴ
+};
+
+// GL̴߳󣬺̨߳׼MipɺGL߳ϴ
+struct TextureJob {
+    const char* filename = NULL;
+    GLuint texID = 0;
+    std::atomic<int> state{ TEX_PENDING };
+    int fromCache = 0;  // MipǷֱԻ
+    MipChain chain;     // ϴͨΪļӳ䣩ϴϸ
+    int residentBase = 0;  // ԴбϸGL_TEXTURE_BASE_LEVEL
+};
+
+static TextureJob textureJobs[3];  //  textures[] һһӦ
+static int textureJobCount = 0;
+static std::thread textureThread;  // ̨̣߳ȫ˳
+static std::chrono::steady_clock::time_point textureStart;  // ʼصʱ
+
+// ̨̣߳׼һMipκGL
+static void prepareTexture(TextureJob& job) {
+    MappedFile source;
+    if (!source.open(job.filename)) { job.state = TEX_FAILED; return; }
+    uint32_t params[3] = { MIP_CACHE_VERSION, (uint32_t)useCompression, (uint32_t)maxTextureSize };  // Ӱɽ
+    uint64_t key = hashBytes((const GLubyte*)params, sizeof(params), hashBytes(source.data, source.size));
+    char cachePath[512];
+    snprintf(cachePath, sizeof(cachePath), "%s.mip", job.filename);
+    if (readMipCache(cachePath, key, job.chain)) {
+        job.fromCache = 1;
+        job.state = TEX_READY;
+        return;
+    }
+
+    int width, height;
+    std::vector<GLubyte> pixels;
+    if (!decodeBmp(source, width, height, pixels)) { job.state = TEX_FAILED; return; }
+    source.close();  // ҪԴļ
+    int potWidth = floorPowerOfTwo(width, maxTextureSize), potHeight = floorPowerOfTwo(height, maxTextureSize);
+    if (potWidth != width || potHeight != height) {  // 2ݻ򳬹ߴ磺Сԭߴ2ݣִ¿߱ȣ
+        std::vector<GLubyte> scaled;
+        resampleBox(pixels, width, height, scaled, potWidth, potHeight);
+        pixels.swap(scaled);
+    }
+    buildMipChain(pixels, potWidth, potHeight, useCompression, job.chain);
+    if (!writeMipCache(cachePath, key, job.chain)) printf("޷д: %s\n", cachePath);  // ֻӰ´
+    else {
+        job.chain.release();
+        if (!readMipCache(cachePath, key, job.chain)) { job.state = TEX_FAILED; return; }  // ΪӳдĻ棺פڴֻҳ
+    }
+    job.state = TEX_READY;
+}
+
+static void textureWorker() {
+    for (int i = 0; i < textureJobCount; ++i) prepareTexture(textureJobs[i]);
+}
+
+// ˳ʱȴ̨̣߳glutMainLoop ͨ exit() 
+static void joinTextureThread() {
+    if (textureThread.joinable()) textureThread.join();
+}
+
+// ϴMipȫ
+static void uploadMipChain(GLuint texID, const MipChain& chain) {
+    GLuint prevTex;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&prevTex);
+    glBindTexture(GL_TEXTURE_2D, texID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // Mipен
+    const GLubyte* level = chain.data;
+    for (int i = 0; i < chain.levels; ++i) {
+        int w, h;
+        mipLevelSize(chain.width, chain.height, i, w, h);
+        GLsizei bytes = (GLsizei)mipLevelBytes(chain.format, w, h);
+        if (chain.format == TEX_FORMAT_BC1) compressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, w, h, 0, bytes, level);
+        else glTexImage2D(GL_TEXTURE_2D, i, GL_RGB8, w, h, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, level);
+        level += bytes;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);  // ָĬ
+    glBindTexture(GL_TEXTURE_2D, prevTex);
+}
+
+// GḶ߳ϴѾرϴĸpending ڵȴ
+int pollTextures(int* pending) {
+    int uploaded = 0, waiting = 0;
+    for (int i = 0; i < textureJobCount; ++i) {
+        TextureJob& job = textureJobs[i];
+        int state = job.state.load();
+        if (state == TEX_PENDING) { ++waiting; continue; }
+        if (state == TEX_FAILED) {
+            printf("ʧ: %s\n", job.filename);
+            job.state = TEX_UPLOADED;  // ֻһΣռλ
+            continue;
+        }
+        if (state != TEX_READY) continue;
+        uploadMipChain(job.texID, job.chain);
+        printf(" %s: %dx%d, %d , %s, %s\n", job.filename, job.chain.width, job.chain.height, job.chain.levels,
+            job.chain.format == TEX_FORMAT_BC1 ? "BC1" : "BGR8", job.fromCache ? "Ի" : "ɻ");
+        job.residentBase = 0;  // ϴȫ֮ updateTextureResidency ͷ
+        job.state = TEX_UPLOADED;
+        ++uploaded;
     }
+    if (waiting == 0 && uploaded > 0) {
+        joinTextureThread();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - textureStart).count();
+        printf("ȫ: %.1f \n", ms);
+    }
+    if (pending) *pending = waiting;
+    return uploaded;
+}
+
+/* ŶӼأIDʾ1x1ɫռλɺ̨߳׼pollTextures ϴ */
+GLuint loadBmpTexture(const char* filename) {
+    GLuint texID = 0;  // ID
+    glGenTextures(1, &texID);
+    if (texID == 0) return 0;  // ʧ
 
     // 浱ǰ
     GLuint prevTex;
@@ -139,17 +556,336 @@ GLuint loadBmpTexture(const char* filename) {
     // 滻ģʽǼɫ
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 
-    // MipmapGL_BGR_EXTBMPBGR˳
-    gluBuild2DMipmaps(GL_TEXTURE_2D, 3, imgWidth, imgHeight, GL_BGR_EXT, GL_UNSIGNED_BYTE, pixelData);
+    // ռλ1x1Mipκιģʽ¶
+    const GLubyte grey[3] = { 128, 128, 128 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, grey);
 
     // ָ֮ǰ
     glBindTexture(GL_TEXTURE_2D, prevTex);
-    free(pixelData);  // ͷ
-    fclose(file);     // رļ
 
+    TextureJob& job = textureJobs[textureJobCount++];
+    job.filename = filename;
+    job.texID = texID;
     return texID;  // ID
 }
 
+
+// ==================== ȼ ====================
+// ֻ仯ʱһΣжıΰΪذ塢컨塢ǽ飬
+// δһ̬㻺УGL_T2F_V3F ʽÿ֡ÿֻһΰ󶨺һ glDrawArrays
+// ڶ䰴Z˳УɼÿҲĶ㷶Χ
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892  // GL 1.5 㻺
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+
+typedef void (APIENTRY* PfnGenBuffers)(GLsizei, GLuint*);
+typedef void (APIENTRY* PfnBindBuffer)(GLenum, GLuint);
+typedef void (APIENTRY* PfnBufferData)(GLenum, ptrdiff_t, const void*, GLenum);
+static PfnGenBuffers genBuffers = NULL;  // GL 1.5 ʱأ֧ʱ˻ؿͻ˶
+static PfnBindBuffer bindBuffer = NULL;
+static PfnBufferData bufferData = NULL;
+
+static int tunnelSegments = 7;          // --segments Nʱ [ ] /ӱĬϸ z=-60  10
+static GLfloat segmentLength = 10.0f;   // ÿγȣ--segment-length Lÿظһ
+static int tunnelEndless = 0;           // ޾ȣ--endless  E ޣֻ渲Ӿһ
+static int bufferSegments = 0;          // 㻺еĶ
+static GLfloat bufferOrigin = 0.0f;     // е0εʼZ޾ģʽΪ0ʱƽƣ
+static int visibleLo = 0, visibleHi = -1;  // һ֡ƵĶ䷶Χͳ
+
+// ͸ӲonReshape ͶӰ׶޳פʹֵͬ
+#define FOV_Y 35.5        // ֱҰȣ
+#define NEAR_PLANE 1.0    // ü
+#define FAR_PLANE 150.0   // Զü
+static GLdouble viewAspect = 1.0;   // ߱
+static GLint viewportHeight = 400;  // ӿڸ߶ȣأ
+
+// ׶㵽루ԶüĽǵ㣩ֻΧڵĶܿɼ
+static double viewRadius() {
+    double t = tan(FOV_Y * 0.5 * 3.14159265358979323846 / 180.0);
+    return FAR_PLANE * sqrt(1.0 + t * t * (1.0 + viewAspect * viewAspect));
+}
+
+// 㣺 GL_T2F_V3F һ
+struct TunnelVertex {
+    GLfloat s, t;     // 
+    GLfloat x, y, z;  // λ
+};
+
+// ͬһıڶ㻺еķΧ
+struct TunnelBatch {
+    GLuint* texture;  // ָȫIDID initTextures иֵ
+    GLint first;      // һ
+    GLsizei count;    // ÿ4ΪһıΣ
+};
+
+static TunnelBatch tunnelBatches[3] = { { &groundTex, 0, 0 }, { &ceilingTex, 0, 0 }, { &wallTex, 0, 0 } };  // ˳ԭͬ
+static GLuint tunnelVBO = 0;                      // ̬㻺壨0ʾ֧VBO
+static std::vector<TunnelVertex> tunnelVertices;  // ֧VBOʱΪͻ˶
+
+// ׷һıε4㣨Ϊ (0,0) (1,0) (1,1) (0,1)
+static void addQuad(std::vector<TunnelVertex>& out, const GLfloat corners[4][3]) {
+    static const GLfloat texCoords[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+    for (int i = 0; i < 4; ++i) {
+        TunnelVertex v = { texCoords[i][0], texCoords[i][1], corners[i][0], corners[i][1], corners[i][2] };
+        out.push_back(v);
+    }
+}
+
+// ǰγȲϴ i  [zStart, zStart+segmentLength)
+// ȵһδ z=0 ʼ޾ȵĻ z=0 ʼ㹻׶Z
+void buildTunnel() {
+    bufferSegments = tunnelEndless ? (int)ceil(2.0 * viewRadius() / segmentLength) + 2 : tunnelSegments;
+    bufferOrigin = tunnelEndless ? 0.0f : (GLfloat)(1 - tunnelSegments) * segmentLength;
+    std::vector<TunnelVertex> groups[3];  // 0=ذ 1=컨 2=ǽ
+    for (int i = 0; i < bufferSegments; ++i) {
+        GLfloat zStart = bufferOrigin + (GLfloat)i * segmentLength;  // ʼZ
+        GLfloat zEnd = zStart + segmentLength;                                  // Z
+        const GLfloat ground[4][3] = { { -10.0f, -10.0f, zStart }, { -10.0f, -10.0f, zEnd }, { 10.0f, -10.0f, zEnd }, { 10.0f, -10.0f, zStart } };  // ǰǰҺ
+        const GLfloat ceiling[4][3] = { { -10.0f, 10.0f, zStart }, { -10.0f, 10.0f, zEnd }, { 10.0f, 10.0f, zEnd }, { 10.0f, 10.0f, zStart } };   // Ƶذ壬Y=10
+        const GLfloat leftWall[4][3] = { { -10.0f, -10.0f, zStart }, { -10.0f, 10.0f, zStart }, { -10.0f, 10.0f, zEnd }, { -10.0f, -10.0f, zEnd } };  // ºϺǰǰ
+        const GLfloat rightWall[4][3] = { { 10.0f, -10.0f, zStart }, { 10.0f, 10.0f, zStart }, { 10.0f, 10.0f, zEnd }, { 10.0f, -10.0f, zEnd } };
+        addQuad(groups[0], ground);
+        addQuad(groups[1], ceiling);
+        addQuad(groups[2], leftWall);
+        addQuad(groups[2], rightWall);
+    }
+
+    // ƴӣ¼ÿķΧ
+    tunnelVertices.clear();
+    for (int i = 0; i < 3; ++i) {
+        tunnelBatches[i].first = (GLint)tunnelVertices.size();
+        tunnelBatches[i].count = (GLsizei)groups[i].size();
+        tunnelVertices.insert(tunnelVertices.end(), groups[i].begin(), groups[i].end());
+    }
+
+    if (tunnelVBO) {
+        bindBuffer(GL_ARRAY_BUFFER, tunnelVBO);
+        bufferData(GL_ARRAY_BUFFER, (ptrdiff_t)(tunnelVertices.size() * sizeof(TunnelVertex)), tunnelVertices.data(), GL_STATIC_DRAW);
+        bindBuffer(GL_ARRAY_BUFFER, 0);
+        std::vector<TunnelVertex>().swap(tunnelVertices);  // Դ
+    }
+    if (tunnelEndless) printf("޾: γ %.1f,  %d ", segmentLength, bufferSegments);
+    else printf(": %d  x %.1f", tunnelSegments, segmentLength);
+    printf(", %d , ÿ֡ 3 λƵã%s\n", tunnelBatches[2].first + tunnelBatches[2].count, tunnelVBO ? "VBO" : "ͻ˶");
+}
+
+// ʼȣ֧ GL 1.5 ʱ㻺壬Ȼɼ
+void initTunnel() {
+    int major = 1, minor = 0;
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (version) sscanf(version, "%d.%d", &major, &minor);
+    textureStreaming = major > 1 || minor >= 2;  // GL_TEXTURE_BASE_LEVEL
+    if (major > 1 || minor >= 5) {
+        genBuffers = (PfnGenBuffers)glutGetProcAddress("glGenBuffers");
+        bindBuffer = (PfnBindBuffer)glutGetProcAddress("glBindBuffer");
+        bufferData = (PfnBufferData)glutGetProcAddress("glBufferData");
+        if (genBuffers && bindBuffer && bufferData) genBuffers(1, &tunnelVBO);
+    }
+    buildTunnel();
+}
+
+// ---- ˫Ⱦ glLoadMatrixd ͬ ----
+
+// out = a * b
+static void multiplyMatrix(const double a[16], const double b[16], double out[16]) {
+    double r[16];
+    for (int col = 0; col < 4; ++col)
+        for (int row = 0; row < 4; ++row) {
+            double sum = 0.0;
+            for (int k = 0; k < 4; ++k) sum += a[k * 4 + row] * b[col * 4 + k];
+            r[col * 4 + row] = sum;
+        }
+    memcpy(out, r, sizeof(r));
+}
+
+// m = m * T(0, 0, z)
+static void translateZ(double m[16], double z) {
+    for (int row = 0; row < 4; ++row) m[12 + row] += m[8 + row] * z;
+}
+
+// m = m * R(angle, ) glRotatef ͬaxis Ϊ0Xᣩ1Yᣩ
+static void rotateAxis(double m[16], double angleDeg, int axis) {
+    double r = angleDeg * 3.14159265358979323846 / 180.0, c = cos(r), s = sin(r);
+    double rot[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    if (axis == 0) { rot[5] = c; rot[6] = s; rot[9] = -s; rot[10] = c; }
+    else { rot[0] = c; rot[2] = -s; rot[8] = s; rot[10] = c; }
+    multiplyMatrix(m, rot, m);
+}
+
+// ۲ԭ onDisplay е glTranslatef/glRotatef ͬ˳Ҫ˫ȼ
+static void computeViewMatrix(double m[16]) {
+    static const double identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    memcpy(m, identity, sizeof(identity));
+    translateZ(m, depthPos);          // Zƽ
+    rotateAxis(m, rotateAngle, 1);    // Yת
+    translateZ(m, mouseDepth);        // Zδ£
+    rotateAxis(m, viewPitch, 0);      // X
+    rotateAxis(m, mouseRotate, 1);    // Yת
+}
+
+// еλã۲ [R t] ԭ㣬 -R^T t
+static void cameraPosition(const double view[16], double eye[3]) {
+    for (int i = 0; i < 3; ++i) eye[i] = -(view[i * 4 + 0] * view[12] + view[i * 4 + 1] * view[13] + view[i * 4 + 2] * view[14]);
+}
+
+// ׶ƽ棨a, b, c, dڲ ax+by+cz+d >= 0 ͶӰ*۲ ϵõ
+static void extractFrustum(const double view[16], double planes[6][4]) {
+    double f = 1.0 / tan(FOV_Y * 0.5 * 3.14159265358979323846 / 180.0);
+    double proj[16] = { f / viewAspect, 0, 0, 0, 0, f, 0, 0,
+                        0, 0, (FAR_PLANE + NEAR_PLANE) / (NEAR_PLANE - FAR_PLANE), -1,
+                        0, 0, 2.0 * FAR_PLANE * NEAR_PLANE / (NEAR_PLANE - FAR_PLANE), 0 };  //  gluPerspective ͬ
+    double clip[16];
+    multiplyMatrix(proj, view, clip);
+    for (int i = 0; i < 6; ++i) {
+        int row = i / 2;
+        double sign = (i & 1) ? -1.0 : 1.0;  // ҡϡԶ
+        for (int k = 0; k < 4; ++k) planes[i][k] = clip[k * 4 + 3] + sign * clip[k * 4 + row];
+    }
+}
+
+//  [z0, z1] İΧУxy Ϊ 10Ƿ׶ཻأֻ޳ȫĳƽĶ䣩
+static int segmentVisible(const double planes[6][4], double z0, double z1) {
+    for (int i = 0; i < 6; ++i) {
+        const double* p = planes[i];
+        double x = p[0] > 0 ? 10.0 : -10.0, y = p[1] > 0 ? 10.0 : -10.0, z = p[2] > 0 ? z1 : z0;  // طԶĽǵ
+        if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0) return 0;
+    }
+    return 1;
+}
+
+// ȣֻǰ viewRadius() ڵĶ䣬׶͹ȽཻZһ䣬
+// ˿ɼÿһΰ󶨡һλơ޾ģʽѻƽƵһɼ䴦ظʹ
+static void drawTunnel(const double view[16]) {
+    double planes[6][4], eye[3];
+    extractFrustum(view, planes);
+    cameraPosition(view, eye);
+    double radius = viewRadius();
+    long long lo = (long long)floor((eye[2] - radius - bufferOrigin) / segmentLength);  // ԻԭΪ0Ķ
+    long long hi = (long long)floor((eye[2] + radius - bufferOrigin) / segmentLength);
+    if (!tunnelEndless) {
+        if (lo < 0) lo = 0;
+        if (hi > tunnelSegments - 1) hi = tunnelSegments - 1;
+    }
+    while (lo <= hi && !segmentVisible(planes, bufferOrigin + (double)lo * segmentLength, bufferOrigin + (double)(lo + 1) * segmentLength)) ++lo;
+    while (hi >= lo && !segmentVisible(planes, bufferOrigin + (double)hi * segmentLength, bufferOrigin + (double)(hi + 1) * segmentLength)) --hi;
+    visibleLo = (int)lo;
+    visibleHi = (int)hi;
+    if (lo > hi) return;  // ȫɼ
+
+    long long first = lo, count = hi - lo + 1;
+    double model[16];
+    memcpy(model, view, sizeof(model));
+    if (tunnelEndless) {
+        translateZ(model, (double)lo * segmentLength);  // ĵ0Ƶһɼ䣨˫ȣȻС
+        first = 0;
+        if (count > bufferSegments) count = bufferSegments;
+    }
+    glPushMatrix();
+    glLoadMatrixd(model);
+
+    if (tunnelVBO) {
+        bindBuffer(GL_ARRAY_BUFFER, tunnelVBO);
+        glInterleavedArrays(GL_T2F_V3F, 0, (const void*)0);  // VBOʱָΪƫ
+    }
+    else {
+        glInterleavedArrays(GL_T2F_V3F, 0, tunnelVertices.data());
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (tunnelBatches[i].count == 0) continue;
+        GLsizei perSegment = tunnelBatches[i].count / bufferSegments;  // ÿεĶذ/컨4ǽ8
+        glBindTexture(GL_TEXTURE_2D, *tunnelBatches[i].texture);
+        glDrawArrays(GL_QUADS, tunnelBatches[i].first + (GLint)first * perSegment, (GLsizei)count * perSegment);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);         // glInterleavedArrays õ
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    if (tunnelVBO) bindBuffer(GL_ARRAY_BUFFER, 0);
+    glPopMatrix();
+}
+
+// ---- פԴбϸMip ----
+
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C  // GL 1.2
+#endif
+#define RESIDENCY_EVICT_MARGIN 1.5  // ٿ1.5òĳʱͷֵϴ
+
+//  index0=ذ 1=ǽ 2=컨壩ڱ
+static double surfaceDistance(int index, const double eye[3]) {
+    double dz = 0.0;  // ȣ֮ʱZ
+    if (!tunnelEndless) {
+        double zMin = bufferOrigin, zMax = bufferOrigin + (double)tunnelSegments * segmentLength;
+        if (eye[2] < zMin) dz = zMin - eye[2];
+        else if (eye[2] > zMax) dz = eye[2] - zMax;
+    }
+    double cx = eye[0] < -10.0 ? -10.0 - eye[0] : (eye[0] > 10.0 ? eye[0] - 10.0 : 0.0);  //  x[-10,10] ľ
+    double cy = eye[1] < -10.0 ? -10.0 - eye[1] : (eye[1] > 10.0 ? eye[1] - 10.0 : 0.0);
+    double plane;  // ƽľ
+    if (index == 0) { plane = fabs(eye[1] + 10.0); cy = 0.0; }
+    else if (index == 2) { plane = fabs(eye[1] - 10.0); cy = 0.0; }
+    else { plane = fmin(fabs(eye[0] + 10.0), fabs(eye[0] - 10.0)); cx = 0.0; }
+    return sqrt(plane * plane + cx * cx + cy * cy + dz * dz);
+}
+
+//  distance ԱʱҪϸÿظһγȿ20н϶ߣ
+// һؼ಻һؼɣֻԷбʱGLѡļֻ֣
+static int mipLevelForDistance(const MipChain& chain, double distance) {
+    if (distance < NEAR_PLANE) distance = NEAR_PLANE;
+    double pixelsPerUnit = viewportHeight / (2.0 * distance * tan(FOV_Y * 0.5 * 3.14159265358979323846 / 180.0));
+    double texelsPerUnit = (chain.width > chain.height ? chain.width : chain.height) / fmin((double)segmentLength, 20.0);
+    int level = 0;
+    while (level + 1 < chain.levels && texelsPerUnit / (double)(1 << (level + 1)) >= pixelsPerUnit) ++level;
+    return level;
+}
+
+// ÿ֡ãҪϸļʱӳĻϴԶͷŲҪļ
+static void updateTextureResidency(const double view[16]) {
+    if (!textureStreaming) return;
+    double eye[3];
+    cameraPosition(view, eye);
+    int mipmapFilter = currentMinFilter != GL_NEAREST && currentMinFilter != GL_LINEAR;
+    for (int i = 0; i < textureJobCount; ++i) {
+        TextureJob& job = textureJobs[i];
+        if (job.state.load() != TEX_UPLOADED || !job.chain.data) continue;
+        double distance = surfaceDistance(i, eye);
+        int want = mipmapFilter ? mipLevelForDistance(job.chain, distance) : 0;
+        int keep = mipmapFilter ? mipLevelForDistance(job.chain, distance / RESIDENCY_EVICT_MARGIN) : 0;
+        int base = job.residentBase;
+        if (want < base) base = want;       // 
+        else if (keep > base) base = keep;  // ͷ
+        else continue;
+
+        GLuint prevTex;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&prevTex);
+        glBindTexture(GL_TEXTURE_2D, job.texID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        const GLubyte* level = job.chain.data + mipChainBytes(job.chain.format, job.chain.width, job.chain.height, base);  //  base 
+        for (int lv = base; lv < job.residentBase; ++lv) {  //  [base, residentBase)
+            int w, h;
+            mipLevelSize(job.chain.width, job.chain.height, lv, w, h);
+            GLsizei bytes = (GLsizei)mipLevelBytes(job.chain.format, w, h);
+            if (job.chain.format == TEX_FORMAT_BC1) compressedTexImage2D(GL_TEXTURE_2D, lv, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, w, h, 0, bytes, level);
+            else glTexImage2D(GL_TEXTURE_2D, lv, GL_RGB8, w, h, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, level);
+            level += bytes;
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+        for (int lv = job.residentBase; lv < base; ++lv) {  // ͷ [residentBase, base)Ϊ0x0ļռԴ棬ڻҲӰ
+            glTexImage2D(GL_TEXTURE_2D, lv, GL_RGB8, 0, 0, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, NULL);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, prevTex);
+
+        size_t resident = mipChainBytes(job.chain.format, job.chain.width, job.chain.height, job.chain.levels)
+            - mipChainBytes(job.chain.format, job.chain.width, job.chain.height, base);
+        printf("פ %s:  %d %dx%d, %.1f KB\n", job.filename, base,
+            (job.chain.width >> base) > 0 ? job.chain.width >> base : 1, (job.chain.height >> base) > 0 ? job.chain.height >> base : 1, resident / 1024.0);
+        job.residentBase = base;
+    }
+}
+
 // ܻصӿںͶӰ
 void onReshape(GLsizei width, GLsizei height) {
     glViewport(0, 0, width, height);  // ӿ
@@ -160,7 +896,10 @@ void onReshape(GLsizei width, GLsizei height) {
     glLoadIdentity();             // 
 
     // ͸ͶӰ35.5 FOVü1.0Զü150.0
-    gluPerspective(35.5, ratio, 1.0, 150.0);
+    gluPerspective(FOV_Y, ratio, NEAR_PLANE, FAR_PLANE);
+    viewAspect = ratio;       // ׶޳פʹͬ͸Ӳ
+    viewportHeight = height;
+    if (tunnelEndless) buildTunnel();  // ޾ȵĻȡ׶
 
     glMatrixMode(GL_MODELVIEW);   // ģͼģʽ
     glLoadIdentity();             // 
@@ -171,62 +910,21 @@ void onReshape(GLsizei width, GLsizei height) {
 // ʾصȾ
 void onDisplay() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);  // ɫ
-    glPushMatrix();  // ջ
-
-    // Ӧȫֱ任ƽơת˳Ҫ
-    glTranslatef(0.0f, 0.0f, depthPos);  // Zƽ
-    glRotatef(rotateAngle, 0.0f, 1.0f, 0.0f);  // Yת
-
-    glTranslatef(0.0f, 0.0f, mouseDepth);  // Zδ£
-    glRotatef(viewPitch, 1.0f, 0.0f, 0.0f);  // X
-    glRotatef(mouseRotate, 0.0f, 1.0f, 0.0f);  // Yת
-
-    // ȶ䣺z=-600ÿ10λһ䣨ظ
-    for (GLfloat zStart = -60.0f; zStart <= 0.0f; zStart += 10.0f) {
-        GLfloat zEnd = zStart + 10.0f;  // Z
-
-        // ذ壺ıΣ0-1
-        glBindTexture(GL_TEXTURE_2D, groundTex);
-        glBegin(GL_QUADS);
-        glTexCoord2f(0.0f, 0.0f); glVertex3f(-10.0f, -10.0f, zStart);  // 
-        glTexCoord2f(1.0f, 0.0f); glVertex3f(-10.0f, -10.0f, zEnd);    // ǰ
-        glTexCoord2f(1.0f, 1.0f); glVertex3f(10.0f, -10.0f, zEnd);     // ǰ
-        glTexCoord2f(0.0f, 1.0f); glVertex3f(10.0f, -10.0f, zStart);   // Һ
-        glEnd();
-
-        // 컨壺Ƶذ壬Y=10
-        glBindTexture(GL_TEXTURE_2D, ceilingTex);
-        glBegin(GL_QUADS);
-        glTexCoord2f(0.0f, 0.0f); glVertex3f(-10.0f, 10.0f, zStart);
-        glTexCoord2f(1.0f, 0.0f); glVertex3f(-10.0f, 10.0f, zEnd);
-        glTexCoord2f(1.0f, 1.0f); glVertex3f(10.0f, 10.0f, zEnd);
-        glTexCoord2f(0.0f, 1.0f); glVertex3f(10.0f, 10.0f, zStart);
-        glEnd();
-
-        // ǽڣǽ/ǽıΣ
-        glBindTexture(GL_TEXTURE_2D, wallTex);
-        glBegin(GL_QUADS);
-        // ǽX=-10
-        glTexCoord2f(0.0f, 0.0f); glVertex3f(-10.0f, -10.0f, zStart);  // º
-        glTexCoord2f(1.0f, 0.0f); glVertex3f(-10.0f, 10.0f, zStart);   // Ϻ
-        glTexCoord2f(1.0f, 1.0f); glVertex3f(-10.0f, 10.0f, zEnd);     // ǰ
-        glTexCoord2f(0.0f, 1.0f); glVertex3f(-10.0f, -10.0f, zEnd);    // ǰ
-        // ǽX=10
-        glTexCoord2f(0.0f, 0.0f); glVertex3f(10.0f, -10.0f, zStart);
-        glTexCoord2f(1.0f, 0.0f); glVertex3f(10.0f, 10.0f, zStart);
-        glTexCoord2f(1.0f, 1.0f); glVertex3f(10.0f, 10.0f, zEnd);
-        glTexCoord2f(0.0f, 1.0f); glVertex3f(10.0f, -10.0f, zEnd);
-        glEnd();
-    }
-
-    glPopMatrix();       // ָ
+
+    // ȫֱ任ƽơת computeViewMatrix
+    double view[16];
+    computeViewMatrix(view);
+
+    updateTextureResidency(view);  // /ͷϸ
+    drawTunnel(view);              // ޳ƿɼ
+
     glutSwapBuffers();   // ˫彻
 }
 
 // صͷ
 void onSpecialKey(GLint key, GLint x, GLint y) {
-    if (key == GLUT_KEY_UP) depthPos += 0.5f;       // ϣǰ
-    if (key == GLUT_KEY_DOWN) depthPos -= 0.5f;     // £
+    if (key == GLUT_KEY_UP) depthPos += 0.5;        // ϣǰ
+    if (key == GLUT_KEY_DOWN) depthPos -= 0.5;      // £
     if (key == GLUT_KEY_LEFT) rotateAngle -= 0.5f;  // ת
     if (key == GLUT_KEY_RIGHT) rotateAngle += 0.5f; // ңת
 
@@ -235,6 +933,16 @@ void onSpecialKey(GLint key, GLint x, GLint y) {
     glutPostRedisplay();  // ˢ
 }
 
+// ̻ص[ ] ȶ/ӱԻƿ泤ȵı仯E л޾
+void onKey(unsigned char key, int x, int y) {
+    if (key == '[' && tunnelSegments > 1) tunnelSegments /= 2;
+    else if (key == ']' && tunnelSegments < (1 << 20)) tunnelSegments *= 2;
+    else if (key == 'e' || key == 'E') tunnelEndless = !tunnelEndless;
+    else return;
+    buildTunnel();
+    glutPostRedisplay();  // ˢ
+}
+
 // 갴ص¼ʼλ
 void onMouse(int button, int state, int x, int y) {
     if (isMenuOpen) return;  // ˵ʱ
@@ -278,6 +986,7 @@ void onMenuSelect(int option) {
     };
 
     GLenum selectedFilter = minFilters[option - 10];  // ȡѡ
+    currentMinFilter = selectedFilter;  // MipmapҪ0פһ֡룩
 
     // ӦõMAG̶LINEAR
     for (int i = 0; i < 3; i++) {
@@ -298,7 +1007,14 @@ void initTextures() {
     glEnable(GL_DEPTH_TEST);               // Ȳ
     glEnable(GL_TEXTURE_2D);               // 2D
 
-    // ļresource/Ŀ¼
+    // ߳ҪGLߴ硢Ƿ֧BC1
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    compressedTexImage2D = (PfnCompressedTexImage2D)glutGetProcAddress("glCompressedTexImage2D");
+    useCompression = extensions && strstr(extensions, "GL_EXT_texture_compression_s3tc") && compressedTexImage2D;
+    textureStart = std::chrono::steady_clock::now();
+
+    // ŶӼأresource/Ŀ¼
     textures[0] = loadBmpTexture("resource/ground.bmp");
     textures[1] = loadBmpTexture("resource/wall.bmp");
     textures[2] = loadBmpTexture("resource/ceiling.bmp");
@@ -307,24 +1023,46 @@ void initTextures() {
     groundTex = textures[0];
     wallTex = textures[1];
     ceilingTex = textures[2];
+
+    textureThread = std::thread(textureWorker);  // ļȡ벻
+    atexit(joinTextureThread);
+}
+
+// ʱصϴѾˢ£δɵʱѯ
+void onTextureTimer(int) {
+    int pending;
+    if (pollTextures(&pending) > 0) glutPostRedisplay();
+    if (pending > 0) glutTimerFunc(10, onTextureTimer, 0);
 }
 
 // GLUTʼѭ
 int main(int argc, char* argv[]) {
-    glutInit(&argc, argv);                   // GLUTʼ
+    glutInit(&argc, argv);                   // GLUTʼ֮ argv ֻʣԼĲ
+    for (int i = 1; i + 1 < argc; ++i) {     // --segments N--segment-length LȲ
+        if (strcmp(argv[i], "--segments") == 0) tunnelSegments = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--segment-length") == 0) segmentLength = (GLfloat)atof(argv[++i]);
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--endless") == 0) tunnelEndless = 1;
+    }
+    if (tunnelSegments < 1) tunnelSegments = 1;
+    if (segmentLength <= 0.0f) segmentLength = 10.0f;
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);  // ˫ + RGBA
     glutInitWindowPosition(100, 100);        // λ
     glutInitWindowSize(400, 400);            // ڴС
     glutCreateWindow("OpenGL Mipmap Demo");  // 
 
     initTextures();  // ʼ
+    initTunnel();    // ȶ㻺
 
     // עص
     glutDisplayFunc(onDisplay);   // ʾ
     glutReshapeFunc(onReshape);   // 
     glutSpecialFunc(onSpecialKey); // 
+    glutKeyboardFunc(onKey);      // ͨȳ
     glutMouseFunc(onMouse);       // 갴
     glutMotionFunc(onMotion);     // ק
+    glutTimerFunc(0, onTextureTimer, 0);  // ϴ
 
     // Ҽ˵
     glutCreateMenu(onMenuSelect);
@@ -7,10 +7,26 @@
  *
  * Ҫԣ
  * - ׷ٺģ֧䡢淴䡢䣨FresnelЧӦӰ⡣
- * - ʹPerlinľĳľݷ߷ͶӰ
- * - ϵͳֽ֧/ǽֲڶȣģʹMonte Carlo
+ * - ʹPerlinľĳľݷ߷ͶӰɰѡֵSIMDֵʱ決Ϊmipmap
+ * - ϵͳֽ֧/ǽֲڶȣģʹMonte CarloĬֻڵһδֲڷ䴦16ߣ
  * - ̶ӽǣFOVɵ֧٤У
- * - ոȾESC˳
+ * - ոȾSֹͣʽȾ +/- ع⡢T лɫӳ䡢D л׷٣ G лCPU/GPUˣESC˳
+ * - ʣ/PageUp/PageDown ƶԴ[ ] ԴǿȣV ѡʡ< > ֲڶȣ뼸岻䣬CPUȾû߽㣬ֻɫ
+ * - ޽ģʽ--output ֱӰѽд PPM/PNG8λ PFM/EXRԸ㣩ֱ --size ָ
+ * - Ӧ--adaptive N ȡ2x2ֲٰط֡ԤָԵƽ
+ * - ׷ֻдԸ㻺壬֮ͳһع⡢ɫӳ䣨reinhard/acesSIMD٤Ϳѡ8λͼ
+ * - ʾϴֻһΣɱ洢ֻ֮ glTexSubImage2D ϴֿ飻֧ GL 4.4 ʱֱ߳д־ӳ˫PBO
+ * - ʽȾ̨߳ÿÿ׷1ۼƵ㻺壬ڶʱϴǰƽֵٿס
+ * - ٽṹͼԪ塢ӡǽھΣSAHBVH֯Ӱ⹲ͬһ
+ * - SIMD󽻣ͼԪBVHҶ˳ΪSoASSE/AVX2һβ4/8SlabӰ߰2x2߰SIMD㡢Ըõ common/simd_math.h
+ * - ̣߳зΪ32x32ֿ飬ɹȡ̳߳زȾ̶ʱ뵥߳̽λһ¡
+ * - ļ--scene-file ȡı塢ӡΡʡԴ״μغдƻ棬ֱ֮ mmap ӳʹãҲؽBVH
+ * - 񣺳ļ OBJ/PLY 任ʵÿ/±鲢ԼBVHˮ󽻡SIMDȳԡ
+ * - ׼ԣ--bench Թ̶Ⱦ Cornell / ѹ / ģɨֱʡ߳΢׼У͵JSONС
+ * - 룺--denoise ɷ//ȸ壨벣ԽĹԵ֪ -trous ˲ģֻ1~4--aux 塣
+ * - GPUˣ--gpu򴰿а GBVHͼԪͲϴΪSSBO OpenGL 4.3 ɫCPUͬкɫģͽʽȾֱʾCPU·Ϊοʵ֡
+ * - ֲʽȾ--worker ڵ㣬Эڵѻֿ龭TCPַϲڵķֿ鱻ظȡʧЧڵķֿ·䣬뱾Ⱦλһ¡
+ * - Ⱦͳƣ -DRT_STATS ʱ߳ͳƸÿߵĽڵ/ͼԪȺɵÿشȶͼĬϱ벻κμ롣
  *
  * ֣
  * - ӳߴ磺x-1.51.5y03.0z-1.50ǽ򿪣
@@ -19,15 +35,21 @@
  * - ľ䣺λãʹBoxṹ
  *
  * У
- * g++ -o raytracer main.cpp -lGL -lGLU -lglut -lm
- * ./raytracer
+ * g++ -O2 -mavx2 -o raytracer main.cpp -lGL -lGLU -lglut -lm -lpthread   ȥ -mavx2 ʹ4·SSEģ
+ * ./raytracer --output out.png --size 1920x1080 [--passes N]   ޽ȾҪX
+ * ./raytracer [--threads N] [--seed S] [--no-packets] [--glossy always|first|roulette] [--blocking] [--passes N] [--adaptive N] [--wood simd|baked|procedural] [--gpu]
+ * ./raytracer --output out.png --denoise --glossy-samples 4 [--aux aux.pfm]   룬ģ
+ * ./raytracer --scene-file cornell.scene --output out.png   ļ--export-scene F ó
+ * ./raytracer --worker 7000      ./raytracer --workers host1:7000,host2:7000 --output out.png   ֲʽȾ
+ * ./raytracer --bench [quick|micro] [--bench-out results.jsonl]   ׼ԣҪXmicro ֻܺ΢׼
+ * g++ -O2 -mavx2 -DRT_STATS ... ./raytracer --output out.png --heatmap cost.png   Ⱦͳȶͼ
  *
- * ע⣺ȾʱϳCPUȾڴС800x600
+ * ע⣺ȾʱϳCPUȾĬϴڴС800x600
  */
 
 #define _USE_MATH_DEFINES  // M_PIѧ
 
-#include <GL/glut.h>  // GLUT⣺ڡ¼ͽ
+#include <GL/freeglut.h>  // FreeGLUT⣺ڡ¼ͽglutGetProcAddress ڼPBOȽµGL
 #include <GL/glu.h>   // GLU⣺ṩ߲εOpenGLܣ
 #include <GL/gl.h>    // OpenGLĿ⣺ͼȾAPI
 #include <cmath>      // ѧsqrtsincos
@@ -36,52 +58,228 @@
 #include <chrono>     // ߾ʱӣڲȾʱ
 #include <random>     // ɣPerlinMonte Carlo
 #include <algorithm>  // 㷨std::swapstd::minstd::max
+#include <thread>     // ߳Ⱦ߳
+#include <mutex>      // кͽ
+#include <condition_variable>  // ̳߳صȴ/
+#include <deque>      // ˫˶Уÿ̵߳ķֿУȡͷȡȡβ
+#include <atomic>     // ԭӼʣֿ
+#include <functional> // std::functionִ̳߳еķֿ
+#include <memory>     // std::unique_ptrÿ̶߳
+#include <cstdlib>    // std::atoistd::strtoulв
+#include <cstring>    // std::strcmpвȽ
+#include <cstdint>    // uint32_tuint64_tPCG״̬
+#include <cstddef>    // std::ptrdiff_tGLСƫ
+#include <cstdio>     // std::snprintfڱ
+#include <fstream>    // std::ofstream޽ģʽֱдͼļ
+#include <string>     // std::string·
+#include <cctype>     // std::tolowerչȽ
+#include <cerrno>     // errnoPLYԪ
+#include <climits>    // INT_MAXPLYԪ
+#include <limits>     // std::numeric_limitsSIMDе
+#include <unordered_map>  // ļвŵӳ
+#include <type_traits>    // std::is_trivially_copyable水ڴ沼ֱӳ
+#include <filesystem>     // ļĴС޸ʱ䣨жϻǷڣ
+#if defined(_WIN32)
+#include <winsock2.h>     // ֲʽȾTCPӣ windows.h ֮ǰ
+#include <ws2tcpip.h>     // getaddrinfo
+#include <windows.h>      // CreateFileMapping/MapViewOfFileӳ䳡
+#else
+#include <sys/mman.h>     // mmapӳ䳡
+#include <fcntl.h>        // open
+#include <unistd.h>       // close
+#include <sys/socket.h>   // ֲʽȾTCP
+#include <netinet/in.h>   // sockaddr_in
+#include <netinet/tcp.h>  // TCP_NODELAY
+#include <arpa/inet.h>    // htonl/htons
+#include <netdb.h>        // getaddrinfo
+#include <poll.h>         // pollЭڵͬʱȴڵ
+#endif
+#include "../common/simd_math.h"  // ѧģ飺SIMD㣨vfloatVec3
 
- // Ϊ˼򻯣ʹ Mersenne Twister 棨α
-std::mt19937 rng(std::chrono::high_resolution_clock::now().time_since_epoch().count());
-//  -1.0  1.0 ֮ĸŶ
-std::uniform_real_distribution<float> dist_neg_pos_one(-1.0f, 1.0f);
-//  0.0  1.0 ֮ĸãδʹã
-std::uniform_real_distribution<float> dist_zero_one(0.0f, 1.0f);
-
-const int WIDTH = 800;   // Ⱦڿȣأ
-const int HEIGHT = 600;  // Ⱦڸ߶ȣأ
-unsigned char* framebuffer;  // ֡洢RGBݣOpenGLʾ
-
-// Vector3ṹ壺3D͵㣬λáߡɫ
-struct Vector3 {
-    float x, y, z;  // 
-    Vector3(float x = 0, float y = 0, float z = 0) : x(x), y(y), z(z) {}  // 캯Ĭ
-    // ӷ
-    Vector3 operator+(const Vector3& v) const { return Vector3(x + v.x, y + v.y, z + v.z); }
-    // 
-    Vector3 operator-(const Vector3& v) const { return Vector3(x - v.x, y - v.y, z - v.z); }
-    // ˷ * 
-    Vector3 operator*(float s) const { return Vector3(x * s, y * s, z * s); }
-    // ˷Hadamardɫϣ
-    Vector3 operator*(const Vector3& v) const { return Vector3(x * v.x, y * v.y, z * v.z); }
-    // Ԫ * Գƣ
-    friend Vector3 operator*(float s, const Vector3& v) { return v * s; }
-    // ڼǶȡͶӰ
-    float dot(const Vector3& v) const { return x * v.x + y * v.y + z * v.z; }
-    // ڼ㷨ߡֱ
-    Vector3 cross(const Vector3& v) const {
-        return Vector3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
-    }
-    // һصλ
-    Vector3 normalize() const {
-        float len = std::sqrt(x * x + y * y + z * z);  // 㳤
-        return len > 0 ? *this * (1.0f / len) : *this;  // 
-    }
-    // ȼ
-    float length() const { return std::sqrt(x * x + y * y + z * z); }
+// ȾӣĬȡǰʱ䣻ͨ --seed ̶ֵָʱȾȫ
+unsigned int renderSeed = static_cast<unsigned int>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+// Ⱦ߳ĬȡCPUͨ --threads ָ1ʾ߳Ⱦ
+int renderThreads = std::max(1u, std::thread::hardware_concurrency());
+const int TILE_SIZE = 32;  // ȾķֿСأ
+bool usePackets = true;    // ӰǷ2x2߰׷٣--no-packets رգ
+bool progressiveMode = true;     // ģʽǷ񽥽ʽȾ--blocking رգ
+int renderPasses = 0;            // --passes ָı0ΪĬϣڽʽ256飬޽ģʽ1飩
+std::string outputPath;          // --output ָļʱ޽ģʽ
+std::string heatmapPath;         // --heatmap ָÿشͼļҪ -DRT_STATS 룩
+std::string auxOutputPath;       // --aux ָĸ壨ʡߡȣļ
+int adaptiveBudget = 0;          // Ӧÿ֡Ԥ㣨ƽÿ--adaptive ָ0Ϊر
+float adaptiveThreshold = 0.01f; // ؾֵı׼ʾռȣڴֵ׷--aa-threshold ָ
+const int AA_BASE_SAMPLES = 4;   // Ӧĳʼ2x2ֲ
+const int AA_MAX_SAMPLES = 256;  // ص
+
+// ֣ĬCornell Box̶Ļ׼Գ--scene ѡ--bench ʹã
+enum SceneLayout {
+    SCENE_CORNELL = 0,  // ԭʼCornell Box
+    SCENE_STRESS,       // Cornell Box + 20000СBVHSIMDѹԣ
+    SCENE_GLOSSY        // Cornell Boxǽں͵ذ嶼Ϊֲڷ䣨ģѹԣ
+};
+int sceneLayout = SCENE_CORNELL;
+const int STRESS_SPHERES = 20000;       // ѹС
+const unsigned int STRESS_SEED = 7u;    // ѹİڷӣ --seed ޹أι̶
+bool benchMode = false;          // --benchл׼׼
+bool benchQuick = false;         // --bench quickֻСãð̲ԣ
+bool benchMicroOnly = false;     // --bench microֻ󽻡ĵ΢׼Ⱦ
+std::string benchOutPath;        // --bench-out ָĽļΪʱд׼
+std::string sceneFilePath;       // --scene-file ָıΪʱʹósceneLayout
+std::string exportScenePath;     // --export-sceneѵǰдıļ
+bool useSceneCache = true;       // ıǷдƻ棨<ļ>.cache--no-scene-cache رգ
+int workerPort = 0;              // --worker PORTΪֲʽȾĹڵö˿ڣ0Ϊ
+std::vector<std::string> workerAddresses;  // --workers host:port,...޽ȾʱѷַֿЩڵ
+double distTimeout = 120.0;      // --dist-timeout Sڵ㳬 S ûзطֿ鼴ΪʧЧֿ·
+bool gpuBackend = false;         // --gpuģʽGPUɫȾа G лCPU·Ϊοʵ
+
+ // Ϊ˼򻯣ʹ Mersenne Twister 棨αֻڳʼPerlinû
+std::mt19937 rng(renderSeed);
+
+// Pcg32ṹ壺PCG-XSH-RR 32λ״ֻ̬16ֽڣֻβ
+// ׷ʱÿ߳һݣÿؿʼʱ (, x, y) ²֣֤߳˳޹
+struct Pcg32 {
+    uint64_t state = 0x853C49E6748FEA9BULL;
+    uint64_t inc = 0xDA3E39CB94B95BDBULL;  // ţΪ
+
+    void seed(uint64_t initState, uint64_t stream) {
+        state = 0;
+        inc = (stream << 1u) | 1u;
+        next();
+        state += initState;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = static_cast<uint32_t>(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // [0, 1) ȷֲȡ24λ֤ϸС1
+    float nextFloat() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+thread_local Pcg32 pixelRng;  // ׷棨ÿ߳һݣ
+
+// ʼһأ²ֵǰ̵߳
+void beginPixelRng(unsigned int seed) {
+    pixelRng.seed(seed, renderSeed);
+}
+
+//  0.0  1.0 ֮˹̶ģ
+float randZeroOne() {
+    return pixelRng.nextFloat();
+}
+
+//  -1.0  1.0 ֮Ŷ
+float randNegPosOne() {
+    return pixelRng.nextFloat() * 2.0f - 1.0f;
+}
+
+// ģķѲԣƴֲڱ֮ηʱĹ
+enum GlossyPolicy {
+    GLOSSY_SPLIT_ALWAYS = 0,  // ÿδֲڷ䶼ѳ GLOSSY_SAMPLES ߣ 16^ գ
+    GLOSSY_SPLIT_FIRST,       // ֻ·ϵһδֲڷ䴦ѣ֮ÿηֻ׷1
+    GLOSSY_ROULETTE           // ͬϣ֮ĴֲڷԶ˹̶ǰֹƫʼȨ
+};
+const int GLOSSY_SAMPLES = 16;               // ʱĬϲ
+int glossyPolicy = GLOSSY_SPLIT_FIRST;       // ͨ --glossy always|first|roulette ѡ
+int glossySplitSamples = GLOSSY_SAMPLES;     // ȾʱĲ--glossy-samples N --denoise ɽ1~4
+
+// ----------------------------------------------------
+// Ⱦͳƣ -DRT_STATS ãÿ߳һݼ·ֻ̱߳
+// ҲУδ RT_STATS ʱĺչΪգȫ롣
+
+// 4ͨλĸ߰ĻԾ
+inline int popcount4(int mask) {
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+#ifdef RT_STATS
+struct RayStats {
+    uint64_t primaryRays = 0;     // 
+    uint64_t shadowRays = 0;      // Ӱ
+    uint64_t reflectionRays = 0;  // 淴ߣʵFresnelȫ䣩
+    uint64_t refractionRays = 0;  // 
+    uint64_t glossyRays = 0;      // ģ
+    uint64_t nodeTests = 0;       // BVHڵΧвԣ߰Ծͨƣ
+    uint64_t primTests = 0;       // ͼԪ󽻲
+    int maxDepth = 0;             // ݹ
+
+    uint64_t rays() const { return primaryRays + shadowRays + reflectionRays + refractionRays + glossyRays; }
 };
 
+std::mutex rayStatsMutex;                             // עֻ߳״μͻʱ
+std::vector<std::unique_ptr<RayStats>> rayStatsList;  // ̵߳ļ߳˳ԱԱ
+thread_local RayStats* rayStatsLocal = nullptr;       // ǰ̵߳ļ
+
+// ǰ̵߳ļ״εʱע
+inline RayStats& threadStats() {
+    if (!rayStatsLocal) {
+        std::lock_guard<std::mutex> lock(rayStatsMutex);
+        rayStatsList.emplace_back(new RayStats());
+        rayStatsLocal = rayStatsList.back().get();
+    }
+    return *rayStatsLocal;
+}
+
+#define STAT_ADD(field, n) (threadStats().field += (n))
+#define STAT_MAX(field, v) (threadStats().field = std::max(threadStats().field, (v)))
+#define STAT_COST() (threadStats().nodeTests + threadStats().primTests)  // شۣڵ + ͼԪ
+#else
+#define STAT_ADD(field, n) ((void)0)
+#define STAT_MAX(field, v) ((void)0)
+#define STAT_COST() 0
+#endif
+
+const int WIDTH = 800;   // ĬȾڿȣأ
+const int HEIGHT = 600;  // ĬȾڸ߶ȣأ
+int imageWidth = WIDTH;    // ʵȾȣ--size ָ
+int imageHeight = HEIGHT;  // ʵȾ߶
+unsigned char* framebuffer;  // ֡ɵ8λRGBʾֵOpenGLʾ8λͼ
+float* hdrBuffer;            // Ը֡壺׷дķȣ룬ҲֱPFM/EXR
+
+// Vector33D͵㣬λáߡɫȣѧģе Vec3˳ԭĽṹͬȾ䣩
+typedef Vec3 Vector3;
+
 // Rayṹ壺ߣ׷
 struct Ray {
     Vector3 origin, direction;  // ͷ
-    Ray(Vector3 o, Vector3 d) : origin(o), direction(d.normalize()) {}  // 캯Զһ
+    Vector3 invDirection;       // SlabԣӡBVHڵ㣩ãÿֻһ
+    Ray(Vector3 o, Vector3 d) : origin(o), direction(d.normalize()) {  // 캯Զһ
+        invDirection = Vector3(1 / direction.x, 1 / direction.y, 1 / direction.z);
+    }
+    // ѹһʱʹã normalize()ӰߵķԴͬһοõ
+    static Ray withUnitDirection(Vector3 o, Vector3 d) {
+        Ray r;
+        r.origin = o;
+        r.direction = d;
+        r.invDirection = Vector3(1 / d.x, 1 / d.y, 1 / d.z);
+        return r;
+    }
+private:
+    Ray() {}
+};
+
+// ͣɲʾɫʱθǻɫ
+enum TextureType {
+    TEX_NONE = 0,       // ֱʹ color
+    TEX_WOOD_GRAIN,     // Perlinľƣľ䣩
+    TEX_FLOOR_PLANKS    // ذľƣsin + ƣ
+};
+
+// ľƵֵʽɲѡMaterial::textureEval
+enum TextureEval {
+    TEX_EVAL_PROCEDURAL = 0,  // ÿɫñ perlinNoise + sinԭʼʵ֣
+    TEX_EVAL_BAKED,           // ʱÿ決ΪmipmapɫʱԲ
+    TEX_EVAL_SIMD             // SIMDsin߰ڵĶɫһֵ
 };
+int woodTextureEval = TEX_EVAL_SIMD;  // ľʵľֵʽ--wood procedural|baked|simd ָ
 
 // Materialṹ壺
 struct Material {
@@ -91,14 +289,16 @@ struct Material {
     float roughness = 0.0f;  // ֲڶȣ0Ϊ⻬1Ϊȫ䣨ģ䣩
     bool isRefractive = false;  // ǷΪʣ粣
     bool isMetallic = false;    // ǷΪʣӰ췴ɫ
+    int texture = TEX_NONE;     // ͣTextureType
+    int textureEval = TEX_EVAL_PROCEDURAL;  // ľֵʽTextureEval
 };
 
 // Sphereṹ壺弸
 struct Sphere {
     Vector3 center;  // ĵ
     float radius;    // 뾶
-    Material mat;    // 
-    Sphere(Vector3 c, float r, Material m) : center(c), radius(r), mat(m) {}  // 캯
+    int materialID;  // ʱţScene::materials ±꣩
+    Sphere(Vector3 c, float r, int matID) : center(c), radius(r), materialID(matID) {}  // 캯
     // -ཻԣη̣t
     bool intersect(const Ray& ray, float& t) const {
         Vector3 oc = ray.origin - center;  // ԭ㵽ĵ
@@ -117,12 +317,11 @@ struct Sphere {
 // Boxṹ壺ΧУAABB
 struct Box {
     Vector3 min, max;  // С/
-    Material mat;      // 
-    Box(Vector3 mn, Vector3 mx, Material m) : min(mn), max(mx), mat(m) {}  // 캯
+    int materialID;    // ʱţScene::materials ±꣩
+    Box(Vector3 mn, Vector3 mx, int matID) : min(mn), max(mx), materialID(matID) {}  // 캯
     // -ཻԣSlab/뿪ÿtֵ
     bool intersect(const Ray& ray, float& t, Vector3& normal) const {
-        // 㷴򣨱㣩
-        Vector3 invDir(1 / ray.direction.x, 1 / ray.direction.y, 1 / ray.direction.z);
+        const Vector3& invDir = ray.invDirection;  // 򣨹߹ʱѼ㣩
         // XSlab
         float tMin = (min.x - ray.origin.x) * invDir.x;
         float tMax = (max.x - ray.origin.x) * invDir.x;
@@ -146,11 +345,16 @@ struct Box {
         t = tMin;  // 
         if (t < 0.001f || t > 1000.0f) return false;  // Ч
 
+        normal = normalAt(ray, t);
+        return true;
+    }
+
+    // 淨ߣݻ䷽ȷⷨߣSIMDֻtȷٵ
+    Vector3 normalAt(const Ray& ray, float t) const {
         // е
         Vector3 hitPoint = ray.origin + ray.direction * t;
         float eps = 0.001f;  // 㾫ֵ
-        normal = Vector3(0, 0, 0);  // ʼ
-        // ݻ䷽ȷߣⷨߣ
+        Vector3 normal = Vector3(0, 0, 0);  // ʼ
         if (std::abs(hitPoint.x - min.x) < eps && ray.direction.x < 0) normal = Vector3(-1, 0, 0);
         else if (std::abs(hitPoint.x - max.x) < eps && ray.direction.x > 0) normal = Vector3(1, 0, 0);
         else if (std::abs(hitPoint.y - min.y) < eps && ray.direction.y < 0) normal = Vector3(0, -1, 0);
@@ -163,10 +367,891 @@ struct Box {
             Vector3 center = (min + max) * 0.5f;
             normal = (hitPoint - center).normalize();
         }
+        return normal;
+    }
+};
+
+// Rectṹ壺ΣCornell Boxǽڡذ塢컨壩
+// min/max ڷϵķͬηΧ߳ڲ˫ɼ
+struct Rect {
+    Vector3 min, max;  // ηΧ
+    Vector3 normal;    // ɫ
+    int materialID;    // ʱţScene::materials ±꣩
+    int axis;          // ᣨ0=x, 1=y, 2=z
+    Rect(Vector3 mn, Vector3 mx, Vector3 n, int matID) : min(mn), max(mx), normal(n), materialID(matID) {
+        axis = std::abs(n.x) > 0.5f ? 0 : (std::abs(n.y) > 0.5f ? 1 : 2);
+    }
+    // -ཻԣƽĽ㣬ټǷھηΧ
+    bool intersect(const Ray& ray, float& t) const {
+        float denom = normal.dot(ray.direction);  // ߡ
+        if (std::abs(denom) <= 0.001f) return false;  // ƽ
+        t = (min - ray.origin).dot(normal) / denom;  // t = ( - ԭ)   / denom
+        if (t <= 0.001f) return false;  // ֻҪ򽻵
+        Vector3 p = ray.origin + ray.direction * t;
+        // ߽飨ᣩ
+        if (axis != 0 && (p.x < min.x || p.x > max.x)) return false;
+        if (axis != 1 && (p.y < min.y || p.y > max.y)) return false;
+        if (axis != 2 && (p.z < min.z || p.z > max.z)) return false;
+        return true;
+    }
+};
+
+// ȡ0=x, 1=y, 2=z
+inline float axisComponent(const Vector3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// ϵ꣺ȥᣬ갴 [mn, mx] һ [0, 1]
+inline void planarUV(const Vector3& p, const Vector3& mn, const Vector3& mx, int axis, float& u, float& v) {
+    int ua = axis == 0 ? 2 : 0;  // xzux
+    int va = axis == 1 ? 2 : 1;  // yzvy
+    float uSize = axisComponent(mx, ua) - axisComponent(mn, ua);
+    float vSize = axisComponent(mx, va) - axisComponent(mn, va);
+    u = uSize > 0 ? (axisComponent(p, ua) - axisComponent(mn, ua)) / uSize : 0.0f;
+    v = vSize > 0 ? (axisComponent(p, va) - axisComponent(mn, va)) / vSize : 0.0f;
+}
+
+// ----------------------------------------------------
+// BVHٽṹSAHʽ乹չƽΪڵ
+
+// С/
+inline Vector3 vmin(const Vector3& a, const Vector3& b) {
+    return Vector3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+}
+inline Vector3 vmax(const Vector3& a, const Vector3& b) {
+    return Vector3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+}
+
+// AABBṹ壺Χ
+struct AABB {
+    Vector3 min = Vector3(1e30f, 1e30f, 1e30f);
+    Vector3 max = Vector3(-1e30f, -1e30f, -1e30f);
+    void grow(const Vector3& p) { min = vmin(min, p); max = vmax(max, p); }
+    void grow(const AABB& b) { min = vmin(min, b.min); max = vmax(max, b.max); }
+    Vector3 center() const { return (min + max) * 0.5f; }
+    // պз0
+    float area() const {
+        Vector3 e = max - min;
+        if (e.x < 0) return 0.0f;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+// -AABB SlabԣinvDirΪԤȼķǷ [0, tMax) ཻtEntryΪ
+inline bool intersectAABB(const Vector3& bmin, const Vector3& bmax, const Vector3& origin, const Vector3& invDir,
+    float tMax, float& tEntry) {
+    float tx1 = (bmin.x - origin.x) * invDir.x, tx2 = (bmax.x - origin.x) * invDir.x;
+    float tNear = std::min(tx1, tx2), tFar = std::max(tx1, tx2);
+    float ty1 = (bmin.y - origin.y) * invDir.y, ty2 = (bmax.y - origin.y) * invDir.y;
+    tNear = std::max(tNear, std::min(ty1, ty2)); tFar = std::min(tFar, std::max(ty1, ty2));
+    float tz1 = (bmin.z - origin.z) * invDir.z, tz2 = (bmax.z - origin.z) * invDir.z;
+    tNear = std::max(tNear, std::min(tz1, tz2)); tFar = std::min(tFar, std::max(tz1, tz2));
+    tEntry = tNear;
+    return tFar >= std::max(tNear, 0.0f) && tNear < tMax;
+}
+
+// ----------------------------------------------------
+// SceneArray顣׶ std::vector ͬд洢ӳʱ attach() ֱָ
+// ӳļڴ棬ơ䡣ͼϵ޸ĲȰݸƵд洢
+template <class T>
+class SceneArray {
+public:
+    SceneArray() {}
+    SceneArray(const SceneArray& o) : storage(o.ptr, o.ptr + o.count) { sync(); }
+    SceneArray& operator=(const SceneArray& o) {
+        if (this != &o) { storage.assign(o.ptr, o.ptr + o.count); sync(); }
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+    T& operator[](size_t i) { return ptr[i]; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    T* begin() { return ptr; }
+    T* end() { return ptr + count; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+    T& back() { return ptr[count - 1]; }
+
+    void push_back(const T& v) { own(); storage.push_back(v); sync(); }
+    void reserve(size_t n) { own(); storage.reserve(n); sync(); }
+    void resize(size_t n) { own(); storage.resize(n); sync(); }
+    void assign(size_t n, const T& v) { storage.assign(n, v); sync(); }
+    void clear() { storage.clear(); sync(); }
+
+    // ָⲿڴ [p, p+n)÷֤ڳڱ飩
+    void attach(T* p, size_t n) {
+        std::vector<T>().swap(storage);
+        ptr = p;
+        count = n;
+        external = true;
+    }
+
+private:
+    void own() {
+        if (external) storage.assign(ptr, ptr + count);
+        external = false;
+    }
+    void sync() { ptr = storage.data(); count = storage.size(); external = false; }
+
+    std::vector<T> storage;  // д洢
+    T* ptr = nullptr;        // ǰݣд洢ӳڴ棩
+    size_t count = 0;
+    bool external = false;   // ǷΪⲿڴͼ
+};
+
+// ֻ򿪡дʱӳļӳҳ水ҳ룬޸ֻӰ챾
+struct MappedFile {
+    void* data = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+    bool open(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (!mapping) { close(); return false; }
+        data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        if (!data) { close(); return false; }
+        size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        off_t end = lseek(fd, 0, SEEK_END);
+        if (end <= 0) { ::close(fd); return false; }
+        void* p = mmap(nullptr, static_cast<size_t>(end), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // ӳ佨󼴿ɹر
+        if (p == MAP_FAILED) return false;
+        data = p;
+        size = static_cast<size_t>(end);
+#endif
+        return true;
+    }
+
+    void close() {
+#if defined(_WIN32)
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+};
+
+// BVHNodeṹ壺32ֽչƽڵ
+// count > 0 ΪҶӣͼԪΪ primIndices[leftFirst .. leftFirst+count)
+// Ϊڲڵ㣬ҺΪ nodes[leftFirst]  nodes[leftFirst+1]
+struct BVHNode {
+    Vector3 bmin, bmax;  // ڵΧ
+    int leftFirst;       //  / ׸ͼԪλ
+    int count;           // ҶͼԪ0ʾڲڵ㣩
+};
+
+// ----------------------------------------------------
+// SIMD󽻺ģSoAṹ飩֣һͬʱ SIMD_WIDTH Slab/ǽھΣ
+// -mavx2 ʱΪ8·AVX2x86-64ĬΪ4·SSEƽ̨˻Ϊѭ
+// vfloat 㣨SIMD_WIDTHvset1/vload/vadd... dotSpan/normalizeSpan ڹģ common/simd_math.h 
+
+// һ n 󽻣ΪSoA o 뷽 d Sphere::intersect ˳ͬ
+// ʱ t[i] ΪЧ룬Ϊ -1
+inline int intersectSphereSpan(const Sphere& sphere, const float* ox, const float* oy, const float* oz,
+    const float* dx, const float* dy, const float* dz, float* t, int n) {
+    int i = 0, hits = 0;
+#if SIMD_WIDTH > 1
+    const vfloat cx = vset1(sphere.center.x), cy = vset1(sphere.center.y), cz = vset1(sphere.center.z);
+    const vfloat r2 = vset1(sphere.radius * sphere.radius), zero = vset1(0.0f), two = vset1(2.0f), four = vset1(4.0f);
+    const vfloat eps = vset1(0.001f), miss = vset1(-1.0f);
+    for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+        vfloat vdx = vload(dx + i), vdy = vload(dy + i), vdz = vload(dz + i);
+        vfloat ocx = vsub(vload(ox + i), cx), ocy = vsub(vload(oy + i), cy), ocz = vsub(vload(oz + i), cz);
+        vfloat a = vadd(vadd(vmul(vdx, vdx), vmul(vdy, vdy)), vmul(vdz, vdz));
+        vfloat b = vmul(two, vadd(vadd(vmul(ocx, vdx), vmul(ocy, vdy)), vmul(ocz, vdz)));
+        vfloat c = vsub(vadd(vadd(vmul(ocx, ocx), vmul(ocy, ocy)), vmul(ocz, ocz)), r2);
+        vfloat disc = vsub(vmul(b, b), vmul(vmul(four, a), c));
+        vfloat valid = vcmpge(disc, zero);
+        vfloat root = vsqrt(vmaxf(disc, zero));
+        vfloat twoA = vmul(two, a);
+        vfloat tNear = vdiv(vsub(vsub(zero, b), root), twoA);
+        vfloat tFar = vdiv(vadd(vsub(zero, b), root), twoA);
+        vfloat tHit = vselect(vcmpgt(tNear, eps), tNear, tFar);
+        vfloat hit = vand(valid, vcmpgt(tHit, eps));
+        vstore(t + i, vselect(hit, tHit, miss));
+        int mask = vmovemask(hit);
+        for (; mask; mask &= mask - 1) ++hits;
+    }
+#endif
+    for (; i < n; ++i) {
+        Ray ray = Ray::withUnitDirection(Vector3(ox[i], oy[i], oz[i]), Vector3(dx[i], dy[i], dz[i]));
+        float ti;
+        bool hit = sphere.intersect(ray, ti);
+        t[i] = hit ? ti : -1.0f;
+        hits += hit;
+    }
+    return hits;
+}
+
+// PrimSoAṹ壺BVHҶ˳еͼԪݣ±꼴 BVH::primIndices еλã
+// ÿҶΪ塢SlabʵֻλЧSlabֻSlabλЧʵʹSoAݣ
+// ĩβ SIMD_WIDTH ԪأʹҶһزԽ磨ͨɼΣ
+struct PrimSoA {
+    SceneArray<float> cx, cy, cz, r2;                      // 뾶ƽ
+    SceneArray<float> minX, minY, minZ, maxX, maxY, maxZ;  // SlabΧӣΪ0ǽھΣ
+    SceneArray<int> leafSphereCount;                       // ҶʼλôҶ
+    SceneArray<int> leafInstanceCount;                     // ҶʼλôҶʵҶĩβ
+
+    void resize(size_t n) {
+        size_t padded = n + SIMD_WIDTH;
+        for (auto v : { &cx, &cy, &cz, &r2, &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) v->assign(padded, 0.0f);
+        leafSphereCount.assign(padded, 0);
+        leafInstanceCount.assign(padded, 0);
+    }
+};
+
+// 1 vs λ [first, first+count) 壺ҵ tBest Ľʱ tBest/bestPos true
+//  Sphere::intersect ͬĶη 0.001 Խֵ
+// AnyHit ΪtrueʱӰߣֻشǷڵһҵ㼴أ tBest/bestPos
+template <bool AnyHit = false>
+inline bool intersectSpheresSoA(const PrimSoA& soa, int first, int count, const Ray& ray, float& tBest, int& bestPos) {
+    float a = ray.direction.dot(ray.direction);  // ƽ
+    bool found = false;
+#if SIMD_WIDTH > 1
+    vfloat ox = vset1(ray.origin.x), oy = vset1(ray.origin.y), oz = vset1(ray.origin.z);
+    vfloat dx = vset1(ray.direction.x), dy = vset1(ray.direction.y), dz = vset1(ray.direction.z);
+    vfloat va = vset1(a), twoA = vset1(2 * a), fourA = vset1(4 * a), two = vset1(2.0f);
+    vfloat eps = vset1(0.001f), zero = vset1(0.0f), inf = vset1(std::numeric_limits<float>::infinity());
+    for (int i = 0; i < count; i += SIMD_WIDTH) {
+        int k = first + i;
+        vfloat ocx = vsub(ox, vload(&soa.cx[k]));  // ԭ㵽ĵ
+        vfloat ocy = vsub(oy, vload(&soa.cy[k]));
+        vfloat ocz = vsub(oz, vload(&soa.cz[k]));
+        vfloat b = vmul(two, vadd(vadd(vmul(ocx, dx), vmul(ocy, dy)), vmul(ocz, dz)));  // 
+        vfloat c = vsub(vadd(vadd(vmul(ocx, ocx), vmul(ocy, ocy)), vmul(ocz, ocz)), vload(&soa.r2[k]));  // 
+        vfloat disc = vsub(vmul(b, b), vmul(fourA, c));  // бʽ
+        vfloat sq = vsqrt(vmaxf(disc, zero));
+        vfloat negB = vsub(zero, b);
+        vfloat t0 = vdiv(vsub(negB, sq), twoA);  // Ͻ
+        vfloat t1 = vdiv(vadd(negB, sq), twoA);  // Զ
+        vfloat t = vselect(vcmpgt(t0, eps), t0, t1);
+        vfloat valid = vand(vand(vcmpge(disc, zero), vcmpgt(t, eps)),
+            vand(vcmplt(t, vset1(tBest)), vcmplt(vlaneindex(), vset1(static_cast<float>(count - i)))));
+        if (vmovemask(valid) == 0) continue;
+        if (AnyHit) return true;
+        float ts[SIMD_WIDTH];
+        vstore(ts, vselect(valid, t, inf));
+        for (int l = 0; l < SIMD_WIDTH; ++l) {
+            if (ts[l] < tBest) { tBest = ts[l]; bestPos = k + l; found = true; }
+        }
+    }
+    (void)va;
+#else
+    for (int k = first; k < first + count; ++k) {
+        Vector3 oc = ray.origin - Vector3(soa.cx[k], soa.cy[k], soa.cz[k]);
+        float b = 2 * oc.dot(ray.direction);
+        float c = oc.dot(oc) - soa.r2[k];
+        float disc = b * b - 4 * a * c;
+        if (disc < 0) continue;
+        float sq = std::sqrt(disc);
+        float t = (-b - sq) / (2 * a);
+        if (!(t > 0.001f)) t = (-b + sq) / (2 * a);
+        if (t > 0.001f && t < tBest) {
+            if (AnyHit) return true;
+            tBest = t; bestPos = k; found = true;
+        }
+    }
+#endif
+    return found;
+}
+
+// 1 vs λ [first, first+count) Slab Box::intersect ͬĽ [0.001, 1000] Χ
+// Ϊ0ǽھڷϽ=뿪Ȼ˻Ϊƽ + Χ飻AnyHit ͬ
+template <bool AnyHit = false>
+inline bool intersectSlabsSoA(const PrimSoA& soa, int first, int count, const Ray& ray, float& tBest, int& bestPos) {
+    bool found = false;
+#if SIMD_WIDTH > 1
+    vfloat ox = vset1(ray.origin.x), oy = vset1(ray.origin.y), oz = vset1(ray.origin.z);
+    vfloat ix = vset1(ray.invDirection.x), iy = vset1(ray.invDirection.y), iz = vset1(ray.invDirection.z);
+    vfloat tLo = vset1(0.001f), tHi = vset1(1000.0f), inf = vset1(std::numeric_limits<float>::infinity());
+    for (int i = 0; i < count; i += SIMD_WIDTH) {
+        int k = first + i;
+        vfloat tx1 = vmul(vsub(vload(&soa.minX[k]), ox), ix), tx2 = vmul(vsub(vload(&soa.maxX[k]), ox), ix);
+        vfloat ty1 = vmul(vsub(vload(&soa.minY[k]), oy), iy), ty2 = vmul(vsub(vload(&soa.maxY[k]), oy), iy);
+        vfloat tz1 = vmul(vsub(vload(&soa.minZ[k]), oz), iz), tz2 = vmul(vsub(vload(&soa.maxZ[k]), oz), iz);
+        vfloat tNear = vmaxf(vmaxf(vminf(tx1, tx2), vminf(ty1, ty2)), vminf(tz1, tz2));
+        vfloat tFar = vminf(vminf(vmaxf(tx1, tx2), vmaxf(ty1, ty2)), vmaxf(tz1, tz2));
+        vfloat valid = vand(vand(vcmple(tNear, tFar), vand(vcmpge(tNear, tLo), vcmple(tNear, tHi))),
+            vand(vcmplt(tNear, vset1(tBest)), vcmplt(vlaneindex(), vset1(static_cast<float>(count - i)))));
+        if (vmovemask(valid) == 0) continue;
+        if (AnyHit) return true;
+        float ts[SIMD_WIDTH];
+        vstore(ts, vselect(valid, tNear, inf));
+        for (int l = 0; l < SIMD_WIDTH; ++l) {
+            if (ts[l] < tBest) { tBest = ts[l]; bestPos = k + l; found = true; }
+        }
+    }
+#else
+    for (int k = first; k < first + count; ++k) {
+        float tx1 = (soa.minX[k] - ray.origin.x) * ray.invDirection.x, tx2 = (soa.maxX[k] - ray.origin.x) * ray.invDirection.x;
+        float ty1 = (soa.minY[k] - ray.origin.y) * ray.invDirection.y, ty2 = (soa.maxY[k] - ray.origin.y) * ray.invDirection.y;
+        float tz1 = (soa.minZ[k] - ray.origin.z) * ray.invDirection.z, tz2 = (soa.maxZ[k] - ray.origin.z) * ray.invDirection.z;
+        float tNear = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::min(tz1, tz2));
+        float tFar = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::max(tz1, tz2));
+        if (tNear <= tFar && tNear >= 0.001f && tNear <= 1000.0f && tNear < tBest) {
+            if (AnyHit) return true;
+            tBest = tNear; bestPos = k; found = true;
+        }
+    }
+#endif
+    return found;
+}
+
+// ɹ߰2x2ص߻ǵӰߣBVHڵ4ͬʱSlab
+const int PACKET_SIZE = 4;
+
+// 4 vs һAABBеͨλ룬tEntryΪͨ
+inline int intersectAABB4(const BVHNode& node, const Ray* const rays[PACKET_SIZE], const float tMax[PACKET_SIZE],
+    float tEntry[PACKET_SIZE]) {
+#if defined(__SSE2__)
+    __m128 ox = _mm_setr_ps(rays[0]->origin.x, rays[1]->origin.x, rays[2]->origin.x, rays[3]->origin.x);
+    __m128 oy = _mm_setr_ps(rays[0]->origin.y, rays[1]->origin.y, rays[2]->origin.y, rays[3]->origin.y);
+    __m128 oz = _mm_setr_ps(rays[0]->origin.z, rays[1]->origin.z, rays[2]->origin.z, rays[3]->origin.z);
+    __m128 ix = _mm_setr_ps(rays[0]->invDirection.x, rays[1]->invDirection.x, rays[2]->invDirection.x, rays[3]->invDirection.x);
+    __m128 iy = _mm_setr_ps(rays[0]->invDirection.y, rays[1]->invDirection.y, rays[2]->invDirection.y, rays[3]->invDirection.y);
+    __m128 iz = _mm_setr_ps(rays[0]->invDirection.z, rays[1]->invDirection.z, rays[2]->invDirection.z, rays[3]->invDirection.z);
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmin.x), ox), ix), tx2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmax.x), ox), ix);
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmin.y), oy), iy), ty2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmax.y), oy), iy);
+    __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmin.z), oz), iz), tz2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bmax.z), oz), iz);
+    __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_min_ps(tz1, tz2));
+    __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_max_ps(tz1, tz2));
+    _mm_storeu_ps(tEntry, tNear);
+    __m128 hit = _mm_and_ps(_mm_cmpge_ps(tFar, _mm_max_ps(tNear, _mm_setzero_ps())), _mm_cmplt_ps(tNear, _mm_loadu_ps(tMax)));
+    return _mm_movemask_ps(hit);
+#else
+    int mask = 0;
+    for (int i = 0; i < PACKET_SIZE; ++i) {
+        if (intersectAABB(node.bmin, node.bmax, rays[i]->origin, rays[i]->invDirection, tMax[i], tEntry[i])) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// ----------------------------------------------------
+// BVH
+
+// BVHṹ壺ͼԪ޹أֻÿͼԪİΧУҶڵɵ÷ص
+struct BVH {
+    SceneArray<BVHNode> nodes;    // չƽڵ飬nodes[0]Ϊ
+    SceneArray<int> primIndices;  // Ҷ˳źͼԪ
+
+    static const int SAH_BINS = 12;  // SAH
+    static constexpr int MAX_DEPTH = 63;              // ޣﵽǿƳΪҶӣ˻ļ޼
+    static constexpr int STACK_SIZE = MAX_DEPTH + 1;  // ջȲ MAX_DEPTH ʱջ MAX_DEPTH + 1 ڵ㣬ѹջ
+    int leafWidth = 1;    // Ҷ󽻺һβԵͼԪSIMDȣSAH ceil(n / leafWidth) ҶӴ
+    int maxLeafSize = 4;  // ҶͼԪʱʹSAHҲǿƻ֣
+
+    // primBounds[i] Ϊ i ͼԪİΧ
+    void build(const std::vector<AABB>& primBounds) {
+        nodes.clear();
+        primIndices.resize(primBounds.size());
+        for (size_t i = 0; i < primBounds.size(); ++i) primIndices[i] = static_cast<int>(i);
+        if (primBounds.empty()) return;
+        nodes.reserve(primBounds.size() * 2);
+        nodes.push_back(BVHNode());
+        nodes[0].leftFirst = 0;
+        nodes[0].count = static_cast<int>(primBounds.size());
+        updateBounds(0, primBounds);
+        subdivide(0, primBounds, 0);
+    }
+
+    // leafFn(first, count, tMax) Ҷ primIndices[first .. first+count) 󽻣
+    // иʱ tMax trueĺȷʣԶtMax̺ɱ޳
+    template <class LeafFn>
+    bool traverse(const Vector3& origin, const Vector3& invDir, float& tMax, LeafFn&& leafFn) const {
+        return !nodes.empty() && traverseNodes(nodes.data(), origin, invDir, tMax, leafFn);
+    }
+
+    //  traverse ͬչƽڵ飨ʵBVHڳĽڵУnodes ָ
+    template <class LeafFn>
+    static bool traverseNodes(const BVHNode* nodes, const Vector3& origin, const Vector3& invDir, float& tMax, LeafFn&& leafFn) {
+        bool hit = false;
+        int stack[STACK_SIZE];
+        int sp = 0;
+        float tEntry;
+        STAT_ADD(nodeTests, 1);
+        if (!intersectAABB(nodes[0].bmin, nodes[0].bmax, origin, invDir, tMax, tEntry)) return false;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            const BVHNode& node = nodes[stack[--sp]];
+            if (node.count > 0) {
+                if (leafFn(node.leftFirst, node.count, tMax)) hit = true;
+                continue;
+            }
+            STAT_ADD(nodeTests, 2);
+            int a = node.leftFirst, b = node.leftFirst + 1;
+            float ta, tb;
+            bool hitA = intersectAABB(nodes[a].bmin, nodes[a].bmax, origin, invDir, tMax, ta);
+            bool hitB = intersectAABB(nodes[b].bmin, nodes[b].bmax, origin, invDir, tMax, tb);
+            if (hitA && hitB) {
+                if (ta > tb) std::swap(a, b);
+                stack[sp++] = b;  // Զջ
+                stack[sp++] = a;
+            }
+            else if (hitA) stack[sp++] = a;
+            else if (hitB) stack[sp++] = b;
+        }
+        return hit;
+    }
+
+    // ߰4߹һνڵʣڵSSEͬʱɣ
+    // leafFn(lane, first, count, tMax[lane]) ԵҶ󽻡ջбýڵʱĻԾͨ
+    template <class LeafFn>
+    void traversePacket(const Ray* const rays[PACKET_SIZE], float tMax[PACKET_SIZE], int activeMask, LeafFn&& leafFn) const {
+        if (nodes.empty() || activeMask == 0) return;
+        int stackNode[STACK_SIZE], stackMask[STACK_SIZE];
+        int sp = 0;
+        float tEntry[PACKET_SIZE];
+        int rootMask = intersectAABB4(nodes[0], rays, tMax, tEntry) & activeMask;
+        STAT_ADD(nodeTests, popcount4(activeMask));
+        if (rootMask == 0) return;
+        stackNode[sp] = 0; stackMask[sp++] = rootMask;
+        while (sp > 0) {
+            --sp;
+            const BVHNode& node = nodes[stackNode[sp]];
+            int mask = stackMask[sp];
+            if (node.count > 0) {
+                for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+                    if (mask & (1 << lane)) leafFn(lane, node.leftFirst, node.count, tMax[lane]);
+                }
+                continue;
+            }
+            int a = node.leftFirst, b = node.leftFirst + 1;
+            float ta[PACKET_SIZE], tb[PACKET_SIZE];
+            STAT_ADD(nodeTests, 2 * popcount4(mask));
+            int maskA = intersectAABB4(nodes[a], rays, tMax, ta) & mask;
+            int maskB = intersectAABB4(nodes[b], rays, tMax, tb) & mask;
+            if (maskA && maskB) {
+                // ԻԾͨСԶ
+                float nearA = 1e30f, nearB = 1e30f;
+                for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+                    if (maskA & (1 << lane)) nearA = std::min(nearA, ta[lane]);
+                    if (maskB & (1 << lane)) nearB = std::min(nearB, tb[lane]);
+                }
+                if (nearA > nearB) { std::swap(a, b); std::swap(maskA, maskB); }
+                stackNode[sp] = b; stackMask[sp++] = maskB;  // Զջ
+                stackNode[sp] = a; stackMask[sp++] = maskA;
+            }
+            else if (maskA) { stackNode[sp] = a; stackMask[sp++] = maskA; }
+            else if (maskB) { stackNode[sp] = b; stackMask[sp++] = maskB; }
+        }
+    }
+
+    // ⽻ӰߣleafFn(first, count) Ҷҵһڵtrue漴
+    // Ҫ㣬˺ӲtMax Ҳ
+    template <class LeafFn>
+    bool traverseAny(const Vector3& origin, const Vector3& invDir, float tMax, LeafFn&& leafFn) const {
+        return !nodes.empty() && traverseNodesAny(nodes.data(), origin, invDir, tMax, leafFn);
+    }
+
+    template <class LeafFn>
+    static bool traverseNodesAny(const BVHNode* nodes, const Vector3& origin, const Vector3& invDir, float tMax, LeafFn&& leafFn) {
+        int stack[STACK_SIZE];
+        int sp = 0;
+        float tEntry;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            const BVHNode& node = nodes[stack[--sp]];
+            STAT_ADD(nodeTests, 1);
+            if (!intersectAABB(node.bmin, node.bmax, origin, invDir, tMax, tEntry)) continue;
+            if (node.count > 0) {
+                if (leafFn(node.leftFirst, node.count)) return true;
+                continue;
+            }
+            stack[sp++] = node.leftFirst + 1;
+            stack[sp++] = node.leftFirst;
+        }
+        return false;
+    }
+
+    // ߰⽻رڵͨλ롣ͨһڵ˳ڵԣȫͨȷǰ
+    template <class LeafFn>
+    int traversePacketAny(const Ray* const rays[PACKET_SIZE], const float tMax[PACKET_SIZE], int activeMask, LeafFn&& leafFn) const {
+        if (nodes.empty() || activeMask == 0) return 0;
+        int stackNode[STACK_SIZE], stackMask[STACK_SIZE];
+        int sp = 0;
+        int occludedMask = 0;
+        float tEntry[PACKET_SIZE];
+        stackNode[sp] = 0; stackMask[sp++] = activeMask;
+        while (sp > 0) {
+            --sp;
+            const BVHNode& node = nodes[stackNode[sp]];
+            STAT_ADD(nodeTests, popcount4(stackMask[sp] & ~occludedMask));
+            int mask = intersectAABB4(node, rays, tMax, tEntry) & stackMask[sp] & ~occludedMask;
+            if (mask == 0) continue;
+            if (node.count > 0) {
+                for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+                    if ((mask & (1 << lane)) && leafFn(lane, node.leftFirst, node.count)) occludedMask |= 1 << lane;
+                }
+                if (occludedMask == activeMask) break;
+                continue;
+            }
+            stackNode[sp] = node.leftFirst + 1; stackMask[sp++] = mask;
+            stackNode[sp] = node.leftFirst; stackMask[sp++] = mask;
+        }
+        return occludedMask;
+    }
+
+private:
+    // Ҷ󽻴ۣSIMDһβ leafWidth ͼԪ
+    float leafCost(int count) const {
+        return static_cast<float>((count + leafWidth - 1) / leafWidth);
+    }
+
+    void updateBounds(int nodeIdx, const std::vector<AABB>& primBounds) {
+        BVHNode& node = nodes[nodeIdx];
+        AABB box;
+        for (int i = 0; i < node.count; ++i) box.grow(primBounds[primIndices[node.leftFirst + i]]);
+        node.bmin = box.min;
+        node.bmax = box.max;
+    }
+
+    // SAHİΧѰҴСĻƽ
+    float findBestSplit(const BVHNode& node, const std::vector<AABB>& primBounds, int& bestAxis, float& bestPos) const {
+        AABB centroidBounds;
+        for (int i = 0; i < node.count; ++i) centroidBounds.grow(primBounds[primIndices[node.leftFirst + i]].center());
+
+        float bestCost = 1e30f;
+        for (int axis = 0; axis < 3; ++axis) {
+            float lo = axis == 0 ? centroidBounds.min.x : (axis == 1 ? centroidBounds.min.y : centroidBounds.min.z);
+            float hi = axis == 0 ? centroidBounds.max.x : (axis == 1 ? centroidBounds.max.y : centroidBounds.max.z);
+            if (hi - lo < 1e-6f) continue;  // غϣ޷
+
+            AABB binBox[SAH_BINS];
+            int binCount[SAH_BINS] = { 0 };
+            float scale = SAH_BINS / (hi - lo);
+            for (int i = 0; i < node.count; ++i) {
+                const AABB& b = primBounds[primIndices[node.leftFirst + i]];
+                Vector3 c = b.center();
+                float cv = axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+                int bin = std::min(SAH_BINS - 1, static_cast<int>((cv - lo) * scale));
+                binCount[bin]++;
+                binBox[bin].grow(b);
+            }
+
+            // ǰ׺/׺ɨõÿƽ
+            float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+            int leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+            AABB leftBox, rightBox;
+            int leftSum = 0, rightSum = 0;
+            for (int i = 0; i < SAH_BINS - 1; ++i) {
+                leftSum += binCount[i];
+                leftCount[i] = leftSum;
+                leftBox.grow(binBox[i]);
+                leftArea[i] = leftBox.area();
+                rightSum += binCount[SAH_BINS - 1 - i];
+                rightCount[SAH_BINS - 2 - i] = rightSum;
+                rightBox.grow(binBox[SAH_BINS - 1 - i]);
+                rightArea[SAH_BINS - 2 - i] = rightBox.area();
+            }
+            for (int i = 0; i < SAH_BINS - 1; ++i) {
+                if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+                float cost = leafCost(leftCount[i]) * leftArea[i] + leafCost(rightCount[i]) * rightArea[i];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestPos = lo + (i + 1) / scale;
+                }
+            }
+        }
+        return bestCost;
+    }
+
+    void subdivide(int nodeIdx, const std::vector<AABB>& primBounds, int depth) {
+        BVHNode node = nodes[nodeIdx];  // push_backʹʧЧ
+        if (node.count <= 1 || depth >= MAX_DEPTH) return;
+
+        int axis = -1;
+        float splitPos = 0;
+        float splitCost = findBestSplit(node, primBounds, axis, splitPos);
+        if (axis < 0) return;  // ȫغϣҶ
+
+        // SAHִֹۣ1 + ӽڵҶӴֹͣ
+        AABB parent;
+        parent.min = node.bmin; parent.max = node.bmax;
+        float parentArea = parent.area();
+        float cost = parentArea > 0 ? 1.0f + splitCost / parentArea : 1e30f;
+        if (cost >= leafCost(node.count) && node.count <= maxLeafSize) return;
+
+        // ƽԭط
+        int i = node.leftFirst, j = node.leftFirst + node.count - 1;
+        while (i <= j) {
+            Vector3 c = primBounds[primIndices[i]].center();
+            float cv = axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+            if (cv < splitPos) ++i;
+            else std::swap(primIndices[i], primIndices[j--]);
+        }
+        int leftCount = i - node.leftFirst;
+        if (leftCount == 0 || leftCount == node.count) return;
+
+        int left = static_cast<int>(nodes.size());
+        nodes.push_back(BVHNode());
+        nodes.push_back(BVHNode());
+        nodes[left].leftFirst = node.leftFirst;
+        nodes[left].count = leftCount;
+        nodes[left + 1].leftFirst = i;
+        nodes[left + 1].count = node.count - leftCount;
+        nodes[nodeIdx].leftFirst = left;
+        nodes[nodeIdx].count = 0;
+        updateBounds(left, primBounds);
+        updateBounds(left + 1, primBounds);
+        subdivide(left, primBounds, depth + 1);
+        subdivide(left + 1, primBounds, depth + 1);
+    }
+};
+
+// ----------------------------------------------------
+// Ķ㡢κ͸ԵBVHֱڳУ
+// BVHֻʵ任ͬһĶʵһݼBVH
+
+// Transformṹ壺3x4任p' = M * (p, 1)ʵռռ以
+struct Transform {
+    float m[3][4];
+
+    static Transform identity() {
+        Transform t;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 4; ++c) t.m[r][c] = r == c ? 1.0f : 0.0f;
+        }
+        return t;
+    }
+    static Transform translate(const Vector3& d) {
+        Transform t = identity();
+        t.m[0][3] = d.x; t.m[1][3] = d.y; t.m[2][3] = d.z;
+        return t;
+    }
+    static Transform scale(const Vector3& k) {
+        Transform t = identity();
+        t.m[0][0] = k.x; t.m[1][1] = k.y; t.m[2][2] = k.z;
+        return t;
+    }
+    //  axis0=x, 1=y, 2=zת degrees ȣϵ
+    static Transform rotate(int axis, float degrees) {
+        Transform t = identity();
+        float rad = degrees * static_cast<float>(M_PI) / 180.0f;
+        float c = std::cos(rad), sn = std::sin(rad);
+        int a = (axis + 1) % 3, b = (axis + 2) % 3;
+        t.m[a][a] = c; t.m[a][b] = -sn;
+        t.m[b][a] = sn; t.m[b][b] = c;
+        return t;
+    }
+
+    // ϱ任Ӧ o Ӧ *this
+    Transform operator*(const Transform& o) const {
+        Transform t;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                t.m[r][c] = m[r][0] * o.m[0][c] + m[r][1] * o.m[1][c] + m[r][2] * o.m[2][c] + (c == 3 ? m[r][3] : 0.0f);
+            }
+        }
+        return t;
+    }
+
+    Vector3 point(const Vector3& p) const {
+        return Vector3(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+            m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+            m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+    }
+    Vector3 vector(const Vector3& v) const {
+        return Vector3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+            m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+            m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+    }
+    // Բֵת絽任תü嵽תãڱ任
+    Vector3 transposedVector(const Vector3& v) const {
+        return Vector3(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z,
+            m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z,
+            m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z);
+    }
+
+    // 任3x3ðʽƽΪ -R^-1 * tʱfalse
+    bool inverse(Transform& out) const {
+        float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+        if (!(std::abs(det) > 1e-12f)) return false;
+        float inv = 1.0f / det;
+        out.m[0][0] = c00 * inv;
+        out.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+        out.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+        out.m[1][0] = c01 * inv;
+        out.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+        out.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+        out.m[2][0] = c02 * inv;
+        out.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+        out.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+        for (int r = 0; r < 3; ++r) {
+            out.m[r][3] = -(out.m[r][0] * m[0][3] + out.m[r][1] * m[1][3] + out.m[r][2] * m[2][3]);
+        }
         return true;
     }
 };
 
+// MeshTriangleṹ壺 Scene::meshVertices е±꣨12ֽڣظ涥㣩
+struct MeshTriangle {
+    int v[3];
+};
+
+// Meshṹ壺һڹеķΧBVHڵĺ± nodeOffsetҶӵ± triOffset
+// ΰBVHҶ˳С㰴״ʹ˳УһҶʱռĶڴл
+struct Mesh {
+    int nodeOffset, nodeCount;      // Scene::meshNodes еķΧ
+    int triOffset, triCount;        // Scene::meshTriangles еķΧ
+    int vertexOffset, vertexCount;  // Scene::meshVertices еķΧ
+    Vector3 bmin, bmax;             // ռΧ
+};
+
+// MeshInstanceṹ壺һΰڷţֻšʱźͱ任Ԥã
+struct MeshInstance {
+    int mesh;
+    int materialID;
+    Transform objectToWorld, worldToObject;
+};
+
+// ˮܹ-󽻣Woop, Benthin, Wald 2013ÿԤ㣺ֵΪ kz
+// б任ѹ߷Ϊ +z󽻻ΪάߺķŲԡϵĵܻĳһڣ©
+struct WatertightRay {
+    Vector3 origin;
+    int kx, ky, kz;
+    float sx, sy, sz;
+
+    WatertightRay(const Vector3& o, const Vector3& d) : origin(o) {
+        float ax = std::abs(d.x), ay = std::abs(d.y), az = std::abs(d.z);
+        kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+        kx = (kz + 1) % 3;
+        ky = (kx + 1) % 3;
+        float dz = axisComponent(d, kz);
+        if (dz < 0) std::swap(kx, ky);  // εĻƷ
+        sx = axisComponent(d, kx) / dz;
+        sy = axisComponent(d, ky) / dz;
+        sz = 1.0f / dz;
+    }
+
+    // Թ꣬ (kx, ky, kz) ţδУ
+    Vector3 local(const Vector3& p) const {
+        Vector3 r = p - origin;
+        return Vector3(axisComponent(r, kx), axisComponent(r, ky), axisComponent(r, kz));
+    }
+};
+
+// εˮܲԣa/b/c Ϊ WatertightRay::local Ķ㡣 (0.001, tBest) ʱд t 
+// uv Ϊ bc ȨأߺǡΪ0߲߻򶥵㣩ʱdouble㣬֤жһ
+inline bool intersectTriangleWatertight(const WatertightRay& wr, const Vector3& a, const Vector3& b, const Vector3& c,
+    float tBest, float& t, float& u, float& v) {
+    float ax = a.x - wr.sx * a.z, ay = a.y - wr.sy * a.z;
+    float bx = b.x - wr.sx * b.z, by = b.y - wr.sy * b.z;
+    float cx = c.x - wr.sx * c.z, cy = c.y - wr.sy * c.z;
+    float U = cx * by - cy * bx;
+    float V = ax * cy - ay * cx;
+    float W = bx * ay - by * ax;
+    if (U == 0.0f || V == 0.0f || W == 0.0f) {
+        U = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+        V = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+        W = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+    }
+    if ((U < 0 || V < 0 || W < 0) && (U > 0 || V > 0 || W > 0)) return false;  // ߺţ
+    float det = U + V + W;
+    if (det == 0.0f) return false;  // ƽƽУ˻
+    float T = (U * a.z + V * b.z + W * c.z) * wr.sz;
+    float rcp = 1.0f / det;
+    t = T * rcp;
+    if (!(t > 0.001f && t < tBest)) return false;
+    u = V * rcp;
+    v = W * rcp;
+    return true;
+}
+
+// 1 vs  [first, first+count)± trisÿ SIMD_WIDTH ΰͨռͬʱߺ
+// бߺΪ0ͨ棨double㣩ͨ·иʱ tBest/bestTri/bestU/bestV
+// AnyHit ΪtrueʱӰߣҵһ㼴
+template <bool AnyHit = false>
+inline bool intersectTriangles(const MeshTriangle* tris, const Vector3* verts, int first, int count, const WatertightRay& wr,
+    float& tBest, int& bestTri, float& bestU, float& bestV) {
+    bool found = false;
+#if SIMD_WIDTH > 1
+    vfloat sx = vset1(wr.sx), sy = vset1(wr.sy), sz = vset1(wr.sz), zero = vset1(0.0f);
+    for (int i = 0; i < count; i += SIMD_WIDTH) {
+        int n = std::min(SIMD_WIDTH, count - i);
+        float p[9][SIMD_WIDTH];  // ͨľֲ꣺a.xyz, b.xyz, c.xyz
+        for (int l = 0; l < SIMD_WIDTH; ++l) {
+            const MeshTriangle& tri = tris[first + i + std::min(l, n - 1)];  // ĩ鲻ʱظһͨΣ
+            for (int k = 0; k < 3; ++k) {
+                Vector3 q = wr.local(verts[tri.v[k]]);
+                p[k * 3][l] = q.x; p[k * 3 + 1][l] = q.y; p[k * 3 + 2][l] = q.z;
+            }
+        }
+        vfloat az = vload(p[2]), bz = vload(p[5]), cz = vload(p[8]);
+        vfloat ax = vsub(vload(p[0]), vmul(sx, az)), ay = vsub(vload(p[1]), vmul(sy, az));
+        vfloat bx = vsub(vload(p[3]), vmul(sx, bz)), by = vsub(vload(p[4]), vmul(sy, bz));
+        vfloat cx = vsub(vload(p[6]), vmul(sx, cz)), cy = vsub(vload(p[7]), vmul(sy, cz));
+        vfloat U = vsub(vmul(cx, by), vmul(cy, bx));
+        vfloat V = vsub(vmul(ax, cy), vmul(ay, cx));
+        vfloat W = vsub(vmul(bx, ay), vmul(by, ax));
+        int laneMask = (1 << n) - 1;
+        int edgeZero = vmovemask(vor(vor(vcmpeq(U, zero), vcmpeq(V, zero)), vcmpeq(W, zero))) & laneMask;
+        int anyNeg = vmovemask(vor(vor(vcmplt(U, zero), vcmplt(V, zero)), vcmplt(W, zero)));
+        int anyPos = vmovemask(vor(vor(vcmpgt(U, zero), vcmpgt(V, zero)), vcmpgt(W, zero)));
+        vfloat rcp = vdiv(vset1(1.0f), vadd(vadd(U, V), W));  // detΪ0ʱ t ΪNaNıȽȻ޳
+        vfloat t = vmul(vmul(vadd(vadd(vmul(U, az), vmul(V, bz)), vmul(W, cz)), sz), rcp);
+        int hitMask = vmovemask(vand(vcmpgt(t, vset1(0.001f)), vcmplt(t, vset1(tBest)))) & laneMask & ~(anyNeg & anyPos) & ~edgeZero;
+        for (int l = 0; l < SIMD_WIDTH; ++l) {
+            if (!(edgeZero & (1 << l))) continue;
+            float tl, ul, vl;
+            if (intersectTriangleWatertight(wr, Vector3(p[0][l], p[1][l], p[2][l]), Vector3(p[3][l], p[4][l], p[5][l]),
+                Vector3(p[6][l], p[7][l], p[8][l]), tBest, tl, ul, vl)) {
+                if (AnyHit) return true;
+                tBest = tl; bestTri = first + i + l; bestU = ul; bestV = vl; found = true;
+            }
+        }
+        if (hitMask == 0) continue;
+        if (AnyHit) return true;
+        float ts[SIMD_WIDTH], us[SIMD_WIDTH], vs[SIMD_WIDTH];
+        vstore(ts, t);
+        vstore(us, vmul(V, rcp));
+        vstore(vs, vmul(W, rcp));
+        for (int l = 0; l < SIMD_WIDTH; ++l) {
+            if ((hitMask & (1 << l)) && ts[l] < tBest) { tBest = ts[l]; bestTri = first + i + l; bestU = us[l]; bestV = vs[l]; found = true; }
+        }
+    }
+#else
+    for (int k = first; k < first + count; ++k) {
+        const MeshTriangle& tri = tris[k];
+        float t, u, v;
+        if (intersectTriangleWatertight(wr, wr.local(verts[tri.v[0]]), wr.local(verts[tri.v[1]]), wr.local(verts[tri.v[2]]), tBest, t, u, v)) {
+            if (AnyHit) return true;
+            tBest = t; bestTri = k; bestU = u; bestV = v; found = true;
+        }
+    }
+#endif
+    return found;
+}
+
 // ----------------------------------------------------
 // ظ
 // һ򻯵1D2D Perlin-like noiseľŶ
@@ -235,56 +1320,1044 @@ float perlinNoise(float x, float y) {
     );
 }
 
-// ----------------------------------------------------
-
-// Sceneṹ壺塢Դ׷ٺ
-struct Scene {
-    std::vector<Sphere*> spheres;  // б
-    std::vector<Box*> boxes;       // б
-    Vector3 lightPos = Vector3(0, 2.9f, 0);     // Դλãģ
-    Vector3 lightColor = Vector3(1.5f, 1.5f, 1.5f);  // Դɫɫǿ1.5
-    Vector3 bgColor = Vector3(0.85f, 0.85f, 0.85f);  // ɫǳң
-    Vector3 cameraPos = Vector3(0, 1.5f, 2.5f);  // λãǰ
-    Vector3 lookAt = Vector3(0, 1.5f, 0.0f);     // עӵ㣨ģ
-    float fov = 90.0f * M_PI / 180.0f;           // ҰǶȣȣ90ڣ
+#if SIMD_WIDTH > 1
+// grad() ϵgrad(hash, x, y) == gradX[hash & 0xF] * x + gradY[hash & 0xF] * y
+const float gradX[16] = { 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+const float gradY[16] = { 1, 1, -1, -1, 0, 0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
 
-    // ̬ļ
-    ~Scene() {
-        for (auto s : spheres) delete s;
-        for (auto b : boxes) delete b;
+// ͬʱ SIMD_WIDTH  perlinNoiseûͨУSSEûgather
+// ݶȺͲֵ㣬˳ͬλһ
+inline vfloat perlinNoiseSIMD(vfloat x, vfloat y) {
+    vfloat fx = vfloor(x), fy = vfloor(y);
+    float cellX[SIMD_WIDTH], cellY[SIMD_WIDTH];
+    vstore(cellX, fx);
+    vstore(cellY, fy);
+    float g[8][SIMD_WIDTH];  // ĸǵݶϵ (x, y)
+    for (int l = 0; l < SIMD_WIDTH; ++l) {
+        int X = static_cast<int>(cellX[l]) & 255;
+        int Y = static_cast<int>(cellY[l]) & 255;
+        int A = p[X] + Y, B = p[X + 1] + Y;
+        int h[4] = { p[A] & 0xF, p[B] & 0xF, p[A + 1] & 0xF, p[B + 1] & 0xF };
+        for (int c = 0; c < 4; ++c) {
+            g[c * 2][l] = gradX[h[c]];
+            g[c * 2 + 1][l] = gradY[h[c]];
+        }
     }
+    x = vsub(x, fx);  // С
+    y = vsub(y, fy);
+    vfloat one = vset1(1.0f), x1 = vsub(x, one), y1 = vsub(y, one);
+    // fade(t) = t^3 * (t * (t * 6 - 15) + 10)
+    vfloat u = vmul(vmul(vmul(x, x), x), vadd(vmul(x, vsub(vmul(x, vset1(6.0f)), vset1(15.0f))), vset1(10.0f)));
+    vfloat v = vmul(vmul(vmul(y, y), y), vadd(vmul(y, vsub(vmul(y, vset1(6.0f)), vset1(15.0f))), vset1(10.0f)));
+    vfloat g00 = vadd(vmul(vload(g[0]), x), vmul(vload(g[1]), y));
+    vfloat g10 = vadd(vmul(vload(g[2]), x1), vmul(vload(g[3]), y));
+    vfloat g01 = vadd(vmul(vload(g[4]), x), vmul(vload(g[5]), y1));
+    vfloat g11 = vadd(vmul(vload(g[6]), x1), vmul(vload(g[7]), y1));
+    vfloat iu = vsub(one, u), iv = vsub(one, v);
+    vfloat lower = vadd(vmul(iu, g00), vmul(u, g10));
+    vfloat upper = vadd(vmul(iu, g01), vmul(u, g11));
+    return vadd(vmul(iv, lower), vmul(v, upper));
+}
 
-    // ƽཻԣƽ
-    bool planeIntersect(const Ray& ray, float& t, const Vector3& point, const Vector3& normal) {
-        float denom = normal.dot(ray.direction);  // ߡ
-        if (std::abs(denom) > 0.001f) {  // ƽ
-            t = (point - ray.origin).dot(normal) / denom;  // t = ( - ԭ)   / denom
-            return t > 0.001f;  // 򽻵
+//  sinCephes sinf İ˷Լ + ʽ|x| < 8192 ʱԼ1e-7
+inline vfloat sinSIMD(vfloat x) {
+    vfloat zero = vset1(0.0f), one = vset1(1.0f);
+    vfloat sign = vselect(vcmplt(x, zero), vset1(-1.0f), one);
+    x = vmaxf(x, vsub(zero, x));  // |x|
+    vfloat j = vfloor(vmul(x, vset1(1.27323954473516f)));  // x / (pi/4)
+    j = vadd(j, vsub(j, vmul(vset1(2.0f), vfloor(vmul(j, vset1(0.5f))))));  // һż
+    vfloat octant = vsub(j, vmul(vset1(8.0f), vfloor(vmul(j, vset1(0.125f)))));  // j mod 8
+    vfloat upperHalf = vcmpgt(octant, vset1(3.0f));
+    sign = vselect(upperHalf, vsub(zero, sign), sign);
+    octant = vselect(upperHalf, vsub(octant, vset1(4.0f)), octant);
+    // չԼx - j * pi/4
+    x = vsub(vsub(vsub(x, vmul(j, vset1(0.78515625f))), vmul(j, vset1(2.4187564849853515625e-4f))), vmul(j, vset1(3.77489497744594108e-8f)));
+    vfloat z = vmul(x, x);
+    vfloat sinPoly = vadd(vmul(vmul(vsub(vmul(vadd(vmul(vset1(-1.9515295891e-4f), z), vset1(8.3321608736e-3f)), z), vset1(1.6666654611e-1f)), z), x), x);
+    vfloat cosPoly = vadd(vsub(vmul(vmul(vadd(vmul(vsub(vmul(vset1(2.443315711809948e-5f), z), vset1(1.388731625493765e-3f)), z), vset1(4.166664568298827e-2f)), z), z),
+        vmul(vset1(0.5f), z)), one);
+    return vmul(sign, vselect(vcmpeq(octant, vset1(2.0f)), cosPoly, sinPoly));
+}
+#endif
+
+// MipTextureṹ壺決RGBmipmap0Ϊԭʼֱʣÿ㳤룩бѰַ
+struct MipTexture {
+    std::vector<std::vector<Vector3>> levels;
+    std::vector<int> widths, heights;
+
+    // ɵ0mipmap2x2ʽ˲
+    void build(int w, int h, std::vector<Vector3>&& base) {
+        levels.clear(); widths.clear(); heights.clear();
+        levels.push_back(std::move(base)); widths.push_back(w); heights.push_back(h);
+        while (w > 1 || h > 1) {
+            int nw = std::max(1, (w + 1) / 2), nh = std::max(1, (h + 1) / 2);
+            const std::vector<Vector3>& src = levels.back();
+            std::vector<Vector3> dst(nw * nh);
+            for (int y = 0; y < nh; ++y) {
+                for (int x = 0; x < nw; ++x) {
+                    int sx0 = std::min(2 * x, w - 1), sx1 = std::min(2 * x + 1, w - 1);
+                    int sy0 = std::min(2 * y, h - 1), sy1 = std::min(2 * y + 1, h - 1);
+                    dst[y * nw + x] = (src[sy0 * w + sx0] + src[sy0 * w + sx1] + src[sy1 * w + sx0] + src[sy1 * w + sx1]) * 0.25f;
+                }
+            }
+            levels.push_back(std::move(dst)); widths.push_back(nw); heights.push_back(nh);
+            w = nw; h = nh;
         }
-        return false;
     }
 
-    // ޸ģɳľƵĺ
-    Vector3 getWoodTextureColor(const Vector3& hitPoint, const Vector3& normal) {
-        // ľɫǳľľ
-        Vector3 lightWood = Vector3(0.65f, 0.45f, 0.25f);
-        Vector3 darkWood = Vector3(0.45f, 0.25f, 0.1f);
+    bool empty() const { return levels.empty(); }
 
-        // ƵʺŶǿ
-        float scale = 10.0f;             // 
-        float stripeDensity = 0.3f;      // ܶȣСֵ
-        float noiseStrength = 0.3f;      // Ŷǿ
+    // ˫Բuv  [0, 1]
+    Vector3 bilinear(int level, float u, float v) const {
+        int w = widths[level], h = heights[level];
+        const std::vector<Vector3>& tex = levels[level];
+        float fx = u * w - 0.5f, fy = v * h - 0.5f;
+        float flx = std::floor(fx), fly = std::floor(fy);
+        float tx = fx - flx, ty = fy - fly;
+        int x0 = std::max(0, std::min(static_cast<int>(flx), w - 1)), x1 = std::max(0, std::min(static_cast<int>(flx) + 1, w - 1));
+        int y0 = std::max(0, std::min(static_cast<int>(fly), h - 1)), y1 = std::max(0, std::min(static_cast<int>(fly) + 1, h - 1));
+        return interpolate(interpolate(tex[y0 * w + x0], tex[y0 * w + x1], tx), interpolate(tex[y1 * w + x0], tex[y1 * w + x1], tx), ty);
+    }
 
-        float noiseVal;                  // Perlinֵ
-        float stripeCoord;               // 
+    // Բlod Ϊ log2(ÿظǵĵ0)
+    Vector3 sample(float u, float v, float lod) const {
+        int maxLevel = static_cast<int>(levels.size()) - 1;
+        lod = std::max(0.0f, std::min(lod, static_cast<float>(maxLevel)));
+        int l0 = static_cast<int>(lod);
+        int l1 = std::min(l0 + 1, maxLevel);
+        float t = lod - l0;
+        Vector3 c0 = bilinear(l0, u, v);
+        return t > 0.0f ? interpolate(c0, bilinear(l1, u, v), t) : c0;
+    }
+};
 
-        // ݷ߷ѡͶӰƽͷUVӳ䣩
-        if (std::abs(normal.y) > 0.9f) { // /ײ (XZƽͶӰZ)
-            stripeCoord = hitPoint.z * scale; // Z
-            noiseVal = perlinNoise(hitPoint.x * scale * 0.5f, hitPoint.z * scale * 0.5f); // ŶX
+// ----------------------------------------------------
+// ߳Ⱦӹϣ빤ȡ̳߳
+
+// ӣȫӺΪһ32λӣMurmurHash3 finalizer
+unsigned int hashPixelSeed(unsigned int seed, int x, int y) {
+    unsigned int h = seed ^ (static_cast<unsigned int>(x) * 0x9E3779B1u) ^ (static_cast<unsigned int>(y) * 0x85EBCA77u);
+    h ^= h >> 16; h *= 0x85EBCA6Bu;
+    h ^= h >> 13; h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Tileṹ壺֡еһηֿ [x0, x1) x [y0, y1)
+struct Tile {
+    int x0, y0, x1, y1;
+};
+
+//  width x height ĻзΪ TILE_SIZE Сķֿ飨ȣ
+std::vector<Tile> makeTiles(int width, int height, int tileSize) {
+    std::vector<Tile> tiles;
+    for (int y = 0; y < height; y += tileSize) {
+        for (int x = 0; x < width; x += tileSize) {
+            tiles.push_back({ x, y, std::min(x + tileSize, width), std::min(y + tileSize, height) });
         }
-        else if (std::abs(normal.x) > 0.9f) { // X (YZƽͶӰY)
-            stripeCoord = hitPoint.y * scale; // Yƣֱ
+    }
+    return tiles;
+}
+
+// WorkStealingPoolȡ̳߳
+// ÿ߳ӵԼķֿУͷȡԼĶп˾ʹ̶߳еβȡ
+// 򡢻ƽȰֿ鼯е̲߳֡ run() ߳ҲΪ 0 Ź̲߳롣
+class WorkStealingPool {
+public:
+    typedef std::function<void(const Tile&, int)> TileFunc;  // ֿ(ֿ, ̱߳)
+
+    explicit WorkStealingPool(int numWorkers) : numWorkers(std::max(1, numWorkers)) {
+        for (int i = 0; i < this->numWorkers; ++i) queues.emplace_back(new WorkerQueue());
+        for (int i = 1; i < this->numWorkers; ++i) threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            stopping = true;
+        }
+        wakeCv.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    int size() const { return numWorkers; }
+
+    // ִһֿ飬ֱȫ
+    void run(const std::vector<Tile>& tiles, const TileFunc& fn) {
+        // ΰѷָֿ̣߳ڷֿͬһ̣߳ڻ棩ʱٻȡ
+        for (int w = 0; w < numWorkers; ++w) {
+            size_t begin = tiles.size() * w / numWorkers;
+            size_t end = tiles.size() * (w + 1) / numWorkers;
+            std::lock_guard<std::mutex> lock(queues[w]->m);
+            for (size_t i = begin; i < end; ++i) queues[w]->q.push_back(static_cast<int>(i));
+        }
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            curTiles = &tiles;
+            curFn = &fn;
+            remaining = static_cast<int>(tiles.size());
+            busyWorkers = numWorkers - 1;
+            ++generation;
+        }
+        wakeCv.notify_all();
+
+        drain(0);  // ߳Ϊ0Ź߳
+
+        std::unique_lock<std::mutex> lock(poolMutex);
+        doneCv.wait(lock, [this] { return busyWorkers == 0; });
+        curTiles = nullptr;
+        curFn = nullptr;
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex m;
+        std::deque<int> q;  // ֿ
+    };
+
+    // ԼĶͷȡ
+    bool popLocal(int w, int& tile) {
+        std::lock_guard<std::mutex> lock(queues[w]->m);
+        if (queues[w]->q.empty()) return false;
+        tile = queues[w]->q.front();
+        queues[w]->q.pop_front();
+        return true;
+    }
+
+    // ̶߳βȡ
+    bool steal(int w, int& tile) {
+        for (int i = 1; i < numWorkers; ++i) {
+            int victim = (w + i) % numWorkers;
+            std::lock_guard<std::mutex> lock(queues[victim]->m);
+            if (!queues[victim]->q.empty()) {
+                tile = queues[victim]->q.back();
+                queues[victim]->q.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // ȡ/ȡֱзֿ鶼
+    void drain(int w) {
+        int tile;
+        while (remaining.load() > 0 && (popLocal(w, tile) || steal(w, tile))) {
+            (*curFn)((*curTiles)[tile], w);
+            --remaining;
+        }
+    }
+
+    void workerLoop(int w) {
+        int seenGeneration = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(poolMutex);
+                wakeCv.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+            }
+            drain(w);
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                --busyWorkers;
+            }
+            doneCv.notify_all();
+        }
+    }
+
+    int numWorkers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex poolMutex;               // ĵ״̬
+    std::condition_variable wakeCv;     // ѹ߳̿ʼһ
+    std::condition_variable doneCv;     // ֪ͨ߳ȫ
+    const std::vector<Tile>* curTiles = nullptr;
+    const TileFunc* curFn = nullptr;
+    std::atomic<int> remaining{ 0 };    // δɵķֿ
+    int busyWorkers = 0;                // ڴĺ̨߳
+    int generation = 0;                 // α
+    bool stopping = false;
+};
+
+// ----------------------------------------------------
+// ׷ٽ׶ֻԷд hdrBufferȾ򽥽ʽȾÿֿ飩ͳһתΪ8λʾֵд framebuffer
+// عɫӳ䰴 SIMD_WIDTH ·ͨ㣬٤ص std::powѡÿض
+// ıعɫӳֻһ׶Σ׷٣ +/- ع⣬T лɫӳ䣬D л
+
+enum ToneMapOperator {
+    TONEMAP_NONE = 0,  // ֱӽضϵ [0, 1]Ĭϣԭдʱıֽһ£
+    TONEMAP_REINHARD,  // x / (1 + x)
+    TONEMAP_ACES       // ACES ӰߵϣNarkowicz
+};
+int toneMapOperator = TONEMAP_NONE;  // ͨ --tonemap none|reinhard|aces ѡ
+float exposureEV = 0.0f;             // --exposure EVɫӳǰɫ 2^EV
+bool ditherOutput = false;           // --ditherʱÿƽɫ
+
+const float DISPLAY_GAMMA = 0.454f;   // ʾ٤1/2.2  0.454
+const int DITHER_CURVE_SIZE = 1024;   // ·٤߱С
+const unsigned int DITHER_SEED = 0x6D2B79F5u;  // Ĺ̶ӣ --seed ޹أɫӳʱͼ
+
+// ԭص٤루[0, 1] ضϣNaN Ϊ0ֻɲұͻ׼ԶԱ
+inline unsigned char encodeDisplayReference(float c) {
+    c = std::pow(std::max(0.0f, std::min(c, 1.0f)), DISPLAY_GAMMA);
+    return static_cast<unsigned char>(std::min(255.0f, c * 255));
+}
+
+// ٤ұthresholds[k] ΪС k Сֵɲοֵõοֽһ¡
+// ָβ7λͰÿͰڱ1ȡͰı룬һֵȽ
+struct DisplayEncoder {
+    static const uint32_t LOW_BITS = 109u << 23;  // 2^-18СֵΪ0
+    static const int BUCKETS = static_cast<int>(((0x3F800000u - LOW_BITS) >> 16) + 1);  // 1.0Ϊֹ
+    float thresholds[257];        // thresholds[256] Ϊ󣬱֤Ƚ255ֹͣ
+    unsigned char bucketCode[BUCKETS];
+    float curve[DITHER_CURVE_SIZE + 1];  // · sqrt(c) ȡ٤ߣsqrt ƽԲֵԶС1
+
+    DisplayEncoder() {
+        thresholds[0] = 0.0f;
+        for (int k = 1; k < 256; ++k) {
+            uint32_t lo = 0, hi = 0x3F800000u;  // ο渡λģʽ1.0 Ϊ255
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (encodeDisplayReference(bitsToFloat(mid)) >= k) hi = mid;
+                else lo = mid + 1;
+            }
+            thresholds[k] = bitsToFloat(lo);
+        }
+        thresholds[256] = std::numeric_limits<float>::infinity();
+        for (int i = 0; i < BUCKETS; ++i) bucketCode[i] = encodeDisplayReference(bitsToFloat(LOW_BITS + (static_cast<uint32_t>(i) << 16)));
+        for (int i = 0; i <= DITHER_CURVE_SIZE; ++i) {
+            float s = static_cast<float>(i) / DITHER_CURVE_SIZE;
+            curve[i] = std::pow(s * s, DISPLAY_GAMMA);
+        }
+    }
+
+    static float bitsToFloat(uint32_t bits) {
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    // c ѽضϵ [0, 1]
+    unsigned char encode(float c) const {
+        uint32_t bits;
+        std::memcpy(&bits, &c, sizeof(bits));
+        int code = bits < LOW_BITS ? 0 : bucketCode[(bits - LOW_BITS) >> 16];
+        while (c >= thresholds[code + 1]) ++code;
+        return static_cast<unsigned char>(code);
+    }
+
+    // 룺u Ϊ [0, 1) floor(ʾֵ * 255 + u) ʾֵ
+    unsigned char encodeDithered(float c, float u) const {
+        float s = std::sqrt(c) * DITHER_CURVE_SIZE;
+        int i = std::min(static_cast<int>(s), DITHER_CURVE_SIZE - 1);
+        float v = curve[i] + (curve[i + 1] - curve[i]) * (s - i);
+        return static_cast<unsigned char>(std::min(255.0f, v * 255 + u));
+    }
+};
+
+const DisplayEncoder displayEncoder;
+
+// ͨɫӳ䣨SIMD βʹã˳ SIMD ·ͬλһ£ [0, 1]NaN Ϊ0+inf Ϊ1
+inline float toneMapValue(float x) {
+    x = std::max(0.0f, x);
+    if (toneMapOperator == TONEMAP_REINHARD) x = x / (1.0f + x);
+    else if (toneMapOperator == TONEMAP_ACES) x = (x * (x * 2.51f + 0.03f)) / (x * (x * 2.43f + 0.59f) + 0.14f);
+    return std::min(1.0f, x);
+}
+
+//  n ֵͨعɫӳ䣬д out
+void toneMapSpan(const float* in, float* out, int n, float scale) {
+    int i = 0;
+#if SIMD_WIDTH > 1
+    vfloat vscale = vset1(scale), zero = vset1(0.0f), one = vset1(1.0f);
+    for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+        vfloat x = vmaxf(vmul(vload(in + i), vscale), zero);  // һΪNaNʱ max صڶNaN -> 0
+        if (toneMapOperator == TONEMAP_REINHARD) {
+            x = vdiv(x, vadd(one, x));
+        }
+        else if (toneMapOperator == TONEMAP_ACES) {
+            vfloat num = vmul(x, vadd(vmul(x, vset1(2.51f)), vset1(0.03f)));
+            vfloat den = vadd(vmul(x, vadd(vmul(x, vset1(2.43f)), vset1(0.59f))), vset1(0.14f));
+            x = vdiv(num, den);
+        }
+        vstore(out + i, vminf(x, one));  // inf/inf õNaN -> 1
+    }
+#endif
+    for (; i < n; ++i) out[i] = toneMapValue(in[i] * scale);
+}
+
+//  hdrBuffer ľ [x0, x1) x [y0, y1) תΪ framebuffer 8λʾֵͬɶ߳ͬʱ
+void postProcessRegion(int x0, int y0, int x1, int y1) {
+    float scale = std::exp2(exposureEV);
+    int n = (x1 - x0) * 3;
+    std::vector<float> row(n);
+    for (int y = y0; y < y1; ++y) {
+        size_t offset = (static_cast<size_t>(y) * imageWidth + x0) * 3;
+        toneMapSpan(hdrBuffer + offset, row.data(), n, scale);
+        unsigned char* dst = framebuffer + offset;
+        if (!ditherOutput) {
+            for (int i = 0; i < n; ++i) dst[i] = displayEncoder.encode(row[i]);
+            continue;
+        }
+        for (int x = x0; x < x1; ++x) {
+            unsigned int h = hashPixelSeed(DITHER_SEED, x, y);  // ÿͨȡ10λ
+            for (int c = 0; c < 3; ++c) {
+                int i = (x - x0) * 3 + c;
+                dst[i] = displayEncoder.encodeDithered(row[i], ((h >> (c * 10)) & 1023u) * (1.0f / 1024.0f));
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------
+// 루--denoiseԵ֪ -trous С˲Dammertz  2010 SVGF ķʽ÷յ hdrBuffer С
+// ɫȳԷʵõ""Թ DENOISE_LEVELS  5x5 B3 1, 2, 4ÿĿ׶𼶼ӱ
+// ھӰ߼нǡȲʲȨأԵĨƽȲԸı׼Ϊ߶ȣ
+// ģƽû򼸺䡣ɫǷ񺬲ȷģ׷ûȡ
+// ֱӹա䣩Ϊ0صķΧͬصȹƣ֮˲𼶴ݡ
+// ˲ٳ˻طʣľƵϸڱ壨ʡߡȣ Scene::renderAux ɣ
+// ͲֱһǾ棬СԵͬΪ˲߽硣
+
+// ÿظ hdrBuffer ͬдţ
+struct AuxBuffers {
+    std::vector<float> albedo;  // RGBһǾ/ɫ;ɫ
+    std::vector<float> normal;  // XYZñķߣΪ0
+    std::vector<float> depth;   // ߵñ·ȣΪ -1
+    std::vector<unsigned char> stochastic;  // 1׷ٸʱȡģ䡢˹̶ģɫ
+};
+
+bool denoiseOutput = false;  // --denoise/ʽ/ֲʽȾ֡
+const int DENOISE_LEVELS = 3;             // ˲ǰ뾶 2*(1+2+4) = 14 أ༶淴ƫ棩
+const int DENOISE_VARIANCE_RADIUS = 3;    // ʼĹƴڣ7x7
+const float DENOISE_LUMINANCE_PHI = 4.0f; // Ȳ 4 ׼˥SVGF ȡֵ
+const float DENOISE_ALBEDO_PHI = 0.1f;    // ʲĳ߶
+const float DENOISE_DEPTH_PHI = 0.02f;    // Ȳĳ߶ȣȣſбصԱ仯
+const float DENOISE_MIN_ALBEDO = 0.01f;   // ʱСʣԽӽ0ͨŴ
+
+inline float luminance(const float* c) {
+    return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+}
+
+//  pq ֮ɫ޹صıԵȨأ߼нǡȲʲq Ϊ򱳶ʱΪ0
+inline float denoiseEdgeWeight(const AuxBuffers& aux, size_t p, size_t q, float invDepth) {
+    float dq = aux.depth[q];
+    if (dq < 0) return 0.0f;  // ǰصƽ
+    const float* np = &aux.normal[p * 3];
+    const float* nq = &aux.normal[q * 3];
+    float cosN = np[0] * nq[0] + np[1] * nq[1] + np[2] * nq[2];
+    if (cosN <= 0) return 0.0f;
+    float wn = cosN * cosN; wn *= wn; wn *= wn; wn *= wn; wn *= wn; wn *= wn; wn *= wn;  // cos^128߼нǳԼ8ʱȨصһ루ϵķ淨߱仯ܿ죩
+    const float* ap = &aux.albedo[p * 3];
+    const float* aq = &aux.albedo[q * 3];
+    float da = (aq[0] - ap[0]) * (aq[0] - ap[0]) + (aq[1] - ap[1]) * (aq[1] - ap[1]) + (aq[2] - ap[2]) * (aq[2] - ap[2]);
+    return wn * std::exp(-(da * (1.0f / (DENOISE_ALBEDO_PHI * DENOISE_ALBEDO_PHI)) + std::abs(dq - aux.depth[p]) * invDepth));
+}
+
+// ʼ[x0, x1) x [y0, y1) ÿΧ 7x7 ͬһ桢ͬھӵȷ
+void denoiseVarianceRegion(const float* color, float* variance, const AuxBuffers& aux, int w, int h, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            size_t p = static_cast<size_t>(y) * w + x;
+            variance[p] = 0.0f;
+            if (aux.depth[p] < 0 || !aux.stochastic[p]) continue;
+            float invDepth = 1.0f / (DENOISE_DEPTH_PHI * aux.depth[p] + 1e-4f);
+            float sum = 0, sum2 = 0, weightSum = 0;
+            for (int qy = std::max(0, y - DENOISE_VARIANCE_RADIUS); qy <= std::min(h - 1, y + DENOISE_VARIANCE_RADIUS); ++qy) {
+                for (int qx = std::max(0, x - DENOISE_VARIANCE_RADIUS); qx <= std::min(w - 1, x + DENOISE_VARIANCE_RADIUS); ++qx) {
+                    size_t q = static_cast<size_t>(qy) * w + qx;
+                    if (!aux.stochastic[q]) continue;
+                    float weight = denoiseEdgeWeight(aux, p, q, invDepth);
+                    float l = luminance(color + q * 3);
+                    sum += l * weight; sum2 += l * l * weight; weightSum += weight;
+                }
+            }
+            float mean = sum / weightSum;  // ȨΪ1
+            variance[p] = std::max(0.0f, sum2 / weightSum - mean * mean);
+        }
+    }
+}
+
+// һ -trous ˲ [x0, x1) x [y0, y1) ذ step ȡ 5x5 ھӼȨƽ
+// ɫ뷽 src/srcVariance д dst/dstVarianceȨƽݣͬɲУ
+void atrousRegion(const float* src, const float* srcVariance, float* dst, float* dstVariance, const AuxBuffers& aux,
+    int w, int h, int step, int x0, int y0, int x1, int y1) {
+    static const float kernel[5] = { 1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16 };  // B3
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            size_t p = static_cast<size_t>(y) * w + x;
+            const float* cp = src + p * 3;
+            if (aux.depth[p] < 0) {  // ˲
+                dst[p * 3] = cp[0]; dst[p * 3 + 1] = cp[1]; dst[p * 3 + 2] = cp[2];
+                dstVariance[p] = srcVariance[p];
+                continue;
+            }
+            // ķȡ3x3˹ƽصķƲȶ
+            float variance = 0, varianceWeight = 0;
+            for (int j = -1; j <= 1; ++j) {
+                for (int i = -1; i <= 1; ++i) {
+                    int qx = x + i, qy = y + j;
+                    if (qx < 0 || qx >= w || qy < 0 || qy >= h) continue;
+                    float k = (i == 0 ? 0.5f : 0.25f) * (j == 0 ? 0.5f : 0.25f);
+                    variance += srcVariance[static_cast<size_t>(qy) * w + qx] * k;
+                    varianceWeight += k;
+                }
+            }
+            float invLuminance = 1.0f / (DENOISE_LUMINANCE_PHI * std::sqrt(variance / varianceWeight) + 1e-4f);
+            float invDepth = 1.0f / (DENOISE_DEPTH_PHI * step * aux.depth[p] + 1e-4f);
+            float lp = luminance(cp);
+            float sum[3] = { 0, 0, 0 }, sumVariance = 0, weightSum = 0;
+            for (int j = -2; j <= 2; ++j) {
+                int qy = y + j * step;
+                if (qy < 0 || qy >= h) continue;
+                for (int i = -2; i <= 2; ++i) {
+                    int qx = x + i * step;
+                    if (qx < 0 || qx >= w) continue;
+                    size_t q = static_cast<size_t>(qy) * w + qx;
+                    float edge = denoiseEdgeWeight(aux, p, q, invDepth);
+                    if (edge == 0.0f) continue;
+                    const float* cq = src + q * 3;
+                    float weight = kernel[i + 2] * kernel[j + 2] * edge * std::exp(-std::abs(luminance(cq) - lp) * invLuminance);
+                    sum[0] += cq[0] * weight; sum[1] += cq[1] * weight; sum[2] += cq[2] * weight;
+                    sumVariance += srcVariance[q] * weight * weight;
+                    weightSum += weight;
+                }
+            }
+            float inv = 1.0f / weightSum;  // ȨغΪ
+            dst[p * 3] = sum[0] * inv; dst[p * 3 + 1] = sum[1] * inv; dst[p * 3 + 2] = sum[2] * inv;
+            dstVariance[p] = sumVariance * inv * inv;
+        }
+    }
+}
+
+// ----------------------------------------------------
+// ͼOpenGLֱӴ֡дļ8λ PPM/PNG PFM/EXR
+
+// Сд
+template <class T>
+void writeLE(std::ostream& out, T value) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::reverse(bytes, bytes + sizeof(T));
+#endif
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(T));
+}
+
+// д32λPNG鳤CRC
+void writeBE32(std::ostream& out, uint32_t v) {
+    unsigned char b[4] = { (unsigned char)(v >> 24), (unsigned char)(v >> 16), (unsigned char)(v >> 8), (unsigned char)v };
+    out.write(reinterpret_cast<const char*>(b), 4);
+}
+
+// PPM (P6)8λRGB϶
+bool writePPM(const std::string& path, int w, int h, const unsigned char* rgb) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out << "P6\n" << w << " " << h << "\n255\n";
+    out.write(reinterpret_cast<const char*>(rgb), static_cast<std::streamsize>(w) * h * 3);
+    return static_cast<bool>(out);
+}
+
+// PNG CRC32ֽڲ
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t len) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    for (size_t i = 0; i < len; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+// дһPNG飺 +  +  + CRC(+)
+void writePngChunk(std::ostream& out, const char* type, const std::vector<unsigned char>& data) {
+    writeBE32(out, static_cast<uint32_t>(data.size()));
+    out.write(type, 4);
+    if (!data.empty()) out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    uint32_t crc = crc32Update(0xFFFFFFFFu, reinterpret_cast<const unsigned char*>(type), 4);
+    if (!data.empty()) crc = crc32Update(crc, data.data(), data.size());
+    writeBE32(out, crc ^ 0xFFFFFFFFu);
+}
+
+// PNG8λRGBΪzlibIDATʹòѹdeflate洢飨ļԼΪԭʼС
+bool writePNG(const std::string& path, int w, int h, const unsigned char* rgb) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    out.write(reinterpret_cast<const char*>(signature), 8);
+
+    std::vector<unsigned char> ihdr(13);
+    for (int i = 0; i < 4; ++i) { ihdr[i] = (unsigned char)(w >> (24 - 8 * i)); ihdr[4 + i] = (unsigned char)(h >> (24 - 8 * i)); }
+    ihdr[8] = 8;   // λ
+    ihdr[9] = 2;   // ɫͣRGB
+    ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;  // ѹ˲
+    writePngChunk(out, "IHDR", ihdr);
+
+    // ԭʼɨߣÿǰ˲0
+    size_t rowBytes = static_cast<size_t>(w) * 3;
+    std::vector<unsigned char> raw;
+    raw.reserve((rowBytes + 1) * h);
+    for (int y = 0; y < h; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb + y * rowBytes, rgb + (y + 1) * rowBytes);
+    }
+
+    // zlibͷ + 洢飨ÿ65535ֽڣ+ Adler-32
+    std::vector<unsigned char> z;
+    z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    z.push_back(0x78); z.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t len = std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + len == raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back((unsigned char)(len & 0xFF)); z.push_back((unsigned char)(len >> 8));
+        z.push_back((unsigned char)(~len & 0xFF)); z.push_back((unsigned char)((~len >> 8) & 0xFF));
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw) { a = (a + c) % 65521; b = (b + a) % 65521; }
+    uint32_t adler = (b << 16) | a;
+    for (int i = 0; i < 4; ++i) z.push_back((unsigned char)(adler >> (24 - 8 * i)));
+    writePngChunk(out, "IDAT", z);
+    writePngChunk(out, "IEND", std::vector<unsigned char>());
+    return static_cast<bool>(out);
+}
+
+// PFMԸRGBΪʾСɨ¶
+bool writePFM(const std::string& path, int w, int h, const float* rgb) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out << "PF\n" << w << " " << h << "\n-1.0\n";
+    for (int y = h - 1; y >= 0; --y)
+        for (int i = 0; i < w * 3; ++i) writeLE(out, rgb[static_cast<size_t>(y) * w * 3 + i]);
+    return static_cast<bool>(out);
+}
+
+// OpenEXRɨͼѹB/G/R32λͨͨĸ洢
+bool writeEXR(const std::string& path, int w, int h, const float* rgb) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    writeLE<uint32_t>(out, 20000630u);  // ħ
+    writeLE<uint32_t>(out, 2u);         // 汾2ɨ
+
+    auto attr = [&](const char* name, const char* type, uint32_t size) {
+        out.write(name, std::strlen(name) + 1);
+        out.write(type, std::strlen(type) + 1);
+        writeLE<uint32_t>(out, size);
+    };
+    const char* channels[3] = { "B", "G", "R" };
+    attr("channels", "chlist", 3 * (2 + 16) + 1);
+    for (const char* c : channels) {
+        out.write(c, 2);                 //  + '\0'
+        writeLE<int32_t>(out, 2);        // ͣFLOAT
+        writeLE<uint32_t>(out, 0);       // pLinear + 
+        writeLE<int32_t>(out, 1);        // xSampling
+        writeLE<int32_t>(out, 1);        // ySampling
+    }
+    out.put(0);
+    attr("compression", "compression", 1); out.put(0);  // NO_COMPRESSION
+    attr("dataWindow", "box2i", 16);
+    writeLE<int32_t>(out, 0); writeLE<int32_t>(out, 0); writeLE<int32_t>(out, w - 1); writeLE<int32_t>(out, h - 1);
+    attr("displayWindow", "box2i", 16);
+    writeLE<int32_t>(out, 0); writeLE<int32_t>(out, 0); writeLE<int32_t>(out, w - 1); writeLE<int32_t>(out, h - 1);
+    attr("lineOrder", "lineOrder", 1); out.put(0);  // INCREASING_Y
+    attr("pixelAspectRatio", "float", 4); writeLE<float>(out, 1.0f);
+    attr("screenWindowCenter", "v2f", 8); writeLE<float>(out, 0.0f); writeLE<float>(out, 0.0f);
+    attr("screenWindowWidth", "float", 4); writeLE<float>(out, 1.0f);
+    out.put(0);  // ͷ
+
+    // ɨƫƱ֮ÿУy + ݳ + ͨ
+    uint32_t lineBytes = static_cast<uint32_t>(w) * 3 * 4;
+    uint64_t offset = static_cast<uint64_t>(out.tellp()) + static_cast<uint64_t>(h) * 8;
+    for (int y = 0; y < h; ++y) writeLE<uint64_t>(out, offset + static_cast<uint64_t>(y) * (8 + lineBytes));
+    for (int y = 0; y < h; ++y) {
+        writeLE<int32_t>(out, y);
+        writeLE<uint32_t>(out, lineBytes);
+        for (int c = 2; c >= 0; --c)  // B, G, R
+            for (int x = 0; x < w; ++x) writeLE<float>(out, rgb[(static_cast<size_t>(y) * w + x) * 3 + c]);
+    }
+    return static_cast<bool>(out);
+}
+
+// չѡʽдǰ֡
+bool writeImage(const std::string& path, int w, int h, const unsigned char* rgb, const float* hdr) {
+    std::string ext = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (ext == ".png") return writePNG(path, w, h, rgb);
+    if (ext == ".pfm") return writePFM(path, w, h, hdr);
+    if (ext == ".exr") return writeEXR(path, w, h, hdr);
+    if (ext != ".ppm") std::cerr << "δ֪ͼʽPPMд: " << path << std::endl;
+    return writePPM(path, w, h, rgb);
+}
+
+// --aux Fļչǰ .albedo / .normal / .depth
+std::string auxImagePath(const std::string& path, const char* kind) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + "." + kind;
+    return path.substr(0, dot) + "." + kind + path.substr(dot);
+}
+
+// д壺PFM/EXR ԭʼֵȵıΪ -18λʽзӳΪ n*0.5+0.5ȰԶһ
+bool writeAuxImages(const std::string& path, int w, int h, const AuxBuffers& aux) {
+    size_t n = static_cast<size_t>(w) * h;
+    std::vector<float> depth3(n * 3), normal01(n * 3), depth01(n * 3);
+    float maxDepth = *std::max_element(aux.depth.begin(), aux.depth.end());
+    float invDepth = maxDepth > 0 ? 1.0f / maxDepth : 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            depth3[i * 3 + c] = aux.depth[i];
+            depth01[i * 3 + c] = std::max(0.0f, aux.depth[i]) * invDepth;
+            normal01[i * 3 + c] = aux.normal[i * 3 + c] * 0.5f + 0.5f;
+        }
+    }
+    const float* hdr[3] = { aux.albedo.data(), aux.normal.data(), depth3.data() };
+    const float* display[3] = { aux.albedo.data(), normal01.data(), depth01.data() };
+    const char* kinds[3] = { "albedo", "normal", "depth" };
+    std::vector<unsigned char> rgb(n * 3);
+    for (int k = 0; k < 3; ++k) {
+        for (size_t i = 0; i < n * 3; ++i) rgb[i] = encodeDisplayReference(display[k][i]);
+        std::string file = auxImagePath(path, kinds[k]);
+        if (!writeImage(file, w, h, rgb.data(), hdr[k])) return false;
+        std::cout << "д: " << file << std::endl;
+    }
+    return true;
+}
+
+// ----------------------------------------------------
+
+// ͼԪͣBVHеͼԪָӦ͵б
+enum PrimType {
+    PRIM_SPHERE = 0,
+    PRIM_BOX,
+    PRIM_RECT,
+    PRIM_INSTANCE  // ʵindex Ϊ Scene::instances ±
+};
+
+// PrimRefṹ壺ͼԪã + ڶӦбе± + ʱţ
+struct PrimRef {
+    int type;
+    int index;
+    int materialID;
+};
+
+// HitRecordṹ壺ѯ24ֽڣֻŲƲʡ
+// ֻ t/primIDʵ꣩materialID ڲѯһΣ
+// е㡢ߺuvɫ׶ζս㣨surfaceAt
+struct HitRecord {
+    float t;          // 
+    int primID;       // еͼԪScene::prims ±꣩
+    int materialID;   // ʱţScene::materials ±꣩
+    float u, v;       // ꣨Ϊ꣩
+    int triangle;     // ʵʱΣScene::meshTriangles ±꣩
+};
+
+// ļĴС޸ʱ䣺һ仯Ϊ
+struct SceneSourceStamp {
+    uint64_t size = 0;
+    int64_t time = 0;
+};
+
+// Sceneṹ壺塢Դ׷ٺ
+struct Scene {
+    std::unique_ptr<MappedFile> cacheMapping;  // ӳʱļӳ䣨ֱָУ
+    SceneArray<Sphere> spheres;    // бֵţ
+    SceneArray<Box> boxes;         // б
+    SceneArray<Rect> rects;        // ǽ/ذ/컨б
+    SceneArray<PrimRef> prims;     // ͼԪãBVHͼԪż±꣩
+    SceneArray<Material> materials;  // ʱͼԪֻţɫʱŲ
+    SceneArray<Vector3> meshVertices;        // Ķ
+    SceneArray<MeshTriangle> meshTriangles;  // ΣڰBVHҶ˳
+    SceneArray<BVHNode> meshNodes;           // ԵBVHڵ
+    SceneArray<Mesh> meshes;                 // 
+    SceneArray<MeshInstance> instances;      // ʵBVHе PRIM_INSTANCE ͼԪ
+    SceneArray<char> dependencyPaths;                // õⲿļ񣩣'\0' ָжϻǷ
+    SceneArray<SceneSourceStamp> dependencyStamps;   // ӦļʱĴС޸ʱ
+    BVH bvh;                       // ͼԪļٽṹ
+    PrimSoA soa;                   // BVHҶ˳еSIMD
+    int glossySamples = GLOSSY_SAMPLES;  // ģʱĲʽȾÿΪ1
+    Vector3 lightPos = Vector3(0, 2.9f, 0);     // Դλãģ
+    Vector3 lightColor = Vector3(1.5f, 1.5f, 1.5f);  // Դɫɫǿ1.5
+    Vector3 bgColor = Vector3(0.85f, 0.85f, 0.85f);  // ɫǳң
+    Vector3 cameraPos = Vector3(0, 1.5f, 2.5f);  // λãǰ
+    Vector3 lookAt = Vector3(0, 1.5f, 0.0f);     // עӵ㣨ģ
+    float fov = 90.0f * M_PI / 180.0f;           // ҰǶȣȣ90ڣ
+    int geometryVersion = 0;  // 壨ͼԪBVHÿؽ¼ʱ1߻ݴжǷ
+
+    // ֹ̨ͣȾ尴ֵţͷţ
+    ~Scene() {
+        stopProgressive();
+    }
+
+    // ǼǲʣţͼԪɹͬһţ
+    int addMaterial(const Material& m) {
+        materials.push_back(m);
+        return static_cast<int>(materials.size()) - 1;
+    }
+
+    // Ǽtris Ķ± vertsΪ񵥶BVHҶӰSIMDȣΰҶ˳
+    // 㰴״ʹ˳׷ӵ飨δõĶ㶪
+    int addMesh(const std::vector<Vector3>& verts, const std::vector<MeshTriangle>& tris) {
+        std::vector<AABB> bounds(tris.size());
+        for (size_t i = 0; i < tris.size(); ++i) {
+            for (int k = 0; k < 3; ++k) bounds[i].grow(verts[tris[i].v[k]]);
+        }
+        BVH local;
+        local.leafWidth = SIMD_WIDTH;
+        local.maxLeafSize = std::max(4, SIMD_WIDTH);
+        local.build(bounds);
+
+        Mesh mesh;
+        mesh.nodeOffset = static_cast<int>(meshNodes.size());
+        mesh.nodeCount = static_cast<int>(local.nodes.size());
+        mesh.triOffset = static_cast<int>(meshTriangles.size());
+        mesh.triCount = static_cast<int>(tris.size());
+        mesh.vertexOffset = static_cast<int>(meshVertices.size());
+        mesh.bmin = local.nodes.empty() ? Vector3() : local.nodes[0].bmin;
+        mesh.bmax = local.nodes.empty() ? Vector3() : local.nodes[0].bmax;
+        for (const BVHNode& node : local.nodes) meshNodes.push_back(node);  // ȷС reserveȷԤÿ׷Ӷ·䲢֮ǰȫ
+        std::vector<int> remap(verts.size(), -1);
+        int used = 0;
+        for (int i : local.primIndices) {
+            MeshTriangle tri = tris[i];
+            for (int k = 0; k < 3; ++k) {
+                int& r = remap[tri.v[k]];
+                if (r < 0) { r = used++; meshVertices.push_back(verts[tri.v[k]]); }
+                tri.v[k] = mesh.vertexOffset + r;
+            }
+            meshTriangles.push_back(tri);
+        }
+        mesh.vertexCount = used;
+        meshes.push_back(mesh);
+        return static_cast<int>(meshes.size()) - 1;
+    }
+
+    // ǼʵobjectToWorld 棨Ϊ0ʱfalse
+    bool addInstance(int mesh, const Transform& objectToWorld, int materialID) {
+        MeshInstance inst;
+        inst.mesh = mesh;
+        inst.materialID = materialID;
+        inst.objectToWorld = objectToWorld;
+        if (!objectToWorld.inverse(inst.worldToObject)) return false;
+        instances.push_back(inst);
+        return true;
+    }
+
+    // BVHռͼԪİΧУ仯Ҫµ
+    void buildBVH() {
+        prims.clear();
+        std::vector<AABB> bounds;
+        for (int i = 0; i < (int)spheres.size(); ++i) {
+            prims.push_back({ PRIM_SPHERE, i, spheres[i].materialID });
+            AABB b;
+            Vector3 r(spheres[i].radius, spheres[i].radius, spheres[i].radius);
+            b.grow(spheres[i].center - r);
+            b.grow(spheres[i].center + r);
+            bounds.push_back(b);
+        }
+        for (int i = 0; i < (int)boxes.size(); ++i) {
+            prims.push_back({ PRIM_BOX, i, boxes[i].materialID });
+            AABB b;
+            b.grow(boxes[i].min);
+            b.grow(boxes[i].max);
+            bounds.push_back(b);
+        }
+        for (int i = 0; i < (int)rects.size(); ++i) {
+            prims.push_back({ PRIM_RECT, i, rects[i].materialID });
+            AABB b;
+            Vector3 pad(1e-4f, 1e-4f, 1e-4f);  // κΪ0չSlab˻
+            b.grow(rects[i].min - pad);
+            b.grow(rects[i].max + pad);
+            bounds.push_back(b);
+        }
+        for (int i = 0; i < (int)instances.size(); ++i) {
+            prims.push_back({ PRIM_INSTANCE, i, instances[i].materialID });
+            const MeshInstance& inst = instances[i];
+            const Mesh& mesh = meshes[inst.mesh];
+            AABB b;
+            for (int c = 0; c < 8; ++c) {  // ռΧе8Ǳ任ռ
+                b.grow(inst.objectToWorld.point(Vector3(c & 1 ? mesh.bmax.x : mesh.bmin.x,
+                    c & 2 ? mesh.bmax.y : mesh.bmin.y, c & 4 ? mesh.bmax.z : mesh.bmin.z)));
+            }
+            bounds.push_back(b);
+        }
+        bvh.leafWidth = SIMD_WIDTH;  // ҶӰSIMDȼƴۣҶ
+        bvh.maxLeafSize = std::max(4, SIMD_WIDTH);
+        bvh.build(bounds);
+        buildSoA();
+        ++geometryVersion;
+        std::cout << "BVH: " << prims.size() << " ͼԪ, " << bvh.nodes.size() << " ڵ" << std::endl;
+        if (!instances.empty()) {
+            std::cout << ": " << meshes.size() << " " << meshTriangles.size() << " , " << meshVertices.size()
+                << " 㣩, " << instances.size() << " ʵ" << std::endl;
+        }
+    }
+
+    // BVHҶ˳SoAݣÿҶڰǰSlabǽڣСʵں
+    void buildSoA() {
+        soa.resize(bvh.primIndices.size());
+        for (const BVHNode& node : bvh.nodes) {
+            if (node.count == 0) continue;
+            int* first = &bvh.primIndices[node.leftFirst];
+            int* instancesBegin = std::stable_partition(first, first + node.count, [&](int i) { return prims[i].type != PRIM_INSTANCE; });
+            std::stable_partition(first, instancesBegin, [&](int i) { return prims[i].type == PRIM_SPHERE; });
+            soa.leafInstanceCount[node.leftFirst] = static_cast<int>(first + node.count - instancesBegin);
+            int sphereCount = 0;
+            for (int i = 0; i < node.count; ++i) {
+                int pos = node.leftFirst + i;
+                const PrimRef& ref = prims[bvh.primIndices[pos]];
+                if (ref.type == PRIM_SPHERE) {
+                    const Sphere* sp = &spheres[ref.index];
+                    soa.cx[pos] = sp->center.x; soa.cy[pos] = sp->center.y; soa.cz[pos] = sp->center.z;
+                    soa.r2[pos] = sp->radius * sp->radius;
+                    ++sphereCount;
+                    continue;
+                }
+                if (ref.type == PRIM_INSTANCE) continue;
+                Vector3 mn = ref.type == PRIM_BOX ? boxes[ref.index].min : rects[ref.index].min;
+                Vector3 mx = ref.type == PRIM_BOX ? boxes[ref.index].max : rects[ref.index].max;
+                soa.minX[pos] = mn.x; soa.minY[pos] = mn.y; soa.minZ[pos] = mn.z;
+                soa.maxX[pos] = mx.x; soa.maxY[pos] = mx.y; soa.maxZ[pos] = mx.z;
+            }
+            soa.leafSphereCount[node.leftFirst] = sphereCount;
+        }
+    }
+
+    //  vs ʵ߱任ռ䣨򲻹һt ռһ£ڸԼBVH
+    bool intersectInstance(const Ray& ray, int instIndex, float& tBest, HitRecord& hit) const {
+        const MeshInstance& inst = instances[instIndex];
+        const Mesh& mesh = meshes[inst.mesh];
+        Ray local = Ray::withUnitDirection(inst.worldToObject.point(ray.origin), inst.worldToObject.vector(ray.direction));  // ䷽
+        WatertightRay wr(local.origin, local.direction);
+        const MeshTriangle* tris = meshTriangles.data() + mesh.triOffset;
+        int tri = -1;
+        float u = 0, v = 0;
+        bool found = BVH::traverseNodes(&meshNodes[mesh.nodeOffset], local.origin, local.invDirection, tBest, [&](int first, int count, float& tLeaf) {
+            STAT_ADD(primTests, count);
+            return intersectTriangles<false>(tris, meshVertices.data(), first, count, wr, tLeaf, tri, u, v);
+        });
+        if (!found) return false;
+        hit.triangle = mesh.triOffset + tri;
+        hit.u = u;
+        hit.v = v;
+        return true;
+    }
+
+    // ʵڵԣһ (0.001, tMax) ཻtrue
+    bool occludedInstance(const Ray& ray, int instIndex, float tMax) const {
+        const MeshInstance& inst = instances[instIndex];
+        const Mesh& mesh = meshes[inst.mesh];
+        Ray local = Ray::withUnitDirection(inst.worldToObject.point(ray.origin), inst.worldToObject.vector(ray.direction));
+        WatertightRay wr(local.origin, local.direction);
+        const MeshTriangle* tris = meshTriangles.data() + mesh.triOffset;
+        return BVH::traverseNodesAny(&meshNodes[mesh.nodeOffset], local.origin, local.invDirection, tMax, [&](int first, int count) {
+            STAT_ADD(primTests, count);
+            float t = tMax, u, v;
+            int tri;
+            return intersectTriangles<true>(tris, meshVertices.data(), first, count, wr, t, tri, u, v);
+        });
+    }
+
+    // Ҷ󽻣 BVH λ [first, first+count) ͼԪ/Slab SIMDģҶĩβʵ
+    bool intersectLeaf(const Ray& ray, int first, int count, float& tBest, HitRecord& hit) const {
+        STAT_ADD(primTests, count);
+        int sphereCount = soa.leafSphereCount[first];
+        int instanceCount = soa.leafInstanceCount[first];
+        int slabCount = count - sphereCount - instanceCount;
+        int bestPos = -1;
+        if (sphereCount > 0) intersectSpheresSoA<false>(soa, first, sphereCount, ray, tBest, bestPos);
+        if (slabCount > 0) intersectSlabsSoA<false>(soa, first + sphereCount, slabCount, ray, tBest, bestPos);
+        for (int pos = first + count - instanceCount; pos < first + count; ++pos) {
+            if (intersectInstance(ray, prims[bvh.primIndices[pos]].index, tBest, hit)) bestPos = pos;
+        }
+        if (bestPos < 0) return false;
+        hit.primID = bvh.primIndices[bestPos];
+        return true;
+    }
+
+    // ѯ (0.001, tMax) ѰͼԪߺͷ//ģ߹
+    bool intersect(const Ray& ray, float tMax, HitRecord& hit) const {
+        hit.t = tMax;
+        bool found = bvh.traverse(ray.origin, ray.invDirection, hit.t, [&](int first, int count, float& tBest) {
+            return intersectLeaf(ray, first, count, tBest, hit);
+        });
+        if (found) hit.materialID = prims[hit.primID].materialID;
+        return found;
+    }
+
+    // ҶڵԣһͼԪ (0.001, tMax) ཻtrue㡢㷨
+    bool occludedLeaf(const Ray& ray, int first, int count, float tMax) const {
+        STAT_ADD(primTests, count);
+        int sphereCount = soa.leafSphereCount[first];
+        int instanceCount = soa.leafInstanceCount[first];
+        int slabCount = count - sphereCount - instanceCount;
+        int unusedPos;
+        if (sphereCount > 0 && intersectSpheresSoA<true>(soa, first, sphereCount, ray, tMax, unusedPos)) return true;
+        if (slabCount > 0 && intersectSlabsSoA<true>(soa, first + sphereCount, slabCount, ray, tMax, unusedPos)) return true;
+        for (int pos = first + count - instanceCount; pos < first + count; ++pos) {
+            if (occludedInstance(ray, prims[bvh.primIndices[pos]].index, tMax)) return true;
+        }
+        return false;
+    }
+
+    // ڵѯӰߣorigin صλ dir  (0.001, tMax) ǷһͼԪǽڣסҵһڵֹͣ
+    bool occluded(const Vector3& origin, const Vector3& dir, float tMax) const {
+        Ray ray = Ray::withUnitDirection(origin, dir);
+        return bvh.traverseAny(ray.origin, ray.invDirection, tMax, [&](int first, int count) {
+            return occludedLeaf(ray, first, count, tMax);
+        });
+    }
+
+    // ߰ڵѯ activeMask бڵͨλ
+    int occludedPacket(const Ray* const rays[PACKET_SIZE], const float tMax[PACKET_SIZE], int activeMask) const {
+        return bvh.traversePacketAny(rays, tMax, activeMask, [&](int lane, int first, int count) {
+            return occludedLeaf(*rays[lane], first, count, tMax[lane]);
+        });
+    }
+
+    // ߰ѯactiveMask еͨ룬ͨλ
+    int intersectPacket(const Ray* const rays[PACKET_SIZE], const float tMax[PACKET_SIZE], int activeMask, HitRecord hits[PACKET_SIZE]) const {
+        float tBest[PACKET_SIZE];
+        int foundMask = 0;
+        for (int i = 0; i < PACKET_SIZE; ++i) tBest[i] = tMax[i];
+        bvh.traversePacket(rays, tBest, activeMask, [&](int lane, int first, int count, float& tLane) {
+            if (intersectLeaf(*rays[lane], first, count, tLane, hits[lane])) foundMask |= 1 << lane;
+        });
+        for (int i = 0; i < PACKET_SIZE; ++i) {
+            hits[i].t = tBest[i];
+            if (foundMask & (1 << i)) hits[i].materialID = prims[hits[i].primID].materialID;
+        }
+        return foundMask;
+    }
+
+    // ޸ģɳľƵĺ
+    Vector3 getWoodTextureColor(const Vector3& hitPoint, const Vector3& normal) {
+        // ľɫǳľľ
+        Vector3 lightWood = Vector3(0.65f, 0.45f, 0.25f);
+        Vector3 darkWood = Vector3(0.45f, 0.25f, 0.1f);
+
+        // ƵʺŶǿ
+        float scale = 10.0f;             // 
+        float stripeDensity = 0.3f;      // ܶȣСֵ
+        float noiseStrength = 0.3f;      // Ŷǿ
+
+        float noiseVal;                  // Perlinֵ
+        float stripeCoord;               // 
+
+        // ݷ߷ѡͶӰƽͷUVӳ䣩
+        if (std::abs(normal.y) > 0.9f) { // /ײ (XZƽͶӰZ)
+            stripeCoord = hitPoint.z * scale; // Z
+            noiseVal = perlinNoise(hitPoint.x * scale * 0.5f, hitPoint.z * scale * 0.5f); // ŶX
+        }
+        else if (std::abs(normal.x) > 0.9f) { // X (YZƽͶӰY)
+            stripeCoord = hitPoint.y * scale; // Yƣֱ
             noiseVal = perlinNoise(hitPoint.y * scale * 0.5f, hitPoint.z * scale * 0.5f); // ŶZ
         }
         else { // Z (XYƽͶӰY)
@@ -292,429 +2365,3931 @@ struct Scene {
             noiseVal = perlinNoise(hitPoint.x * scale * 0.5f, hitPoint.y * scale * 0.5f); // ŶX
         }
 
-        // ͼʹsinƣŶ
-        float stripePattern = std::sin(stripeCoord * 2.0f * M_PI / stripeDensity + noiseVal * noiseStrength * 10.0f);
-        stripePattern = (stripePattern + 1.0f) * 0.5f; // һ0-1
-        stripePattern = std::abs(stripePattern - 0.5f) * 2.0f; // ƱԵ
-        stripePattern = std::pow(stripePattern, 2.0f); // ʹƸ
+        // ͼʹsinƣŶ
+        float stripePattern = std::sin(stripeCoord * 2.0f * M_PI / stripeDensity + noiseVal * noiseStrength * 10.0f);
+        stripePattern = (stripePattern + 1.0f) * 0.5f; // һ0-1
+        stripePattern = std::abs(stripePattern - 0.5f) * 2.0f; // ƱԵ
+        stripePattern = std::pow(stripePattern, 2.0f); // ʹƸ
+
+        // patternľɫֵ֮
+        return interpolate(lightWood, darkWood, stripePattern);
+    }
+
+    // ľƣ getWoodTextureColor ͬͼÿ SIMD_WIDTH ɫһsin
+    // sinΪʽƣ std::sin Լ1e-7
+    void getWoodTextureColors(const Vector3* points, const Vector3* normals, int n, Vector3* out) const {
+#if SIMD_WIDTH > 1
+        const float scale = 10.0f, stripeDensity = 0.3f, noiseStrength = 0.3f;  //  getWoodTextureColor ͬĲ
+        Vector3 lightWood = Vector3(0.65f, 0.45f, 0.25f);
+        Vector3 darkWood = Vector3(0.45f, 0.25f, 0.1f);
+        for (int i = 0; i < n; i += SIMD_WIDTH) {
+            float nx[SIMD_WIDTH], ny[SIMD_WIDTH], stripe[SIMD_WIDTH];
+            for (int l = 0; l < SIMD_WIDTH; ++l) {
+                const Vector3& hp = points[std::min(i + l, n - 1)];  // ĩ鲻ʱظһ
+                const Vector3& nm = normals[std::min(i + l, n - 1)];
+                // ͬͶӰƽѡ
+                if (std::abs(nm.y) > 0.9f) { stripe[l] = hp.z * scale; nx[l] = hp.x * scale * 0.5f; ny[l] = hp.z * scale * 0.5f; }
+                else if (std::abs(nm.x) > 0.9f) { stripe[l] = hp.y * scale; nx[l] = hp.y * scale * 0.5f; ny[l] = hp.z * scale * 0.5f; }
+                else { stripe[l] = hp.y * scale; nx[l] = hp.x * scale * 0.5f; ny[l] = hp.y * scale * 0.5f; }
+            }
+            vfloat noise = perlinNoiseSIMD(vload(nx), vload(ny));
+            vfloat phase = vadd(vmul(vload(stripe), vset1(2.0f * static_cast<float>(M_PI) / stripeDensity)), vmul(noise, vset1(noiseStrength * 10.0f)));
+            vfloat pattern = vmul(vadd(sinSIMD(phase), vset1(1.0f)), vset1(0.5f));  // һ0-1
+            pattern = vsub(pattern, vset1(0.5f));
+            pattern = vmul(vmaxf(pattern, vsub(vset1(0.0f), pattern)), vset1(2.0f));  // ƱԵ
+            pattern = vmul(pattern, pattern);  // 񻯣pow(x, 2)
+            float pat[SIMD_WIDTH];
+            vstore(pat, pattern);
+            for (int l = 0; l < SIMD_WIDTH && i + l < n; ++l) out[i + l] = interpolate(lightWood, darkWood, pat[l]);
+        }
+#else
+        for (int i = 0; i < n; ++i) out[i] = const_cast<Scene*>(this)->getWoodTextureColor(points[i], normals[i]);
+#endif
+    }
+
+    // ---- 決ľƣÿ6һmipmap±Ϊ ± * 6 + ţ * 2 + 棩 ----
+    static const int BAKE_TEXELS_PER_UNIT = 512;  // 決ܶȣ0.03Լ15
+    std::vector<MipTexture> bakedFaces;
+
+    static int boxFaceIndex(const Vector3& normal) {
+        if (std::abs(normal.x) > 0.5f) return normal.x > 0 ? 1 : 0;
+        if (std::abs(normal.y) > 0.5f) return normal.y > 0 ? 3 : 2;
+        return normal.z > 0 ? 5 : 4;
+    }
+
+    // ʱ決 TEX_EVAL_BAKED ľƺӣĵ planarUV ӳ以棬ֵ
+    void bakeTextures() {
+        auto start = std::chrono::high_resolution_clock::now();
+        bakedFaces.assign(boxes.size() * 6, MipTexture());
+        int bakedCount = 0;
+        for (size_t b = 0; b < boxes.size(); ++b) {
+            const Box* box = &boxes[b];
+            const Material& mat = materials[box->materialID];
+            if (mat.texture != TEX_WOOD_GRAIN || mat.textureEval != TEX_EVAL_BAKED) continue;
+            for (int face = 0; face < 6; ++face) {
+                int axis = face / 2;
+                int ua = axis == 0 ? 2 : 0, va = axis == 1 ? 2 : 1;  //  planarUV ͬѡ
+                float uMin = axisComponent(box->min, ua), uSize = axisComponent(box->max, ua) - uMin;
+                float vMin = axisComponent(box->min, va), vSize = axisComponent(box->max, va) - vMin;
+                float plane = axisComponent((face & 1) ? box->max : box->min, axis);
+                int w = std::max(1, static_cast<int>(std::ceil(uSize * BAKE_TEXELS_PER_UNIT)));
+                int h = std::max(1, static_cast<int>(std::ceil(vSize * BAKE_TEXELS_PER_UNIT)));
+                Vector3 normal(0, 0, 0);
+                (axis == 0 ? normal.x : (axis == 1 ? normal.y : normal.z)) = (face & 1) ? 1.0f : -1.0f;
+                std::vector<Vector3> texels(w * h), points(w), normals(w, normal);
+                for (int y = 0; y < h; ++y) {
+                    for (int x = 0; x < w; ++x) {
+                        float c[3];
+                        c[axis] = plane;
+                        c[ua] = uMin + (x + 0.5f) / w * uSize;
+                        c[va] = vMin + (y + 0.5f) / h * vSize;
+                        points[x] = Vector3(c[0], c[1], c[2]);
+                    }
+                    getWoodTextureColors(points.data(), normals.data(), w, &texels[y * w]);
+                }
+                bakedFaces[b * 6 + face].build(w, h, std::move(texels));
+            }
+            ++bakedCount;
+        }
+        if (bakedCount > 0) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+            std::cout << "ľƺ決: " << bakedCount << " , " << ms.count() << " " << std::endl;
+        }
+    }
+
+    // ѡķʽľɫ決߾ظǵѡmip
+    Vector3 woodColorAt(const HitRecord& hit, const Vector3& hitPoint, const Vector3& hitNormal, const Vector3& rayDir, int eval) {
+        if (eval == TEX_EVAL_BAKED) {
+            const PrimRef& ref = prims[hit.primID];
+            if (ref.type == PRIM_BOX && ref.index * 6 < static_cast<int>(bakedFaces.size())) {
+                const MipTexture& tex = bakedFaces[ref.index * 6 + boxFaceIndex(hitNormal)];
+                if (!tex.empty()) {
+                    float pixelSpread = 2.0f * std::tan(fov * 0.5f) / imageHeight;  // λ봦һصĿ
+                    float cosTheta = std::max(0.25f, std::abs(rayDir.dot(hitNormal)));  // ʱ㼣
+                    float texels = hit.t * pixelSpread / cosTheta * BAKE_TEXELS_PER_UNIT;
+                    return tex.sample(hit.u, hit.v, std::log2(std::max(texels, 1.0f)));
+                }
+            }
+        }
+        else if (eval == TEX_EVAL_SIMD) {
+            Vector3 color;
+            getWoodTextureColors(&hitPoint, &hitNormal, 1, &color);
+            return color;
+        }
+        return getWoodTextureColor(hitPoint, hitNormal);
+    }
+
+    // ذľƣsin + 
+    Vector3 getFloorTextureColor(const Vector3& p) {
+        float woodX = p.x * 15.0f;
+        float woodZ = p.z * 8.0f;
+        float pattern = std::sin(woodX) * 0.5f + 0.5f;  // X
+        int stripe = static_cast<int>(woodZ * 5) % 2;    // Z
+        Vector3 baseColor = stripe ? Vector3(0.55f, 0.35f, 0.15f) : Vector3(0.45f, 0.25f, 0.1f);
+        return baseColor * (0.8f + pattern * 0.2f);  // ɫ
+    }
+
+    // ӳɫı㣺ֻյе㡢ߺuv
+    void surfaceAt(const Ray& ray, HitRecord& hit, Vector3& hitPoint, Vector3& hitNormal) const {
+        hitPoint = ray.origin + ray.direction * hit.t;
+        const PrimRef& ref = prims[hit.primID];
+        switch (ref.type) {
+        case PRIM_SPHERE:
+            hitNormal = (hitPoint - spheres[ref.index].center).normalize();  // 巨ߣ
+            hit.u = 0.5f + std::atan2(hitNormal.z, hitNormal.x) / (2.0f * static_cast<float>(M_PI));  // 
+            hit.v = 0.5f - std::asin(std::max(-1.0f, std::min(1.0f, hitNormal.y))) / static_cast<float>(M_PI);  // γ
+            break;
+        case PRIM_BOX: {
+            const Box* box = &boxes[ref.index];
+            hitNormal = box->normalAt(ray, hit.t);
+            int axis = std::abs(hitNormal.x) > 0.5f ? 0 : (std::abs(hitNormal.y) > 0.5f ? 1 : 2);
+            planarUV(hitPoint, box->min, box->max, axis, hit.u, hit.v);
+            break;
+        }
+        case PRIM_RECT: {
+            const Rect* rect = &rects[ref.index];
+            hitNormal = rect->normal;
+            planarUV(hitPoint, rect->min, rect->max, rect->axis, hit.u, hit.v);
+            break;
+        }
+        case PRIM_INSTANCE: {
+            // ηߣռתñ任ռ䣻uv ʱ
+            const MeshInstance& inst = instances[ref.index];
+            const MeshTriangle& tri = meshTriangles[hit.triangle];
+            Vector3 a = meshVertices[tri.v[0]];
+            Vector3 n = (meshVertices[tri.v[1]] - a).cross(meshVertices[tri.v[2]] - a);
+            hitNormal = inst.worldToObject.transposedVector(n).normalize();
+            // ˫ɫ߳һࣨҪⷨжϽ
+            if (!materials[hit.materialID].isRefractive && hitNormal.dot(ray.direction) > 0) hitNormal = hitNormal * -1;
+            break;
+        }
+        }
+    }
+
+    // ӰߣӻеطƫƺԴmaxT ΪҪڵ
+    Ray shadowRayAt(const Vector3& hitPoint, const Vector3& hitNormal, float& maxT) const {
+        Vector3 toLight = lightPos - hitPoint;
+        float dist = toLight.length();  // Դ루һһο
+        maxT = dist - 0.001f;
+        return Ray::withUnitDirection(hitPoint + hitNormal * 0.001f, toLight * (1.0f / dist));  // ƫ
+    }
+
+    // ׷ٺݹ׷٣ɫ
+    // canSplit·Ƿģѣ GlossyPolicy
+    Vector3 trace(const Ray& ray, int depth = 0, bool canSplit = true) {
+        if (depth > 6) return bgColor;  // Ƶݹȣѭ
+        STAT_MAX(maxDepth, depth);
+
+        HitRecord hit;
+        if (!intersect(ray, 100000.0f, hit)) return bgColor;  // ޽㣬ر
+        return shade(ray, hit, depth, canSplit);
+    }
+
+    // ɫɫ/ݹص trace
+    // knownShadow Ϊ -1 ʱзӰߣ0/1 ʾӰɹ߰Ԥ
+    // albedo ǿʱΪ߰Ԥɫ
+    Vector3 shade(const Ray& ray, HitRecord hit, int depth, bool canSplit = true, int knownShadow = -1, const Vector3* albedo = nullptr) {
+        // ݻеͼԪȡûе㡢ߺͲ
+        Vector3 hitPoint, hitNormal;  // еͷ
+        surfaceAt(ray, hit, hitPoint, hitNormal);
+        const Material& hitMat = materials[hit.materialID];  // вʣƣ
+
+        // ǲɫ
+        Vector3 surfaceColor = hitMat.color;
+        if (albedo) {
+            surfaceColor = *albedo;
+        }
+        else if (hitMat.texture == TEX_WOOD_GRAIN) {
+            surfaceColor = woodColorAt(hit, hitPoint, hitNormal, ray.direction, hitMat.textureEval);  // ľ䳤ľ
+        }
+        else if (hitMat.texture == TEX_FLOOR_PLANKS) {
+            surfaceColor = getFloorTextureColor(hitPoint);  // ذľ
+        }
+
+        Vector3 finalColor = Vector3(0, 0, 0);  // ɫʼ
+
+        // ʣȼߣΪı·
+        if (hitMat.isRefractive&& depth < 6) {
+            float cosI = -ray.direction.dot(hitNormal);  // 
+            float eta = hitMat.eta;  // 
+            Vector3 n = hitNormal;   // 
+
+            bool entering = cosI > 0;  // Ƿ
+            if (!entering) {  // ڲ
+                cosI = -cosI;
+                n = hitNormal * -1;  // ת
+                eta = 1.0f / eta;    // 
+            }
+
+            float sinT2 = eta * eta * (1 - cosI * cosI);  // Snell
+            if (sinT2 < 1.0f) {  // 䣨ȫ䣩
+                float cosT = std::sqrt(1 - sinT2);  // 
+                // ䷽ʽ
+                Vector3 refractDir = (ray.direction * eta + n * (eta * cosI - cosT)).normalize();
+                Ray refractRay(hitPoint - n * 0.001f, refractDir);  // ƫƱԽ
+                STAT_ADD(refractionRays, 1);
+                Vector3 refractColor = trace(refractRay, depth + 1, canSplit);  // ݹ׷
+
+                // FresnelЧӦ/͸
+                float R0 = ((eta - 1) * (eta - 1)) / ((eta + 1) * (eta + 1));  // ֱ䷴
+                float fresnel = R0 + (1 - R0) * std::pow(1 - cosI, 5);  // Schlick
+
+                // 䲿
+                Vector3 reflectDir = (ray.direction - hitNormal * 2 * ray.direction.dot(hitNormal)).normalize();
+                Ray reflectRay(hitPoint + hitNormal * 0.001f, reflectDir);
+                STAT_ADD(reflectionRays, 1);
+                Vector3 reflectColor = trace(reflectRay, depth + 1, canSplit);
+
+                finalColor = refractColor * (1 - fresnel) + reflectColor * fresnel;  // 
+            }
+            else {  // ȫ
+                Vector3 reflectDir = (ray.direction - n * 2 * ray.direction.dot(n)).normalize();
+                Ray reflectRay(hitPoint + n * 0.001f, reflectDir);
+                STAT_ADD(reflectionRays, 1);
+                finalColor = trace(reflectRay, depth + 1, canSplit);
+            }
+            return finalColor;  // ֱӷ
+        }
+
+        // ׼ռ ( + ߹⣬Phongģ)
+        Vector3 localColor = Vector3(0, 0, 0);  // ɫ
+        Vector3 lightDir = (lightPos - hitPoint).normalize();  // ߷
+        float lightDist = (lightPos - hitPoint).length();      // Դ
+
+        // Ӱ⣺ӻеԴӰӹߣͨBVHͼԪڵ
+        bool inShadow = knownShadow == 1;
+        if (knownShadow < 0) {
+            float shadowMaxT;
+            Ray shadowRay = shadowRayAt(hitPoint, hitNormal, shadowMaxT);
+            STAT_ADD(shadowRays, 1);
+            inShadow = occluded(shadowRay.origin, shadowRay.direction, shadowMaxT);
+        }
+
+        if (!inShadow) {  // Ӱ
+            // ⣺㶨
+            localColor = localColor + hitMat.ka * surfaceColor;
+
+            // 䣺Lambertģ
+            float diff = std::max(0.0f, hitNormal.dot(lightDir));  // cos theta
+            float attenuation = 1.0f / (1.0f + 0.05f * lightDist * lightDist);  // ˥
+
+            if (hitMat.isMetallic) {
+                // 䣬òɫƹɫ
+                localColor = localColor + hitMat.kd * (surfaceColor * lightColor) * diff * attenuation * 0.1f;
+            }
+            else {
+                localColor = localColor + hitMat.kd * (surfaceColor * lightColor) * diff * attenuation;
+            }
+
+            // ߹⣺Phongģ
+            Vector3 viewDir = (cameraPos - hitPoint).normalize();  // ߷
+            Vector3 reflectDir = (hitNormal * (2 * hitNormal.dot(lightDir)) - lightDir).normalize();  // ䷽
+            float spec = std::pow(std::max(0.0f, viewDir.dot(reflectDir)), hitMat.shininess);  // ߹ǿ
+            // ߹òɫǽùɫ
+            localColor = localColor + hitMat.ks * (hitMat.isMetallic ? surfaceColor : lightColor) * spec * attenuation;
+        }
+        else {
+            // ӰУ⣬
+            localColor = hitMat.ka * surfaceColor * 0.5f;
+        }
+
+        finalColor = localColor;  // Ϊ
+
+        //  (вʣͨkr)
+        if (hitMat.kr > 0.0f && depth < 6) {
+            Vector3 reflectDir = (ray.direction - hitNormal * 2 * ray.direction.dot(hitNormal)).normalize();  // ䷽
+
+            // Monte Carloģ䣨ֲڱ棩
+            Vector3 glossyReflectColor = Vector3(0, 0, 0);
+            int SAMPLES_PER_GLOSSY_RAY = 1;  // Ĭ1
+            bool childCanSplit = canSplit;   // ·Ƿ
+            float survivalWeight = 1.0f;     // ˹̶ĴĲȨ
+            if (hitMat.roughness > 0.001f) {
+                if (canSplit || glossyPolicy == GLOSSY_SPLIT_ALWAYS) {
+                    SAMPLES_PER_GLOSSY_RAY = glossySamples;  // ֲʱӲ٣
+                    childCanSplit = glossyPolicy == GLOSSY_SPLIT_ALWAYS;  // ѹ·ٷѣָ
+                }
+                else if (glossyPolicy == GLOSSY_ROULETTE) {
+                    // 淴ʱ仯ֹ·Ϊ0İ 1/ Ȩ
+                    float survival = std::max(0.05f, std::min(0.95f, hitMat.kr));
+                    if (randZeroOne() < survival) survivalWeight = 1.0f / survival;
+                    else SAMPLES_PER_GLOSSY_RAY = 0;
+                }
+            }
+
+            // ѭ
+            for (int i = 0; i < SAMPLES_PER_GLOSSY_RAY; ++i) {
+                Vector3 perturbedReflectDir = reflectDir;  // ʼΪ
+
+                if (hitMat.roughness > 0.001f) {
+                    // Ŷλ
+                    float r1 = randNegPosOne();
+                    float r2 = randNegPosOne();
+                    float r3 = randNegPosOne();
+                    Vector3 randomVec = Vector3(r1, r2, r3).normalize();
+
+                    // ϣŶǿroughness
+                    perturbedReflectDir = (reflectDir + randomVec * hitMat.roughness).normalize();
+
+                    // ȷڷ߰򣨱ⱳ棩
+                    if (perturbedReflectDir.dot(hitNormal) < 0) {
+                        perturbedReflectDir = reflectDir;
+                    }
+                }
+
+                Ray reflectRay(hitPoint + hitNormal * 0.001f, perturbedReflectDir);  // ƫ
+                if (hitMat.roughness > 0.001f) STAT_ADD(glossyRays, 1);
+                else STAT_ADD(reflectionRays, 1);
+                glossyReflectColor = glossyReflectColor + trace(reflectRay, depth + 1, childCanSplit);  // ݹ
+            }
+            if (SAMPLES_PER_GLOSSY_RAY > 0) {
+                glossyReflectColor = glossyReflectColor * (survivalWeight / SAMPLES_PER_GLOSSY_RAY);  // ƽ
+            }
+
+            // ϱعͷ
+            if (hitMat.isMetallic) {
+                // ɫ * ɫ
+                Vector3 metalReflectColor = glossyReflectColor * surfaceColor;
+                finalColor = finalColor * (1.0f - hitMat.kr) + metalReflectColor * hitMat.kr;
+            }
+            else {
+                // ǽֱӻ
+                finalColor = finalColor * (1.0f - hitMat.kr) + glossyReflectColor * hitMat.kr;
+            }
+        }
+
+        return finalColor;  // ɫ
+    }
+
+    // ÿ֡һΣع
+    struct CameraBasis {
+        Vector3 forward, right, up;
+        float tanHalfFov, aspect;
+    };
+
+    CameraBasis makeCameraBasis() const {
+        CameraBasis cam;
+        cam.forward = (lookAt - cameraPos).normalize();  // ǰ
+        cam.right = cam.forward.cross(Vector3(0, 1, 0)).normalize();  // Yϣ
+        cam.up = cam.right.cross(cam.forward).normalize();       // 
+        cam.tanHalfFov = std::tan(fov / 2);
+        cam.aspect = imageWidth / float(imageHeight);
+        return cam;
+    }
+
+    //  (x, y) ߷δһjx/jy Ϊڶƫƣ0ʾؽǵ㣬Ⱦһ£
+    Vector3 primaryDirection(int x, int y, const CameraBasis& cam, float jx, float jy) const {
+        // Ļ굽͸ͶӰ
+        float u = (2.0f * (x + jx) / imageWidth - 1.0f) * cam.tanHalfFov * cam.aspect;  // Xƫƣ߱У
+        float v = (1.0f - 2.0f * (y + jy) / imageHeight) * cam.tanHalfFov;  // YƫƣתY
+        return cam.forward + cam.right * u + cam.up * v;
+    }
+
+    //  (x, y) ߣȹһRay 캯ٹһһΣtraceQuad ·ͬιһλһ£
+    Ray primaryRay(int x, int y, const CameraBasis& cam, float jx = 0.0f, float jy = 0.0f) const {
+        return Ray(cameraPos, primaryDirection(x, y, cam, jx, jy).normalize());
+    }
+
+    //  pass ӣ0Ⱦͬ
+    static unsigned int passSeed(int pass) {
+        return renderSeed + static_cast<unsigned int>(pass) * 0x9E3779B9u;
+    }
+
+    // ڶ0鲻֮һ·ϣõռص
+    static void pixelJitter(int pass, int x, int y, float& jx, float& jy) {
+        if (pass == 0) { jx = jy = 0.0f; return; }
+        unsigned int h = hashPixelSeed(passSeed(pass) ^ 0xA511E9B3u, x, y);
+        jx = (h & 0xFFFF) * (1.0f / 65536.0f);
+        jy = (h >> 16) * (1.0f / 65536.0f);
+    }
+
+    // ɫд븡֡壨8λʾֵ postProcessRegion ڷֿ֡ɺͳһɣ
+    void writePixel(int x, int y, const Vector3& col) {
+        float* hdr = &hdrBuffer[(y * imageWidth + x) * 3];
+        hdr[0] = col.x; hdr[1] = col.y; hdr[2] = col.z;
+    }
+
+    // ֿ֡齻Ⱦ̳߳أ÷֤ûнʽȾʹ̳߳أ
+    void postProcessFrame() {
+        std::vector<Tile> tiles = makeTiles(imageWidth, imageHeight, TILE_SIZE);
+        renderPool().run(tiles, [](const Tile& tile, int) { postProcessRegion(tile.x0, tile.y0, tile.x1, tile.y1); });
+    }
+
+    // ---- 룺 -trous ˲ atrousRegion ----
+    AuxBuffers aux;          // һ֡ĸ壺0˳¼recordAux renderAux 
+    bool auxRecording = false;  // ε0¼
+    bool auxValid = false;      // aux ҶӦǰ
+
+    // һߵĸ棨ط/䷽򣩣ȡһǾķʡߺۼ·ȣ
+    // ɫ˽ʡȡӰص
+    void auxFeatures(const Ray& ray, Vector3& albedo, Vector3& normal, float& depth) {
+        HitRecord hit;
+        bool found = intersect(ray, 100000.0f, hit);
+        auxFeaturesFrom(ray, hit, found, albedo, normal, depth);
+    }
+
+    // ͬ auxFeaturesߵĽ֪0ɫʱѾظ󽻣
+    void auxFeaturesFrom(Ray ray, HitRecord hit, bool found, Vector3& albedo, Vector3& normal, float& depth) {
+        Vector3 throughput(1, 1, 1);
+        depth = 0.0f;
+        for (int bounce = 0; bounce <= 6; ++bounce) {  //  trace ͬ
+            if (bounce > 0) found = intersect(ray, 100000.0f, hit);
+            if (!found) break;
+            Vector3 hitPoint, hitNormal;
+            surfaceAt(ray, hit, hitPoint, hitNormal);
+            const Material& mat = materials[hit.materialID];
+            depth += hit.t;
+            if (bounce < 6 && mat.isRefractive) {
+                float cosI = -ray.direction.dot(hitNormal);
+                float eta = mat.eta;
+                Vector3 n = hitNormal;
+                if (!(cosI > 0)) { cosI = -cosI; n = hitNormal * -1; eta = 1.0f / eta; }
+                float sinT2 = eta * eta * (1 - cosI * cosI);
+                if (sinT2 < 1.0f) ray = Ray(hitPoint - n * 0.001f, ray.direction * eta + n * (eta * cosI - std::sqrt(1 - sinT2)));  // ͸䷽
+                else ray = Ray(hitPoint + n * 0.001f, ray.direction - n * 2 * ray.direction.dot(n));  // ȫ
+                continue;
+            }
+            if (bounce < 6 && mat.kr >= 0.99f && mat.roughness <= 0.001f) {  // 棺عȨΪ0Ƿ
+                if (mat.isMetallic) throughput = throughput * mat.color;
+                ray = Ray(hitPoint + hitNormal * 0.001f, ray.direction - hitNormal * 2 * ray.direction.dot(hitNormal));
+                continue;
+            }
+            Vector3 surfaceColor = mat.color;
+            if (mat.texture == TEX_WOOD_GRAIN) surfaceColor = getWoodTextureColor(hitPoint, hitNormal);
+            else if (mat.texture == TEX_FLOOR_PLANKS) surfaceColor = getFloorTextureColor(hitPoint);
+            albedo = throughput * surfaceColor;
+            normal = hitNormal;
+            return;
+        }
+        albedo = throughput * bgColor;  // þ
+        normal = Vector3(0, 0, 0);
+        depth = -1.0f;
+    }
+
+    // 0鿪ʼǰãҪʱɫͬʱ¼
+    void beginAuxRecording() {
+        auxValid = false;
+        auxRecording = denoiseOutput || !auxOutputPath.empty();
+        if (!auxRecording) return;
+        size_t n = static_cast<size_t>(imageWidth) * imageHeight;
+        aux.albedo.assign(n * 3, 0.0f);
+        aux.normal.assign(n * 3, 0.0f);
+        aux.depth.assign(n, -1.0f);
+        aux.stochastic.assign(n, 0);
+    }
+
+    // 0ãcomplete Ϊfalse;ֹͣʱ¼֮Ҫʱ renderAux 
+    void finishAuxRecording(bool complete) {
+        if (auxRecording && complete) auxValid = true;
+        auxRecording = false;
+    }
+
+    // 0ɫ (x, y) ãseeded Ϊɫǰ״̬״̬ı伴˵ȡɫ
+    //  renderAux жͬǷȡֻȡ·ϵĲԣģ޹أ
+    void recordAux(int x, int y, const Ray& ray, const HitRecord& hit, bool found, uint64_t seeded) {
+        if (!auxRecording) return;
+        size_t p = static_cast<size_t>(y) * imageWidth + x;
+        aux.stochastic[p] = pixelRng.state != seeded;
+        Vector3 albedo, normal;
+        auxFeaturesFrom(ray, hit, found, albedo, normal, aux.depth[p]);
+        aux.albedo[p * 3] = albedo.x; aux.albedo[p * 3 + 1] = albedo.y; aux.albedo[p * 3 + 2] = albedo.z;
+        aux.normal[p * 3] = normal.x; aux.normal[p * 3 + 1] = normal.y; aux.normal[p * 3 + 2] = normal.z;
+    }
+
+    // ɸ壨ûоص0Ļ棺ӦֲʽGPUˣصߣ0飬޶
+    // ⰴ0׷1ģ䲻ѣ״̬ûиı伴˵Ƿ񺬲ɫ
+    void renderAux() {
+        size_t n = static_cast<size_t>(imageWidth) * imageHeight;
+        aux.albedo.assign(n * 3, 0.0f);
+        aux.normal.assign(n * 3, 0.0f);
+        aux.depth.assign(n, -1.0f);
+        aux.stochastic.assign(n, 0);
+        int savedGlossySamples = glossySamples;
+        glossySamples = 1;
+        CameraBasis cam = makeCameraBasis();
+        std::vector<Tile> tiles = makeTiles(imageWidth, imageHeight, TILE_SIZE);
+        renderPool().run(tiles, [&](const Tile& tile, int) {
+            for (int y = tile.y0; y < tile.y1; ++y) {
+                for (int x = tile.x0; x < tile.x1; ++x) {
+                    size_t p = static_cast<size_t>(y) * imageWidth + x;
+                    Vector3 albedo, normal;
+                    auxFeatures(primaryRay(x, y, cam), albedo, normal, aux.depth[p]);
+                    aux.albedo[p * 3] = albedo.x; aux.albedo[p * 3 + 1] = albedo.y; aux.albedo[p * 3 + 2] = albedo.z;
+                    aux.normal[p * 3] = normal.x; aux.normal[p * 3 + 1] = normal.y; aux.normal[p * 3 + 2] = normal.z;
+                    beginPixelRng(hashPixelSeed(passSeed(0), x, y));
+                    uint64_t seeded = pixelRng.state;
+                    trace(primaryRay(x, y, cam));
+                    aux.stochastic[p] = pixelRng.state != seeded;
+                }
+            }
+        });
+        glossySamples = savedGlossySamples;
+        auxValid = true;
+    }
+
+    // ֡룺ɸ壬ʺ -trous ˲д hdrBuffer֮ɵ÷º
+    void denoiseFrame() {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!auxValid) renderAux();
+        size_t n = static_cast<size_t>(imageWidth) * imageHeight;
+        std::vector<float> illumination(n * 3), temp(n * 3), variance(n), tempVariance(n);
+        for (size_t i = 0; i < n * 3; ++i) illumination[i] = hdrBuffer[i] / std::max(aux.albedo[i], DENOISE_MIN_ALBEDO);
+        std::vector<Tile> tiles = makeTiles(imageWidth, imageHeight, TILE_SIZE);
+        renderPool().run(tiles, [&](const Tile& tile, int) {
+            denoiseVarianceRegion(illumination.data(), variance.data(), aux, imageWidth, imageHeight, tile.x0, tile.y0, tile.x1, tile.y1);
+        });
+        float* src = illumination.data();
+        float* dst = temp.data();
+        float* srcVariance = variance.data();
+        float* dstVariance = tempVariance.data();
+        for (int level = 0; level < DENOISE_LEVELS; ++level) {
+            renderPool().run(tiles, [&](const Tile& tile, int) {
+                atrousRegion(src, srcVariance, dst, dstVariance, aux, imageWidth, imageHeight, 1 << level, tile.x0, tile.y0, tile.x1, tile.y1);
+            });
+            std::swap(src, dst);
+            std::swap(srcVariance, dstVariance);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (aux.depth[i] < 0) continue;  // ԭֵ
+            for (int c = 0; c < 3; ++c) hdrBuffer[i * 3 + c] = src[i * 3 + c] * std::max(aux.albedo[i * 3 + c], DENOISE_MIN_ALBEDO);
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+        std::cout << ": " << DENOISE_LEVELS << "  -trous, " << ms.count() << " " << std::endl;
+    }
+
+    // ׷ٵصһ߳߳·ã֤λһ£
+    Vector3 tracePixel(int x, int y, const CameraBasis& cam, int pass) {
+        beginPixelRng(hashPixelSeed(passSeed(pass), x, y));  // ÿض֣˳޹
+        uint64_t seeded = pixelRng.state;
+        float jx, jy;
+        pixelJitter(pass, x, y, jx, jy);
+        STAT_ADD(primaryRays, 1);
+        uint64_t cost0 = STAT_COST();
+        Ray ray = primaryRay(x, y, cam, jx, jy);
+        HitRecord hit;
+        bool found = intersect(ray, 100000.0f, hit);  //  trace() ͬԱ¼߽
+        if (pass == 0) recordPrimaryHit(x, y, ray, hit, found);
+        Vector3 color = found ? shade(ray, hit, 0, true) : bgColor;  // ɫ޽Ϊ
+        addPixelCost(x, y, STAT_COST() - cost0);
+        if (pass == 0) recordAux(x, y, ray, hit, found, seeded);
+        return color;
+    }
+
+    // ---- ߻棺뼸岻ʱֻ޸˹Դʣ0ֱӸϴμ¼߽㣬
+    // ֻ¼ɫμߡ0ûжȾ뽥ʽȾĵ0鹲ͬһݻ ----
+    struct PrimaryHit {
+        Vector3 direction;   // ߷ѹһΪλã
+        HitRecord hit;       // 㣺е뷨 surfaceAt  t ͼԪؽʱͼԪ
+        bool found = false;  // ǷУΪ
+    };
+    bool cachePrimaryHits = false;      // Ƿά棨ģʽ޽ģʽֻȾһΣҪ
+    std::vector<PrimaryHit> primaryCache;  // ÿһд
+    bool primaryCacheRecording = false;    // ε0д뻺
+    bool primaryCacheReuse = false;        // ε0ӻɫ
+    bool primaryCacheValid = false;        // ҶӦ¼뼸
+    Vector3 cachedCameraPos, cachedLookAt;
+    float cachedFov = 0;
+    int cachedWidth = 0, cachedHeight = 0, cachedGeometry = -1;
+
+    bool primaryCacheMatches() const {
+        return primaryCacheValid && cachedWidth == imageWidth && cachedHeight == imageHeight && cachedGeometry == geometryVersion
+            && cachedFov == fov && cachedCameraPos.x == cameraPos.x && cachedCameraPos.y == cameraPos.y && cachedCameraPos.z == cameraPos.z
+            && cachedLookAt.x == lookAt.x && cachedLookAt.y == lookAt.y && cachedLookAt.z == lookAt.z;
+    }
+
+    // 0鿪ʼǰãʱûȾ߳УЧʱ鸴ã򱾱¼¼
+    void beginPrimaryCache() {
+        primaryCacheReuse = primaryCacheRecording = false;
+        if (!cachePrimaryHits) return;
+        if (primaryCacheMatches()) {
+            primaryCacheReuse = true;
+            return;
+        }
+        primaryCacheValid = false;
+        primaryCache.assign(static_cast<size_t>(imageWidth) * imageHeight, PrimaryHit());
+        primaryCacheRecording = true;
+    }
+
+    // 0ãcomplete Ϊfalse;ֹͣʱ¼汣Ч
+    void finishPrimaryCache(bool complete) {
+        if (primaryCacheReuse) std::cout << "߻: ãֻɫ" << std::endl;
+        if (primaryCacheRecording && complete) {
+            primaryCacheValid = true;
+            cachedCameraPos = cameraPos; cachedLookAt = lookAt; cachedFov = fov;
+            cachedWidth = imageWidth; cachedHeight = imageHeight; cachedGeometry = geometryVersion;
+        }
+        primaryCacheReuse = primaryCacheRecording = false;
+    }
+
+    // ¼0߽㣨ÿֻһ߳д
+    void recordPrimaryHit(int x, int y, const Ray& ray, const HitRecord& hit, bool found) {
+        if (!primaryCacheRecording) return;
+        PrimaryHit& entry = primaryCache[static_cast<size_t>(y) * imageWidth + x];
+        entry.direction = ray.direction;
+        entry.hit = hit;
+        entry.found = found;
+    }
+
+    // ӻɫ0 (x, y)󽻣׷λһ
+    Vector3 shadeCachedPixel(int x, int y) {
+        beginPixelRng(hashPixelSeed(passSeed(0), x, y));
+        uint64_t seeded = pixelRng.state;
+        const PrimaryHit& entry = primaryCache[static_cast<size_t>(y) * imageWidth + x];
+        Ray ray = Ray::withUnitDirection(cameraPos, entry.direction);
+        Vector3 color = bgColor;
+        if (entry.found) {
+            uint64_t cost0 = STAT_COST();
+            color = shade(ray, entry.hit, 0, true);
+            addPixelCost(x, y, STAT_COST() - cost0);
+        }
+        recordAux(x, y, ray, entry.hit, entry.found, seeded);
+        return color;
+    }
+
+    // ߰׷2x2أ߰һBVHٰѷеӰɵڶ
+    // ֮ɫ/ȴμ߲ɣ׷٣out  (0,0) (1,0) (0,1) (1,1) 
+    void traceQuad(int x0, int y0, const CameraBasis& cam, int pass, Vector3 out[PACKET_SIZE]) {
+        float dx[PACKET_SIZE], dy[PACKET_SIZE], dz[PACKET_SIZE];  // 4ߵķһһ
+        for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+            int x = x0 + (lane & 1), y = y0 + (lane >> 1);
+            float jx, jy;
+            pixelJitter(pass, x, y, jx, jy);
+            Vector3 d = primaryDirection(x, y, cam, jx, jy);
+            dx[lane] = d.x; dy[lane] = d.y; dz[lane] = d.z;
+        }
+        normalizeSpan(dx, dy, dz, PACKET_SIZE);
+        normalizeSpan(dx, dy, dz, PACKET_SIZE);  // Ӧ primaryRay  Ray 캯ĵڶιһ
+        Ray rays[PACKET_SIZE] = { Ray::withUnitDirection(cameraPos, Vector3(dx[0], dy[0], dz[0])), Ray::withUnitDirection(cameraPos, Vector3(dx[1], dy[1], dz[1])),
+                                  Ray::withUnitDirection(cameraPos, Vector3(dx[2], dy[2], dz[2])), Ray::withUnitDirection(cameraPos, Vector3(dx[3], dy[3], dz[3])) };
+        const Ray* rayPtrs[PACKET_SIZE] = { &rays[0], &rays[1], &rays[2], &rays[3] };
+        float tMax[PACKET_SIZE] = { 100000.0f, 100000.0f, 100000.0f, 100000.0f };
+        HitRecord hits[PACKET_SIZE];
+        STAT_ADD(primaryRays, PACKET_SIZE);
+        uint64_t cost0 = STAT_COST();
+        int hitMask = intersectPacket(rayPtrs, tMax, 0xF, hits);
+        if (pass == 0) {
+            for (int lane = 0; lane < PACKET_SIZE; ++lane) recordPrimaryHit(x0 + (lane & 1), y0 + (lane >> 1), rays[lane], hits[lane], (hitMask >> lane) & 1);
+        }
+
+        // Ӱ߰ʲӰ⣩
+        Ray shadowRays[PACKET_SIZE] = { rays[0], rays[1], rays[2], rays[3] };
+        const Ray* shadowPtrs[PACKET_SIZE] = { &shadowRays[0], &shadowRays[1], &shadowRays[2], &shadowRays[3] };
+        float shadowMaxT[PACKET_SIZE] = { 0, 0, 0, 0 };
+        int shadowMask = 0;
+        Vector3 woodPoints[PACKET_SIZE], woodNormals[PACKET_SIZE];  // ѡSIMDľƵĻе㣬ֵ
+        int woodLanes[PACKET_SIZE], woodCount = 0;
+        for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+            if (!(hitMask & (1 << lane))) continue;
+            const Material& mat = materials[hits[lane].materialID];
+            if (mat.isRefractive) continue;
+            Vector3 hitPoint, hitNormal;
+            surfaceAt(rays[lane], hits[lane], hitPoint, hitNormal);
+            shadowRays[lane] = shadowRayAt(hitPoint, hitNormal, shadowMaxT[lane]);
+            shadowMask |= 1 << lane;
+            if (mat.texture == TEX_WOOD_GRAIN && mat.textureEval == TEX_EVAL_SIMD) {
+                woodPoints[woodCount] = hitPoint;
+                woodNormals[woodCount] = hitNormal;
+                woodLanes[woodCount++] = lane;
+            }
+        }
+        STAT_ADD(shadowRays, popcount4(shadowMask));
+        int occludedMask = occludedPacket(shadowPtrs, shadowMaxT, shadowMask);
+        uint64_t packetCost = STAT_COST() - cost0;  // ߰Ĵƽָ4
+        Vector3 woodColors[PACKET_SIZE];
+        const Vector3* albedo[PACKET_SIZE] = { nullptr, nullptr, nullptr, nullptr };
+        if (woodCount > 0) {
+            getWoodTextureColors(woodPoints, woodNormals, woodCount, woodColors);
+            for (int i = 0; i < woodCount; ++i) albedo[woodLanes[i]] = &woodColors[i];
+        }
+
+        for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+            int x = x0 + (lane & 1), y = y0 + (lane >> 1);
+            beginPixelRng(hashPixelSeed(passSeed(pass), x, y));
+            uint64_t seeded = pixelRng.state;
+            out[lane] = bgColor;  // ޽㣬ر
+            uint64_t laneCost0 = STAT_COST();
+            if (hitMask & (1 << lane)) {
+                int knownShadow = (shadowMask & (1 << lane)) ? ((occludedMask >> lane) & 1) : -1;
+                out[lane] = shade(rays[lane], hits[lane], 0, true, knownShadow, albedo[lane]);
+            }
+            addPixelCost(x, y, STAT_COST() - laneCost0 + packetCost / PACKET_SIZE);
+            if (pass == 0) recordAux(x, y, rays[lane], hits[lane], (hitMask >> lane) & 1, seeded);
+        }
+    }
+
+    // ׷پ [x0, x1) x [y0, y1) һsink(x, y, color) ս
+    // ù߰ʱ2x2Եʣ
+    template <class Sink>
+    void renderBlock(int x0, int y0, int x1, int y1, const CameraBasis& cam, int pass, Sink&& sink) {
+        if (pass == 0 && primaryCacheReuse) {  // ߽ѻ棺ɫ߰
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x) sink(x, y, shadeCachedPixel(x, y));
+            return;
+        }
+        int y = y0;
+        if (usePackets) {
+            for (; y + 1 < y1; y += 2) {
+                int x = x0;
+                for (; x + 1 < x1; x += 2) {
+                    Vector3 quad[PACKET_SIZE];
+                    traceQuad(x, y, cam, pass, quad);
+                    for (int lane = 0; lane < PACKET_SIZE; ++lane) sink(x + (lane & 1), y + (lane >> 1), quad[lane]);
+                }
+                for (; x < x1; ++x) {
+                    sink(x, y, tracePixel(x, y, cam, pass));
+                    sink(x, y + 1, tracePixel(x, y + 1, cam, pass));
+                }
+            }
+        }
+        for (; y < y1; ++y)
+            for (int x = x0; x < x1; ++x)
+                sink(x, y, tracePixel(x, y, cam, pass));
+    }
+
+    std::unique_ptr<WorkStealingPool> pool;  // Ⱦ̳߳أ贴߳仯ʱؽ
+
+    WorkStealingPool& renderPool() {
+        if (!pool || pool->size() != renderThreads) {
+            pool.reset();
+            pool.reset(new WorkStealingPool(renderThreads));
+        }
+        return *pool;
+    }
+
+    // ߳Ⱦѻгɷֿ飬ȡ̳߳
+    void renderTiled(const CameraBasis& cam) {
+        std::vector<Tile> tiles = makeTiles(imageWidth, imageHeight, TILE_SIZE);
+        std::atomic<int> tilesDone{ 0 };
+        std::mutex printMutex;
+        int total = static_cast<int>(tiles.size());
+        renderPool().run(tiles, [&](const Tile& tile, int) {
+            renderBlock(tile.x0, tile.y0, tile.x1, tile.y1, cam, 0, [this](int x, int y, const Vector3& c) { writePixel(x, y, c); });
+            int done = ++tilesDone;
+            if (done * 10 / total != (done - 1) * 10 / total) {  // ÿ10%һ
+                std::lock_guard<std::mutex> lock(printMutex);
+                std::cout << ": " << (done * 100 / total) << "%\n";  // ˢ£̣߳
+            }
+        });
+    }
+
+    // Ⱦͼеһ򲢰ɫд outУÿRGBд֡壩ֲʽȾĹڵʹá
+    // passes Ϊ1ʱ render() ͬģѣ1ʱ renderProgressive ͬذ˳ۼƺ 1/passes
+    // ߽Ϊżʱ߰֡Ⱦͬλһ
+    void renderRegion(const Tile& region, int passes, float* out) {
+        glossySamples = passes > 1 ? 1 : glossySplitSamples;
+        CameraBasis cam = makeCameraBasis();
+        int width = region.x1 - region.x0;
+        std::fill(out, out + static_cast<size_t>(width) * (region.y1 - region.y0) * 3, 0.0f);
+        std::vector<Tile> tiles = makeTiles(width, region.y1 - region.y0, TILE_SIZE);
+        renderPool().run(tiles, [&](const Tile& local, int) {
+            Tile tile = { region.x0 + local.x0, region.y0 + local.y0, region.x0 + local.x1, region.y0 + local.y1 };
+            for (int pass = 0; pass < passes; ++pass) {
+                renderBlock(tile.x0, tile.y0, tile.x1, tile.y1, cam, pass, [&](int x, int y, const Vector3& c) {
+                    float* acc = &out[((y - region.y0) * width + x - region.x0) * 3];
+                    acc[0] += c.x; acc[1] += c.y; acc[2] += c.z;
+                });
+            }
+            if (passes > 1) {
+                float invCount = 1.0f / passes;
+                for (int y = tile.y0; y < tile.y1; ++y) {
+                    float* row = &out[((y - region.y0) * width + tile.x0 - region.x0) * 3];
+                    for (int i = 0; i < (tile.x1 - tile.x0) * 3; ++i) row[i] *= invCount;
+                }
+            }
+        });
+    }
+
+    // Ⱦʽ֡
+    void render() {
+        stopProgressive();  // 뽥ʽȾ
+        glossySamples = glossySplitSamples;
+        resetStats();
+        auto start = std::chrono::high_resolution_clock::now();  // ʼʱ
+        CameraBasis cam = makeCameraBasis();
+        if (adaptiveBudget <= 0) beginPrimaryCache();  // Ӧжʹ߻
+        if (adaptiveBudget <= 0) beginAuxRecording();  // ֻͬͨĵ0¼
+        else auxValid = false;
+
+        if (adaptiveBudget > 0) {
+            renderAdaptive(cam);
+        }
+        else if (renderThreads > 1) {
+            renderTiled(cam);
+        }
+        else {
+            // ߳·Ⱦ߰ģʽÿУ
+            int rowStep = usePackets ? 2 : 1;
+            for (int y = 0; y < imageHeight; y += rowStep) {
+                int yEnd = std::min(y + rowStep, imageHeight);
+                renderBlock(0, y, imageWidth, yEnd, cam, 0, [this](int px, int py, const Vector3& c) { writePixel(px, py, c); });
+                if (yEnd * 10 / imageHeight != y * 10 / imageHeight) std::cout << ": " << (yEnd * 100 / imageHeight) << "%\n";  // ÿ10%һ
+            }
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();  // ʱ
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Ⱦ! ʱ: " << duration.count() / 1000.0f << " 루" << renderThreads << " ̣߳" << std::endl;  // ʱ
+        printStats(duration.count() / 1000.0);
+        finishPrimaryCache(true);
+        finishAuxRecording(true);
+
+        if (denoiseOutput) denoiseFrame();  // ͳ֮󣺸Ĺ߲뱾֡ͳ
+        postProcessFrame();
+        markAllDirty();
+    }
+
+    // ---- Ⱦͳƣ RayStatsÿشͼ -DRT_STATS ۼƣ--heatmap  ----
+    std::vector<float> costBuffer;  // ÿۼƴۣڵ + ͼԪԣͬһͬһʱֻһ߳д
+
+    void addPixelCost(int x, int y, uint64_t cost) {
+#ifdef RT_STATS
+        costBuffer[y * imageWidth + x] += static_cast<float>(cost);
+#else
+        (void)x; (void)y; (void)cost;
+#endif
+    }
+
+    // ÿ֡ʼʱ㣨ʱûȾ߳У
+    void resetStats() {
+#ifdef RT_STATS
+        std::lock_guard<std::mutex> lock(rayStatsMutex);
+        for (auto& st : rayStatsList) *st = RayStats();
+        costBuffer.assign(imageWidth * imageHeight, 0.0f);
+#endif
+    }
+
+    // ̵߳ļseconds Ϊ֡ǽʱ
+    void printStats(double seconds) const {
+#ifdef RT_STATS
+        std::lock_guard<std::mutex> lock(rayStatsMutex);
+        RayStats total;
+        for (const auto& st : rayStatsList) {
+            total.primaryRays += st->primaryRays;
+            total.shadowRays += st->shadowRays;
+            total.reflectionRays += st->reflectionRays;
+            total.refractionRays += st->refractionRays;
+            total.glossyRays += st->glossyRays;
+            total.nodeTests += st->nodeTests;
+            total.primTests += st->primTests;
+            total.maxDepth = std::max(total.maxDepth, st->maxDepth);
+        }
+        uint64_t rays = std::max<uint64_t>(total.rays(), 1);
+        std::cout << "ͳ:  " << total.primaryRays << ", Ӱ " << total.shadowRays << ",  " << total.reflectionRays
+            << ",  " << total.refractionRays << ", ģ " << total.glossyRays << "\n"
+            << "  ÿ: ڵ " << total.nodeTests / double(rays) << ", ͼԪ " << total.primTests / double(rays)
+            << ";  " << total.maxDepth << "; ܼ " << total.rays() / std::max(seconds, 1e-6) / 1e6 << " Mrays/s\n";
+        int index = 0;
+        for (const auto& st : rayStatsList) {
+            if (st->rays() == 0) continue;
+            std::cout << "  ߳ " << index++ << ": " << st->rays() / std::max(seconds, 1e-6) / 1e6 << " Mrays/s\n";
+        }
+        std::cout << std::flush;
+#else
+        (void)seconds;
+#endif
+    }
+
+    // ߳ϴ resetStats() ׷ٵĹδ RT_STATS ʱΪ0
+    uint64_t countedRays() const {
+        uint64_t rays = 0;
+#ifdef RT_STATS
+        std::lock_guard<std::mutex> lock(rayStatsMutex);
+        for (const auto& st : rayStatsList) rays += st->rays();
+#endif
+        return rays;
+    }
+
+    // ȶͼ̶ӳ䵽 ---- αɫдʽͬ writeImage
+    bool writeHeatmap(const std::string& path) const {
+#ifdef RT_STATS
+        if (costBuffer.size() != static_cast<size_t>(imageWidth * imageHeight)) return false;
+        float maxLog = 0.0f;
+        for (float c : costBuffer) maxLog = std::max(maxLog, std::log1p(c));
+        float invMax = maxLog > 0.0f ? 1.0f / maxLog : 0.0f;
+        std::vector<unsigned char> rgb(costBuffer.size() * 3);
+        std::vector<float> linear(costBuffer.size() * 3);
+        for (size_t i = 0; i < costBuffer.size(); ++i) {
+            float t = std::log1p(costBuffer[i]) * invMax;  // 0..1
+            // ֶɫ0  -> 0.25  -> 0.5  -> 0.75  -> 1 
+            static const float ramp[5][3] = { {0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 1, 0}, {1, 1, 1} };
+            float f = t * 4.0f;
+            int k = std::min(3, static_cast<int>(f));
+            float w = f - k;
+            for (int c = 0; c < 3; ++c) {
+                float v = ramp[k][c] * (1.0f - w) + ramp[k + 1][c] * w;
+                rgb[i * 3 + c] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+                linear[i * 3 + c] = costBuffer[i];  // ʽԭʼۣڶ
+            }
+        }
+        return writeImage(path, imageWidth, imageHeight, rgb.data(), linear.data());
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    // ---- Ӧÿȡ AA_BASE_SAMPLES ֲٰʣԤָ ----
+
+    // ͳƣɫͣԼʾռȵĺ/ƽͣƾֵķ
+    struct PixelStats {
+        Vector3 sum = Vector3(0, 0, 0);
+        float lumSum = 0.0f, lumSq = 0.0f;
+        int count = 0;
+        void add(const Vector3& c) {
+            sum = sum + c;
+            float lum = 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+            float display = std::pow(std::max(0.0f, std::min(lum, 1.0f)), 0.454f);  //  writePixel ͬ٤
+            lumSum += display;
+            lumSq += display * display;
+            ++count;
+        }
+        // ֵı׼sqrt( / )
+        float error() const {
+            if (count < 2) return 1e30f;
+            float mean = lumSum / count;
+            float var = std::max(0.0f, (lumSq - lumSum * mean) / (count - 1));
+            return std::sqrt(var / count);
+        }
+    };
+
+    //  k ƫƣǰ AA_BASE_SAMPLES ռ2x2ֲеһ֮ھ
+    static void adaptiveJitter(int k, int x, int y, float& jx, float& jy) {
+        unsigned int h = hashPixelSeed(passSeed(k) ^ 0xA511E9B3u, x, y);
+        float rx = (h & 0xFFFF) * (1.0f / 65536.0f), ry = (h >> 16) * (1.0f / 65536.0f);
+        if (k < AA_BASE_SAMPLES) {
+            jx = ((k & 1) + rx) * 0.5f;
+            jy = ((k >> 1) + ry) * 0.5f;
+        }
+        else {
+            jx = rx;
+            jy = ry;
+        }
+    }
+
+    //  (x, y) ׷ӵ [first, first+n) ÿ (, , x, y) ֣˳޹
+    void addPixelSamples(PixelStats& stats, int x, int y, const CameraBasis& cam, int first, int n) {
+        for (int k = first; k < first + n; ++k) {
+            beginPixelRng(hashPixelSeed(passSeed(k), x, y));
+            float jx, jy;
+            adaptiveJitter(k, x, y, jx, jy);
+            STAT_ADD(primaryRays, 1);
+            uint64_t cost0 = STAT_COST();
+            stats.add(trace(primaryRay(x, y, cam, jx, jy)));
+            addPixelCost(x, y, STAT_COST() - cost0);
+        }
+    }
+
+    // ӦȾÿ߳ѡֵأȣӱֱȫ
+    // ﵽ޻֡Ԥ adaptiveBudget * ѡֻͳ߳޹
+    void renderAdaptive(const CameraBasis& cam) {
+        glossySamples = 1;  // ģͬٹ̶16
+        int pixelCount = imageWidth * imageHeight;
+        std::vector<PixelStats> stats(pixelCount);
+        std::vector<Tile> tiles = makeTiles(imageWidth, imageHeight, TILE_SIZE);
+        int tilesX = (imageWidth + TILE_SIZE - 1) / TILE_SIZE;
+        long long budget = static_cast<long long>(std::max(adaptiveBudget, AA_BASE_SAMPLES)) * pixelCount;
+
+        renderPool().run(tiles, [&](const Tile& tile, int) {
+            for (int y = tile.y0; y < tile.y1; ++y)
+                for (int x = tile.x0; x < tile.x1; ++x)
+                    addPixelSamples(stats[y * imageWidth + x], x, y, cam, 0, AA_BASE_SAMPLES);
+        });
+        long long used = static_cast<long long>(AA_BASE_SAMPLES) * pixelCount;
+
+        std::vector<std::pair<float, int>> candidates;  // (, ±)
+        std::vector<std::vector<int>> tilePixels(tiles.size());
+        std::vector<int> extra(pixelCount, 0);
+        std::vector<float> errors(pixelCount);
+        int rounds = 0;
+        while (used < budget) {
+            // ͼ3x3ֵţǡȫͬأ͹һ
+            for (int i = 0; i < pixelCount; ++i) errors[i] = stats[i].error();
+            candidates.clear();
+            for (int y = 0; y < imageHeight; ++y) {
+                for (int x = 0; x < imageWidth; ++x) {
+                    int i = y * imageWidth + x;
+                    if (stats[i].count >= AA_MAX_SAMPLES) continue;
+                    float err = errors[i];
+                    for (int ny = std::max(0, y - 1); ny <= std::min(imageHeight - 1, y + 1); ++ny)
+                        for (int nx = std::max(0, x - 1); nx <= std::min(imageWidth - 1, x + 1); ++nx)
+                            err = std::max(err, errors[ny * imageWidth + nx]);
+                    if (err > adaptiveThreshold) candidates.push_back({ err, i });
+                }
+            }
+            if (candidates.empty()) break;
+            std::sort(candidates.begin(), candidates.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+                return a.first != b.first ? a.first > b.first : a.second < b.second;
+            });
+            for (auto& list : tilePixels) list.clear();
+            for (const auto& c : candidates) {
+                if (used >= budget) break;
+                int i = c.second;
+                int n = static_cast<int>(std::min<long long>(std::min(stats[i].count, AA_MAX_SAMPLES - stats[i].count), budget - used));
+                extra[i] = n;
+                used += n;
+                int x = i % imageWidth, y = i / imageWidth;
+                tilePixels[(y / TILE_SIZE) * tilesX + x / TILE_SIZE].push_back(i);
+            }
+            renderPool().run(tiles, [&](const Tile& tile, int) {
+                for (int i : tilePixels[&tile - tiles.data()])
+                    addPixelSamples(stats[i], i % imageWidth, i / imageWidth, cam, stats[i].count, extra[i]);
+            });
+            ++rounds;
+            std::cout << "Ӧ " << rounds << " : " << candidates.size() << " δ, ۼ "
+                << used / float(pixelCount) << " /" << std::endl;
+        }
+
+        int maxCount = 0;
+        for (int i = 0; i < pixelCount; ++i) {
+            writePixel(i % imageWidth, i / imageWidth, stats[i].sum * (1.0f / stats[i].count));
+            maxCount = std::max(maxCount, stats[i].count);
+        }
+        std::cout << "Ӧ:  " << used << "ƽ " << used / float(pixelCount) << " "
+            << maxCount << "" << std::endl;
+    }
+
+    // ---- ʽȾ̨߳ۼƣÿÿ1ʾ߳ʱϴǰƽֵ ----
+    std::vector<float> accumBuffer;               // ɫۼƺͣÿRGB
+    std::thread progressiveThread;                // ̨Ⱦ߳
+    std::atomic<bool> progressiveStop{ false };   // ֹͣ
+    std::atomic<int> progressivePasses{ 0 };      // ɵı
+    std::mutex framebufferMutex;                  //  framebuffer߳дطֿ飬display() ϴ
+    std::atomic<bool> framebufferDirty{ false };  // شϴ
+    std::vector<unsigned char> dirtyTiles;        // ÿ TILE_SIZE ֿһǣд֡塢δϴ framebufferMutex 
+
+    int tilesPerRow() const { return (imageWidth + TILE_SIZE - 1) / TILE_SIZE; }
+
+    // Ƿֿϴ÷ framebufferMutexʾ̲߳ͬʱУ
+    void markTileDirty(const Tile& tile) {
+        size_t count = static_cast<size_t>(tilesPerRow()) * ((imageHeight + TILE_SIZE - 1) / TILE_SIZE);
+        if (dirtyTiles.size() != count) dirtyTiles.assign(count, 1);
+        dirtyTiles[(tile.y0 / TILE_SIZE) * tilesPerRow() + tile.x0 / TILE_SIZE] = 1;
+        framebufferDirty = true;
+    }
+
+    // ֡ϴȾ
+    void markAllDirty() {
+        dirtyTiles.assign(static_cast<size_t>(tilesPerRow()) * ((imageHeight + TILE_SIZE - 1) / TILE_SIZE), 1);
+        framebufferDirty = true;
+    }
+
+    // ʼ¿ʼʽȾ maxPasses 飻
+    void startProgressive(int maxPasses) {
+        resetProgressive();
+        progressiveThread = std::thread(&Scene::progressiveLoop, this, maxPasses);
+    }
+
+    // ڵǰ߳ͬۼ maxPasses 飨޽ģʽʹãʱ֡弴Ϊƽֵ
+    void renderProgressive(int maxPasses) {
+        resetProgressive();
+        progressiveLoop(maxPasses);
+    }
+
+    // ֹͣڽеĽʽȾۼƻ
+    void resetProgressive() {
+        stopProgressive();
+        accumBuffer.assign(imageWidth * imageHeight * 3, 0.0f);
+        progressivePasses = 0;
+        progressiveStop = false;
+    }
+
+    // ֹͣʽȾȴ̨߳˳ɵķֿ鱣֡У
+    void stopProgressive() {
+        progressiveStop = true;
+        if (progressiveThread.joinable()) progressiveThread.join();
+    }
+
+    void progressiveLoop(int maxPasses) {
+        resetStats();
+        auto start = std::chrono::high_resolution_clock::now();
+        glossySamples = 1;  // ÿÿֻȡ1ģɶۼ
+        CameraBasis cam = makeCameraBasis();
+        std::vector<Tile> tiles = makeTiles(imageWidth, imageHeight, TILE_SIZE);
+        std::atomic<bool> firstTile{ true };
+        beginPrimaryCache();
+        beginAuxRecording();
+        for (int pass = 0; pass < maxPasses && !progressiveStop; ++pass) {
+            float invCount = 1.0f / (pass + 1);
+            renderPool().run(tiles, [&](const Tile& tile, int) {
+                if (progressiveStop) return;  // ֹͣʣֿ
+                renderBlock(tile.x0, tile.y0, tile.x1, tile.y1, cam, pass, [this](int x, int y, const Vector3& c) {
+                    float* acc = &accumBuffer[(y * imageWidth + x) * 3];
+                    acc[0] += c.x; acc[1] += c.y; acc[2] += c.z;
+                });
+                // ֿɺƽֵд֡壺ÿֿ pass+1
+                {
+                    std::lock_guard<std::mutex> lock(framebufferMutex);
+                    for (int y = tile.y0; y < tile.y1; ++y) {
+                        for (int x = tile.x0; x < tile.x1; ++x) {
+                            const float* acc = &accumBuffer[(y * imageWidth + x) * 3];
+                            writePixel(x, y, Vector3(acc[0], acc[1], acc[2]) * invCount);
+                        }
+                    }
+                    postProcessRegion(tile.x0, tile.y0, tile.x1, tile.y1);
+                    markTileDirty(tile);
+                }
+                if (firstTile.exchange(false)) {
+                    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+                    std::cout << "׸ֿ: " << ms.count() << " " << std::endl;
+                }
+            });
+            if (pass == 0) finishPrimaryCache(!progressiveStop);  // ;ֹͣĵ0鲻Ϊ
+            if (pass == 0) finishAuxRecording(!progressiveStop);
+            if (progressiveStop) break;
+            progressivePasses = pass + 1;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+            std::cout << " " << pass + 1 << " , ۼʱ: " << ms.count() / 1000.0f << " " << std::endl;
+        }
+        std::cout << "ʽȾ: " << progressivePasses << " " << std::endl;
+        printStats(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        if (denoiseOutput && !progressiveStop) {  // ȫɺƽֵ루;ֹͣʱԭʼۼƽ
+            std::lock_guard<std::mutex> lock(framebufferMutex);  // ºҲ hdrBuffer
+            denoiseFrame();
+            postProcessFrame();
+            markAllDirty();
+        }
+    }
+};
+
+Scene* scene;  // ȫֳָ
+GLuint texture;  // OpenGLID
+
+// ----------------------------------------------------
+// ֡ʽϴֻһΣֻ֮ glTexSubImage2D ϴֿ顣
+// ֧ GL 4.4 / ARB_buffer_storage ʱʹ־ӳPBOframebuffer ֱָһӳڴ棬
+// ߳㿽д룻ÿϴ󽻻դ֤CPUдGPUδǸPBO
+// ֧ʱ˻Ϊͨڴֿ glTexSubImage2D
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+#ifndef GL_RGB8
+#define GL_RGB8 0x8051
+#endif
+
+typedef void (APIENTRY* PfnGenBuffers)(GLsizei, GLuint*);
+typedef void (APIENTRY* PfnBindBuffer)(GLenum, GLuint);
+typedef void (APIENTRY* PfnBufferStorage)(GLenum, std::ptrdiff_t, const void*, GLbitfield);
+typedef void* (APIENTRY* PfnMapBufferRange)(GLenum, std::ptrdiff_t, std::ptrdiff_t, GLbitfield);
+typedef void (APIENTRY* PfnTexStorage2D)(GLenum, GLsizei, GLenum, GLsizei, GLsizei);
+typedef void* (APIENTRY* PfnFenceSync)(GLenum, GLbitfield);
+typedef GLenum(APIENTRY* PfnClientWaitSync)(void*, GLbitfield, uint64_t);
+typedef void (APIENTRY* PfnDeleteSync)(void*);
+
+// ǰĵGL汾ǷΪ major.minorָ֧չ
+bool hasGLFeature(int major, int minor, const char* extension) {
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    int ma = 0, mi = 0;
+    if (version && std::sscanf(version, "%d.%d", &ma, &mi) == 2 && (ma > major || (ma == major && mi >= minor))) return true;
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    return extensions && std::strstr(extensions, extension) != nullptr;
+}
+
+struct FramebufferUpload {
+    bool streaming = false;   // Ƿʹó־ӳPBO
+    GLuint pbo[2] = { 0, 0 };
+    unsigned char* mapped[2] = { nullptr, nullptr };
+    void* fence[2] = { nullptr, nullptr };  // ÿPBOһϴդ
+    int current = 0;          // framebuffer ǰָPBO
+    PfnBindBuffer bindBuffer = nullptr;
+    PfnFenceSync fenceSync = nullptr;
+    PfnClientWaitSync clientWaitSync = nullptr;
+    PfnDeleteSync deleteSync = nullptr;
+
+    //  initGL()  initScene() ֮ã洢ʱ framebuffer ӳPBOڴ
+    void init() {
+        int w = imageWidth, h = imageHeight;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        PfnTexStorage2D texStorage2D = hasGLFeature(4, 2, "GL_ARB_texture_storage") ?
+            reinterpret_cast<PfnTexStorage2D>(glutGetProcAddress("glTexStorage2D")) : nullptr;
+        if (texStorage2D) texStorage2D(GL_TEXTURE_2D, 1, GL_RGB8, w, h);  // ɱ洢֮衢Ҳ·
+        else glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+
+        if (!hasGLFeature(4, 4, "GL_ARB_buffer_storage")) return;
+        PfnGenBuffers genBuffers = reinterpret_cast<PfnGenBuffers>(glutGetProcAddress("glGenBuffers"));
+        PfnBufferStorage bufferStorage = reinterpret_cast<PfnBufferStorage>(glutGetProcAddress("glBufferStorage"));
+        PfnMapBufferRange mapBufferRange = reinterpret_cast<PfnMapBufferRange>(glutGetProcAddress("glMapBufferRange"));
+        bindBuffer = reinterpret_cast<PfnBindBuffer>(glutGetProcAddress("glBindBuffer"));
+        fenceSync = reinterpret_cast<PfnFenceSync>(glutGetProcAddress("glFenceSync"));
+        clientWaitSync = reinterpret_cast<PfnClientWaitSync>(glutGetProcAddress("glClientWaitSync"));
+        deleteSync = reinterpret_cast<PfnDeleteSync>(glutGetProcAddress("glDeleteSync"));
+        if (!genBuffers || !bufferStorage || !mapBufferRange || !bindBuffer || !fenceSync || !clientWaitSync || !deleteSync) return;
+
+        std::ptrdiff_t size = static_cast<std::ptrdiff_t>(w) * h * 3;
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;  // һӳ䣺CPUдʽˢ
+        genBuffers(2, pbo);
+        for (int i = 0; i < 2; ++i) {
+            bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+            bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, framebuffer, flags);
+            mapped[i] = static_cast<unsigned char*>(mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+        }
+        bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!mapped[0] || !mapped[1]) return;
+        delete[] framebuffer;  // ֱ֮дӳڴ
+        framebuffer = mapped[0];
+        current = 0;
+        streaming = true;
+        std::cout << "֡ϴ: ־ӳ˫PBO" << std::endl;
+    }
+
+    // ϴֿ飨÷ framebufferMutex
+    void upload() {
+        std::vector<unsigned char>& dirty = scene->dirtyTiles;
+        int tilesX = scene->tilesPerRow();
+        if (std::find(dirty.begin(), dirty.end(), 1) == dirty.end()) return;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, imageWidth);  // ֿͼеӾ
+        if (streaming) bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[current]);
+        const unsigned char* base = streaming ? nullptr : framebuffer;  // PBOʱָΪƫ
+        for (size_t i = 0; i < dirty.size(); ++i) {
+            if (!dirty[i]) continue;
+            dirty[i] = 0;
+            int x0 = static_cast<int>(i % tilesX) * TILE_SIZE, y0 = static_cast<int>(i / tilesX) * TILE_SIZE;
+            int w = std::min(TILE_SIZE, imageWidth - x0), h = std::min(TILE_SIZE, imageHeight - y0);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, w, h, GL_RGB, GL_UNSIGNED_BYTE, base + (static_cast<std::ptrdiff_t>(y0) * imageWidth + x0) * 3);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        if (!streaming) return;
+        bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        fence[current] = fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // һPBO֮дصķֿȴһεϴȡɣͨɣ
+        int next = 1 - current;
+        if (fence[next]) {
+            clientWaitSync(fence[next], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            deleteSync(fence[next]);
+            fence[next] = nullptr;
+        }
+        current = next;
+        framebuffer = mapped[current];
+    }
+
+    // ˳ǰӳڴGLͷţ delete[]
+    void release() {
+        if (streaming) framebuffer = nullptr;
+    }
+};
+
+FramebufferUpload framebufferUpload;  // ʾ˵֡ϴ
+
+// OpenGLʼʾ޽ģʽã
+void initGL() {
+    glClearColor(0, 0, 0, 1);  // ɫ
+    glEnable(GL_TEXTURE_2D);   // 2D
+    glGenTextures(1, &texture);  // ID
+    glBindTexture(GL_TEXTURE_2D, texture);  // 
+    // ˣԲֵ
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // ȵRGBвһ4ֽڶ
+}
+
+// ----------------------------------------------------
+// GPUɫˣ--gpuа G лͬһ Scene BVHͼԪͲϴΪɫ洢壬
+// ɫÿÿ׷1CPUʽȾͬӡPCGСɫģͣ
+// ڸۼͼƽٰǰع/ɫӳ/٤д display() ʾRGBA8CPU
+// GLSLûеݹ飺trace/shade дΪʽջÿЯɫȨأɫӹԵģ
+// ˳ջģÿһ·ɺȡеʹ˳CPUݹһ¡
+// ľǰ򻯷ʽֵ決/SIMDֻCPUϵֵʽͼͬʵĳ֧֣CPUȾ
+// Ҫ OpenGL 4.3ɫSSBOͼдCPU·ǲοʵ֣ڸ㾫ȣsin/pow/sqrt ʵ֣ڡ
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_READ_WRITE
+#define GL_READ_WRITE 0x88BA
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+#ifndef GL_RGBA8
+#define GL_RGBA8 0x8058
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+
+typedef GLuint(APIENTRY* PfnCreateShader)(GLenum);
+typedef void (APIENTRY* PfnShaderSource)(GLuint, GLsizei, const char* const*, const GLint*);
+typedef void (APIENTRY* PfnCompileShader)(GLuint);
+typedef void (APIENTRY* PfnGetShaderiv)(GLuint, GLenum, GLint*);
+typedef void (APIENTRY* PfnGetShaderInfoLog)(GLuint, GLsizei, GLsizei*, char*);
+typedef void (APIENTRY* PfnDeleteShader)(GLuint);
+typedef GLuint(APIENTRY* PfnCreateProgram)();
+typedef void (APIENTRY* PfnAttachShader)(GLuint, GLuint);
+typedef void (APIENTRY* PfnLinkProgram)(GLuint);
+typedef void (APIENTRY* PfnGetProgramiv)(GLuint, GLenum, GLint*);
+typedef void (APIENTRY* PfnGetProgramInfoLog)(GLuint, GLsizei, GLsizei*, char*);
+typedef void (APIENTRY* PfnUseProgram)(GLuint);
+typedef GLint(APIENTRY* PfnGetUniformLocation)(GLuint, const char*);
+typedef void (APIENTRY* PfnUniform1i)(GLint, GLint);
+typedef void (APIENTRY* PfnUniform1ui)(GLint, GLuint);
+typedef void (APIENTRY* PfnUniform1f)(GLint, GLfloat);
+typedef void (APIENTRY* PfnUniform2i)(GLint, GLint, GLint);
+typedef void (APIENTRY* PfnUniform3f)(GLint, GLfloat, GLfloat, GLfloat);
+typedef void (APIENTRY* PfnBufferData)(GLenum, std::ptrdiff_t, const void*, GLenum);
+typedef void (APIENTRY* PfnBindBufferBase)(GLenum, GLuint, GLuint);
+typedef void (APIENTRY* PfnBindImageTexture)(GLuint, GLuint, GLint, GLboolean, GLint, GLenum, GLenum);
+typedef void (APIENTRY* PfnDispatchCompute)(GLuint, GLuint, GLuint);
+typedef void (APIENTRY* PfnMemoryBarrier)(GLbitfield);
+
+// ɫԴ밴θglShaderSource ַܶεݲ GpuTracer::upload һ
+const char* const GPU_SHADER_SOURCE[] = {
+    // ݣBVHڵ㣨lo.w/hi.w Ϊ leftFirst/count λģʽBVHҶ˳еͼԪʡPerlinû
+    R"GLSL(#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+struct Node { vec4 lo; vec4 hi; };
+struct Prim { vec4 a; vec4 b; vec4 n; ivec4 info; };
+struct Mat { vec4 color; vec4 k; vec4 p; ivec4 f; };
+layout(std430, binding = 0) readonly buffer Nodes { Node nodes[]; };
+layout(std430, binding = 1) readonly buffer Prims { Prim prims[]; };
+layout(std430, binding = 2) readonly buffer Mats { Mat mats[]; };
+layout(std430, binding = 3) readonly buffer Perm { int perm[]; };
+layout(rgba32f, binding = 0) uniform image2D accumImage;
+layout(rgba8, binding = 1) uniform writeonly image2D outputImage;
+uniform ivec2 uImageSize;
+uniform int uRowOffset, uNodeCount, uPass, uTrace, uGlossySamples, uGlossyPolicy, uToneMap, uDither;
+uniform uint uSeed;
+uniform vec3 uLightPos, uLightColor, uBgColor, uCameraPos, uForward, uRight, uUp;
+uniform float uTanHalfFov, uAspect, uExposure;
+const int PRIM_SPHERE = 0, PRIM_BOX = 1;
+const int GLOSSY_SPLIT_ALWAYS = 0, GLOSSY_ROULETTE = 2;
+const int TEX_WOOD_GRAIN = 1, TEX_FLOOR_PLANKS = 2;
+)GLSL",
+    // CPUͬӹϣ PCG-XSH-RR64λ״̬ (32λ, 32λ) uintʾ
+    R"GLSL(
+uvec2 rngState, rngInc;
+uvec2 add64(uvec2 a, uvec2 b) { uint carry; uint lo = uaddCarry(a.x, b.x, carry); return uvec2(lo, a.y + b.y + carry); }
+uvec2 mul64(uvec2 a, uvec2 b) { uint hi, lo; umulExtended(a.x, b.x, hi, lo); return uvec2(lo, hi + a.x * b.y + a.y * b.x); }
+uint pcgNext() {
+    uvec2 old = rngState;
+    rngState = add64(mul64(old, uvec2(0x4C957F2Du, 0x5851F42Du)), rngInc);
+    uvec2 x = uvec2(old.x ^ ((old.x >> 18) | (old.y << 14)), old.y ^ (old.y >> 18));
+    uint xorshifted = (x.x >> 27) | (x.y << 5);
+    uint rot = old.y >> 27;
+    return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+}
+void beginPixelRng(uint seed) {
+    rngState = uvec2(0u);
+    rngInc = uvec2((uSeed << 1) | 1u, uSeed >> 31);
+    pcgNext();
+    rngState = add64(rngState, uvec2(seed, 0u));
+    pcgNext();
+}
+float randZeroOne() { return float(pcgNext() >> 8) * (1.0 / 16777216.0); }
+float randNegPosOne() { return randZeroOne() * 2.0 - 1.0; }
+uint hashPixelSeed(uint seed, int x, int y) {
+    uint h = seed ^ (uint(x) * 0x9E3779B1u) ^ (uint(y) * 0x85EBCA77u);
+    h ^= h >> 16; h *= 0x85EBCA6Bu;
+    h ^= h >> 13; h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+uint passSeed(int pass) { return uSeed + uint(pass) * 0x9E3779B9u; }
+vec3 normalize3(vec3 v) { float len = sqrt(dot(v, v)); return len > 0.0 ? v * (1.0 / len) : v; }
+)GLSL",
+    // 󽻣CPU·ͬAABB壨0.001ԽֵSlab[0.001, 1000]ԺBVH˳
+    R"GLSL(
+struct Ray { vec3 o; vec3 d; vec3 inv; };
+Ray makeRay(vec3 o, vec3 d) { Ray r; r.o = o; r.d = d; r.inv = 1.0 / d; return r; }
+bool hitBounds(vec3 lo, vec3 hi, Ray r, float tMax, out float tEntry) {
+    vec3 t1 = (lo - r.o) * r.inv, t2 = (hi - r.o) * r.inv;
+    vec3 tn = min(t1, t2), tf = max(t1, t2);
+    float tNear = max(max(tn.x, tn.y), tn.z), tFar = min(min(tf.x, tf.y), tf.z);
+    tEntry = tNear;
+    return tFar >= max(tNear, 0.0) && tNear < tMax;
+}
+bool hitPrim(int pos, Ray r, float tBest, out float t) {
+    Prim pr = prims[pos];
+    if (pr.info.x == PRIM_SPHERE) {
+        vec3 oc = r.o - pr.a.xyz;
+        float a = dot(r.d, r.d);
+        float b = 2.0 * dot(oc, r.d);
+        float c = dot(oc, oc) - pr.a.w;
+        float disc = b * b - 4.0 * a * c;
+        t = 0.0;
+        if (disc < 0.0) return false;
+        float sq = sqrt(disc);
+        t = (-b - sq) / (2.0 * a);
+        if (!(t > 0.001)) t = (-b + sq) / (2.0 * a);
+        return t > 0.001 && t < tBest;
+    }
+    vec3 t1 = (pr.a.xyz - r.o) * r.inv, t2 = (pr.b.xyz - r.o) * r.inv;
+    vec3 tn = min(t1, t2), tf = max(t1, t2);
+    t = max(max(tn.x, tn.y), tn.z);
+    float tFar = min(min(tf.x, tf.y), tf.z);
+    return t <= tFar && t >= 0.001 && t <= 1000.0 && t < tBest;
+}
+bool intersectScene(Ray r, inout float tBest, out int hitPos) {
+    hitPos = -1;
+    float te;
+    if (uNodeCount == 0 || !hitBounds(nodes[0].lo.xyz, nodes[0].hi.xyz, r, tBest, te)) return false;
+    int stack[64];  // BVH::STACK_SIZEڵͬһ޵BVHѹջԽ
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        Node nd = nodes[stack[--sp]];
+        int first = floatBitsToInt(nd.lo.w), count = floatBitsToInt(nd.hi.w);
+        if (count > 0) {
+            for (int i = first; i < first + count; ++i) {
+                float t;
+                if (hitPrim(i, r, tBest, t)) { tBest = t; hitPos = i; }
+            }
+            continue;
+        }
+        int a = first, b = first + 1;
+        float ta, tb;
+        bool hitA = hitBounds(nodes[a].lo.xyz, nodes[a].hi.xyz, r, tBest, ta);
+        bool hitB = hitBounds(nodes[b].lo.xyz, nodes[b].hi.xyz, r, tBest, tb);
+        if (hitA && hitB) {
+            if (ta > tb) { int s = a; a = b; b = s; }
+            stack[sp++] = b;
+            stack[sp++] = a;
+        }
+        else if (hitA) stack[sp++] = a;
+        else if (hitB) stack[sp++] = b;
+    }
+    return hitPos >= 0;
+}
+bool occludedScene(Ray r, float tMax) {
+    if (uNodeCount == 0) return false;
+    int stack[64];  // ͬ intersectScene
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        Node nd = nodes[stack[--sp]];
+        float te;
+        if (!hitBounds(nd.lo.xyz, nd.hi.xyz, r, tMax, te)) continue;
+        int first = floatBitsToInt(nd.lo.w), count = floatBitsToInt(nd.hi.w);
+        if (count > 0) {
+            for (int i = first; i < first + count; ++i) {
+                float t;
+                if (hitPrim(i, r, tMax, t)) return true;
+            }
+            continue;
+        }
+        stack[sp++] = first + 1;
+        stack[sp++] = first;
+    }
+    return false;
+}
+)GLSL",
+    // ӷߣBox::normalAtPerlinľơذ
+    R"GLSL(
+vec3 surfaceNormal(int pos, Ray r, vec3 p) {
+    Prim pr = prims[pos];
+    if (pr.info.x == PRIM_SPHERE) return normalize3(p - pr.a.xyz);
+    if (pr.info.x != PRIM_BOX) return pr.n.xyz;
+    vec3 mn = pr.a.xyz, mx = pr.b.xyz;
+    const float eps = 0.001;
+    if (abs(p.x - mn.x) < eps && r.d.x < 0.0) return vec3(-1, 0, 0);
+    if (abs(p.x - mx.x) < eps && r.d.x > 0.0) return vec3(1, 0, 0);
+    if (abs(p.y - mn.y) < eps && r.d.y < 0.0) return vec3(0, -1, 0);
+    if (abs(p.y - mx.y) < eps && r.d.y > 0.0) return vec3(0, 1, 0);
+    if (abs(p.z - mn.z) < eps && r.d.z < 0.0) return vec3(0, 0, -1);
+    if (abs(p.z - mx.z) < eps && r.d.z > 0.0) return vec3(0, 0, 1);
+    return normalize3(p - (mn + mx) * 0.5);
+}
+float fade(float t) { return t * t * t * (t * (t * 6.0 - 15.0) + 10.0); }
+float lerp1(float a, float b, float t) { return (1.0 - t) * a + t * b; }
+float grad(int hash, float x, float y) {
+    switch (hash & 15) {
+    case 0: return x + y;
+    case 1: return -x + y;
+    case 2: return x - y;
+    case 3: return -x - y;
+    case 4: return x;
+    case 5: return -x;
+    case 6: return y;
+    case 7: return -y;
+    default: return 0.0;
+    }
+}
+float perlinNoise(float x, float y) {
+    float fx = floor(x), fy = floor(y);
+    int X = int(fx) & 255, Y = int(fy) & 255;
+    x -= fx;
+    y -= fy;
+    float u = fade(x), v = fade(y);
+    int A = perm[X] + Y, B = perm[X + 1] + Y;
+    return lerp1(lerp1(grad(perm[A], x, y), grad(perm[B], x - 1.0, y), u),
+                 lerp1(grad(perm[A + 1], x, y - 1.0), grad(perm[B + 1], x - 1.0, y - 1.0), u), v);
+}
+vec3 woodColor(vec3 p, vec3 n) {
+    const float scale = 10.0, stripeDensity = 0.3, noiseStrength = 0.3;
+    float stripe, noise;
+    if (abs(n.y) > 0.9) { stripe = p.z * scale; noise = perlinNoise(p.x * scale * 0.5, p.z * scale * 0.5); }
+    else if (abs(n.x) > 0.9) { stripe = p.y * scale; noise = perlinNoise(p.y * scale * 0.5, p.z * scale * 0.5); }
+    else { stripe = p.y * scale; noise = perlinNoise(p.x * scale * 0.5, p.y * scale * 0.5); }
+    float pattern = sin(stripe * 2.0 * 3.14159265358979 / stripeDensity + noise * noiseStrength * 10.0);
+    pattern = (pattern + 1.0) * 0.5;
+    pattern = abs(pattern - 0.5) * 2.0;
+    pattern = pattern * pattern;
+    return vec3(0.65, 0.45, 0.25) * (1.0 - pattern) + vec3(0.45, 0.25, 0.1) * pattern;
+}
+vec3 floorColor(vec3 p) {
+    float pattern = sin(p.x * 15.0) * 0.5 + 0.5;
+    bool stripe = (int(p.z * 8.0 * 5.0) & 1) != 0;
+    return (stripe ? vec3(0.55, 0.35, 0.15) : vec3(0.45, 0.25, 0.1)) * (0.8 + pattern * 0.2);
+}
+)GLSL",
+    // ɫʽջremaining Ϊ0һ׷ٵĹߣ0ģʣջʱȡŶһߣ
+    R"GLSL(
+struct Task { vec3 o; vec3 d; vec3 n; vec3 w; float rough; int depth; int canSplit; int remaining; };
+// ÿݹһһ֧ģʣֻ0..MAX_BOUNCES-1
+// ջͬʱ MAX_BOUNCES + 1 ϽȷpushRay ļ鲻ᴥᶪ
+const int MAX_BOUNCES = 6;
+const int MAX_TASKS = MAX_BOUNCES + 1;
+Task tasks[MAX_TASKS];
+int taskCount;
+void pushRay(vec3 o, vec3 d, int depth, int canSplit, vec3 w) {
+    if (taskCount == MAX_TASKS) return;
+    tasks[taskCount++] = Task(o, normalize3(d), vec3(0.0), w, 0.0, depth, canSplit, 0);
+}
+vec3 tracePath(Ray primary) {
+    vec3 color = vec3(0.0);
+    taskCount = 0;
+    pushRay(primary.o, primary.d, 0, 1, vec3(1.0));
+    while (taskCount > 0) {
+        Task tk = tasks[--taskCount];
+        if (tk.remaining > 0) {
+            if (tk.remaining > 1) { tasks[taskCount] = tk; tasks[taskCount++].remaining = tk.remaining - 1; }
+            vec3 dir = tk.d;
+            if (tk.rough > 0.001) {
+                float r1 = randNegPosOne();
+                float r2 = randNegPosOne();
+                float r3 = randNegPosOne();
+                dir = normalize3(tk.d + normalize3(vec3(r1, r2, r3)) * tk.rough);
+                if (dot(dir, tk.n) < 0.0) dir = tk.d;
+            }
+            pushRay(tk.o + tk.n * 0.001, dir, tk.depth, tk.canSplit, tk.w);
+            continue;
+        }
+        if (tk.depth > MAX_BOUNCES) { color += tk.w * uBgColor; continue; }
+        Ray r = makeRay(tk.o, tk.d);
+        float t = 100000.0;
+        int pos;
+        if (!intersectScene(r, t, pos)) { color += tk.w * uBgColor; continue; }
+        vec3 p = r.o + r.d * t;
+        vec3 n = surfaceNormal(pos, r, p);
+        Mat m = mats[prims[pos].info.y];
+        vec3 surf = m.color.rgb;
+        if (m.f.z == TEX_WOOD_GRAIN) surf = woodColor(p, n);
+        else if (m.f.z == TEX_FLOOR_PLANKS) surf = floorColor(p);
+        bool metal = m.f.y != 0;
+
+        if (m.f.x != 0 && tk.depth < MAX_BOUNCES) {
+            float cosI = -dot(r.d, n);
+            float eta = m.p.y;
+            vec3 nn = n;
+            if (!(cosI > 0.0)) { cosI = -cosI; nn = -n; eta = 1.0 / eta; }
+            float sinT2 = eta * eta * (1.0 - cosI * cosI);
+            if (sinT2 < 1.0) {
+                float cosT = sqrt(1.0 - sinT2);
+                float R0 = ((eta - 1.0) * (eta - 1.0)) / ((eta + 1.0) * (eta + 1.0));
+                float c = 1.0 - cosI;
+                float fresnel = R0 + (1.0 - R0) * (c * c * c * c * c);
+                pushRay(p + n * 0.001, normalize3(r.d - n * 2.0 * dot(r.d, n)), tk.depth + 1, tk.canSplit, tk.w * fresnel);
+                pushRay(p - nn * 0.001, normalize3(r.d * eta + nn * (eta * cosI - cosT)), tk.depth + 1, tk.canSplit, tk.w * (1.0 - fresnel));
+            }
+            else {
+                pushRay(p + nn * 0.001, normalize3(r.d - nn * 2.0 * dot(r.d, nn)), tk.depth + 1, tk.canSplit, tk.w);
+            }
+            continue;
+        }
+
+        vec3 toLight = uLightPos - p;
+        vec3 lightDir = normalize3(toLight);
+        float lightDist = length(toLight);
+        vec3 local;
+        if (!occludedScene(makeRay(p + n * 0.001, toLight * (1.0 / lightDist)), lightDist - 0.001)) {
+            float diff = max(0.0, dot(n, lightDir));
+            float attenuation = 1.0 / (1.0 + 0.05 * lightDist * lightDist);
+            local = m.k.x * surf + m.k.y * (surf * uLightColor) * diff * attenuation * (metal ? 0.1 : 1.0);
+            vec3 viewDir = normalize3(uCameraPos - p);
+            vec3 reflectDir = normalize3(n * (2.0 * dot(n, lightDir)) - lightDir);
+            float spec = pow(max(0.0, dot(viewDir, reflectDir)), m.p.x);
+            local += m.k.z * (metal ? surf : uLightColor) * spec * attenuation;
+        }
+        else {
+            local = m.k.x * surf * 0.5;
+        }
+
+        float kr = m.k.w;
+        if (kr > 0.0 && tk.depth < MAX_BOUNCES) {
+            color += tk.w * local * (1.0 - kr);
+            int samples = 1, childCanSplit = tk.canSplit;
+            float survivalWeight = 1.0;
+            if (m.p.z > 0.001) {
+                if (tk.canSplit != 0 || uGlossyPolicy == GLOSSY_SPLIT_ALWAYS) {
+                    samples = uGlossySamples;
+                    childCanSplit = uGlossyPolicy == GLOSSY_SPLIT_ALWAYS ? 1 : 0;
+                }
+                else if (uGlossyPolicy == GLOSSY_ROULETTE) {
+                    float survival = max(0.05, min(0.95, kr));
+                    if (randZeroOne() < survival) survivalWeight = 1.0 / survival;
+                    else samples = 0;
+                }
+            }
+            if (samples > 0 && taskCount < MAX_TASKS) {
+                vec3 w = tk.w * (kr * survivalWeight / float(samples)) * (metal ? surf : vec3(1.0));
+                tasks[taskCount++] = Task(p, normalize3(r.d - n * 2.0 * dot(r.d, n)), n, w, m.p.z, tk.depth + 1, childCanSplit, samples);
+            }
+        }
+        else {
+            color += tk.w * local;
+        }
+    }
+    return color;
+}
+)GLSL",
+    // ׷٣ֻºһأۼƽ toneMapValue / encodeDisplayReference / encodeDithered Ĺʽ
+    R"GLSL(
+float toneMap(float x) {
+    x = max(0.0, x);
+    if (uToneMap == 1) x = x / (1.0 + x);
+    else if (uToneMap == 2) x = (x * (x * 2.51 + 0.03)) / (x * (x * 2.43 + 0.59) + 0.14);
+    return min(1.0, x);
+}
+void main() {
+    ivec2 px = ivec2(gl_GlobalInvocationID.x, int(gl_GlobalInvocationID.y) + uRowOffset);
+    if (px.x >= uImageSize.x || px.y >= uImageSize.y) return;
+    vec3 sum;
+    if (uTrace != 0) {
+        beginPixelRng(hashPixelSeed(passSeed(uPass), px.x, px.y));
+        float jx = 0.0, jy = 0.0;
+        if (uPass > 0) {
+            uint h = hashPixelSeed(passSeed(uPass) ^ 0xA511E9B3u, px.x, px.y);
+            jx = float(h & 0xFFFFu) * (1.0 / 65536.0);
+            jy = float(h >> 16) * (1.0 / 65536.0);
+        }
+        float u = (2.0 * (float(px.x) + jx) / float(uImageSize.x) - 1.0) * uTanHalfFov * uAspect;
+        float v = (1.0 - 2.0 * (float(px.y) + jy) / float(uImageSize.y)) * uTanHalfFov;
+        vec3 c = tracePath(makeRay(uCameraPos, normalize3(normalize3(uForward + uRight * u + uUp * v))));
+        sum = uPass == 0 ? c : imageLoad(accumImage, px).rgb + c;
+        imageStore(accumImage, px, vec4(sum, 1.0));
+    }
+    else {
+        sum = imageLoad(accumImage, px).rgb;
+    }
+    vec3 linear = sum * (1.0 / float(uPass + 1));
+    uint h = hashPixelSeed(0x6D2B79F5u, px.x, px.y);
+    vec3 code;
+    for (int c = 0; c < 3; ++c) {
+        float g = pow(toneMap(linear[c] * uExposure), 0.454);
+        float noise = uDither != 0 ? float((h >> uint(c * 10)) & 1023u) * (1.0 / 1024.0) : 0.0;
+        code[c] = floor(min(255.0, g * 255.0 + noise));
+    }
+    imageStore(outputImage, px, vec4(code * (1.0 / 255.0), 1.0));
+}
+)GLSL"
+};
+
+// GpuTracerɫ򡢳塢ۼͼʾ
+struct GpuTracer {
+    static constexpr int DISPATCH_ROWS = 64;  // ÿdispatchύʱ̣GPUʱ
+    bool ready = false;
+    bool attempted = false;
+    GLuint program = 0;
+    GLuint buffers[4] = { 0, 0, 0, 0 };  // ڵ㡢ͼԪʡû
+    GLuint accumTexture = 0;   // RGBA32Fۼƺ
+    GLuint outputTexture = 0;  // RGBA8display() ֱʾ
+    int passes = 0;            // ɵı
+    int maxPasses = 256;
+    int nodeCount = 0;
+    std::chrono::steady_clock::time_point startTime;  // νʽȾʼʱ
+    PfnUseProgram useProgram = nullptr;
+    PfnGetUniformLocation getUniformLocation = nullptr;
+    PfnUniform1i uniform1i = nullptr;
+    PfnUniform1ui uniform1ui = nullptr;
+    PfnUniform1f uniform1f = nullptr;
+    PfnUniform2i uniform2i = nullptr;
+    PfnUniform3f uniform3f = nullptr;
+    PfnBindBufferBase bindBufferBase = nullptr;
+    PfnBindBuffer bindBuffer = nullptr;   // updateMaterials ϴʱʱʹ
+    PfnBufferData bufferData = nullptr;
+    PfnBindImageTexture bindImageTexture = nullptr;
+    PfnDispatchCompute dispatchCompute = nullptr;
+    PfnMemoryBarrier memoryBarrier = nullptr;
+
+    // GL initScene() ֮ãɫϴʧʱ˵ԭ򲢷falseʹCPU
+    bool init(const Scene& s) {
+        if (!hasGLFeature(4, 3, "GL_ARB_compute_shader")) {
+            std::cerr << "GPUҪ OpenGL 4.3 ɫʹCPUȾ" << std::endl;
+            return false;
+        }
+        if (!s.instances.empty()) {
+            std::cerr << "GPU˲֧ʵʹCPUȾ" << std::endl;
+            return false;
+        }
+        PfnCreateShader createShader = reinterpret_cast<PfnCreateShader>(glutGetProcAddress("glCreateShader"));
+        PfnShaderSource shaderSource = reinterpret_cast<PfnShaderSource>(glutGetProcAddress("glShaderSource"));
+        PfnCompileShader compileShader = reinterpret_cast<PfnCompileShader>(glutGetProcAddress("glCompileShader"));
+        PfnGetShaderiv getShaderiv = reinterpret_cast<PfnGetShaderiv>(glutGetProcAddress("glGetShaderiv"));
+        PfnGetShaderInfoLog getShaderInfoLog = reinterpret_cast<PfnGetShaderInfoLog>(glutGetProcAddress("glGetShaderInfoLog"));
+        PfnDeleteShader deleteShader = reinterpret_cast<PfnDeleteShader>(glutGetProcAddress("glDeleteShader"));
+        PfnCreateProgram createProgram = reinterpret_cast<PfnCreateProgram>(glutGetProcAddress("glCreateProgram"));
+        PfnAttachShader attachShader = reinterpret_cast<PfnAttachShader>(glutGetProcAddress("glAttachShader"));
+        PfnLinkProgram linkProgram = reinterpret_cast<PfnLinkProgram>(glutGetProcAddress("glLinkProgram"));
+        PfnGetProgramiv getProgramiv = reinterpret_cast<PfnGetProgramiv>(glutGetProcAddress("glGetProgramiv"));
+        PfnGetProgramInfoLog getProgramInfoLog = reinterpret_cast<PfnGetProgramInfoLog>(glutGetProcAddress("glGetProgramInfoLog"));
+        PfnGenBuffers genBuffers = reinterpret_cast<PfnGenBuffers>(glutGetProcAddress("glGenBuffers"));
+        bindBuffer = reinterpret_cast<PfnBindBuffer>(glutGetProcAddress("glBindBuffer"));
+        bufferData = reinterpret_cast<PfnBufferData>(glutGetProcAddress("glBufferData"));
+        PfnTexStorage2D texStorage2D = reinterpret_cast<PfnTexStorage2D>(glutGetProcAddress("glTexStorage2D"));
+        useProgram = reinterpret_cast<PfnUseProgram>(glutGetProcAddress("glUseProgram"));
+        getUniformLocation = reinterpret_cast<PfnGetUniformLocation>(glutGetProcAddress("glGetUniformLocation"));
+        uniform1i = reinterpret_cast<PfnUniform1i>(glutGetProcAddress("glUniform1i"));
+        uniform1ui = reinterpret_cast<PfnUniform1ui>(glutGetProcAddress("glUniform1ui"));
+        uniform1f = reinterpret_cast<PfnUniform1f>(glutGetProcAddress("glUniform1f"));
+        uniform2i = reinterpret_cast<PfnUniform2i>(glutGetProcAddress("glUniform2i"));
+        uniform3f = reinterpret_cast<PfnUniform3f>(glutGetProcAddress("glUniform3f"));
+        bindBufferBase = reinterpret_cast<PfnBindBufferBase>(glutGetProcAddress("glBindBufferBase"));
+        bindImageTexture = reinterpret_cast<PfnBindImageTexture>(glutGetProcAddress("glBindImageTexture"));
+        dispatchCompute = reinterpret_cast<PfnDispatchCompute>(glutGetProcAddress("glDispatchCompute"));
+        memoryBarrier = reinterpret_cast<PfnMemoryBarrier>(glutGetProcAddress("glMemoryBarrier"));
+        if (!createShader || !shaderSource || !compileShader || !getShaderiv || !getShaderInfoLog || !deleteShader || !createProgram ||
+            !attachShader || !linkProgram || !getProgramiv || !getProgramInfoLog || !genBuffers || !bindBuffer || !bufferData ||
+            !texStorage2D || !useProgram || !getUniformLocation || !uniform1i || !uniform1ui || !uniform1f || !uniform2i || !uniform3f ||
+            !bindBufferBase || !bindImageTexture || !dispatchCompute || !memoryBarrier) {
+            std::cerr << "޷GPUGLʹCPUȾ" << std::endl;
+            return false;
+        }
+
+        GLuint shader = createShader(GL_COMPUTE_SHADER);
+        shaderSource(shader, static_cast<GLsizei>(sizeof(GPU_SHADER_SOURCE) / sizeof(GPU_SHADER_SOURCE[0])), GPU_SHADER_SOURCE, nullptr);
+        compileShader(shader);
+        GLint ok = 0;
+        char log[4096];
+        getShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        if (!ok) {
+            getShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cerr << "ɫʧ:\n" << log << std::endl;
+            deleteShader(shader);
+            return false;
+        }
+        program = createProgram();
+        attachShader(program, shader);
+        linkProgram(program);
+        deleteShader(shader);  // ӵĴ
+        getProgramiv(program, GL_LINK_STATUS, &ok);
+        if (!ok) {
+            getProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cerr << "ɫʧ:\n" << log << std::endl;
+            return false;
+        }
+
+        // ݣɫе Node/Prim/Mat ṹһ£ÿԱΪ vec4/ivec4std430 ޶䣩
+        std::vector<float> nodeData;
+        for (const BVHNode& node : s.bvh.nodes) {
+            float lo[4] = { node.bmin.x, node.bmin.y, node.bmin.z, 0 }, hi[4] = { node.bmax.x, node.bmax.y, node.bmax.z, 0 };
+            std::memcpy(&lo[3], &node.leftFirst, sizeof(float));
+            std::memcpy(&hi[3], &node.count, sizeof(float));
+            nodeData.insert(nodeData.end(), lo, lo + 4);
+            nodeData.insert(nodeData.end(), hi, hi + 4);
+        }
+        static_assert(BVH::STACK_SIZE == 64, "ɫ intersectScene/occludedScene  stack[64]  BVH::STACK_SIZE ͬ");
+        nodeCount = static_cast<int>(s.bvh.nodes.size());
+        struct GpuPrim { float a[4], b[4], n[4]; int info[4]; };
+        std::vector<GpuPrim> primData;
+        for (size_t pos = 0; pos < s.bvh.primIndices.size(); ++pos) {  // BVHҶ˳ҶΪ塢SlabCPU˳ͬ
+            const PrimRef& ref = s.prims[s.bvh.primIndices[pos]];
+            GpuPrim g = GpuPrim();
+            g.info[0] = ref.type;
+            g.info[1] = ref.materialID;
+            if (ref.type == PRIM_SPHERE) {
+                const Sphere& sp = s.spheres[ref.index];
+                g.a[0] = sp.center.x; g.a[1] = sp.center.y; g.a[2] = sp.center.z; g.a[3] = sp.radius * sp.radius;
+            }
+            else {
+                Vector3 mn = ref.type == PRIM_BOX ? s.boxes[ref.index].min : s.rects[ref.index].min;
+                Vector3 mx = ref.type == PRIM_BOX ? s.boxes[ref.index].max : s.rects[ref.index].max;
+                g.a[0] = mn.x; g.a[1] = mn.y; g.a[2] = mn.z;
+                g.b[0] = mx.x; g.b[1] = mx.y; g.b[2] = mx.z;
+                if (ref.type == PRIM_RECT) { g.n[0] = s.rects[ref.index].normal.x; g.n[1] = s.rects[ref.index].normal.y; g.n[2] = s.rects[ref.index].normal.z; }
+            }
+            primData.push_back(g);
+        }
+        std::vector<GpuMaterial> materialData = packMaterials(s);
+        nodeData.resize(std::max<size_t>(nodeData.size(), 8));  // ջ岻ܰ󶨣ٱһԪ
+        primData.resize(std::max<size_t>(primData.size(), 1));
+        const void* data[4] = { nodeData.data(), primData.data(), materialData.data(), p };
+        size_t sizes[4] = { nodeData.size() * sizeof(float), primData.size() * sizeof(GpuPrim), materialData.size() * sizeof(GpuMaterial), sizeof(p) };
+        genBuffers(4, buffers);
+        for (int i = 0; i < 4; ++i) {
+            bindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[i]);
+            bufferData(GL_SHADER_STORAGE_BUFFER, static_cast<std::ptrdiff_t>(sizes[i]), data[i], GL_STATIC_DRAW);
+        }
+        bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        GLuint textures[2];
+        glGenTextures(2, textures);
+        accumTexture = textures[0];
+        outputTexture = textures[1];
+        glBindTexture(GL_TEXTURE_2D, accumTexture);
+        texStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, imageWidth, imageHeight);
+        glBindTexture(GL_TEXTURE_2D, outputTexture);
+        texStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, imageWidth, imageHeight);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        ready = true;
+        std::cout << "GPU˾: " << glGetString(GL_RENDERER) << "" << primData.size() << " ͼԪ, " << nodeCount << " ڵ㣩" << std::endl;
+        return true;
+    }
+
+    struct GpuMaterial { float color[4], k[4], p[4]; int f[4]; };
+
+    // ʱɫ Mat ĲִһԪأ
+    static std::vector<GpuMaterial> packMaterials(const Scene& s) {
+        std::vector<GpuMaterial> materialData;
+        for (const Material& m : s.materials) {
+            GpuMaterial g = { { m.color.x, m.color.y, m.color.z, 0 }, { m.ka, m.kd, m.ks, m.kr }, { m.shininess, m.eta, m.roughness, 0 },
+                              { m.isRefractive ? 1 : 0, m.isMetallic ? 1 : 0, m.texture, 0 } };
+            materialData.push_back(g);
+        }
+        materialData.resize(std::max<size_t>(materialData.size(), 1));
+        return materialData;
+    }
+
+    // ޸ĺϴʱԴλɫÿ dispatch Ϊ uniform 룬Ҫϴ
+    void updateMaterials(const Scene& s) {
+        if (!ready) return;
+        std::vector<GpuMaterial> materialData = packMaterials(s);
+        bindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[2]);
+        bufferData(GL_SHADER_STORAGE_BUFFER, static_cast<std::ptrdiff_t>(materialData.size() * sizeof(GpuMaterial)), materialData.data(), GL_STATIC_DRAW);
+        bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // ¿ʼۼƣ limit 
+    void restart(int limit) {
+        passes = 0;
+        maxPasses = limit;
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    // ״εʱʼֱ֮ӷؽʼʧܲظԣ
+    bool start(const Scene& s) {
+        if (!ready && !attempted) {
+            attempted = true;
+            init(s);
+        }
+        return ready;
+    }
+
+    bool running() const { return ready && passes < maxPasses; }
+
+    // һɫtrace Ϊtrueʱ׷ٵ passes 鲢ۼƣֻǰʾ±еۼƽ
+    void dispatch(const Scene& s, bool trace) {
+        if (!trace && passes == 0) return;  // ۼƽ
+        Scene::CameraBasis cam = s.makeCameraBasis();
+        useProgram(program);
+        auto loc = [&](const char* name) { return getUniformLocation(program, name); };
+        uniform1i(loc("uNodeCount"), nodeCount);
+        uniform1i(loc("uPass"), trace ? passes : passes - 1);
+        uniform1i(loc("uTrace"), trace ? 1 : 0);
+        uniform1i(loc("uGlossySamples"), 1);  // CPUʽȾͬÿ1ɶۼ
+        uniform1i(loc("uGlossyPolicy"), glossyPolicy);
+        uniform1i(loc("uToneMap"), toneMapOperator);
+        uniform1i(loc("uDither"), ditherOutput ? 1 : 0);
+        uniform1ui(loc("uSeed"), renderSeed);
+        uniform1f(loc("uExposure"), std::exp2(exposureEV));
+        uniform1f(loc("uTanHalfFov"), cam.tanHalfFov);
+        uniform1f(loc("uAspect"), cam.aspect);
+        uniform3f(loc("uLightPos"), s.lightPos.x, s.lightPos.y, s.lightPos.z);
+        uniform3f(loc("uLightColor"), s.lightColor.x, s.lightColor.y, s.lightColor.z);
+        uniform3f(loc("uBgColor"), s.bgColor.x, s.bgColor.y, s.bgColor.z);
+        uniform3f(loc("uCameraPos"), s.cameraPos.x, s.cameraPos.y, s.cameraPos.z);
+        uniform3f(loc("uForward"), cam.forward.x, cam.forward.y, cam.forward.z);
+        uniform3f(loc("uRight"), cam.right.x, cam.right.y, cam.right.z);
+        uniform3f(loc("uUp"), cam.up.x, cam.up.y, cam.up.z);
+        uniform2i(loc("uImageSize"), imageWidth, imageHeight);
+        for (int i = 0; i < 4; ++i) bindBufferBase(GL_SHADER_STORAGE_BUFFER, i, buffers[i]);
+        bindImageTexture(0, accumTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        bindImageTexture(1, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        GLint rowLoc = loc("uRowOffset");
+        for (int y = 0; y < imageHeight; y += DISPATCH_ROWS) {
+            uniform1i(rowLoc, y);
+            dispatchCompute((imageWidth + 7) / 8, (std::min(DISPATCH_ROWS, imageHeight - y) + 7) / 8, 1);
+        }
+        memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);  // display() һۼֵ
+        useProgram(0);  // ̶ָ߻
+        if (!trace) return;
+        ++passes;
+        if (passes == 1 || passes == maxPasses) {
+            glFinish();  // ֻױһȴGPUԱʱ
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            if (passes == 1) std::cout << "GPUױ: " << seconds * 1000.0 << " " << std::endl;
+            else std::cout << "GPUʽȾ: " << passes << " , " << seconds << " 루" << passes / seconds << " /룩" << std::endl;
+        }
+    }
+};
+
+GpuTracer gpuTracer;
+
+// ó--scene ѡ񲼾֣Cornell Box ǽڡľ
+void buildBuiltinScene() {
+    // === ɫ ===
+    Material redMirror;
+    redMirror.color = Vector3(0.9f, 0.1f, 0.1f);  // ɫ
+    redMirror.ka = 0.05f; redMirror.kd = 0.0f; redMirror.ks = 0.9f;  // 䣬߾
+    redMirror.kr = 1.0f;  // 
+    redMirror.shininess = 100.0f;  // ߹
+    redMirror.roughness = 0.0f;  // ⻬
+    redMirror.isMetallic = false;
+    if (sceneLayout == SCENE_GLOSSY) redMirror.roughness = 0.15f;  // ĥɰ
+    scene->spheres.push_back(Sphere(Vector3(-1.0f, 0.4f, 0.5f), 0.4f, scene->addMaterial(redMirror)));  // 
+
+    // === м䲣 ===
+    Material glass;
+    glass.color = Vector3(0.95f, 0.95f, 0.95f);  // ף͸
+    glass.ka = 0.0f; glass.kd = 0.0f; glass.ks = 0.1f;  // 
+    glass.kr = 0.0f;  // Fresnel
+    glass.eta = 1.5f;  // 
+    glass.isRefractive = true;
+    glass.isMetallic = false;
+    glass.roughness = 0.0f;
+    scene->spheres.push_back(Sphere(Vector3(0.0f, 0.4f, -0.2f), 0.4f, scene->addMaterial(glass)));
+
+    // === Ҳƽ  ȫ͸ҫƽ===
+    Material gold;
+    gold.color = Vector3(1.0f, 0.76f, 0.33f);   // ƽɫ
+    gold.ka = 0.1f;          // 
+    gold.kd = 0.05f;         // 
+    gold.ks = 1.0f;          // ǿ߹
+    gold.kr = 0.9f;          // ǿ
+    gold.shininess = 200.0f; // ߹
+    gold.roughness = 0.2f;   // ֲڶȣģ䣩
+    gold.isRefractive = false;
+    gold.isMetallic = true;
+    gold.eta = 1.0f;
+    scene->spheres.push_back(Sphere(Vector3(0.85f, 0.25f, 0.6f), 0.25f, scene->addMaterial(gold)));  // С
+
+    // === ľ䣨䣩===
+    Material woodBox;
+    woodBox.color = Vector3(0.5f, 0.3f, 0.15f);  // ľɫǣ
+    woodBox.ka = 0.1f; woodBox.kd = 0.75f; woodBox.ks = 0.1f;  // ľʵ
+    woodBox.kr = 0.0f; woodBox.shininess = 15.0f;
+    woodBox.isMetallic = false;
+    woodBox.roughness = 0.05f;  // ΢ֲ
+    woodBox.texture = TEX_WOOD_GRAIN;  // ľ
+    woodBox.textureEval = woodTextureEval;
+    scene->boxes.push_back(Box(Vector3(0.5f, 0, -1.3f), Vector3(1.3f, 1.0f, -0.5f), scene->addMaterial(woodBox)));  // λ
+
+    // === Cornell BoxǽڣΪͨͼԪBVH ===
+    Material floorMat;  // ذ y=0 (ϸľ)
+    floorMat.ka = 0.15f; floorMat.kd = 0.75f; floorMat.ks = 0.15f;  // 
+    floorMat.kr = 0.0f; floorMat.shininess = 20.0f;
+    floorMat.isMetallic = false;
+    floorMat.roughness = 0.0f;  // ذ⻬
+    floorMat.texture = TEX_FLOOR_PLANKS;
+    if (sceneLayout == SCENE_GLOSSY) { floorMat.kr = 0.25f; floorMat.roughness = 0.1f; }  // ذ
+    scene->rects.push_back(Rect(Vector3(-1.5f, 0, -1.5f), Vector3(1.5f, 0, 1.5f), Vector3(0, 1, 0), scene->addMaterial(floorMat)));
+
+    Material wallMat;  // ǽڹ
+    wallMat.ka = 0.1f; wallMat.kd = 0.8f; wallMat.ks = 0.05f; wallMat.kr = 0.0f;
+    wallMat.isMetallic = false;
+    wallMat.roughness = 0.0f;  // ⻬
+    if (sceneLayout == SCENE_GLOSSY) { wallMat.kr = 0.3f; wallMat.roughness = 0.3f; }  // ǽ
+
+    Material redWall = wallMat;  // ǽ x=-1.5 ()
+    redWall.color = Vector3(0.75f, 0.1f, 0.1f);
+    scene->rects.push_back(Rect(Vector3(-1.5f, 0, -1.5f), Vector3(-1.5f, 3.0f, 1.5f), Vector3(1, 0, 0), scene->addMaterial(redWall)));  // ڷ
+
+    Material greenWall = wallMat;  // ǽ x=1.5 ()
+    greenWall.color = Vector3(0.1f, 0.75f, 0.1f);
+    scene->rects.push_back(Rect(Vector3(1.5f, 0, -1.5f), Vector3(1.5f, 3.0f, 1.5f), Vector3(-1, 0, 0), scene->addMaterial(greenWall)));
+
+    Material whiteWall = wallMat;  // ǽ z=-1.5 컨 y=3.0 ()
+    whiteWall.color = Vector3(0.85f, 0.85f, 0.85f);
+    int whiteWallID = scene->addMaterial(whiteWall);  // 湲ͬһʱ
+    scene->rects.push_back(Rect(Vector3(-1.5f, 0, -1.5f), Vector3(1.5f, 3.0f, -1.5f), Vector3(0, 0, 1), whiteWallID));
+    scene->rects.push_back(Rect(Vector3(-1.5f, 3.0f, -1.5f), Vector3(1.5f, 3.0f, 1.5f), Vector3(0, -1, 0), whiteWallID));
+
+    // === ѹֲС򣨹̶ӣɫ===
+    if (sceneLayout == SCENE_STRESS) {
+        std::mt19937 placeRng(STRESS_SEED);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        Material dot = wallMat;
+        dot.ks = 0.2f; dot.shininess = 30.0f;
+        int dotIDs[3];
+        const Vector3 dotColors[3] = { Vector3(0.2f, 0.4f, 0.8f), Vector3(0.8f, 0.7f, 0.2f), Vector3(0.7f, 0.7f, 0.7f) };
+        for (int k = 0; k < 3; ++k) { dot.color = dotColors[k]; dotIDs[k] = scene->addMaterial(dot); }
+        for (int i = 0; i < STRESS_SPHERES; ++i) {
+            Vector3 c(-1.4f + 2.8f * unit(placeRng), 0.05f + 2.9f * unit(placeRng), -1.4f + 2.8f * unit(placeRng));
+            float r = 0.01f + 0.02f * unit(placeRng);
+            scene->spheres.push_back(Sphere(c, r, dotIDs[i % 3]));
+        }
+    }
+}
+
+// ----------------------------------------------------
+// ıļÿһ䣬# ֮Ϊעͣд3ոָ
+//   camera <λ> <עӵ> <ҰǶ>
+//   light <λ> [<ɫ>]
+//   background <ɫ>
+//   material <> [color <rgb>] [ka k] [kd k] [ks k] [kr k] [shininess s] [roughness r] [eta n] [metal] [refract] [texture wood|floor|none]
+//   sphere <> <뾶> <>
+//   box <С> <> <>                ÿС㲻㣩
+//   rect <С> <> <> <>      Σplane Ϊͬʣͬ
+//   mesh <> <ļ.obj|ļ.ply>              ·ԳļĿ¼
+//   instance <> <> [translate <v>] [rotate x|y|z <Ƕ>] [scale <s>|<v>] [matrix <3x412>] ...
+//                                                任д˳
+// ֵ nan/infcamera עӵ㲻λغϣҲϷ·
+// ȶʹãļĴС޸ʱһ뻺档BVHдɶƻ棺ͷ + ԭʼڴ沼֣64ֽڶ룩
+// ٴμʱļӳڴ棬ֱָӳBVH
+
+bool sceneSourceStamp(const std::string& path, SceneSourceStamp& stamp) {
+    std::error_code ec;
+    stamp.size = static_cast<uint64_t>(std::filesystem::file_size(path, ec));
+    if (ec) return false;
+    stamp.time = static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+    return !ec;
+}
+
+// ڼǺŶȡβΪ '\0'strtof Խ
+struct SceneLineReader {
+    char* cur;
+    bool nonFinite = false;  //  nan/infnumber() ʧܣ÷ݴ˸ԭ
+
+    void skipSpace() { while (*cur == ' ' || *cur == '\t' || *cur == '\r') ++cur; }
+    bool atEnd() { skipSpace(); return *cur == '\0'; }
+    bool word(std::string& out) {
+        skipSpace();
+        char* start = cur;
+        while (*cur && *cur != ' ' && *cur != '\t' && *cur != '\r') ++cur;
+        out.assign(start, cur);
+        return cur != start;
+    }
+    bool number(float& out) {
+        skipSpace();
+        char* next;
+        out = std::strtof(cur, &next);
+        if (next == cur) return false;
+        if (!std::isfinite(out)) { nonFinite = true; return false; }  // strtof  nan/infʲ
+        cur = next;
+        return true;
+    }
+    bool vec(Vector3& v) { return number(v.x) && number(v.y) && number(v.z); }
+};
+
+// ļڴ棨ļɴMBһζԭؽ
+bool readFileText(const std::string& path, std::string& text) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    in.seekg(0, std::ios::end);
+    std::streamoff size = in.tellg();
+    in.seekg(0, std::ios::beg);
+    text.resize(static_cast<size_t>(std::max<std::streamoff>(size, 0)));
+    return static_cast<bool>(in.read(&text[0], static_cast<std::streamsize>(text.size()))) || text.empty();
+}
+
+// Ķ±겢Ѷΰǻ׷ӵ tris
+bool appendFan(const std::vector<int>& corners, size_t vertexCount, std::vector<MeshTriangle>& tris) {
+    for (int c : corners) {
+        if (c < 0 || static_cast<size_t>(c) >= vertexCount) return false;
+    }
+    for (size_t k = 2; k < corners.size(); ++k) tris.push_back({ { corners[0], corners[k - 1], corners[k] } });
+    return true;
+}
+
+// OBJֻȡ v  ff Ķд vv/vtv//vnv/vt/vn±ʾԵǰĩβ
+// ΰǻ䣨vtvnogusemtls ȣ
+bool loadOBJ(const std::string& path, std::vector<Vector3>& verts, std::vector<MeshTriangle>& tris, std::string& error) {
+    std::string text;
+    if (!readFileText(path, text)) { error = path + ": ޷"; return false; }
+    std::string keyword;
+    std::vector<int> corners;
+    int lineNo = 0;
+    size_t pos = 0;
+    auto fail = [&](const std::string& why) {
+        error = path + ":" + std::to_string(lineNo) + ": " + why;
+        return false;
+    };
+    while (pos < text.size()) {
+        ++lineNo;
+        const char* nl = static_cast<const char*>(std::memchr(&text[pos], '\n', text.size() - pos));
+        size_t eol = nl ? static_cast<size_t>(nl - text.data()) : text.size();
+        text[eol] = '\0';  // 볡ļͬβ '\0'strtof/strtol Խ
+        SceneLineReader line{ &text[pos] };
+        pos = eol + 1;
+        if (!line.word(keyword) || keyword[0] == '#') continue;
+        if (keyword == "v") {
+            Vector3 p;
+            if (!line.vec(p)) return fail(line.nonFinite ? "" : "v Ҫ3");
+            verts.push_back(p);
+        }
+        else if (keyword == "f") {
+            corners.clear();
+            while (!line.atEnd()) {
+                char* next;
+                long idx = std::strtol(line.cur, &next, 10);
+                if (next == line.cur || idx == 0) return fail("f Ķ±Ч");
+                line.cur = next;
+                while (*line.cur && *line.cur != ' ' && *line.cur != '\t' && *line.cur != '\r') ++line.cur;  //  /vt/vn
+                corners.push_back(static_cast<int>(idx < 0 ? static_cast<long>(verts.size()) + idx : idx - 1));
+            }
+            if (corners.size() < 3) return fail("Ҫ3");
+            if (!appendFan(corners, verts.size(), tris)) return fail("Ķ±Խ");
+        }
+    }
+    return true;
+}
+
+// PLYԵֵ
+enum PlyType { PLY_NONE = 0, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+int plyTypeFromName(const std::string& name) {
+    if (name == "char" || name == "int8") return PLY_INT8;
+    if (name == "uchar" || name == "uint8") return PLY_UINT8;
+    if (name == "short" || name == "int16") return PLY_INT16;
+    if (name == "ushort" || name == "uint16") return PLY_UINT16;
+    if (name == "int" || name == "int32") return PLY_INT32;
+    if (name == "uint" || name == "uint32") return PLY_UINT32;
+    if (name == "float" || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_NONE;
+}
+
+// PLYĶȡascii ζȡհ׷ָbinary_little_endian Ϳȶȡ
+struct PlyValueReader {
+    const char* cur;
+    const char* end;
+    bool binary;
+
+    template <class T>
+    static double load(const unsigned char* b) { T v; std::memcpy(&v, b, sizeof(T)); return static_cast<double>(v); }
+
+    bool read(int type, double& out) {
+        if (!binary) {
+            char* next;
+            out = std::strtod(cur, &next);
+            if (next == cur) return false;
+            cur = next;
+            return true;
+        }
+        static const int sizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+        int size = sizes[type];
+        if (end - cur < size) return false;
+        unsigned char b[8];
+        std::memcpy(b, cur, size);
+        cur += size;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        std::reverse(b, b + size);  // ļΪС
+#endif
+        switch (type) {
+        case PLY_INT8: out = load<int8_t>(b); break;
+        case PLY_UINT8: out = load<uint8_t>(b); break;
+        case PLY_INT16: out = load<int16_t>(b); break;
+        case PLY_UINT16: out = load<uint16_t>(b); break;
+        case PLY_INT32: out = load<int32_t>(b); break;
+        case PLY_UINT32: out = load<uint32_t>(b); break;
+        case PLY_FLOAT32: out = load<float>(b); break;
+        default: out = load<double>(b); break;
+        }
+        return true;
+    }
+};
+
+// PLY֧ ascii  binary_little_endianvertex Ԫȡ x/y/z ԣֵͣface Ԫȡ
+// vertex_indices vertex_indexбǻԪ԰Ͷ
+bool loadPLY(const std::string& path, std::vector<Vector3>& verts, std::vector<MeshTriangle>& tris, std::string& error) {
+    std::string text;
+    if (!readFileText(path, text)) { error = path + ": ޷"; return false; }
+    struct Property { std::string name; int type = PLY_NONE, countType = PLY_NONE; };  // countType NONEʾб
+    struct Element { std::string name; long long count = 0; std::vector<Property> props; };
+    std::vector<Element> elements;
+    bool binary = false;
+    int lineNo = 0;
+    size_t pos = 0;
+    auto fail = [&](const std::string& why) {
+        error = path + (lineNo > 0 ? ":" + std::to_string(lineNo) : std::string()) + ": " + why;
+        return false;
+    };
+    std::string word, format;
+    bool headerDone = false;
+    while (!headerDone) {
+        if (pos >= text.size()) return fail("ȱ end_header");
+        ++lineNo;
+        const char* nl = static_cast<const char*>(std::memchr(&text[pos], '\n', text.size() - pos));
+        size_t eol = nl ? static_cast<size_t>(nl - text.data()) : text.size();
+        std::string headerLine(text, pos, eol - pos);  // ͷƳԭпܺ '\0'
+        SceneLineReader line{ &headerLine[0] };
+        pos = eol + 1;
+        if (lineNo == 1) {
+            if (!line.word(word) || word != "ply") return fail("PLYļ");
+            continue;
+        }
+        if (!line.word(word) || word == "comment" || word == "obj_info") continue;
+        if (word == "format") {
+            line.word(format);
+            if (format == "binary_little_endian") binary = true;
+            else if (format != "ascii") return fail("ֵ֧PLYʽ: " + format);
+        }
+        else if (word == "element") {
+            Element e;
+            std::string countText;
+            if (!line.word(e.name) || !line.word(countText)) return fail("element Ҫ  ");
+            // float  2^24 ϻᶪʧȣ±Ϊ intܳ INT_MAX
+            char* countEnd;
+            errno = 0;
+            e.count = std::strtoll(countText.c_str(), &countEnd, 10);
+            if (*countEnd != '\0' || errno == ERANGE || e.count < 0 || e.count > INT_MAX) return fail("element Ч: " + countText);
+            elements.push_back(e);
+        }
+        else if (word == "property") {
+            if (elements.empty()) return fail("property ֮ǰȱ element");
+            Property prop;
+            std::string typeName;
+            line.word(typeName);
+            if (typeName == "list") {
+                std::string countName, itemName;
+                line.word(countName);
+                line.word(itemName);
+                prop.countType = plyTypeFromName(countName);
+                prop.type = plyTypeFromName(itemName);
+                if (prop.countType == PLY_NONE) return fail("δ֪: " + countName);
+            }
+            else prop.type = plyTypeFromName(typeName);
+            if (prop.type == PLY_NONE) return fail("δ֪: " + typeName);
+            if (!line.word(prop.name)) return fail("property ȱ");
+            elements.back().props.push_back(prop);
+        }
+        else if (word == "end_header") headerDone = true;
+        else return fail("δ֪ͷ: " + word);
+    }
+    if (format.empty()) return fail("ȱ format");
+
+    lineNo = 0;  // Ĵָк
+    PlyValueReader reader{ text.data() + std::min(pos, text.size()), text.data() + text.size(), binary };
+    std::vector<int> corners;
+    size_t vertexBase = verts.size();
+    size_t vertexCount = 0;
+    for (const Element& e : elements) {
+        if (e.name == "vertex") vertexCount = static_cast<size_t>(e.count);  // ֮ŶĶ
+    }
+    bool vertexLoaded = false;
+    for (const Element& e : elements) {
+        bool isVertex = e.name == "vertex", isFace = e.name == "face";
+        if (isVertex) {
+            if (vertexLoaded) return fail("ظ vertex Ԫ");
+            vertexLoaded = true;
+            verts.reserve(verts.size() + static_cast<size_t>(std::min<long long>(e.count, text.size())));  // ÿԪռ1ֽڣͷ
+        }
+        if (isFace) tris.reserve(tris.size() + static_cast<size_t>(std::min<long long>(e.count, text.size())) * 2);
+        for (long long i = 0; i < e.count; ++i) {
+            Vector3 p;
+            for (const Property& prop : e.props) {
+                double value;
+                if (prop.countType == PLY_NONE) {
+                    if (!reader.read(prop.type, value)) return fail(" " + e.name + " Ԫǰ");
+                    if (isVertex) {
+                        if (prop.name == "x") p.x = static_cast<float>(value);
+                        else if (prop.name == "y") p.y = static_cast<float>(value);
+                        else if (prop.name == "z") p.z = static_cast<float>(value);
+                    }
+                    continue;
+                }
+                double n;
+                if (!reader.read(prop.countType, n) || n < 0) return fail(" " + e.name + " Ԫǰ");
+                bool indices = isFace && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+                corners.clear();
+                for (int k = 0; k < static_cast<int>(n); ++k) {
+                    if (!reader.read(prop.type, value)) return fail(" " + e.name + " Ԫǰ");
+                    if (indices) corners.push_back(static_cast<int>(value));
+                }
+                if (!indices) continue;
+                if (corners.size() < 3) return fail("Ҫ3");
+                for (int& c : corners) c += static_cast<int>(vertexBase);
+                if (!appendFan(corners, vertexBase + vertexCount, tris)) return fail("Ķ±Խ");
+            }
+            if (isVertex) {
+                if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) return fail(" " + std::to_string(i) + " ");
+                verts.push_back(p);
+            }
+        }
+    }
+    return true;
+}
+
+// չ.obj / .plyִСдҪһ
+bool loadMeshFile(const std::string& path, std::vector<Vector3>& verts, std::vector<MeshTriangle>& tris, std::string& error) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    for (char& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    bool ok;
+    if (ext == ".obj") ok = loadOBJ(path, verts, tris, error);
+    else if (ext == ".ply") ok = loadPLY(path, verts, tris, error);
+    else { error = path + ": ֵ֧ʽҪ .obj  .ply"; return false; }
+    if (ok && tris.empty()) { error = path + ": û"; return false; }
+    return ok;
+}
+
+// ¼ⲿļ·ȡ·빤Ŀ¼޹أstamp ΪȡǰĴС޸ʱ
+void addSceneDependency(Scene& s, const std::string& path, const SceneSourceStamp& stamp) {
+    std::error_code ec;
+    std::string full = std::filesystem::absolute(path, ec).lexically_normal().string();
+    if (ec) full = path;
+    for (char c : full) s.dependencyPaths.push_back(c);
+    s.dependencyPaths.push_back('\0');
+    s.dependencyStamps.push_back(stamp);
+}
+
+// ı ss ӦΪճʧʱ error Ϊ "ļ:к: ԭ"
+bool parseSceneText(const std::string& path, Scene& s, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) { error = path + ": ޷"; return false; }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::unordered_map<std::string, int> materialIDs, meshIDs;
+    std::string keyword, name;
+    int lineNo = 0;
+    size_t pos = 0;
+    SceneLineReader line{ nullptr };
+    auto fail = [&](const std::string& why) {
+        error = path + ":" + std::to_string(lineNo) + ": " + (line.nonFinite ? std::string("ֵ nan/inf") : why);
+        return false;
+    };
+    while (pos < text.size()) {
+        ++lineNo;
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) eol = text.size();
+        const char* hash = static_cast<const char*>(std::memchr(&text[pos], '#', eol - pos));  // ֻڱڲע
+        text[hash ? static_cast<size_t>(hash - text.data()) : eol] = '\0';  // ضעβeol == size() ʱдǽβ '\0'
+        line = SceneLineReader{ &text[pos] };
+        pos = eol + 1;
+        if (!line.word(keyword)) continue;  // 
+
+        auto lookupMaterial = [&](int& id) {
+            if (!line.word(name)) return fail("ȱٲ");
+            auto it = materialIDs.find(name);
+            if (it == materialIDs.end()) return fail("δĲ: " + name);
+            id = it->second;
+            return true;
+        };
+        if (keyword == "camera") {
+            float fovDeg;
+            if (!line.vec(s.cameraPos) || !line.vec(s.lookAt) || !line.number(fovDeg)) return fail("camera Ҫ λ עӵ ҰǶ");
+            Vector3 view = s.lookAt - s.cameraPos;
+            if (view.x == 0.0f && view.y == 0.0f && view.z == 0.0f) return fail("camera λעӵ㲻غ");
+            if (view.x == 0.0f && view.z == 0.0f) return fail("camera ֱϻ£Y˵õ");
+            if (!(fovDeg > 0.0f && fovDeg < 180.0f)) return fail("camera ҰǶȱ0180֮");
+            s.fov = fovDeg * static_cast<float>(M_PI) / 180.0f;
+        }
+        else if (keyword == "light") {
+            if (!line.vec(s.lightPos)) return fail("light Ҫλ");
+            if (!line.atEnd() && !line.vec(s.lightColor)) return fail("light ɫҪ3");
+        }
+        else if (keyword == "background") {
+            if (!line.vec(s.bgColor)) return fail("background Ҫɫ");
+        }
+        else if (keyword == "material") {
+            if (!line.word(name)) return fail("material ȱ");
+            Material m;
+            std::string key;
+            while (line.word(key)) {
+                bool ok = true;
+                if (key == "color") ok = line.vec(m.color);
+                else if (key == "ka") ok = line.number(m.ka);
+                else if (key == "kd") ok = line.number(m.kd);
+                else if (key == "ks") ok = line.number(m.ks);
+                else if (key == "kr") ok = line.number(m.kr);
+                else if (key == "shininess") ok = line.number(m.shininess);
+                else if (key == "roughness") ok = line.number(m.roughness);
+                else if (key == "eta") ok = line.number(m.eta);
+                else if (key == "metal") m.isMetallic = true;
+                else if (key == "refract") m.isRefractive = true;
+                else if (key == "texture") {
+                    std::string tex;
+                    ok = line.word(tex);
+                    if (tex == "wood") { m.texture = TEX_WOOD_GRAIN; m.textureEval = woodTextureEval; }
+                    else if (tex == "floor") m.texture = TEX_FLOOR_PLANKS;
+                    else if (tex == "none") m.texture = TEX_NONE;
+                    else return fail("δ֪: " + tex);
+                }
+                else return fail("δ֪: " + key);
+                if (!ok) return fail("ȱֵ: " + key);
+            }
+            if (materialIDs.count(name)) return fail("ظ: " + name);
+            materialIDs[name] = s.addMaterial(m);
+        }
+        else if (keyword == "sphere") {
+            Vector3 c;
+            float r;
+            int id;
+            if (!line.vec(c) || !line.number(r)) return fail("sphere Ҫ  뾶 ");
+            if (!(r > 0.0f)) return fail("뾶Ϊ");
+            if (!lookupMaterial(id)) return false;
+            s.spheres.push_back(Sphere(c, r, id));
+        }
+        else if (keyword == "box") {
+            Vector3 a, b;
+            int id;
+            if (!line.vec(a) || !line.vec(b)) return fail("box Ҫ С  ");
+            if (a.x > b.x || a.y > b.y || a.z > b.z) return fail("box Сÿ϶ܴ");
+            if (!lookupMaterial(id)) return false;
+            s.boxes.push_back(Box(a, b, id));
+        }
+        else if (keyword == "rect" || keyword == "plane") {
+            Vector3 a, b, n;
+            int id;
+            if (!line.vec(a) || !line.vec(b) || !line.vec(n)) return fail(keyword + " Ҫ С   ");
+            if (!lookupMaterial(id)) return false;
+            n = n.normalize();
+            int axis = std::abs(n.x) > 0.5f ? 0 : (std::abs(n.y) > 0.5f ? 1 : 2);
+            if (std::abs(axisComponent(n, axis)) < 0.999f) return fail("η߱");
+            if (axisComponent(a, axis) != axisComponent(b, axis)) return fail("ڷϵķͬ");
+            s.rects.push_back(Rect(vmin(a, b), vmax(a, b), n, id));
+        }
+        else if (keyword == "mesh") {
+            std::string file;
+            if (!line.word(name) || !line.word(file)) return fail("mesh Ҫ  ļ");
+            if (meshIDs.count(name)) return fail("ظ: " + name);
+            std::filesystem::path meshPath(file);
+            if (meshPath.is_relative()) meshPath = std::filesystem::path(path).parent_path() / meshPath;
+            SceneSourceStamp stamp;
+            if (!sceneSourceStamp(meshPath.string(), stamp)) return fail("޷ȡļ: " + meshPath.string());
+            std::vector<Vector3> verts;
+            std::vector<MeshTriangle> tris;
+            std::string meshError;
+            if (!loadMeshFile(meshPath.string(), verts, tris, meshError)) return fail("ʧ: " + meshError);
+            meshIDs[name] = s.addMesh(verts, tris);
+            addSceneDependency(s, meshPath.string(), stamp);
+        }
+        else if (keyword == "instance") {
+            if (!line.word(name)) return fail("instance Ҫ  ");
+            auto it = meshIDs.find(name);
+            if (it == meshIDs.end()) return fail("δ: " + name);
+            int id;
+            if (!lookupMaterial(id)) return false;
+            Transform xf = Transform::identity();
+            std::string op;
+            while (line.word(op)) {
+                Vector3 v;
+                if (op == "translate") {
+                    if (!line.vec(v)) return fail("translate Ҫ3");
+                    xf = Transform::translate(v) * xf;
+                }
+                else if (op == "rotate") {
+                    std::string axis;
+                    float degrees;
+                    if (!line.word(axis) || axis.size() != 1 || axis[0] < 'x' || axis[0] > 'z' || !line.number(degrees)) {
+                        return fail("rotate Ҫ x|y|z Ƕ");
+                    }
+                    xf = Transform::rotate(axis[0] - 'x', degrees) * xf;
+                }
+                else if (op == "scale") {
+                    if (!line.number(v.x)) return fail("scale Ҫ13");
+                    if (!line.number(v.y)) v.y = v.z = v.x;  // ֻһȱ
+                    else if (!line.number(v.z)) return fail("scale Ҫ13");
+                    xf = Transform::scale(v) * xf;
+                }
+                else if (op == "matrix") {
+                    Transform m;
+                    for (int r = 0; r < 3; ++r) {
+                        for (int c = 0; c < 4; ++c) {
+                            if (!line.number(m.m[r][c])) return fail("matrix Ҫ123x4");
+                        }
+                    }
+                    xf = m * xf;
+                }
+                else return fail("δ֪ʵ任: " + op);
+            }
+            if (!s.addInstance(it->second, xf, id)) return fail("ʵ任");
+        }
+        else return fail("δ֪: " + keyword);
+        if (!line.atEnd()) return fail("Ĳ");
+    }
+    return true;
+}
+
+// һдOBJΪԼķΧ±1ʼ
+bool writeMeshOBJ(const std::string& path, const Scene& s, const Mesh& mesh) {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    for (int i = 0; i < mesh.vertexCount; ++i) {
+        const Vector3& v = s.meshVertices[mesh.vertexOffset + i];
+        std::fprintf(f, "v %.9g %.9g %.9g\n", v.x, v.y, v.z);
+    }
+    for (int i = 0; i < mesh.triCount; ++i) {
+        const MeshTriangle& t = s.meshTriangles[mesh.triOffset + i];
+        std::fprintf(f, "f %d %d %d\n", t.v[0] - mesh.vertexOffset + 1, t.v[1] - mesh.vertexOffset + 1, t.v[2] - mesh.vertexOffset + 1);
+    }
+    return std::fclose(f) == 0;
+}
+
+// ѳдıļΪ m0, m1, ...9λЧ֣λһ£
+// ΨһҰǶȣļԶΪλȵĻһΣؿܲ1ulp
+// дͬĿ¼ <ļ>.mesh<i>.objʵı任д matrix
+bool writeSceneText(const std::string& path, const Scene& s) {
+    for (size_t i = 0; i < s.meshes.size(); ++i) {
+        if (!writeMeshOBJ(path + ".mesh" + std::to_string(i) + ".obj", s, s.meshes[i])) return false;
+    }
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    auto vec = [&](const Vector3& v) { std::fprintf(f, " %.9g %.9g %.9g", v.x, v.y, v.z); };
+    std::fprintf(f, "camera"); vec(s.cameraPos); vec(s.lookAt); std::fprintf(f, " %.9g\n", s.fov * 180.0f / static_cast<float>(M_PI));
+    std::fprintf(f, "light"); vec(s.lightPos); vec(s.lightColor); std::fprintf(f, "\n");
+    std::fprintf(f, "background"); vec(s.bgColor); std::fprintf(f, "\n");
+    for (size_t i = 0; i < s.materials.size(); ++i) {
+        const Material& m = s.materials[i];
+        std::fprintf(f, "material m%zu color", i); vec(m.color);
+        std::fprintf(f, " ka %.9g kd %.9g ks %.9g kr %.9g shininess %.9g roughness %.9g eta %.9g",
+            m.ka, m.kd, m.ks, m.kr, m.shininess, m.roughness, m.eta);
+        if (m.isMetallic) std::fprintf(f, " metal");
+        if (m.isRefractive) std::fprintf(f, " refract");
+        if (m.texture == TEX_WOOD_GRAIN) std::fprintf(f, " texture wood");
+        else if (m.texture == TEX_FLOOR_PLANKS) std::fprintf(f, " texture floor");
+        std::fprintf(f, "\n");
+    }
+    for (const Sphere& sp : s.spheres) { std::fprintf(f, "sphere"); vec(sp.center); std::fprintf(f, " %.9g m%d\n", sp.radius, sp.materialID); }
+    for (const Box& b : s.boxes) { std::fprintf(f, "box"); vec(b.min); vec(b.max); std::fprintf(f, " m%d\n", b.materialID); }
+    for (const Rect& r : s.rects) { std::fprintf(f, "rect"); vec(r.min); vec(r.max); vec(r.normal); std::fprintf(f, " m%d\n", r.materialID); }
+    std::string baseName = std::filesystem::path(path).filename().string();
+    for (size_t i = 0; i < s.meshes.size(); ++i) std::fprintf(f, "mesh g%zu %s.mesh%zu.obj\n", i, baseName.c_str(), i);
+    for (const MeshInstance& inst : s.instances) {
+        std::fprintf(f, "instance g%d m%d matrix", inst.mesh, inst.materialID);
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 4; ++c) std::fprintf(f, " %.9g", inst.objectToWorld.m[r][c]);
+        }
+        std::fprintf(f, "\n");
+    }
+    return std::fclose(f) == 0;
+}
+
+// ---- Ƴ ----
+const char SCENE_CACHE_MAGIC[8] = { 'R', 'T', 'S', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t SCENE_CACHE_VERSION = 3;  // һڴ沼ֻBVHԼıʱ13BVHޣ
+const uint32_t SCENE_CACHE_ENDIAN = 0x01020304u;
+const uint64_t SCENE_CACHE_ALIGN = 64;
+
+enum SceneCacheSection {
+    SEC_MATERIALS = 0, SEC_SPHERES, SEC_BOXES, SEC_RECTS, SEC_PRIMS, SEC_NODES, SEC_PRIM_INDICES,
+    SEC_SOA_CX, SEC_SOA_CY, SEC_SOA_CZ, SEC_SOA_R2,
+    SEC_SOA_MINX, SEC_SOA_MINY, SEC_SOA_MINZ, SEC_SOA_MAXX, SEC_SOA_MAXY, SEC_SOA_MAXZ,
+    SEC_LEAF_SPHERES,
+    SEC_MESH_VERTICES, SEC_MESH_TRIANGLES, SEC_MESH_NODES, SEC_MESHES, SEC_INSTANCES, SEC_LEAF_INSTANCES,
+    SEC_DEPENDENCY_PATHS, SEC_DEPENDENCY_STAMPS,
+    SEC_COUNT
+};
+
+struct SceneCacheHeader {
+    char magic[8];
+    uint32_t version, endian, simdWidth, maxLeafSize;  // SoAҶӻSIMDȣȲͬĳ򲻹û
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    Vector3 cameraPos, lookAt, lightPos, lightColor, bgColor;
+    float fov;
+    struct Section {
+        uint64_t offset, count;
+        uint32_t elemSize, reserved;
+    } sections[SEC_COUNT];
+};
+
+static_assert(std::is_trivially_copyable<Material>::value && std::is_trivially_copyable<Sphere>::value &&
+    std::is_trivially_copyable<Box>::value && std::is_trivially_copyable<Rect>::value &&
+    std::is_trivially_copyable<PrimRef>::value && std::is_trivially_copyable<BVHNode>::value &&
+    std::is_trivially_copyable<MeshTriangle>::value && std::is_trivially_copyable<Mesh>::value &&
+    std::is_trivially_copyable<MeshInstance>::value && std::is_trivially_copyable<SceneSourceStamp>::value,
+    "水ڴ沼ֱӳ䣬ͱƽ");
+
+// ΰѳҪ齻 f(ں, )
+template <class F>
+void forEachCachedArray(Scene& s, F&& f) {
+    f(SEC_MATERIALS, s.materials); f(SEC_SPHERES, s.spheres); f(SEC_BOXES, s.boxes); f(SEC_RECTS, s.rects);
+    f(SEC_PRIMS, s.prims); f(SEC_NODES, s.bvh.nodes); f(SEC_PRIM_INDICES, s.bvh.primIndices);
+    f(SEC_SOA_CX, s.soa.cx); f(SEC_SOA_CY, s.soa.cy); f(SEC_SOA_CZ, s.soa.cz); f(SEC_SOA_R2, s.soa.r2);
+    f(SEC_SOA_MINX, s.soa.minX); f(SEC_SOA_MINY, s.soa.minY); f(SEC_SOA_MINZ, s.soa.minZ);
+    f(SEC_SOA_MAXX, s.soa.maxX); f(SEC_SOA_MAXY, s.soa.maxY); f(SEC_SOA_MAXZ, s.soa.maxZ);
+    f(SEC_LEAF_SPHERES, s.soa.leafSphereCount);
+    f(SEC_MESH_VERTICES, s.meshVertices); f(SEC_MESH_TRIANGLES, s.meshTriangles); f(SEC_MESH_NODES, s.meshNodes);
+    f(SEC_MESHES, s.meshes); f(SEC_INSTANCES, s.instances); f(SEC_LEAF_INSTANCES, s.soa.leafInstanceCount);
+    f(SEC_DEPENDENCY_PATHS, s.dependencyPaths); f(SEC_DEPENDENCY_STAMPS, s.dependencyStamps);
+}
+
+inline uint64_t alignCacheOffset(uint64_t offset) {
+    return (offset + SCENE_CACHE_ALIGN - 1) / SCENE_CACHE_ALIGN * SCENE_CACHE_ALIGN;
+}
+
+// д棺дʱļٸ;ʧܲ𻵵Ļ
+bool writeSceneCache(Scene& s, const std::string& path, const SceneSourceStamp& stamp) {
+    SceneCacheHeader header = SceneCacheHeader();  // ֵʼδֶֽΪ0
+    std::memcpy(header.magic, SCENE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = SCENE_CACHE_VERSION;
+    header.endian = SCENE_CACHE_ENDIAN;
+    header.simdWidth = SIMD_WIDTH;
+    header.maxLeafSize = static_cast<uint32_t>(s.bvh.maxLeafSize);
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.cameraPos = s.cameraPos; header.lookAt = s.lookAt; header.fov = s.fov;
+    header.lightPos = s.lightPos; header.lightColor = s.lightColor; header.bgColor = s.bgColor;
+    uint64_t offset = alignCacheOffset(sizeof(header));
+    forEachCachedArray(s, [&](int sec, auto& arr) {
+        header.sections[sec].offset = offset;
+        header.sections[sec].count = arr.size();
+        header.sections[sec].elemSize = sizeof(arr[0]);
+        offset = alignCacheOffset(offset + arr.size() * sizeof(arr[0]));
+    });
+
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    forEachCachedArray(s, [&](int sec, auto& arr) {
+        for (; written < header.sections[sec].offset; ++written) out.put('\0');  // 
+        out.write(reinterpret_cast<const char*>(arr.data()), static_cast<std::streamsize>(arr.size() * sizeof(arr[0])));
+        written = header.sections[sec].offset + arr.size() * sizeof(arr[0]);
+    });
+    out.close();
+    std::error_code ec;
+    if (!out) { std::filesystem::remove(tmpPath, ec); return false; }
+    std::filesystem::rename(tmpPath, path, ec);
+    return !ec;
+}
+
+// ӳ仺棺ͷԴļһҸʱֱָӳ򷵻false
+bool mapSceneCache(Scene& s, const std::string& path, const SceneSourceStamp& stamp) {
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->open(path) || file->size < sizeof(SceneCacheHeader)) return false;
+    SceneCacheHeader header;
+    std::memcpy(&header, file->data, sizeof(header));
+    if (std::memcmp(header.magic, SCENE_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != SCENE_CACHE_VERSION ||
+        header.endian != SCENE_CACHE_ENDIAN || header.simdWidth != SIMD_WIDTH ||
+        header.sourceSize != stamp.size || header.sourceTime != stamp.time) return false;
+    bool valid = true;
+    forEachCachedArray(s, [&](int sec, auto& arr) {
+        const SceneCacheHeader::Section& h = header.sections[sec];
+        valid = valid && h.elemSize == sizeof(arr[0]) && h.offset % SCENE_CACHE_ALIGN == 0 &&
+            h.offset <= file->size && h.count <= (file->size - h.offset) / sizeof(arr[0]);
+    });
+    if (!valid) return false;
+
+    // ⲿļһ仯ҲΪ
+    char* base = static_cast<char*>(file->data);
+    const char* paths = base + header.sections[SEC_DEPENDENCY_PATHS].offset;
+    const SceneSourceStamp* stamps = reinterpret_cast<const SceneSourceStamp*>(base + header.sections[SEC_DEPENDENCY_STAMPS].offset);
+    size_t pathBytes = static_cast<size_t>(header.sections[SEC_DEPENDENCY_PATHS].count), pathPos = 0;
+    for (uint64_t i = 0; i < header.sections[SEC_DEPENDENCY_STAMPS].count; ++i) {
+        const char* end = static_cast<const char*>(std::memchr(paths + pathPos, '\0', pathBytes - pathPos));
+        if (!end) return false;
+        SceneSourceStamp now;
+        if (!sceneSourceStamp(std::string(paths + pathPos, end), now) || now.size != stamps[i].size || now.time != stamps[i].time) return false;
+        pathPos = static_cast<size_t>(end - paths) + 1;
+    }
+    forEachCachedArray(s, [&](int sec, auto& arr) {
+        typedef typename std::remove_reference<decltype(arr[0])>::type Elem;
+        arr.attach(reinterpret_cast<Elem*>(base + header.sections[sec].offset), static_cast<size_t>(header.sections[sec].count));
+    });
+    for (Material& m : s.materials) {
+        if (m.texture == TEX_WOOD_GRAIN) m.textureEval = woodTextureEval;  // ֵʽУдʱƣֻӰ챾̣
+    }
+    s.bvh.leafWidth = SIMD_WIDTH;
+    s.bvh.maxLeafSize = static_cast<int>(header.maxLeafSize);
+    s.cameraPos = header.cameraPos; s.lookAt = header.lookAt; s.fov = header.fov;
+    s.lightPos = header.lightPos; s.lightColor = header.lightColor; s.bgColor = header.bgColor;
+    s.cacheMapping = std::move(file);
+    ++s.geometryVersion;
+    return true;
+}
+
+// ıЧʱֱӳ䣬BVHд棨<ļ>.cache
+bool loadSceneFile(Scene& s, const std::string& path) {
+    auto start = std::chrono::high_resolution_clock::now();
+    auto elapsedMs = [&]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+    SceneSourceStamp stamp;
+    if (!sceneSourceStamp(path, stamp)) {
+        std::cerr << "޷ȡļ: " << path << std::endl;
+        return false;
+    }
+    std::string cachePath = path + ".cache";
+    if (useSceneCache && mapSceneCache(s, cachePath, stamp)) {
+        std::cout << "ӳ: " << cachePath << ", " << s.prims.size() << " ͼԪ, " << elapsedMs() << " " << std::endl;
+        return true;
+    }
+    std::string error;
+    if (!parseSceneText(path, s, error)) {
+        std::cerr << "ļ: " << error << std::endl;
+        return false;
+    }
+    double parseMs = elapsedMs();
+    s.buildBVH();
+    std::cout << " " << parseMs << " , +BVH " << elapsedMs() << " " << std::endl;
+    if (useSceneCache && !writeSceneCache(s, cachePath, stamp)) std::cerr << "дʧ: " << cachePath << std::endl;
+    return true;
+}
+
+// ʼ֡岢ó壨OpenGLļʧʱfalse
+bool tryInitScene() {
+    rng.seed(renderSeed);  // ʹãָģӳʼ
+    initPerlinNoise();  // ʼû
+    framebuffer = new unsigned char[imageWidth * imageHeight * 3];  // ֡
+    hdrBuffer = new float[imageWidth * imageHeight * 3];  // 両֡
+    std::fill(framebuffer, framebuffer + imageWidth * imageHeight * 3, 0);
+    std::fill(hdrBuffer, hdrBuffer + imageWidth * imageHeight * 3, 0.0f);
+
+    if (!sceneFilePath.empty()) {
+        if (!loadSceneFile(*scene, sceneFilePath)) return false;
+    }
+    else {
+        buildBuiltinScene();
+        scene->buildBVH();  // 󹹽ٽṹ
+    }
+    scene->bakeTextures();  // 決ѡ TEX_EVAL_BAKED ľ
+    return true;
+}
+
+// ʱʧܼ˳ڵ tryInitSceneֻܾ
+void initScene() {
+    if (!tryInitScene()) std::exit(1);
+}
+
+// ͷ initScene() ֡ͳ׼֮ؽ
+void releaseScene() {
+    delete[] framebuffer;
+    delete[] hdrBuffer;
+    delete scene;
+    framebuffer = nullptr;
+    hdrBuffer = nullptr;
+    scene = nullptr;
+}
+
+// ʼOpenGLͳ壬֡ϴͨ
+void init() {
+    initGL();
+    initScene();
+    framebufferUpload.init();
+    scene->markAllDirty();  // ɱ洢δ壬֡ϴ
+}
+
+// ʾص֡ȾΪȫı
+void display() {
+    glClear(GL_COLOR_BUFFER_BIT);  // 
+    if (gpuBackend) {
+        glBindTexture(GL_TEXTURE_2D, gpuTracer.outputTexture);  // GPUˣֱʾɫCPU
+    }
+    else {
+        glBindTexture(GL_TEXTURE_2D, texture);  // 
+        std::lock_guard<std::mutex> lock(scene->framebufferMutex);  // ʽȾʱ̻߳ͬʱдطֿ
+        framebufferUpload.upload();  // ֻϴֿ
+    }
+    glBegin(GL_QUADS);  // ȫı
+    glTexCoord2f(0, 1); glVertex2f(-1, -1);  // 
+    glTexCoord2f(1, 1); glVertex2f(1, -1);   // 
+    glTexCoord2f(1, 0); glVertex2f(1, 1);    // 
+    glTexCoord2f(0, 0); glVertex2f(-1, 1);   // 
+    glEnd();
+    glutSwapBuffers();  // ˫彻
+}
+
+// ʱصʽȾʱػ棬ڱʾɱ
+// GPUύɫGLֻڴ̣߳δʱٴδ
+void onTimer(int) {
+    if (gpuBackend) {
+        if (gpuTracer.running()) {
+            gpuTracer.dispatch(*scene, true);
+            char title[128];
+            std::snprintf(title, sizeof(title), "GPU Ray Tracer - Cornell Box with Wood Grain (pass %d)", gpuTracer.passes);
+            glutSetWindowTitle(title);
+            glutPostRedisplay();
+            glutTimerFunc(1, onTimer, 0);
+            return;
+        }
+    }
+    else if (scene->framebufferDirty.exchange(false)) {
+        char title[128];
+        std::snprintf(title, sizeof(title), "CPU Ray Tracer - Cornell Box with Wood Grain (pass %d)", scene->progressivePasses.load());
+        glutSetWindowTitle(title);
+        glutPostRedisplay();
+    }
+    glutTimerFunc(33, onTimer, 0);  // Լ30Hz
+}
+
+// ǰȾ֡
+void restartRender() {
+    if (gpuBackend) {
+        gpuTracer.restart(renderPasses > 0 ? renderPasses : 256);
+    }
+    else if (progressiveMode) {
+        scene->startProgressive(renderPasses > 0 ? renderPasses : 256);  // أڱӦ
+    }
+    else {
+        scene->render();
+        glutPostRedisplay();  // ˢʾ
+    }
+}
+
+int selectedMaterial = 0;  // V ѡС< > ֲڶȵĲ
+
+// ޸ĹԴ֮ǰą̃ʽȾڶȡֹͣ
+void beginSceneEdit() {
+    scene->stopProgressive();
+}
+
+// ޸ĹԴ֮ãGPUϴʱCPU˵ĵ0鸴߻
+void finishSceneEdit() {
+    std::cout << "Դ (" << scene->lightPos.x << ", " << scene->lightPos.y << ", " << scene->lightPos.z << "), ǿ " << scene->lightColor.x;
+    if (!scene->materials.empty()) std::cout << ";  " << selectedMaterial << " ֲڶ " << scene->materials[selectedMaterial].roughness;
+    std::cout << std::endl;
+    gpuTracer.updateMaterials(*scene);
+    restartRender();
+}
+
+// صˮƽƶԴPageUp/PageDown Դ
+void specialKey(int key, int x, int y) {
+    (void)x; (void)y;
+    const float step = 0.1f;
+    Vector3 delta;
+    if (key == GLUT_KEY_LEFT) delta.x = -step;
+    else if (key == GLUT_KEY_RIGHT) delta.x = step;
+    else if (key == GLUT_KEY_UP) delta.z = -step;
+    else if (key == GLUT_KEY_DOWN) delta.z = step;
+    else if (key == GLUT_KEY_PAGE_UP) delta.y = step;
+    else if (key == GLUT_KEY_PAGE_DOWN) delta.y = -step;
+    else return;
+    beginSceneEdit();
+    scene->lightPos = scene->lightPos + delta;
+    finishSceneEdit();
+}
+
+// ̻ص
+void keyboard(unsigned char key, int x, int y) {
+    if (key == 27) {  // ESC˳
+        scene->stopProgressive();
+        exit(0);
+    }
+    if (key == ' ') {  // ոȾ
+        std::cout << "\nʼȾ..." << std::endl;
+        restartRender();
+    }
+    if (key == 's' || key == 'S') {  // 濴ʱֹͣʽȾ
+        if (gpuBackend) {
+            gpuTracer.maxPasses = gpuTracer.passes;
+            std::cout << "ֹͣGPUʽȾ: " << gpuTracer.passes << " " << std::endl;
+        }
+        else {
+            scene->stopProgressive();
+            std::cout << "ֹͣʽȾ: " << scene->progressivePasses << " " << std::endl;
+        }
+    }
+    if (key == 'g' || key == 'G') {  // лCPU/GPUˣ¿ʼȾ
+        if (!gpuBackend && !gpuTracer.start(*scene)) return;
+        gpuBackend = !gpuBackend;
+        if (gpuBackend) {
+            scene->stopProgressive();  // ˲ͬʱ
+            gpuTracer.restart(renderPasses > 0 ? renderPasses : 256);
+        }
+        else {
+            if (progressiveMode) scene->startProgressive(renderPasses > 0 ? renderPasses : 256);
+            scene->markAllDirty();
+        }
+        std::cout << "Ⱦ: " << (gpuBackend ? "GPU" : "CPU") << std::endl;
+        glutPostRedisplay();
+    }
+    if (key == '[' || key == ']') {  // Դǿ
+        beginSceneEdit();
+        scene->lightColor = scene->lightColor * (key == ']' ? 1.25f : 0.8f);
+        finishSceneEdit();
+        return;
+    }
+    if ((key == 'v' || key == 'V') && !scene->materials.empty()) {  // ѡһ
+        selectedMaterial = (selectedMaterial + 1) % static_cast<int>(scene->materials.size());
+        std::cout << "ѡв " << selectedMaterial << ", ֲڶ " << scene->materials[selectedMaterial].roughness << std::endl;
+        return;
+    }
+    if ((key == ',' || key == '<' || key == '.' || key == '>') && !scene->materials.empty()) {  // ѡвʵĴֲڶ
+        beginSceneEdit();
+        float& roughness = scene->materials[selectedMaterial].roughness;
+        roughness = std::min(1.0f, std::max(0.0f, roughness + (key == '.' || key == '>' ? 0.05f : -0.05f)));
+        finishSceneEdit();
+        return;
+    }
+    bool retone = true;  // ع⡢ɫӳ䡢ֻº֡壬׷
+    if (key == '+' || key == '=') exposureEV += 0.5f;
+    else if (key == '-' || key == '_') exposureEV -= 0.5f;
+    else if (key == 't' || key == 'T') toneMapOperator = (toneMapOperator + 1) % (TONEMAP_ACES + 1);
+    else if (key == 'd' || key == 'D') ditherOutput = !ditherOutput;
+    else retone = false;
+    if (retone) {
+        static const char* names[] = { "none", "reinhard", "aces" };
+        std::cout << "ع " << exposureEV << " EV, ɫӳ " << names[toneMapOperator] << ",  " << (ditherOutput ? "" : "") << std::endl;
+        std::lock_guard<std::mutex> lock(scene->framebufferMutex);  // ʽȾͬʱдطֿ飻̳߳æڵǰ̴߳֡
+        postProcessRegion(0, 0, imageWidth, imageHeight);
+        scene->markAllDirty();
+        if (gpuTracer.ready) gpuTracer.dispatch(*scene, false);  // GPUۼƽֻͬ±
+        glutPostRedisplay();
+    }
+}
+
+// вglutInit֮ãGLUTĲѱƳ
+// --threads NȾ߳1Ϊ߳·
+// --seed S   ̶ӣͬ߳λһ
+// --no-packetsر2x2߰ߺӰ׷
+// --glossy P ģѲ always | firstĬϣ| roulette
+// --blocking رսʽȾָͬȾ֡Ⱦڼ䲻Ӧ
+// --passes N ʽȾ޽ģʽΪۼƵıÿÿ1
+// --size WxH ȾֱʣĬ800x600ģʽҲڴС
+// --output F ޽ģʽȾд Fչѡ .ppm/.png 8λ.pfm/.exr Ը㣩
+// --headless ޽ģʽδ --output ʱд render.ppm
+// --adaptive NӦȾ֡ƽÿ N 4ֲ
+// --aa-threshold EӦֵȾֵı׼Ĭ0.01
+// --wood M   ľľֵʽ procedural| bakedʱ決mipmap| simdĬϣSIMD
+// --heatmap F޽ģʽ¶дÿشȶͼڵ+ͼԪαɫ.pfm/.exr ԭʼֵ
+// --scene L   cornellĬϣ| stress20000С| glossyģ䣩
+// --bench [quick|micro]޽л׼׼̶ӣΪÿһJSONmicro ֻܺ΢׼
+// --bench-out F׼Խд FĬϱ׼
+// --scene-file Fıļأʽ parseSceneText״μغ F.cacheֱ֮ӳ
+// --no-scene-cacheǽıд
+// --export-scene F޽ģʽѵǰû --scene-fileдıļ
+// --exposure EV8λ봰ʾع⣨ɫ 2^EVPFM/EXR Աԭʼȣ
+// --tonemap Mɫӳ noneĬϣضϣ| reinhard | aces
+// --dither   8λʱÿɫ
+// --worker PORTΪֲʽȾĹڵ㣬 PORT Эڵ㷢Ⱦֿ飨ҪX
+// --workers H:P,... --output һʹãѻַֿЩڵȾϲļڸڵͬһ·
+// --dist-timeout Sڵ㳬 S 루Ĭ120ûзطֿ鼴ΪʧЧֿڵȾ
+//                   ڵͬΪճʱЭڵ㳬 S ûϢϿ
+// --gpu      ģʽʹGPUɫˣҪ OpenGL 4.3֧ʵʱ˵CPU
+// --denoise  Ⱦø -trous ˲֡
+// --glossy-samples NȾдֲڷѵĲĬ16ʱ1~4ɣ
+// --aux F    ޽ģʽ¶д F  .albedo/.normal/.depth 汾 out.pfm -> out.albedo.pfm
+void parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            renderThreads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--glossy") == 0 && i + 1 < argc) {
+            const char* policy = argv[++i];
+            if (std::strcmp(policy, "always") == 0) glossyPolicy = GLOSSY_SPLIT_ALWAYS;
+            else if (std::strcmp(policy, "first") == 0) glossyPolicy = GLOSSY_SPLIT_FIRST;
+            else if (std::strcmp(policy, "roulette") == 0) glossyPolicy = GLOSSY_ROULETTE;
+            else std::cerr << "δ֪ģ: " << policy << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--blocking") == 0) {
+            progressiveMode = false;
+        }
+        else if (std::strcmp(argv[i], "--passes") == 0 && i + 1 < argc) {
+            renderPasses = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            int w = 0, h = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+                imageWidth = w;
+                imageHeight = h;
+            }
+            else std::cerr << "ЧֱʣӦΪ xߣ: " << argv[i] << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--headless") == 0) {
+            if (outputPath.empty()) outputPath = "render.ppm";
+        }
+        else if (std::strcmp(argv[i], "--adaptive") == 0 && i + 1 < argc) {
+            adaptiveBudget = std::max(AA_BASE_SAMPLES, std::atoi(argv[++i]));
+            progressiveMode = false;  // Ӧоֲ뽥ʽȾ
+        }
+        else if (std::strcmp(argv[i], "--aa-threshold") == 0 && i + 1 < argc) {
+            adaptiveThreshold = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--wood") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (std::strcmp(mode, "procedural") == 0) woodTextureEval = TEX_EVAL_PROCEDURAL;
+            else if (std::strcmp(mode, "baked") == 0) woodTextureEval = TEX_EVAL_BAKED;
+            else if (std::strcmp(mode, "simd") == 0) woodTextureEval = TEX_EVAL_SIMD;
+            else std::cerr << "δ֪ľֵʽ: " << mode << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--heatmap") == 0 && i + 1 < argc) {
+            heatmapPath = argv[++i];
+#ifndef RT_STATS
+            std::cerr << "--heatmap Ҫ -DRT_STATS ±룬Ѻ" << std::endl;
+#endif
+        }
+        else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            const char* layout = argv[++i];
+            if (std::strcmp(layout, "cornell") == 0) sceneLayout = SCENE_CORNELL;
+            else if (std::strcmp(layout, "stress") == 0) sceneLayout = SCENE_STRESS;
+            else if (std::strcmp(layout, "glossy") == 0) sceneLayout = SCENE_GLOSSY;
+            else std::cerr << "δ֪: " << layout << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--scene-file") == 0 && i + 1 < argc) {
+            sceneFilePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-scene-cache") == 0) {
+            useSceneCache = false;
+        }
+        else if (std::strcmp(argv[i], "--export-scene") == 0 && i + 1 < argc) {
+            exportScenePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+            if (i + 1 < argc && std::strcmp(argv[i + 1], "quick") == 0) { benchQuick = true; ++i; }
+            else if (i + 1 < argc && std::strcmp(argv[i + 1], "micro") == 0) { benchMicroOnly = true; ++i; }
+        }
+        else if (std::strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc) {
+            benchOutPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--exposure") == 0 && i + 1 < argc) {
+            exposureEV = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--tonemap") == 0 && i + 1 < argc) {
+            const char* op = argv[++i];
+            if (std::strcmp(op, "none") == 0) toneMapOperator = TONEMAP_NONE;
+            else if (std::strcmp(op, "reinhard") == 0) toneMapOperator = TONEMAP_REINHARD;
+            else if (std::strcmp(op, "aces") == 0) toneMapOperator = TONEMAP_ACES;
+            else std::cerr << "δ֪ɫӳ: " << op << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--dither") == 0) {
+            ditherOutput = true;
+        }
+        else if (std::strcmp(argv[i], "--worker") == 0 && i + 1 < argc) {
+            workerPort = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            std::string list = argv[++i];
+            for (size_t begin = 0; begin <= list.size();) {
+                size_t end = list.find(',', begin);
+                if (end == std::string::npos) end = list.size();
+                if (end > begin) workerAddresses.push_back(list.substr(begin, end - begin));
+                begin = end + 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--dist-timeout") == 0 && i + 1 < argc) {
+            distTimeout = std::max(1.0, std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--gpu") == 0) {
+            gpuBackend = true;
+        }
+        else if (std::strcmp(argv[i], "--denoise") == 0) {
+            denoiseOutput = true;
+        }
+        else if (std::strcmp(argv[i], "--glossy-samples") == 0 && i + 1 < argc) {
+            glossySplitSamples = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--aux") == 0 && i + 1 < argc) {
+            auxOutputPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-packets") == 0) {
+            usePackets = false;
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            renderSeed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            std::cerr << "δ֪: " << argv[i] << std::endl;
+        }
+    }
+}
+
+// Ƿ޽ģʽУglutInit֮ǰжϣ޽ģʽȫGLģûXĽڵ
+bool isHeadless(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0 || std::strcmp(argv[i], "--output") == 0 || std::strcmp(argv[i], "--bench") == 0 ||
+            std::strcmp(argv[i], "--export-scene") == 0 || std::strcmp(argv[i], "--worker") == 0) return true;
+    }
+    return false;
+}
+
+// ͬȾһ֡ʱڵǰ߳ۼƣӦз߶·
+void renderFrame() {
+    if (renderPasses > 1 && adaptiveBudget == 0) {
+        scene->renderProgressive(renderPasses);  // ڵǰ߳ͬۼƶ
+    }
+    else {
+        scene->render();
+    }
+}
+
+// ----------------------------------------------------
+// ֲʽȾ--worker PORT ڵ㣻 --workers host:port,... ޽ȾΪЭڵ㣬
+// ѻг DIST_TILE_SIZE ķֿ龭TCPַϲصԸֿճдͼ
+// ڵ뱾ͬ initScene/Scene Ⱦذ (, , x, y) ҷֿ߽Ϊż
+// ÿֿȫͬһڵ㰴˳ۼƣ˺ϲ뱾Ⱦλһ¡
+// Ϊܸıۼ˳ַֻֿ֡
+// ȣÿڵ㱣 DIST_INFLIGHT ֿ;ڵϿʱֿŶӣпպнڵ
+// ظȡ;ķֿ飨ȷЧڵ㲻ס󼸸ֿ飻нڵʧЧʱЭڵڱȾʣֿ顣
+// Э飺ÿϢΪ {, } ͷӸأֶΰֽԭͣJOB дֽǣһµĽڵ㱻ܾ
+
+#if defined(_WIN32)
+typedef SOCKET NetSocket;
+const NetSocket NET_INVALID_SOCKET = INVALID_SOCKET;
+inline void closeNetSocket(NetSocket s) { closesocket(s); }
+inline int pollNetSockets(pollfd* fds, size_t n, int timeoutMs) { return WSAPoll(fds, static_cast<ULONG>(n), timeoutMs); }
+#else
+typedef int NetSocket;
+const NetSocket NET_INVALID_SOCKET = -1;
+inline void closeNetSocket(NetSocket s) { ::close(s); }
+inline int pollNetSockets(pollfd* fds, size_t n, int timeoutMs) { return ::poll(fds, static_cast<nfds_t>(n), timeoutMs); }
+#endif
+#if defined(MSG_NOSIGNAL)
+const int NET_SEND_FLAGS = MSG_NOSIGNAL;  // ԶѹرʱشǴ SIGPIPE
+#else
+const int NET_SEND_FLAGS = 0;
+#endif
+
+// ʼWindows Ҫ WSAStartupƽ̨Ϊղ
+void initNetwork() {
+#if defined(_WIN32)
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }
+#endif
+}
+
+const char DIST_MAGIC[4] = { 'R', 'T', 'D', 'J' };
+const uint32_t DIST_VERSION = 2;   // Ϣʽıʱ1
+const int DIST_TILE_SIZE = 128;    // ַֿСTILE_SIZE ڵڲٰ TILE_SIZE У
+const int DIST_INFLIGHT = 2;       // ÿڵ;ֿȾǰֿʱһڽջ
+const uint32_t DIST_MAX_MESSAGE = 1u << 28;  // Ϣޣֹĳֶε¾
+
+enum DistMessage {
+    DIST_JOB = 1,   // Э -> Ⱦ + ļ·
+    DIST_READY,     //  -> ЭDistReady
+    DIST_TILE,      // Э -> Ⱦһֿ飨DistTile
+    DIST_RESULT,    //  -> ЭDistTile + ֿɫУÿRGB
+    DIST_ERROR      //  -> ЭϢı
+};
+
+// ӰؽȫȾãڵòͬδأʱؽ
+struct DistJob {
+    char magic[4];
+    uint32_t version, endian;
+    int32_t width, height, passes;
+    uint32_t seed;
+    int32_t glossyPolicy, glossySamples, packets, woodEval, layout;
+    uint32_t sceneFileLength;  // нĳļ·ȣΪ0ʱʹó layout
+};
+
+struct DistReady {
+    int32_t threads, simdWidth;  // SIMDȲͬĽڵλһ£Эڵܾʹ
+};
+
+struct DistTile {
+    int32_t id, x0, y0, x1, y1;
+};
+
+bool sendAll(NetSocket s, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        int n = static_cast<int>(::send(s, p, static_cast<int>(std::min<size_t>(size, 1 << 20)), NET_SEND_FLAGS));
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
 
-        // patternľɫֵ֮
-        return interpolate(lightWood, darkWood, stripePattern);
+bool recvAll(NetSocket s, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        int n = static_cast<int>(::recv(s, p, static_cast<int>(std::min<size_t>(size, 1 << 20)), 0));
+        if (n <= 0) return false;  // Զ˹رաճʱ
+        p += n;
+        size -= static_cast<size_t>(n);
     }
+    return true;
+}
 
-    // ׷ٺݹ׷٣ɫ
-    Vector3 trace(const Ray& ray, int depth = 0) {
-        if (depth > 6) return bgColor;  // Ƶݹȣѭ
+bool sendMessage(NetSocket s, uint32_t type, const void* a, size_t aSize, const void* b = nullptr, size_t bSize = 0) {
+    uint32_t header[2] = { type, static_cast<uint32_t>(aSize + bSize) };
+    return sendAll(s, header, sizeof(header)) && sendAll(s, a, aSize) && (bSize == 0 || sendAll(s, b, bSize));
+}
 
-        float tMin = 100000.0f;  // 
-        Material hitMat;         // в
-        Vector3 hitPoint, hitNormal;  // еͷ
-        bool hasHit = false;     // Ƿн
-        bool isBox = false;      // Ƿкӣ
+bool recvMessage(NetSocket s, uint32_t& type, std::vector<char>& payload) {
+    uint32_t header[2];
+    if (!recvAll(s, header, sizeof(header)) || header[1] > DIST_MAX_MESSAGE) return false;
+    type = header[0];
+    payload.resize(header[1]);
+    return header[1] == 0 || recvAll(s, payload.data(), payload.size());
+}
 
-        // ཻ壬
-        for (auto sphere : spheres) {
-            float t;
-            if (sphere->intersect(ray, t) && t < tMin) {
-                tMin = t;
-                hitPoint = ray.origin + ray.direction * t;
-                hitNormal = (hitPoint - sphere->center).normalize();  // 巨ߣ
-                hitMat = sphere->mat;
-                hasHit = true;
-                isBox = false;
-            }
-        }
+// ճʱ룬0Ϊʱ recv ʱ䷵ʧܣĽڵ㲻ῨסЭڵ
+void setRecvTimeout(NetSocket s, double seconds) {
+#if defined(_WIN32)
+    DWORD ms = static_cast<DWORD>(seconds * 1000);
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&ms), sizeof(ms));
+#else
+    timeval tv;
+    tv.tv_sec = static_cast<long>(seconds);
+    tv.tv_usec = static_cast<long>((seconds - tv.tv_sec) * 1e6);
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#endif
+}
 
-        // ཻк
-        for (auto box : boxes) {
-            float t;
-            Vector3 normal;
-            if (box->intersect(ray, t, normal) && t < tMin) {
-                tMin = t;
-                hitPoint = ray.origin + ray.direction * t;
-                hitNormal = normal;
-                hitMat = box->mat;  // Ȼȡ
-                hasHit = true;
-                isBox = true;
-            }
-        }
-
-        // ذ y=0 (ϸľ)ƽ潻 + ߽
-        float tPlane;
-        if (planeIntersect(ray, tPlane, Vector3(0, 0, 0), Vector3(0, 1, 0)) && tPlane < tMin) {
-            Vector3 p = ray.origin + ray.direction * tPlane;
-            if (p.x >= -1.5f && p.x <= 1.5f && p.z >= -1.5f && p.z <= 1.5f) {  // ӱ߽
-                tMin = tPlane;
-                hitPoint = p;
-                hitNormal = Vector3(0, 1, 0);  // Ϸ
-
-                // ľƣsin + 
-                float woodX = p.x * 15.0f;
-                float woodZ = p.z * 8.0f;
-                float pattern = std::sin(woodX) * 0.5f + 0.5f;  // X
-                int stripe = static_cast<int>(woodZ * 5) % 2;    // Z
-                Vector3 baseColor = stripe ? Vector3(0.55f, 0.35f, 0.15f) : Vector3(0.45f, 0.25f, 0.1f);
-                hitMat.color = baseColor * (0.8f + pattern * 0.2f);  // ɫ
-                hitMat.ka = 0.15f; hitMat.kd = 0.75f; hitMat.ks = 0.15f;  // 
-                hitMat.kr = 0.0f; hitMat.shininess = 20.0f;
-                hitMat.isMetallic = false;
-                hitMat.roughness = 0.0f;  // ذ⻬
-                hasHit = true;
-                isBox = false;
-            }
-        }
-
-        // ǽ x=-1.5 ()ƽ + ߽
-        if (planeIntersect(ray, tPlane, Vector3(-1.5f, 0, 0), Vector3(1, 0, 0)) && tPlane < tMin) {
-            Vector3 p = ray.origin + ray.direction * tPlane;
-            if (p.y >= 0 && p.y <= 3.0f && p.z >= -1.5f && p.z <= 1.5f) {
-                tMin = tPlane; hitPoint = p; hitNormal = Vector3(1, 0, 0);  // ڷ
-                hitMat.color = Vector3(0.75f, 0.1f, 0.1f);  // ɫ
-                hitMat.ka = 0.1f; hitMat.kd = 0.8f; hitMat.ks = 0.05f; hitMat.kr = 0.0f;
-                hitMat.isMetallic = false;
-                hitMat.roughness = 0.0f;  // ⻬
-                hasHit = true;
-                isBox = false;
-            }
-        }
-
-        // ǽ x=1.5 ()
-        if (planeIntersect(ray, tPlane, Vector3(1.5f, 0, 0), Vector3(-1, 0, 0)) && tPlane < tMin) {
-            Vector3 p = ray.origin + ray.direction * tPlane;
-            if (p.y >= 0 && p.y <= 3.0f && p.z >= -1.5f && p.z <= 1.5f) {
-                tMin = tPlane; hitPoint = p; hitNormal = Vector3(-1, 0, 0);
-                hitMat.color = Vector3(0.1f, 0.75f, 0.1f);  // ɫ
-                hitMat.ka = 0.1f; hitMat.kd = 0.8f; hitMat.ks = 0.05f; hitMat.kr = 0.0f;
-                hitMat.isMetallic = false;
-                hitMat.roughness = 0.0f;
-                hasHit = true;
-                isBox = false;
-            }
-        }
-
-        // ǽ z=-1.5 ()
-        if (planeIntersect(ray, tPlane, Vector3(0, 0, -1.5f), Vector3(0, 0, 1)) && tPlane < tMin) {
-            Vector3 p = ray.origin + ray.direction * tPlane;
-            if (p.x >= -1.5f && p.x <= 1.5f && p.y >= 0 && p.y <= 3.0f) {
-                tMin = tPlane; hitPoint = p; hitNormal = Vector3(0, 0, 1);
-                hitMat.color = Vector3(0.85f, 0.85f, 0.85f);  // ɫ
-                hitMat.ka = 0.1f; hitMat.kd = 0.8f; hitMat.ks = 0.05f; hitMat.kr = 0.0f;
-                hitMat.isMetallic = false;
-                hitMat.roughness = 0.0f;
-                hasHit = true;
-                isBox = false;
-            }
-        }
-
-        // 컨 y=3.0 ()
-        if (planeIntersect(ray, tPlane, Vector3(0, 3.0f, 0), Vector3(0, -1, 0)) && tPlane < tMin) {
-            Vector3 p = ray.origin + ray.direction * tPlane;
-            if (p.x >= -1.5f && p.x <= 1.5f && p.z >= -1.5f && p.z <= 1.5f) {
-                tMin = tPlane; hitPoint = p; hitNormal = Vector3(0, -1, 0);
-                hitMat.color = Vector3(0.85f, 0.85f, 0.85f);
-                hitMat.ka = 0.1f; hitMat.kd = 0.8f; hitMat.ks = 0.05f; hitMat.kr = 0.0f;
-                hitMat.isMetallic = false;
-                hitMat.roughness = 0.0f;
-                hasHit = true;
-                isBox = false;
-            }
-        }
-
-        if (!hasHit) return bgColor;  // ޽㣬ر
-
-        // ľ䣬²ɫΪľɫ
-        if (isBox) {
-            hitMat.color = getWoodTextureColor(hitPoint, hitNormal);
+// СϢֿ󣩲ȴϲʱʱеTCP̽ʧЧ
+void configureNetSocket(NetSocket s) {
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+    setsockopt(s, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&one), sizeof(one));
+}
+
+//  ":˿"ʧܷ NET_INVALID_SOCKET
+NetSocket connectTo(const std::string& address) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return NET_INVALID_SOCKET;
+    std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+    addrinfo hints = addrinfo();
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) return NET_INVALID_SOCKET;
+    NetSocket s = NET_INVALID_SOCKET;
+    for (addrinfo* ai = result; ai && s == NET_INVALID_SOCKET; ai = ai->ai_next) {
+        s = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s == NET_INVALID_SOCKET) continue;
+        if (::connect(s, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) != 0) {
+            closeNetSocket(s);
+            s = NET_INVALID_SOCKET;
         }
+    }
+    freeaddrinfo(result);
+    if (s != NET_INVALID_SOCKET) configureNetSocket(s);
+    return s;
+}
 
-        Vector3 finalColor = Vector3(0, 0, 0);  // ɫʼ
+// ǰȫȾöӦ
+DistJob currentDistJob() {
+    DistJob job = DistJob();
+    std::memcpy(job.magic, DIST_MAGIC, sizeof(job.magic));
+    job.version = DIST_VERSION;
+    job.endian = SCENE_CACHE_ENDIAN;
+    job.width = imageWidth;
+    job.height = imageHeight;
+    job.passes = std::max(1, renderPasses);
+    job.seed = renderSeed;
+    job.glossyPolicy = glossyPolicy;
+    job.glossySamples = glossySplitSamples;
+    job.packets = usePackets ? 1 : 0;
+    job.woodEval = woodTextureEval;
+    job.layout = sceneLayout;
+    job.sceneFileLength = static_cast<uint32_t>(sceneFilePath.size());
+    return job;
+}
 
-        // ʣȼߣΪı·
-        if (hitMat.isRefractive&& depth < 6) {
-            float cosI = -ray.direction.dot(hitNormal);  // 
-            float eta = hitMat.eta;  // 
-            Vector3 n = hitNormal;   // 
+// ڵ㣺һЭڵӣֱԷϿ
+void serveCoordinator(NetSocket s, bool& sceneLoaded, std::string& loadedJob) {
+    uint32_t type;
+    std::vector<char> payload;
+    if (!recvMessage(s, type, payload) || type != DIST_JOB || payload.size() < sizeof(DistJob)) return;
+    DistJob job;
+    std::memcpy(&job, payload.data(), sizeof(job));
+    auto reject = [&](const std::string& why) {
+        std::cerr << "ܾ: " << why << std::endl;
+        sendMessage(s, DIST_ERROR, why.data(), why.size());
+    };
+    if (std::memcmp(job.magic, DIST_MAGIC, sizeof(job.magic)) != 0 || job.version != DIST_VERSION || job.endian != SCENE_CACHE_ENDIAN) {
+        return reject("Э汾ֽһ");
+    }
+    if (payload.size() != sizeof(DistJob) + job.sceneFileLength || job.width <= 0 || job.height <= 0 || job.passes <= 0 || job.glossySamples <= 0) {
+        return reject("Ч");
+    }
+    std::string scenePath(payload.data() + sizeof(DistJob), job.sceneFileLength);
+    std::error_code ec;
+    if (!scenePath.empty() && !std::filesystem::exists(scenePath, ec)) return reject("ڵûгļ: " + scenePath);
 
-            bool entering = cosI > 0;  // Ƿ
-            if (!entering) {  // ڲ
-                cosI = -cosI;
-                n = hitNormal * -1;  // ת
-                eta = 1.0f / eta;    // 
-            }
+    // ѼصĳͬʱãͬһȾ֡ؽBVH
+    std::string jobKey(payload.begin(), payload.end());
+    if (!sceneLoaded || jobKey != loadedJob) {
+        imageWidth = job.width;
+        imageHeight = job.height;
+        renderPasses = job.passes;
+        renderSeed = job.seed;
+        glossyPolicy = job.glossyPolicy;
+        glossySplitSamples = job.glossySamples;
+        usePackets = job.packets != 0;
+        woodTextureEval = job.woodEval;
+        sceneLayout = job.layout;
+        sceneFilePath = scenePath;
+        releaseScene();
+        scene = new Scene();
+        if (!tryInitScene()) {
+            sceneLoaded = false;  // صĳһʼʱͷؽ
+            loadedJob.clear();
+            return reject("ļʧܣԭڵ: " + scenePath);
+        }
+        sceneLoaded = true;
+        loadedJob = jobKey;
+    }
+    DistReady ready = { renderThreads, SIMD_WIDTH };
+    if (!sendMessage(s, DIST_READY, &ready, sizeof(ready))) return;
 
-            float sinT2 = eta * eta * (1 - cosI * cosI);  // Snell
-            if (sinT2 < 1.0f) {  // 䣨ȫ䣩
-                float cosT = std::sqrt(1 - sinT2);  // 
-                // ䷽ʽ
-                Vector3 refractDir = (ray.direction * eta + n * (eta * cosI - cosT)).normalize();
-                Ray refractRay(hitPoint - n * 0.001f, refractDir);  // ƫƱԽ
-                Vector3 refractColor = trace(refractRay, depth + 1);  // ݹ׷
+    std::vector<float> pixels;
+    int tiles = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    while (recvMessage(s, type, payload) && type == DIST_TILE && payload.size() == sizeof(DistTile)) {
+        DistTile tile;
+        std::memcpy(&tile, payload.data(), sizeof(tile));
+        if (tile.x0 < 0 || tile.y0 < 0 || tile.x1 > imageWidth || tile.y1 > imageHeight || tile.x0 >= tile.x1 || tile.y0 >= tile.y1) {
+            return reject("ֿԽ");
+        }
+        pixels.resize(static_cast<size_t>(tile.x1 - tile.x0) * (tile.y1 - tile.y0) * 3);
+        scene->renderRegion({ tile.x0, tile.y0, tile.x1, tile.y1 }, renderPasses, pixels.data());
+        if (!sendMessage(s, DIST_RESULT, &tile, sizeof(tile), pixels.data(), pixels.size() * sizeof(float))) break;
+        ++tiles;
+    }
+    std::cout << "ЭڵϿ:  " << tiles << " ֿ, "
+        << std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() << " " << std::endl;
+}
 
-                // FresnelЧӦ/͸
-                float R0 = ((eta - 1) * (eta - 1)) / ((eta + 1) * (eta + 1));  // ֱ䷴
-                float fresnel = R0 + (1 - R0) * std::pow(1 - cosI, 5);  // Schlick
+// ڵѭ portηÿЭڵ
+int runWorker(int port) {
+    initNetwork();
+    NetSocket listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == NET_INVALID_SOCKET) { std::cerr << "޷׽" << std::endl; return 1; }
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+    sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listener, 4) != 0) {
+        std::cerr << "޷˿ " << port << std::endl;
+        closeNetSocket(listener);
+        return 1;
+    }
+    std::cout << "ڵ˿ " << port << "" << renderThreads << " ̣߳" << std::endl;
+    bool sceneLoaded = false;
+    std::string loadedJob;
+    for (;;) {
+        NetSocket conn = ::accept(listener, nullptr, nullptr);
+        if (conn == NET_INVALID_SOCKET) continue;
+        configureNetSocket(conn);
+        setRecvTimeout(conn, distTimeout);  // Эڵʱùڵ recv 
+        std::cout << "Эڵ" << std::endl;
+        serveCoordinator(conn, sceneLoaded, loadedJob);
+        closeNetSocket(conn);
+    }
+}
 
-                // 䲿
-                Vector3 reflectDir = (ray.direction - hitNormal * 2 * ray.direction.dot(hitNormal)).normalize();
-                Ray reflectRay(hitPoint + hitNormal * 0.001f, reflectDir);
-                Vector3 reflectColor = trace(reflectRay, depth + 1);
+// Эڵϵһڵ
+struct DistWorker {
+    std::string address;
+    NetSocket socket = NET_INVALID_SOCKET;
+    std::vector<int> inflight;  // ѷδصķֿ
+    std::chrono::steady_clock::time_point lastProgress;  // һյ򷢳׸ֿ飩ʱ
+    int threads = 0;
+    int tilesDone = 0;
+};
 
-                finalColor = refractColor * (1 - fresnel) + reflectColor * fresnel;  // 
-            }
-            else {  // ȫ
-                Vector3 reflectDir = (ray.direction - n * 2 * ray.direction.dot(n)).normalize();
-                Ray reflectRay(hitPoint + n * 0.001f, reflectDir);
-                finalColor = trace(reflectRay, depth + 1);
-            }
-            return finalColor;  // ֱӷ
-        }
+// Эڵ㣺ַ֡ڵȾд framebuffer/hdrBuffer뱾 renderFrame ͬ
+void renderDistributed() {
+    typedef std::chrono::steady_clock Clock;
+    auto start = Clock::now();
+    initNetwork();
+    scene->auxValid = false;  // 治ص0飺Ҫʱ renderAux 
+    std::vector<Tile> tiles = makeTiles(imageWidth, imageHeight, DIST_TILE_SIZE);
+    int total = static_cast<int>(tiles.size());
+    std::vector<DistWorker> workers;
+    DistJob job = currentDistJob();
 
-        // ׼ռ ( + ߹⣬Phongģ)
-        Vector3 localColor = Vector3(0, 0, 0);  // ɫ
-        Vector3 lightDir = (lightPos - hitPoint).normalize();  // ߷
-        float lightDist = (lightPos - hitPoint).length();      // Դ
+    auto dropWorker = [&](DistWorker& w, const std::string& why) {
+        std::cerr << "ڵ " << w.address << " ʧЧ" << why << "" << w.inflight.size() << " ;ֿ·" << std::endl;
+        closeNetSocket(w.socket);
+        w.socket = NET_INVALID_SOCKET;
+    };
+    for (const std::string& address : workerAddresses) {
+        DistWorker w;
+        w.address = address;
+        w.socket = connectTo(address);
+        if (w.socket == NET_INVALID_SOCKET) { std::cerr << "޷ӹڵ: " << address << std::endl; continue; }
+        setRecvTimeout(w.socket, distTimeout);  // ڵسʱ
+        if (!sendMessage(w.socket, DIST_JOB, &job, sizeof(job), sceneFilePath.data(), sceneFilePath.size())) {
+            dropWorker(w, "ʧ");
+            continue;
+        }
+        workers.push_back(w);
+    }
+    // нڵ㲢мسȴ
+    std::vector<char> payload;
+    uint32_t type;
+    for (DistWorker& w : workers) {
+        if (!recvMessage(w.socket, type, payload)) { dropWorker(w, "ûӦ"); continue; }
+        if (type == DIST_ERROR) { dropWorker(w, std::string(payload.begin(), payload.end())); continue; }
+        DistReady ready;
+        if (type != DIST_READY || payload.size() != sizeof(ready)) { dropWorker(w, "Э"); continue; }
+        std::memcpy(&ready, payload.data(), sizeof(ready));
+        if (ready.simdWidth != SIMD_WIDTH) { dropWorker(w, "SIMD " + std::to_string(ready.simdWidth) + " 뱾ͬ"); continue; }
+        w.threads = ready.threads;
+        std::cout << "ڵ: " << w.address << "" << w.threads << " ̣߳" << std::endl;
+    }
 
-        // Ӱ⣺ӻеԴӰӹ
-        Ray shadowRay(hitPoint + hitNormal * 0.001f, lightDir);  // ƫ
-        bool inShadow = false;
+    std::deque<int> pending;
+    for (int i = 0; i < total; ++i) pending.push_back(i);
+    std::vector<char> done(total, 0);
+    std::vector<int> copies(total, 0);  // ÿֿ鵱ǰڼڵȾ
+    int doneCount = 0, duplicates = 0;
+    auto alive = [](const DistWorker& w) { return w.socket != NET_INVALID_SOCKET; };
+    auto release = [&](DistWorker& w) {  // ڵʧЧ;ֿδɵķŻض
+        for (int id : w.inflight) {
+            if (--copies[id] == 0 && !done[id]) pending.push_front(id);
+        }
+        w.inflight.clear();
+    };
+    // Ϊڵѡһֿ飺ȡУпʱظȡ;١Ҳڱڵϵδɷֿ
+    auto nextTile = [&](const DistWorker& w) {
+        while (!pending.empty()) {
+            int id = pending.front();
+            pending.pop_front();
+            if (!done[id]) return id;
+        }
+        int best = -1;
+        for (int id = 0; id < total; ++id) {
+            if (done[id] || copies[id] == 0 || std::find(w.inflight.begin(), w.inflight.end(), id) != w.inflight.end()) continue;
+            if (best < 0 || copies[id] < copies[best]) best = id;
+        }
+        if (best >= 0) ++duplicates;
+        return best;
+    };
 
-        // ڵ
-        for (auto s : spheres) {
-            float st;
-            if (s->intersect(shadowRay, st) && st < lightDist - 0.001f) {
-                inShadow = true; break;
+    while (doneCount < total) {
+        std::vector<pollfd> fds;
+        std::vector<DistWorker*> polled;
+        for (DistWorker& w : workers) {
+            if (!alive(w)) continue;
+            while (static_cast<int>(w.inflight.size()) < DIST_INFLIGHT) {
+                int id = nextTile(w);
+                if (id < 0) break;
+                const Tile& t = tiles[id];
+                DistTile msg = { id, t.x0, t.y0, t.x1, t.y1 };
+                if (w.inflight.empty()) w.lastProgress = Clock::now();
+                w.inflight.push_back(id);
+                ++copies[id];
+                if (!sendMessage(w.socket, DIST_TILE, &msg, sizeof(msg))) break;  // ʧĽշ
             }
+            if (w.inflight.empty()) continue;
+            pollfd p;
+            p.fd = w.socket;
+            p.events = POLLIN;
+            p.revents = 0;
+            fds.push_back(p);
+            polled.push_back(&w);
         }
-
-        // ڵ
-        if (!inShadow) {
-            for (auto b : boxes) {
-                float bt; Vector3 bn;
-                if (b->intersect(shadowRay, bt, bn) && bt < lightDist - 0.001f) {
-                    inShadow = true; break;
+        if (polled.empty()) {
+            // ûпõĹڵ㣺ʣֿڱȾ
+            int remaining = 0;
+            for (int id = 0; id < total; ++id) remaining += !done[id];
+            std::cerr << "ûпõĹڵ㣬Ⱦʣ " << remaining << " ֿ" << std::endl;
+            std::vector<float> pixels;
+            for (int id = 0; id < total; ++id) {
+                if (done[id]) continue;
+                const Tile& t = tiles[id];
+                pixels.resize(static_cast<size_t>(t.x1 - t.x0) * (t.y1 - t.y0) * 3);
+                scene->renderRegion(t, std::max(1, renderPasses), pixels.data());
+                for (int y = t.y0; y < t.y1; ++y) {
+                    for (int x = t.x0; x < t.x1; ++x) {
+                        const float* c = &pixels[((y - t.y0) * (t.x1 - t.x0) + x - t.x0) * 3];
+                        scene->writePixel(x, y, Vector3(c[0], c[1], c[2]));
+                    }
                 }
+                done[id] = 1;
+                ++doneCount;
             }
+            break;
         }
 
-        if (!inShadow) {  // Ӱ
-            // ⣺㶨
-            localColor = localColor + hitMat.ka * hitMat.color;
-
-            // 䣺Lambertģ
-            float diff = std::max(0.0f, hitNormal.dot(lightDir));  // cos theta
-            float attenuation = 1.0f / (1.0f + 0.05f * lightDist * lightDist);  // ˥
-
-            if (hitMat.isMetallic) {
-                // 䣬òɫƹɫ
-                localColor = localColor + hitMat.kd * (hitMat.color * lightColor) * diff * attenuation * 0.1f;
+        pollNetSockets(fds.data(), fds.size(), 200);
+        auto now = Clock::now();
+        for (size_t i = 0; i < polled.size(); ++i) {
+            DistWorker& w = *polled[i];
+            if (!(fds[i].revents & (POLLIN | POLLERR | POLLHUP))) {
+                if (std::chrono::duration<double>(now - w.lastProgress).count() > distTimeout) { dropWorker(w, "ʱ"); release(w); }
+                continue;
             }
-            else {
-                localColor = localColor + hitMat.kd * (hitMat.color * lightColor) * diff * attenuation;
+            DistTile tile;
+            if (!recvMessage(w.socket, type, payload)) { dropWorker(w, "ӶϿ"); release(w); continue; }
+            if (type != DIST_RESULT || payload.size() < sizeof(tile)) { dropWorker(w, "Э"); release(w); continue; }
+            std::memcpy(&tile, payload.data(), sizeof(tile));
+            auto it = std::find(w.inflight.begin(), w.inflight.end(), tile.id);
+            const Tile* t = tile.id >= 0 && tile.id < total ? &tiles[tile.id] : nullptr;
+            if (it == w.inflight.end() || !t || tile.x0 != t->x0 || tile.y0 != t->y0 || tile.x1 != t->x1 || tile.y1 != t->y1 ||
+                payload.size() != sizeof(tile) + static_cast<size_t>(t->x1 - t->x0) * (t->y1 - t->y0) * 3 * sizeof(float)) {
+                dropWorker(w, "Чֿ");
+                release(w);
+                continue;
+            }
+            w.inflight.erase(it);
+            --copies[tile.id];
+            w.lastProgress = now;
+            ++w.tilesDone;
+            if (done[tile.id]) continue;  // ظȡĸڵ
+            const char* src = payload.data() + sizeof(tile);
+            for (int y = t->y0; y < t->y1; ++y) {
+                for (int x = t->x0; x < t->x1; ++x) {
+                    float c[3];
+                    std::memcpy(c, src + ((y - t->y0) * (t->x1 - t->x0) + x - t->x0) * 3 * sizeof(float), sizeof(c));
+                    scene->writePixel(x, y, Vector3(c[0], c[1], c[2]));
+                }
             }
+            done[tile.id] = 1;
+            ++doneCount;
+            if (doneCount * 10 / total != (doneCount - 1) * 10 / total) std::cout << ": " << (doneCount * 100 / total) << "%\n";
+        }
+    }
+    for (DistWorker& w : workers) {
+        if (alive(w)) closeNetSocket(w.socket);  // Ⱦظӹرն
+    }
+    if (denoiseOutput) scene->denoiseFrame();  // ֻߣЭڵ㱾
+    scene->postProcessFrame();
+    scene->markAllDirty();
 
-            // ߹⣺Phongģ
-            Vector3 viewDir = (cameraPos - hitPoint).normalize();  // ߷
-            Vector3 reflectDir = (hitNormal * (2 * hitNormal.dot(lightDir)) - lightDir).normalize();  // ䷽
-            float spec = std::pow(std::max(0.0f, viewDir.dot(reflectDir)), hitMat.shininess);  // ߹ǿ
-            // ߹òɫǽùɫ
-            localColor = localColor + hitMat.ks * (hitMat.isMetallic ? hitMat.color : lightColor) * spec * attenuation;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "ֲʽȾ! ʱ: " << seconds << " 루" << total << " ֿ, ظȡ " << duplicates << " Σ" << std::endl;
+    for (const DistWorker& w : workers) std::cout << "  " << w.address << ": " << w.tilesDone << " ֿ" << std::endl;
+}
+
+// ޽ȾȾֱӰ֡дͼļGL
+int runHeadless() {
+    initScene();
+    if (!exportScenePath.empty()) {
+        if (!writeSceneText(exportScenePath, *scene)) {
+            std::cerr << "дļʧ: " << exportScenePath << std::endl;
+            return 1;
         }
-        else {
-            // ӰУ⣬
-            localColor = hitMat.ka * hitMat.color * 0.5f;
+        std::cout << "дļ: " << exportScenePath << std::endl;
+        if (outputPath.empty()) return 0;  // ֻȾ
+    }
+    if (workerAddresses.empty()) {
+        renderFrame();
+    }
+    else if (adaptiveBudget > 0) {
+        std::cerr << "Ӧַֿܷ֡ΪȾ" << std::endl;
+        renderFrame();
+    }
+    else {
+        renderDistributed();
+    }
+    if (!writeImage(outputPath, imageWidth, imageHeight, framebuffer, hdrBuffer)) {
+        std::cerr << "дͼʧ: " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "д: " << outputPath << " (" << imageWidth << "x" << imageHeight << ")" << std::endl;
+    if (!auxOutputPath.empty()) {
+        if (!scene->auxValid) scene->renderAux();  // 0ûм¼ʱֲʽGPU˵ȣ
+        if (!writeAuxImages(auxOutputPath, imageWidth, imageHeight, scene->aux)) {
+            std::cerr << "дʧ: " << auxOutputPath << std::endl;
+            return 1;
         }
+    }
+#ifdef RT_STATS
+    if (!heatmapPath.empty()) {
+        if (scene->writeHeatmap(heatmapPath)) std::cout << "дȶͼ: " << heatmapPath << std::endl;
+        else std::cerr << "дȶͼʧ: " << heatmapPath << std::endl;
+    }
+#endif
+    return 0;
+}
 
-        finalColor = localColor;  // Ϊ
+// ----------------------------------------------------
+// ׼׼--bench̶Ⱦ̶ɨֱʡÿ߳
+// ٶ΢׼ÿһJSONҹԱȽűֱӽ
+//   {"kind":"render","scene":"cornell","width":800,"height":600,"spp":1,"threads":4,"seconds":..,"mrays":..,"checksum":".."}
+//   {"kind":"micro","name":"sphere_intersect","ops":..,"ns_per_op":..,"checksum":".."}
+// mrays Ϊ -DRT_STATS ʱȫμߵ total_mrays
+// checksum Ϊ8λ֡FNV-1aϣͬһ߳޹أ仯˵ˡ
+// ȾеĽΣÿȡ BENCH_REPEATS еʱ䡣
 
-        //  (вʣͨkr)
-        if (hitMat.kr > 0.0f && depth < 6) {
-            Vector3 reflectDir = (ray.direction - hitNormal * 2 * ray.direction.dot(hitNormal)).normalize();  // ䷽
+const unsigned int BENCH_SEED = 1u;  // ׼Թ̶ӣ --seed
+const int BENCH_REPEATS = 3;
 
-            // Monte Carloģ䣨ֲڱ棩
-            Vector3 glossyReflectColor = Vector3(0, 0, 0);
-            int SAMPLES_PER_GLOSSY_RAY = 1;  // Ĭ1
-            if (hitMat.roughness > 0.001f) {
-                SAMPLES_PER_GLOSSY_RAY = 16;  // ֲʱӲ٣
-            }
+// 64λFNV-1aϣ
+uint64_t fnv1a(const void* data, size_t size, uint64_t h = 1469598103934665603ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
 
-            // ѭ
-            for (int i = 0; i < SAMPLES_PER_GLOSSY_RAY; ++i) {
-                Vector3 perturbedReflectDir = reflectDir;  // ʼΪ
+std::string hex64(uint64_t v) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
 
-                if (hitMat.roughness > 0.001f) {
-                    // Ŷλ
-                    float r1 = dist_neg_pos_one(rng);
-                    float r2 = dist_neg_pos_one(rng);
-                    float r3 = dist_neg_pos_one(rng);
-                    Vector3 randomVec = Vector3(r1, r2, r3).normalize();
+const char* sceneLayoutName(int layout) {
+    return layout == SCENE_STRESS ? "stress" : layout == SCENE_GLOSSY ? "glossy" : "cornell";
+}
 
-                    // ϣŶǿroughness
-                    perturbedReflectDir = (reflectDir + randomVec * hitMat.roughness).normalize();
+// 壺ȾеĽϢ
+struct NullBuffer : std::streambuf {
+    int overflow(int c) override { return c; }
+};
 
-                    // ȷڷ߰򣨱ⱳ棩
-                    if (perturbedReflectDir.dot(hitNormal) < 0) {
-                        perturbedReflectDir = reflectDir;
-                    }
-                }
+// һȾãؽʱȾ repeats ȡʱ
+void benchRender(std::ostream& out, int layout, int w, int h, int spp, int threads, int repeats) {
+    sceneLayout = layout;
+    imageWidth = w;
+    imageHeight = h;
+    renderPasses = spp;
+    renderThreads = threads;
+    renderSeed = BENCH_SEED;
+    scene = new Scene();
+    initScene();
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::high_resolution_clock::now();
+        renderFrame();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    double primary = static_cast<double>(w) * h * spp;
+    out << "{\"kind\":\"render\",\"scene\":\"" << sceneLayoutName(layout) << "\",\"width\":" << w << ",\"height\":" << h
+        << ",\"spp\":" << spp << ",\"threads\":" << threads << ",\"seconds\":" << best
+        << ",\"mrays\":" << primary / best / 1e6;
+#ifdef RT_STATS
+    out << ",\"total_mrays\":" << scene->countedRays() / best / 1e6;  // ÿ֡ʼʱ㣬һȾĹ
+#endif
+    out << ",\"checksum\":\"" << hex64(fnv1a(framebuffer, static_cast<size_t>(w) * h * 3)) << "\"}" << std::endl;
+    releaseScene();
+}
 
-                Ray reflectRay(hitPoint + hitNormal * 0.001f, perturbedReflectDir);  // ƫ
-                glossyReflectColor = glossyReflectColor + trace(reflectRay, depth + 1);  // ݹ
-            }
-            glossyReflectColor = glossyReflectColor * (1.0f / SAMPLES_PER_GLOSSY_RAY);  // ƽ
+void benchMicro(std::ostream& out, const char* name, long long ops, double seconds, uint64_t checksum) {
+    out << "{\"kind\":\"micro\",\"name\":\"" << name << "\",\"ops\":" << ops << ",\"ns_per_op\":" << seconds * 1e9 / ops
+        << ",\"checksum\":\"" << hex64(checksum) << "\"}" << std::endl;
+}
 
-            // ϱعͷ
-            if (hitMat.isMetallic) {
-                // ɫ * ɫ
-                Vector3 metalReflectColor = glossyReflectColor * hitMat.color;
-                finalColor = finalColor * (1.0f - hitMat.kr) + metalReflectColor * hitMat.kr;
-            }
-            else {
-                // ǽֱӻ
-                finalColor = finalColor * (1.0f - hitMat.kr) + glossyReflectColor * hitMat.kr;
-            }
-        }
+// ΢׼󽻣Vector3 㡢BVH/ڵѯѹSIMD Perlin
+void benchKernels(std::ostream& out, bool quick) {
+    const int N = quick ? 1 << 16 : 1 << 20;
+    std::mt19937 g(BENCH_SEED);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    typedef std::chrono::high_resolution_clock Clock;
+    auto seconds = [](Clock::time_point t0) { return std::chrono::duration<double>(Clock::now() - t0).count(); };
 
-        return finalColor;  // ɫ
+    // ߣӺĸ
+    std::vector<Ray> rays;
+    rays.reserve(N);
+    for (int i = 0; i < N; ++i) {
+        Vector3 o(unit(g) * 0.5f, 1.5f + unit(g) * 0.5f, unit(g) * 0.5f);
+        Vector3 d(unit(g), unit(g), unit(g));
+        if (d.dot(d) < 1e-6f) d = Vector3(0, 0, 1);
+        rays.push_back(Ray::withUnitDirection(o, d.normalize()));
     }
 
-    // Ⱦ֡
-    void render() {
-        auto start = std::chrono::high_resolution_clock::now();  // ʼʱ
-        Vector3 forward = (lookAt - cameraPos).normalize();  // ǰ
-        Vector3 right = forward.cross(Vector3(0, 1, 0)).normalize();  // Yϣ
-        Vector3 up = right.cross(forward).normalize();       // 
-
-        // ѭ
-        for (int y = 0; y < HEIGHT; ++y) {
-            for (int x = 0; x < WIDTH; ++x) {
-                // Ļ굽͸ͶӰ
-                float u = (2.0f * x / WIDTH - 1.0f) * std::tan(fov / 2) * (WIDTH / float(HEIGHT));  // Xƫƣ߱У
-                float v = (1.0f - 2.0f * y / HEIGHT) * std::tan(fov / 2);  // YƫƣתY
-                Vector3 dir = (forward + right * u + up * v).normalize();  // ߷
-                Ray ray(cameraPos, dir);
-                Vector3 col = trace(ray);  // ׷ɫ
-
-                // ٤УsRGBԣ2.2棩
-                col.x = std::pow(std::max(0.0f, std::min(col.x, 1.0f)), 0.454f);  // 1/2.2  0.454
-                col.y = std::pow(std::max(0.0f, std::min(col.y, 1.0f)), 0.454f);
-                col.z = std::pow(std::max(0.0f, std::min(col.z, 1.0f)), 0.454f);
-
-                // д֡壺RGBֽ
-                int idx = (y * WIDTH + x) * 3;
-                framebuffer[idx] = static_cast<unsigned char>(std::min(255.0f, col.x * 255));
-                framebuffer[idx + 1] = static_cast<unsigned char>(std::min(255.0f, col.y * 255));
-                framebuffer[idx + 2] = static_cast<unsigned char>(std::min(255.0f, col.z * 255));
-            }
-            if (y % 10 == 0) std::cout << ": " << (y * 100 / HEIGHT) << "%" << std::endl;  // 
+    {
+        Sphere sphere(Vector3(0.2f, 1.6f, -0.1f), 0.8f, 0);
+        uint64_t hits = 0;
+        float tSum = 0.0f;
+        auto t0 = Clock::now();
+        for (const Ray& ray : rays) {
+            float t;
+            if (sphere.intersect(ray, t)) { ++hits; tSum += t; }
         }
-
-        auto end = std::chrono::high_resolution_clock::now();  // ʱ
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        std::cout << "Ⱦ! ʱ: " << duration.count() / 1000.0f << " " << std::endl;  // ʱ
+        double sec = seconds(t0);
+        benchMicro(out, "sphere_intersect", N, sec, fnv1a(&tSum, sizeof(tSum), fnv1a(&hits, sizeof(hits))));
     }
-};
-
-Scene* scene;  // ȫֳָ
-GLuint texture;  // OpenGLID
-
-// ʼóOpenGL
-void init() {
-    initPerlinNoise();  // ʼû
-    framebuffer = new unsigned char[WIDTH * HEIGHT * 3];  // ֡
-    glClearColor(0, 0, 0, 1);  // ɫ
-    glEnable(GL_TEXTURE_2D);   // 2D
-    glGenTextures(1, &texture);  // ID
-    glBindTexture(GL_TEXTURE_2D, texture);  // 
-    // ˣԲֵ
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // === ɫ ===
-    Material redMirror;
-    redMirror.color = Vector3(0.9f, 0.1f, 0.1f);  // ɫ
-    redMirror.ka = 0.05f; redMirror.kd = 0.0f; redMirror.ks = 0.9f;  // 䣬߾
-    redMirror.kr = 1.0f;  // 
-    redMirror.shininess = 100.0f;  // ߹
-    redMirror.roughness = 0.0f;  // ⻬
-    redMirror.isMetallic = false;
-    scene->spheres.push_back(new Sphere(Vector3(-1.0f, 0.4f, 0.5f), 0.4f, redMirror));  // 
+    // ԭ Vector3 ԱȣͬһߵSoAλһµĺ׼Уͬ
+    std::vector<float> ox(N), oy(N), oz(N), dx(N), dy(N), dz(N), scratch(N);
+    for (int i = 0; i < N; ++i) {
+        ox[i] = rays[i].origin.x; oy[i] = rays[i].origin.y; oz[i] = rays[i].origin.z;
+        dx[i] = rays[i].direction.x; dy[i] = rays[i].direction.y; dz[i] = rays[i].direction.z;
+    }
+    {
+        Sphere sphere(Vector3(0.2f, 1.6f, -0.1f), 0.8f, 0);
+        auto t0 = Clock::now();
+        uint64_t hits = static_cast<uint64_t>(intersectSphereSpan(sphere, ox.data(), oy.data(), oz.data(), dx.data(), dy.data(), dz.data(), scratch.data(), N));
+        double sec = seconds(t0);
+        float tSum = 0.0f;
+        for (int i = 0; i < N; ++i) if (scratch[i] >= 0.0f) tSum += scratch[i];  // ׼ͬۼ˳
+        benchMicro(out, "sphere_intersect_span", N, sec, fnv1a(&tSum, sizeof(tSum), fnv1a(&hits, sizeof(hits))));
+    }
+    // δһ㵱ʹ
+    std::vector<Vector3> vectors(N);
+    for (int i = 0; i < N; ++i) vectors[i] = rays[i].origin;
+    {
+        std::vector<Vector3> result(N);
+        auto t0 = Clock::now();
+        for (int i = 0; i < N; ++i) result[i] = vectors[i].normalize();
+        double sec = seconds(t0);
+        benchMicro(out, "vector3_normalize", N, sec, fnv1a(result.data(), result.size() * sizeof(Vector3)));
+    }
+    {
+        std::vector<float> x(ox), y(oy), z(oz);
+        auto t0 = Clock::now();
+        normalizeSpan(x.data(), y.data(), z.data(), N);
+        double sec = seconds(t0);
+        std::vector<Vector3> result(N);
+        for (int i = 0; i < N; ++i) result[i] = Vector3(x[i], y[i], z[i]);
+        benchMicro(out, "normalize_span", N, sec, fnv1a(result.data(), result.size() * sizeof(Vector3)));
+    }
+    {
+        std::vector<float> x(ox), y(oy), z(oz);
+        auto t0 = Clock::now();
+        normalizeSpanFast(x.data(), y.data(), z.data(), N);
+        double sec = seconds(t0);
+        float maxError = 0.0f;  // ƽ뾫ȷһΪУͣ׼ͬ
+        for (int i = 0; i < N; ++i) {
+            Vector3 exact = vectors[i].normalize();
+            maxError = std::max(maxError, std::max(std::fabs(x[i] - exact.x), std::max(std::fabs(y[i] - exact.y), std::fabs(z[i] - exact.z))));
+        }
+        out << "{\"kind\":\"micro\",\"name\":\"normalize_span_fast\",\"ops\":" << N << ",\"ns_per_op\":" << sec * 1e9 / N
+            << ",\"max_error\":" << maxError << "}" << std::endl;
+    }
+    {
+        float sum = 0.0f;
+        auto t0 = Clock::now();
+        for (int i = 0; i < N; ++i) scratch[i] = vectors[i].dot(rays[i].direction);
+        double sec = seconds(t0);
+        for (int i = 0; i < N; ++i) sum += scratch[i];
+        benchMicro(out, "vector3_dot", N, sec, fnv1a(&sum, sizeof(sum)));
+    }
+    {
+        float sum = 0.0f;
+        auto t0 = Clock::now();
+        dotSpan(ox.data(), oy.data(), oz.data(), dx.data(), dy.data(), dz.data(), scratch.data(), N);
+        double sec = seconds(t0);
+        for (int i = 0; i < N; ++i) sum += scratch[i];
+        benchMicro(out, "dot_span", N, sec, fnv1a(&sum, sizeof(sum)));
+    }
 
-    // === м䲣 ===
-    Material glass;
-    glass.color = Vector3(0.95f, 0.95f, 0.95f);  // ף͸
-    glass.ka = 0.0f; glass.kd = 0.0f; glass.ks = 0.1f;  // 
-    glass.kr = 0.0f;  // Fresnel
-    glass.eta = 1.5f;  // 
-    glass.isRefractive = true;
-    glass.isMetallic = false;
-    glass.roughness = 0.0f;
-    scene->spheres.push_back(new Sphere(Vector3(0.0f, 0.4f, -0.2f), 0.4f, glass));
+    sceneLayout = SCENE_STRESS;
+    imageWidth = 16;  // ֻõΣ֡ȡС
+    imageHeight = 16;
+    renderSeed = BENCH_SEED;
+    scene = new Scene();
+    initScene();
+    {
+        uint64_t hash = fnv1a(nullptr, 0);
+        auto t0 = Clock::now();
+        for (const Ray& ray : rays) {
+            HitRecord hit;
+            int id = scene->intersect(ray, 100000.0f, hit) ? hit.primID : -1;
+            hash = fnv1a(&id, sizeof(id), hash);
+        }
+        double sec = seconds(t0);
+        benchMicro(out, "bvh_closest_stress", N, sec, hash);
+    }
+    {
+        uint64_t blocked = 0;
+        auto t0 = Clock::now();
+        for (const Ray& ray : rays) blocked += scene->occluded(ray.origin, ray.direction, 1.0f);
+        double sec = seconds(t0);
+        benchMicro(out, "bvh_occluded_stress", N, sec, fnv1a(&blocked, sizeof(blocked)));
+    }
+    releaseScene();  // ûp BENCH_SEED ʼ׼Ӱ
 
-    // === Ҳƽ  ȫ͸ҫƽ===
-    Material gold;
-    gold.color = Vector3(1.0f, 0.76f, 0.33f);   // ƽɫ
-    gold.ka = 0.1f;          // 
-    gold.kd = 0.05f;         // 
-    gold.ks = 1.0f;          // ǿ߹
-    gold.kr = 0.9f;          // ǿ
-    gold.shininess = 200.0f; // ߹
-    gold.roughness = 0.2f;   // ֲڶȣģ䣩
-    gold.isRefractive = false;
-    gold.isMetallic = true;
-    gold.eta = 1.0f;
-    scene->spheres.push_back(new Sphere(Vector3(0.85f, 0.25f, 0.6f), 0.25f, gold));  // С
+    std::vector<float> xs(N), ys(N);
+    for (int i = 0; i < N; ++i) { xs[i] = unit(g) * 64.0f; ys[i] = unit(g) * 64.0f; }
+    {
+        float sum = 0.0f;
+        auto t0 = Clock::now();
+        for (int i = 0; i < N; ++i) sum += perlinNoise(xs[i], ys[i]);
+        double sec = seconds(t0);
+        benchMicro(out, "perlin_noise", N, sec, fnv1a(&sum, sizeof(sum)));
+    }
+#if SIMD_WIDTH > 1
+    {
+        int n = N - N % SIMD_WIDTH;
+        auto t0 = Clock::now();
+        for (int i = 0; i < n; i += SIMD_WIDTH) vstore(&scratch[i], perlinNoiseSIMD(vload(&xs[i]), vload(&ys[i])));
+        for (int i = n; i < N; ++i) scratch[i] = perlinNoise(xs[i], ys[i]);  // ĩβĵ
+        double sec = seconds(t0);
+        float sum = 0.0f;
+        for (int i = 0; i < N; ++i) sum += scratch[i];  // ׼ͬۼ˳
+        benchMicro(out, "perlin_noise_simd", N, sec, fnv1a(&sum, sizeof(sum)));
+    }
+#endif
 
-    // === ľ䣨䣩===
-    Material woodBox;
-    woodBox.color = Vector3(0.5f, 0.3f, 0.15f);  // ľɫǣ
-    woodBox.ka = 0.1f; woodBox.kd = 0.75f; woodBox.ks = 0.1f;  // ľʵ
-    woodBox.kr = 0.0f; woodBox.shininess = 15.0f;
-    woodBox.isMetallic = false;
-    woodBox.roughness = 0.05f;  // ΢ֲ
-    scene->boxes.push_back(new Box(Vector3(0.5f, 0, -1.3f), Vector3(1.3f, 1.0f, -0.5f), woodBox));  // λ
+    // ͨ std::pow 루ԭȵдطʽ SIMD ɫӳ + 룬УӦͬ
+    std::vector<float> radiance(N);
+    for (int i = 0; i < N; ++i) radiance[i] = (unit(g) + 1.0f) * 0.75f;  // [0, 1.5)Ҫضϵĸ߹
+    std::vector<unsigned char> encoded(N);
+    {
+        auto t0 = Clock::now();
+        for (int i = 0; i < N; ++i) encoded[i] = encodeDisplayReference(radiance[i]);
+        double sec = seconds(t0);
+        benchMicro(out, "encode_pow", N, sec, fnv1a(encoded.data(), encoded.size()));
+    }
+    {
+        std::vector<float> mapped(N);
+        auto t0 = Clock::now();
+        toneMapSpan(radiance.data(), mapped.data(), N, 1.0f);
+        for (int i = 0; i < N; ++i) encoded[i] = displayEncoder.encode(mapped[i]);
+        double sec = seconds(t0);
+        benchMicro(out, "encode_lut", N, sec, fnv1a(encoded.data(), encoded.size()));
+    }
 }
 
-// ʾص֡ȾΪȫı
-void display() {
-    glClear(GL_COLOR_BUFFER_BIT);  // 
-    glBindTexture(GL_TEXTURE_2D, texture);  // 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WIDTH, HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, framebuffer);  // 
-    glBegin(GL_QUADS);  // ȫı
-    glTexCoord2f(0, 1); glVertex2f(-1, -1);  // 
-    glTexCoord2f(1, 1); glVertex2f(1, -1);   // 
-    glTexCoord2f(1, 0); glVertex2f(1, 1);    // 
-    glTexCoord2f(0, 0); glVertex2f(-1, 1);   // 
-    glEnd();
-    glutSwapBuffers();  // ˫彻
-}
+// ׼quick ֻСãύǰð̲
+int runBenchmark() {
+    std::ofstream file;
+    if (!benchOutPath.empty()) {
+        file.open(benchOutPath);
+        if (!file) {
+            std::cerr << "޷д׼Խ: " << benchOutPath << std::endl;
+            return 1;
+        }
+    }
+    std::streambuf* coutBuf = std::cout.rdbuf();
+    std::ostream out(benchOutPath.empty() ? coutBuf : file.rdbuf());
+    NullBuffer nullBuffer;
+    std::cout.rdbuf(&nullBuffer);  // Ⱦ
 
-// ̻ص
-void keyboard(unsigned char key, int x, int y) {
-    if (key == 27) exit(0);  // ESC˳
-    if (key == ' ') {  // ոȾ
-        std::cout << "\nʼȾ..." << std::endl;
-        scene->render();
-        glutPostRedisplay();  // ˢʾ
+    int hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threadCounts = { 1 };
+    if (hw > 1) threadCounts.push_back(hw);
+    std::vector<std::pair<int, int>> sizes = { { 320, 240 } };
+    std::vector<int> sppCounts = { 1 };
+    int repeats = 1;
+    if (!benchQuick) {
+        sizes.push_back({ 800, 600 });
+        sppCounts.push_back(4);
+        repeats = BENCH_REPEATS;
     }
+    out << "{\"kind\":\"config\",\"simd_width\":" << SIMD_WIDTH << ",\"packets\":" << (usePackets ? "true" : "false")
+        << ",\"hardware_threads\":" << hw << ",\"seed\":" << BENCH_SEED << "}" << std::endl;
+
+    const int layouts[3] = { SCENE_CORNELL, SCENE_STRESS, SCENE_GLOSSY };
+    if (!benchMicroOnly) {
+        for (int layout : layouts)
+            for (const auto& size : sizes)
+                for (int spp : sppCounts)
+                    for (int threads : threadCounts)
+                        benchRender(out, layout, size.first, size.second, spp, threads, repeats);
+    }
+    benchKernels(out, benchQuick);
+
+    std::cout.rdbuf(coutBuf);
+    return 0;
 }
 
 // ʼGLUTͳ
 int main(int argc, char** argv) {
     scene = new Scene();  // 
+    if (isHeadless(argc, argv)) {
+        parseArgs(argc, argv);  // Ⱦ
+        if (gpuBackend) std::cerr << "--gpu ֻڴģʽ޽ȾʹCPU" << std::endl;
+        if (benchMode) {
+            delete scene;  // ׼Ϊÿؽ
+            return runBenchmark();
+        }
+        if (workerPort > 0) return runWorker(workerPort);  // ֻڱֹʱ˳
+        int status = runHeadless();
+        releaseScene();
+        return status;
+    }
     glutInit(&argc, argv);  // GLUTʼ
+    parseArgs(argc, argv);  // Ⱦ
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);  // ˫ + RGBA
-    glutInitWindowSize(WIDTH, HEIGHT);  // ڴС
+    glutInitWindowSize(imageWidth, imageHeight);  // ڴС
     glutCreateWindow("CPU Ray Tracer - Cornell Box with Wood Grain");  // ڱ
 
     init();  // ʼOpenGL
-    scene->render();  // ״Ⱦ
+    scene->cachePrimaryHits = true;  // ⡢ʱ߽
+    if (gpuBackend && !gpuTracer.start(*scene)) gpuBackend = false;  // ʱ˵CPU
+    if (gpuBackend) gpuTracer.restart(renderPasses > 0 ? renderPasses : 256);  //  onTimer ύ
+    else if (progressiveMode) scene->startProgressive(renderPasses > 0 ? renderPasses : 256);  // ״Ⱦ̨У
+    else scene->render();
 
     glutDisplayFunc(display);  // ʾص
     glutKeyboardFunc(keyboard);  // ̻ص
+    glutSpecialFunc(specialKey);  // ƶԴ
+    glutTimerFunc(33, onTimer, 0);  // ڼ齥ʽȾ
     glutMainLoop();  // ¼ѭ
 
     // 
-    delete[] framebuffer;
-    delete scene;
+    scene->stopProgressive();
+    framebufferUpload.release();
+    releaseScene();
     return 0;
 }
\ No newline at end of file